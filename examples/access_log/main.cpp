@@ -0,0 +1,553 @@
+// access_log.cpp
+
+#include <ulib/file.h>
+#include <ulib/utility/string_ext.h>
+#include <ulib/utility/access_log.h>
+
+#undef  PACKAGE
+#define PACKAGE "access_log"
+#undef  ARGS
+#define ARGS "FILE..."
+
+#define U_OPTIONS \
+"purpose \"query the binary structured access log of userver (APACHE_LIKE_LOG_BINARY), the rotated files (.gz) must be given in chronological order\"\n" \
+"option s status    1 \"filter for status code (ex: 404 or 4xx)\" \"\"\n" \
+"option u uri       1 \"filter for substring of the uri\" \"\"\n" \
+"option i ip        1 \"filter for IPv4 address of the client\" \"\"\n" \
+"option f from      1 \"filter for time >= (seconds since the epoch)\" \"\"\n" \
+"option t to        1 \"filter for time < (seconds since the epoch)\" \"\"\n" \
+"option a aggregate 1 \"aggregation (count and bytes) by uri|referer|agent|status|ip instead of print of the records\" \"\"\n" \
+"option n top       1 \"number of entries of the aggregation to print\" \"20\"\n" \
+"option j jobs      1 \"number of worker processes for the aggregation (0 => number of cpu)\" \"0\"\n"
+
+#include <ulib/application.h>
+
+#include <arpa/inet.h>
+#include <sys/wait.h>
+#include <ulib/internal/chttp.h>
+
+// open addressing hash table (key never null) for the dictionary of the strings and for the aggregation of the records
+
+class Table {
+public:
+
+   typedef struct slot {
+      uint64_t key, count, bytes;
+      uint32_t off, len; // string in the pool
+   } slot;
+
+   uint32_t mask, num;
+   slot* vslot;
+
+   Table() : mask(0), num(0), vslot(U_NULLPTR) { resize(1024); }
+
+   ~Table()
+      {
+      U_TRACE_NO_PARAM(5, "Table::~Table()")
+
+      U_SYSCALL_VOID(free, "%p", vslot);
+      }
+
+   slot* lookup(uint64_t key) const
+      {
+      for (uint32_t i = hash(key); vslot[i].key; i = (i+1) & mask)
+         {
+         if (vslot[i].key == key) return vslot+i;
+         }
+
+      return U_NULLPTR;
+      }
+
+   slot* find(uint64_t key) // NB: insert the key if not present...
+      {
+      uint32_t i = hash(key);
+
+      for (; vslot[i].key; i = (i+1) & mask)
+         {
+         if (vslot[i].key == key) return vslot+i;
+         }
+
+      if ((num+1) * 2 > mask)
+         {
+         resize((mask+1) * 2);
+
+         for (i = hash(key); vslot[i].key; i = (i+1) & mask) {}
+         }
+
+      ++num;
+
+      vslot[i].key = key;
+
+      return vslot+i;
+      }
+
+private:
+   uint32_t hash(uint64_t key) const { return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask; }
+
+   void resize(uint32_t n)
+      {
+      U_TRACE(5, "Table::resize(%u)", n)
+
+      slot* old  = vslot;
+      uint32_t i = mask+1;
+
+      vslot = (slot*) U_SYSCALL(calloc, "%u,%u", n, sizeof(slot));
+      mask  = n-1;
+
+      if (old)
+         {
+         while (i--)
+            {
+            if (old[i].key)
+               {
+               uint32_t j = hash(old[i].key);
+
+               while (vslot[j].key) j = (j+1) & mask;
+
+               vslot[j] = old[i];
+               }
+            }
+
+         U_SYSCALL_VOID(free, "%p", old);
+         }
+      }
+
+   U_DISALLOW_COPY_AND_ASSIGN(Table)
+};
+
+class Application : public UApplication {
+public:
+
+   Application() : ip(0), status_min(0), status_max(0xffff), top(20), akey(0), from(0), to(0xffffffffffffffffULL) {}
+
+   // the strings are copied in the pool (the data of the files are freed after the scan)
+
+   void setString(Table::slot* e, const char* s, uint32_t len)
+      {
+      U_TRACE(5, "Application::setString(%p,%.*S,%u)", e, len, s, len)
+
+      e->off = pool.size();
+      e->len = len;
+
+      (void) pool.append(s, len);
+      }
+
+   UString getString(uint64_t key)
+      {
+      U_TRACE(5, "Application::getString(%llu)", key)
+
+      const Table::slot* e = dict.lookup(key);
+
+      if (e) return pool.substr(e->off, e->len);
+
+      UString x(20U);
+
+      x.snprintf(U_CONSTANT_TO_PARAM("#%llx"), key); // NB: the definition is in a file not given...
+
+      return x;
+      }
+
+   bool match(const UAccessLog::record& r)
+      {
+      U_TRACE(5, "Application::match(%p)", &r)
+
+      if (r.status < status_min ||
+          r.status > status_max)
+         {
+         return false;
+         }
+
+      uint64_t sec = r.time / 1000000ULL;
+
+      if (sec < from ||
+          sec >= to)
+         {
+         return false;
+         }
+
+      if (ip &&
+          r.ip != ip)
+         {
+         return false;
+         }
+
+      if (uri)
+         {
+         // NB: the result of the search is cached for every uri (count: 1 => match, 2 => no match)...
+
+         Table::slot* m = vmatch.find(r.uri);
+
+         if (m->count == 0)
+            {
+            const Table::slot* e = dict.lookup(r.uri);
+
+            m->count = (e && u_find(pool.c_pointer(e->off), e->len, U_STRING_TO_PARAM(uri)) ? 1 : 2);
+            }
+
+         if (m->count != 1) return false;
+         }
+
+      return true;
+      }
+
+   void print(const UAccessLog::record& r)
+      {
+      U_TRACE(5, "Application::print(%p)", &r)
+
+      char date[64], addr[INET_ADDRSTRLEN];
+      UString u = getString(r.uri), ref = getString(r.referer), agent = getString(r.agent);
+
+      (void) u_strftime2(date, sizeof(date), U_CONSTANT_TO_PARAM("%d/%b/%Y:%T +0000"), (time_t)(r.time / 1000000ULL));
+
+      if (r.ip == 0) u__strcpy(addr, "-");
+      else           (void) inet_ntop(AF_INET, &r.ip, addr, sizeof(addr));
+
+      (void) output.reserve(u.size() + ref.size() + agent.size() + 200U);
+
+      output.snprintf_add(U_CONSTANT_TO_PARAM("%s - - [%s] \"%.*s %v"), addr, date, U_HTTP_METHOD_NUM_TO_TRACE(r.method < 26 ? r.method : 0), u.rep);
+
+           if (r.version == '2') (void) output.append(U_CONSTANT_TO_PARAM(" HTTP/2"));
+      else if (r.version != '-') output.snprintf_add(U_CONSTANT_TO_PARAM(" HTTP/1.%c"), r.version);
+
+      if (r.body_len) output.snprintf_add(U_CONSTANT_TO_PARAM("\" %u %u \"%v\" \"%v\"\n"), r.status, r.body_len, ref.rep, agent.rep);
+      else            output.snprintf_add(U_CONSTANT_TO_PARAM("\" %u - \"%v\" \"%v\"\n"),  r.status,             ref.rep, agent.rep);
+
+      if (output.size() > (64U * 1024U))
+         {
+         (void) ::write(1, U_STRING_TO_PARAM(output));
+
+         output.setEmpty();
+         }
+      }
+
+   void aggregate(const UAccessLog::record& r)
+      {
+      U_TRACE(5, "Application::aggregate(%p)", &r)
+
+      uint64_t key;
+
+      switch (akey)
+         {
+         case 'u': key = r.uri;                                break;
+         case 'r': key = r.referer;                            break;
+         case 'a': key = r.agent;                              break;
+         case 's': key = r.status | U_ACCESS_LOG_ID_MASK;      break;
+         default:  key = (uint64_t)r.ip | U_ACCESS_LOG_ID_MASK; break;
+         }
+
+      Table::slot* e = aggr.find(key);
+
+      e->count += 1;
+      e->bytes += r.body_len;
+      }
+
+   void scan(const char* name)
+      {
+      U_TRACE(5, "Application::scan(%S)", name)
+
+      UString data = UFile::contentOf(UString(name, u__strlen(name, __PRETTY_FUNCTION__)));
+
+#  ifdef USE_LIBZ
+      if (data.size() > 2 &&
+          UStringExt::isGzip(data))
+         {
+         data = UStringExt::gunzip(data);
+         }
+#  endif
+
+      char type;
+      uint32_t len;
+      const char* s;
+      UAccessLog::record r;
+      const char* ptr = data.data();
+      const char* end = data.pend();
+
+      while ((type = UAccessLog::next(ptr, end)))
+         {
+         if (type == 'S')
+            {
+            Table::slot* e = dict.find(UAccessLog::getString(s, len));
+
+            if (e->len == 0) setString(e, s, len);
+
+            continue;
+            }
+
+         UAccessLog::getRecord(r);
+
+         if (match(r) == false) continue;
+
+         if (akey) aggregate(r);
+         else      print(r);
+         }
+      }
+
+   // the result of the aggregation of a worker: key, count, bytes, len, string (if the definition is known)
+
+   void serialize(UString& buffer)
+      {
+      U_TRACE(5, "Application::serialize(%p)", &buffer)
+
+      for (uint32_t i = 0; i <= aggr.mask; ++i)
+         {
+         const Table::slot* e = aggr.vslot+i;
+
+         if (e->key)
+            {
+            const Table::slot* d = (akey == 's' || akey == 'i' ? U_NULLPTR : dict.lookup(e->key));
+            uint32_t len         = (d ? d->len : 0);
+
+            (void) buffer.append((const char*)e, sizeof(uint64_t) * 3);
+            (void) buffer.append((const char*)&len, sizeof(uint32_t));
+
+            if (len) (void) buffer.append(pool.c_pointer(d->off), len);
+            }
+         }
+      }
+
+   void merge(const UString& buffer)
+      {
+      U_TRACE(5, "Application::merge(%V)", buffer.rep)
+
+      uint32_t len;
+      uint64_t v[3];
+      const char* ptr = buffer.data();
+      const char* end = buffer.pend();
+
+      while ((end - ptr) >= (int)(sizeof(v) + sizeof(len)))
+         {
+         U_MEMCPY(v,    ptr,              sizeof(v));
+         U_MEMCPY(&len, ptr + sizeof(v), sizeof(len));
+
+         ptr += sizeof(v) + sizeof(len);
+
+         Table::slot* e = aggr.find(v[0]);
+
+         e->count += v[1];
+         e->bytes += v[2];
+
+         if (len)
+            {
+            Table::slot* d = dict.find(v[0]);
+
+            if (d->len == 0) setString(d, ptr, len);
+
+            ptr += len;
+            }
+         }
+      }
+
+   // the files are divided between the workers (fork), every worker send the result of the aggregation of its files with a pipe
+
+   void runWorkers(int argc, char* argv[], int njobs)
+      {
+      U_TRACE(5, "Application::runWorkers(%d,%p,%d)", argc, argv, njobs)
+
+      int i, w, fd[64];
+      pid_t pid[64];
+
+      for (w = 0; w < njobs; ++w)
+         {
+         int pfd[2];
+
+         if (U_SYSCALL(pipe, "%p", pfd) == -1) U_ERROR("pipe() failed");
+
+         if ((pid[w] = U_SYSCALL_NO_PARAM(fork)) == 0)
+            {
+            UString buffer(U_CAPACITY);
+
+            (void) U_SYSCALL(close, "%d", pfd[0]);
+
+            for (i = optind + w; i < argc; i += njobs) scan(argv[i]);
+
+            serialize(buffer);
+
+            const char* ptr = buffer.data();
+
+            for (uint32_t n = buffer.size(); n; )
+               {
+               ssize_t value = U_SYSCALL(write, "%d,%p,%u", pfd[1], ptr, n);
+
+               if (value <= 0) break;
+
+               ptr += value;
+               n   -= value;
+               }
+
+            U_EXIT(0);
+            }
+
+         (void) U_SYSCALL(close, "%d", pfd[1]);
+
+         fd[w] = pfd[0];
+         }
+
+      for (w = 0; w < njobs; ++w)
+         {
+         char buf[64 * 1024];
+         UString buffer(U_CAPACITY);
+
+         for (ssize_t value; (value = U_SYSCALL(read, "%d,%p,%u", fd[w], buf, sizeof(buf))) > 0; ) (void) buffer.append(buf, value);
+
+         (void) U_SYSCALL(close, "%d", fd[w]);
+         (void) U_SYSCALL(waitpid, "%d,%p,%d", pid[w], U_NULLPTR, 0);
+
+         merge(buffer);
+         }
+      }
+
+   static int cmp(const void* a, const void* b)
+      {
+      const Table::slot* x = (const Table::slot*)a;
+      const Table::slot* y = (const Table::slot*)b;
+
+      if (x->count != y->count) return (x->count < y->count ? 1 : -1);
+
+      return (x->key < y->key ? -1 : x->key > y->key); // NB: same order of the entries with the same count for any number of workers...
+      }
+
+   void printAggregation()
+      {
+      U_TRACE_NO_PARAM(5, "Application::printAggregation()")
+
+      uint32_t i, n = 0;
+      Table::slot* vec = (Table::slot*) U_SYSCALL(malloc, "%u", (aggr.num+1) * sizeof(Table::slot));
+
+      for (i = 0; i <= aggr.mask; ++i)
+         {
+         if (aggr.vslot[i].key) vec[n++] = aggr.vslot[i];
+         }
+
+      U_SYSCALL_VOID(qsort, "%p,%u,%d,%p", vec, n, sizeof(Table::slot), cmp);
+
+      if (n > top) n = top;
+
+      for (i = 0; i < n; ++i)
+         {
+         uint64_t key = vec[i].key;
+
+         if (akey == 's' ||
+             akey == 'i')
+            {
+            char addr[INET_ADDRSTRLEN];
+            uint32_t value = (uint32_t)(key & ~U_ACCESS_LOG_ID_MASK);
+
+                 if (akey == 's') (void) u__snprintf(addr, sizeof(addr), U_CONSTANT_TO_PARAM("%u"), value);
+            else if (value == 0)  u__strcpy(addr, "-");
+            else                  (void) inet_ntop(AF_INET, &value, addr, sizeof(addr));
+
+            (void) output.reserve(64U + sizeof(addr));
+
+            output.snprintf_add(U_CONSTANT_TO_PARAM("%12llu %14llu %s\n"), vec[i].count, vec[i].bytes, addr);
+
+            continue;
+            }
+
+         UString x = getString(key);
+
+         (void) output.reserve(x.size() + 64U);
+
+         output.snprintf_add(U_CONSTANT_TO_PARAM("%12llu %14llu %v\n"), vec[i].count, vec[i].bytes, x.rep);
+         }
+
+      U_SYSCALL_VOID(free, "%p", vec);
+      }
+
+   void run(int argc, char* argv[], char* env[])
+      {
+      U_TRACE(5, "Application::run(%d,%p,%p)", argc, argv, env)
+
+      UApplication::run(argc, argv, env);
+
+      // manage options
+
+      UString x;
+
+      if (UApplication::isOptions())
+         {
+         x = opt['s'];
+
+         if (x)
+            {
+            status_min =
+            status_max = x.strtoul();
+
+            if (x.size() == 3 &&
+                u_get_unalignedp16(x.c_pointer(1)) == U_MULTICHAR_CONSTANT16('x','x'))
+               {
+               status_min = (x.c_char(0) - '0') * 100;
+               status_max = status_min + 99;
+               }
+            }
+
+         uri = opt['u'];
+
+         x = opt['i'];
+
+         if (x &&
+             inet_pton(AF_INET, x.c_str(), &ip) != 1)
+            {
+            U_ERROR("invalid IPv4 address: %V", x.rep);
+            }
+
+         x = opt['f'];
+
+         if (x) from = x.strtoull();
+
+         x = opt['t'];
+
+         if (x) to = x.strtoull();
+
+         x = opt['a'];
+
+         if (x)
+            {
+                 if (x.equal(U_CONSTANT_TO_PARAM("uri")))     akey = 'u';
+            else if (x.equal(U_CONSTANT_TO_PARAM("referer"))) akey = 'r';
+            else if (x.equal(U_CONSTANT_TO_PARAM("agent")))   akey = 'a';
+            else if (x.equal(U_CONSTANT_TO_PARAM("status")))  akey = 's';
+            else if (x.equal(U_CONSTANT_TO_PARAM("ip")))      akey = 'i';
+            else U_ERROR("invalid aggregation: %V", x.rep);
+            }
+
+         x = opt['n'];
+
+         if (x) top = x.strtoul();
+         }
+
+      u_init_http_method_list();
+
+      int nfile = argc - optind;
+
+      if (nfile <= 0) U_ERROR("missing file");
+
+      // NB: the records are printed in the order of the files, the aggregation of the files can be made in parallel...
+
+      int njobs = (akey ? opt['j'].strtoul() : 1);
+
+      if (njobs <= 0) njobs = u_get_num_cpu();
+      if (njobs > 64) njobs = 64;
+
+      if (njobs > nfile) njobs = nfile;
+
+      if (njobs > 1) runWorkers(argc, argv, njobs);
+      else
+         {
+         for (int i = optind; i < argc; ++i) scan(argv[i]);
+         }
+
+      if (akey) printAggregation();
+
+      if (output) (void) ::write(1, U_STRING_TO_PARAM(output));
+      }
+
+private:
+   UString uri, pool, output;
+   Table dict, aggr, vmatch;
+   in_addr_t ip;
+   uint32_t status_min, status_max, top;
+   char akey;
+   uint64_t from, to;
+};
+
+U_MAIN
@@ -140,6 +140,9 @@ public:
       //                                                                      1 - classic, forking after accept client)
       //                                                                     >1 - pool of process serialize plus monitoring process)
       //
+      // EVENT_BACKEND  mechanism used to wait for the events on the sockets ( epoll    - readiness notification (default)
+      //                                                                       io_uring - multishot accept/recv with provided buffers and batched submission)
+      //
       // CRASH_COUNT         this is the threshold for the number of crash of child server processes
       // CRASH_EMAIL_NOTIFY  the email address to send a message whenever the number of crash > CRASH_COUNT
       // ---------------------------------------------------------------------------------------------------------------------------------------
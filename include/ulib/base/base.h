@@ -277,6 +277,19 @@ typedef struct ustringrep {
    const char* str;
 } ustringrep;
 
+/**
+ * The two high bits of references mark the representation that can be shared between threads:
+ *
+ * U_STRINGREP_SHARED   the references are counted with atomic operations (the rep can be passed between threads without copy)
+ * U_STRINGREP_IMMORTAL the rep is never freed, hold() and release() do nothing (static constant, string_rep_null, interned)
+ *
+ * NB: in both cases the rep is never unique, so the string is immutable (the method that modify it make a private copy before)...
+ */
+
+#define U_STRINGREP_SHARED   0x40000000U
+#define U_STRINGREP_IMMORTAL 0x20000000U
+#define U_STRINGREP_FLAGS    (U_STRINGREP_SHARED | U_STRINGREP_IMMORTAL)
+
 typedef struct ustring { struct ustringrep* rep; } ustring;
 
 #define U_PATH_MAX (1024U - (1 + sizeof(ustringrep)))
@@ -15,6 +15,7 @@
 #define ULIB_CACHE_H 1
 
 #include <ulib/file.h>
+#include <ulib/utility/lock.h>
 
 /**
  * @class UCache
@@ -44,6 +45,8 @@
 #define U_MAX_KEYLEN     1000U
 #define U_MAX_DATALEN 1000000U
 
+class USharedCache;
+
 class U_EXPORT UCache {
 public:
 
@@ -268,9 +271,115 @@ protected:
    char* add(const char* key, uint32_t keylen, uint32_t datalen, uint32_t ttl);
 
 private:
+   void init(char* ptr, uint32_t size, bool bexist) U_NO_EXPORT;
    void init(UFile& _x, uint32_t size, bool bexist, bool brdonly) U_NO_EXPORT;
 
    U_DISALLOW_COPY_AND_ASSIGN(UCache)
+
+   friend class USharedCache;
+};
+
+/**
+ * @class USharedCache
+ *
+ * @brief USharedCache is a fixed-size cache split in independent shards, to share between preforked processes.
+ *
+ * The hash of the key selects the shard, every shard is a UCache (with its own hash table and circular space) protected by its own
+ * process-shared lock, so the lookups and the inserts of the workers on different shards don't serialize on a single writer pointer.
+ * +-------------+------------------------+-----+--------------------------+
+ * | header (64) | lock (64) | UCache 0   | ... | lock (64) | UCache n-1   |
+ * +-------------+------------------------+-----+--------------------------+
+ * NB: the cache must be opened before the fork() of the workers. get() return a copy of the data, because after the unlock the space of
+ *     the entry can be reused by another process...
+ */
+
+#define U_SHARED_CACHE_ALIGN     64U // NB: every lock on its own cache line...
+#define U_SHARED_CACHE_MAX_SHARD 256U
+
+class U_EXPORT USharedCache {
+public:
+
+   // Check for memory error
+   U_MEMORY_TEST
+
+   // Allocator e Deallocator
+   U_MEMORY_ALLOCATOR
+   U_MEMORY_DEALLOCATOR
+
+   USharedCache()
+      {
+      U_TRACE_CTOR(0, USharedCache, "")
+
+      fd     = -1;
+      nshard = 0;
+      map    = U_NULLPTR;
+      lock   = U_NULLPTR;
+      shard  = U_NULLPTR;
+      }
+
+   ~USharedCache();
+
+   // OPEN/CREAT a cache file (nshard is rounded to a power of 2)
+
+   bool open(const UString& path, uint32_t size, uint32_t nshard = 16, const UString* environment = U_NULLPTR, bool btemp = false);
+
+   // OPERATION
+
+   void add(       const UString& key, const UString& data,    uint32_t _ttl = 0);
+   void addContent(const UString& key, const UString& content, uint32_t _ttl = 0); // NB: +null terminator...
+
+   UString get(       const char* key, uint32_t len);
+   UString getContent(const char* key, uint32_t len); // NB: -null terminator...
+
+   UString get(       const UString& key) { return get(       U_STRING_TO_PARAM(key)); }
+   UString getContent(const UString& key) { return getContent(U_STRING_TO_PARAM(key)); }
+
+   // operator []
+
+   UString operator[](const UString& key) { return getContent(key); }
+
+   // SERVICES
+
+   uint32_t getNumShard() const
+      {
+      U_TRACE_NO_PARAM(0, "USharedCache::getNumShard()")
+
+      U_RETURN(nshard);
+      }
+
+   uint32_t getShard(const char* key, uint32_t keylen) const
+      {
+      U_TRACE(0, "USharedCache::getShard(%.*S,%u)", keylen, key, keylen)
+
+      U_INTERNAL_ASSERT_MAJOR(nshard, 0)
+
+      // NB: UCache::hash() use the low bits of the same hash to select the bucket, so we use the high bits...
+
+      uint32_t n = (u_cdb_hash((unsigned char*)key, keylen, -1) >> 24) & (nshard - 1);
+
+      U_RETURN(n);
+      }
+
+   // DEBUG
+
+#if defined(U_STDCPP_ENABLE) && defined(DEBUG)
+   const char* dump(bool reset) const;
+#endif
+
+protected:
+   typedef struct shared_cache_info {
+      uint32_t nshard; // number of shards
+      uint32_t ssize;  // size of every shard (lock included)
+      } shared_cache_info;
+
+   int fd;
+   char* map;
+   ULock* lock;
+   UCache* shard;
+   uint32_t nshard, map_size;
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(USharedCache)
 };
 
 #endif
@@ -75,7 +75,8 @@ template <> inline void u_construct(const UStringRep* rep, uint32_t n)
    U_TRACE(0, "u_construct<UStringRep*>(%p,%u)", rep, n)
 
 #ifndef U_COVERITY_FALSE_POSITIVE // coverity[RESOURCE_LEAK]
-   ((UStringRep*)rep)->references += n;
+   if (rep->references < U_STRINGREP_IMMORTAL) ((UStringRep*)rep)->references += n;
+   else if ((rep->references & U_STRINGREP_IMMORTAL) == 0) (void) __sync_add_and_fetch(&(((UStringRep*)rep)->references), n);
 
    U_INTERNAL_DUMP("references = %d", rep->references + 1)
 #endif
@@ -150,6 +150,8 @@ public:
       {
       U_TRACE_NO_PARAM(0, "UCDB::elem()")
 
+      if (data.dsize == 0) return UString::getStringNull(); // NB: the data can be empty...
+
       UString str((const char*)data.dptr, data.dsize);
 
       U_RETURN_STRING(str);
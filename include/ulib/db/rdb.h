@@ -34,6 +34,12 @@
  * Then provide an abstraction layer that looks like ndbm and writes updates to the journal.
  * Read operations are answered by consulting the cache (build with journal) and the cdb file.
  * The result should be a reasonably small yet crash-proof read-write database
+ *
+ * startReorganize() combines the cdb file and the journal in a new cdb file without stop the database: the journal is frozen
+ * (renamed in <db>.jnl.old) and the writes go on a new journal, a thread builds the new cdb from the old cdb and the frozen
+ * journal (that don't change anymore) while the lookup search the new journal, the frozen journal and the old cdb. When the
+ * new cdb is ready it substitutes the old one at the next lock() of the database and the frozen journal is removed (if the
+ * process die before, open() finds the frozen journal and complete the work)
  */
 
 class URDBServer;
@@ -43,10 +49,14 @@ class UServer_Base;
 class UDataStorage;
 class URDBClient_Base;
 class URDBClientImage;
+class URDBReorganize;
 
 // The interface is very similar to the gdbm one
 
-#  define CACHE_HASHTAB_LEN 769
+#  define CACHE_HASHTAB_LEN  769 // initial number of slot of the hash table of the journal (it grows with the number of record)
+#  define CACHE_HASHTAB_LOAD 2   // average number of record for slot over that the hash table grows
+
+#  define CACHE_JOURNAL_VERSION 2 // format of the journal (1 => hash table of fixed size in the header, node without hash)
 
 #  define RDB_off(prdb)      ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->off
 #  define RDB_capacity(prdb) (uint32_t)(((URDB*)prdb)->journal.st_size - RDB_off(prdb))
@@ -56,7 +66,10 @@ class URDBClientImage;
 #  define RDB_sync(prdb)      ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->sync
 #  define RDB_nrecord(prdb)   ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->nrecord
 #  define RDB_reference(prdb) ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->reference
-#  define RDB_hashtab(prdb)  (((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->hashtab)
+#  define RDB_version(prdb)   ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->version
+#  define RDB_hashtab_len(prdb) ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->hashtab_len
+#  define RDB_hashtab_off(prdb) ((URDB::cache_struct*)(((URDB*)prdb)->journal.map))->hashtab_off
+#  define RDB_hashtab(prdb)     ((uint32_t*)(((URDB*)prdb)->journal.map+RDB_hashtab_off(prdb)))
 
 #  define RDB_ptr(prdb)      (((URDB*)prdb)->journal.map+sizeof(URDB::cache_struct))
 #  define RDB_start(prdb)    (RDB_ptr(prdb)-(CACHE_HASHTAB_LEN*sizeof(uint32_t)))
@@ -84,6 +97,9 @@ public:
       pnode = U_NULLPTR;
        node = 0;
 
+      psnapshot   = U_NULLPTR;
+      preorganize = U_NULLPTR;
+
       key1.dptr  = U_NULLPTR;
       key1.dsize = 0;
       }
@@ -96,6 +112,9 @@ public:
       pnode = U_NULLPTR;
        node = 0;
 
+      psnapshot   = U_NULLPTR;
+      preorganize = U_NULLPTR;
+
       key1.dptr  = U_NULLPTR;
       key1.dsize = 0;
       }
@@ -135,7 +154,7 @@ public:
 
       U_INTERNAL_DUMP("UCDB::nrecord = %u RDB_nrecord = %u", UCDB::nrecord, RDB_nrecord(this))
 
-      U_RETURN(UCDB::nrecord + RDB_nrecord(this));
+      U_RETURN(UCDB::nrecord + RDB_nrecord(this) + (psnapshot ? RDB_nrecord(psnapshot) : 0));
       }
 
    // Close a Reliable DataBase
@@ -147,6 +166,12 @@ public:
 
    bool closeReorganize();
 
+   // Combines the old cdb file and the diffs in a new cdb file in background (without lock the database for all the time)
+
+   bool startReorganize();
+
+   bool isReorganizing() const { return (psnapshot != U_NULLPTR); }
+
    // ---------------------------------------------------------------------
    // Write a key/value pair to a reliable database
    // ---------------------------------------------------------------------
@@ -219,6 +244,20 @@ public:
       return substitute(&key2, _flag);
       }
 
+   // ---------------------------------------------------------------------------------------------------------------------
+   // BATCH: the operations on all the entries of the vector are done with only one lock of the database
+   // ---------------------------------------------------------------------------------------------------------------------
+   // findBatch()   => vdata[i] is the data of vkey[i] (empty if not found), vresult[i] is 0 if found and -1 if not found
+   //                  (the data can be empty), return the number of keys found
+   // storeBatch()  => vkey_data is key0,data0,key1,data1,..., vresult[i] is the result of store() for the pair i,
+   //                  return the number of pair stored
+   // removeBatch() => vresult[i] is the result of remove() for vkey[i], return the number of keys removed
+   // ---------------------------------------------------------------------------------------------------------------------
+
+   uint32_t  findBatch(UVector<UString>& vkey, UVector<UString>& vdata, int* vresult = U_NULLPTR);
+   uint32_t storeBatch(UVector<UString>& vkey_data, int _flag, int* vresult = U_NULLPTR);
+   uint32_t removeBatch(UVector<UString>& vkey,             int* vresult = U_NULLPTR);
+
    bool fetch();
    bool find(const char* key, uint32_t keylen);
 
@@ -281,7 +320,7 @@ public:
 
    static void initRecordLock();
 
-   void   lock() { if (_lock.sem) _lock.lock(); }
+   void   lock() { if (_lock.sem) _lock.lock(); if (preorganize) checkReorganize(); }
    void unlock() { if (_lock.sem) _lock.unlock(); }
 
    // TRANSACTION
@@ -335,9 +374,17 @@ protected:
       uint32_t dptr, dsize;
    } rdb_datum;
 
+   // ----------------------------------------------------------------------------------------------------------------
+   // The hash table start in the header with CACHE_HASHTAB_LEN slot, when the average number of record for slot is over
+   // CACHE_HASHTAB_LOAD we allocate in the journal a table with the double of the slot and we relink on it the nodes of the
+   // hash trees (by the hash saved in the node, so also the key with a hash set by the caller). The space of the old table
+   // is recovered by reorganize() or compactionJournal()...
+   // ----------------------------------------------------------------------------------------------------------------
+
    typedef struct rdb_cache_node {
       rdb_datum key, data;
       uint32_t left, right; // Two cache_node 'pointer' of the binary search tree behind every entry of the hash table
+      uint32_t hash;        // hash of the key (for relink the node when the hash table grows)
    } cache_node;
 
    typedef struct rdb_cache_struct {
@@ -345,7 +392,10 @@ protected:
       uint32_t sync;                       // RDB_sync
       uint32_t nrecord;                    // RDB_nrecord
       uint32_t reference;                  // RDB_reference
-      uint32_t hashtab[CACHE_HASHTAB_LEN]; // RDB_hashtab
+      uint32_t version;                    // RDB_version (CACHE_JOURNAL_VERSION, NB: in the format 1 here start the hash table...)
+      uint32_t hashtab_len;                // RDB_hashtab_len (number of slot of the hash table)
+      uint32_t hashtab_off;                // RDB_hashtab_off (offset of the hash table)
+      uint32_t hashtab[CACHE_HASHTAB_LEN]; // initial hash table
       // -----> data storage...            // RDB_ptr
    } cache_struct;
 
@@ -354,6 +404,7 @@ protected:
    UString at();
 
    int  remove();
+   int _remove();
    bool _fetch();
    bool isDeleted();
    bool reorganize(); // Combines the old cdb file and the diffs in a new cdb file
@@ -379,6 +430,8 @@ protected:
 
       U_CHECK_MEMORY
 
+      if (psnapshot) return snapshotLookup(); // NB: before the old cdb we must search in the frozen journal...
+
       if (UFile::st_size &&
           UCDB::find())
          {
@@ -401,9 +454,14 @@ private:
    uint32_t* pnode;
    uint32_t   node; // RDB_node
    UCDB::datum key1;
+   URDB* psnapshot;             // frozen journal (background reorganize)
+   URDBReorganize* preorganize; // thread that build the new cdb (background reorganize)
 
    static uint32_t nerror;
 
+   void checkReorganize();
+   bool snapshotLookup();
+
    inline void setNodeLeft() U_NO_EXPORT;
    inline void setNodeRight() U_NO_EXPORT;
 
@@ -411,15 +469,24 @@ private:
    void call1(UCDB* pcdb, uint32_t offset) U_NO_EXPORT;
    void print1(UCDB* pcdb, uint32_t offset) U_NO_EXPORT;
    void getKeys1(UCDB* pcdb, uint32_t offset) U_NO_EXPORT;
+   void relink1(uint32_t* tab, uint32_t len, uint32_t offset) U_NO_EXPORT;
    void makeAdd1(UCDB* pcdb, uint32_t offset) U_NO_EXPORT;
 
    bool logJournal(int op) U_NO_EXPORT;
+   bool newJournal(uint32_t sz) U_NO_EXPORT;
+   void endReorganize() U_NO_EXPORT;
+   void deleteSnapshot() U_NO_EXPORT;
+   uint32_t makeCdb(UCDB* pcdb) U_NO_EXPORT;
+   bool beginReorganize(bool bfreeze) U_NO_EXPORT;
    bool resizeJournal(uint32_t oversize) U_NO_EXPORT;
    void call(UCDB* pcdb, vPFpvu function1, vPFpvpc function2) U_NO_EXPORT;
    void callForEntryNotInCache(UCDB* pcdb, vPFpvpc function2) U_NO_EXPORT;
    bool writev(const struct iovec* iov, int n, uint32_t size) U_NO_EXPORT;
 
+   static void htInit(URDB* prdb) U_NO_EXPORT;        // Initialize the hash table in the header
+   static bool checkVersion(const char* path, uint32_t version) U_NO_EXPORT; // Check the format of the journal
    static void htAlloc(URDB* prdb) U_NO_EXPORT;       // Alloc one node for the hash tree
+   static void htGrow(URDB* prdb, uint32_t len) U_NO_EXPORT; // Alloc a new hash table with len slot and relink the nodes on it
    static bool htLookup(URDB* prdb) U_NO_EXPORT;      // Search one key/data pair in the cache
    static void htInsert(URDB* prdb) U_NO_EXPORT;      // Insert one key/data pair in the cache
    static void htRemoveAlloc(URDB* prdb) U_NO_EXPORT; // remove one node allocated for the hash tree
@@ -433,6 +500,7 @@ private:
    friend class UServer_Base;
    friend class URDBClient_Base;
    friend class URDBClientImage;
+   friend class URDBReorganize;
 
    template <class T> friend class URDBObjectHandler;
 };
@@ -128,6 +128,7 @@ public:
 
 protected:
    long tolerance;
+   UTimer* ptimer; // NB: the entry of UTimer while the alarm is scheduled...
 
    static long diff1, diff2;
    static struct timeval  timeout1;
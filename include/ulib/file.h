@@ -58,6 +58,7 @@ class URDB;
 class UHTTP;
 class UCache;
 class UDirWalk;
+class USharedCache;
 class UStringExt;
 class UClientImage_Base;
 
@@ -1366,6 +1367,7 @@ private:
    friend class UStringRep;
    friend class UStringExt;
    friend class UMemoryPool;
+   friend class USharedCache;
    friend class UClientImage_Base;
 
    template <class T> friend class URDBObjectHandler;
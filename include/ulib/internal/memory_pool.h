@@ -463,6 +463,10 @@ public:
 
    static void allocateMemoryBlocks(const char* list);
    static void* pmalloc(uint32_t* pnum, uint32_t type_size = sizeof(char), bool bzero = false);
+
+# if defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+   static bool bthread; // NB: set before the creation of the first thread, from then on every thread allocate from its magazines...
+# endif
 #else
    static void* pop(int stack_index)
       {
@@ -579,6 +583,118 @@ private:
    template <class T> friend class UVector;
 };
 
+/**
+ * Arena (bump allocator) scoped to one request of UClientImage_Base
+ *
+ * Inside a scope (enter()/leave()) the short-lived objects of the request (UStringRep and its data) are carved out of a chain of chunks,
+ * the release of the object only decrements the count of the objects alive and at the end of the request (UClientImage_Base::endRequest())
+ * the arena is rewound in bulk. It is opt-in (REQUEST_ARENA_SIZE) and the scope must be used only for data that don't outlive the request...
+ *
+ * NB: if some object of the arena is still alive at the end of the request the rewind is postponed, so a missing release cost only memory,
+ *     but no more than U_ARENA_MAX_CHUNK chunks: over the cap the scope is refused and the objects are allocated from the pool as usual...
+ *
+ * NB: the arena is process-wide, it is not enabled with the server thread approach (PREFORK_CHILD == -1)...
+ */
+
+#define U_ARENA_MAX_CHUNK 16
+
+class U_EXPORT UMemoryArena {
+public:
+
+   static void init(uint32_t size);
+   static void clear();
+   static void reset();
+
+   static void* allocate(uint32_t sz)
+      {
+      U_TRACE(0, "UMemoryArena::allocate(%u)", sz)
+
+      U_INTERNAL_ASSERT(bscope)
+      U_INTERNAL_ASSERT_POINTER(current)
+
+      sz = (sz + 7) & ~7;
+
+      if ((ptr + sz) > current->end) grow(sz); // NB: over the cap it leave the scope after this allocation...
+
+      void* result = ptr;
+
+      ptr += sz;
+
+      ++live;
+
+      U_RETURN(result);
+      }
+
+   static bool contains(const void* p)
+      {
+      U_TRACE(0, "UMemoryArena::contains(%p)", p)
+
+      if ((const char*)p <  lo ||
+          (const char*)p >= hi) // NB: fast path for the pointers out of the range of the chunks...
+         {
+         U_RETURN(false);
+         }
+
+      for (uarena* c = first; c; c = c->next)
+         {
+         if ((const char*)p >= (const char*)(c+1) &&
+             (const char*)p <  c->end)
+            {
+            U_RETURN(true);
+            }
+         }
+
+      U_RETURN(false);
+      }
+
+   static void release(const void* p) // NB: the pointer must be in the arena (see contains())...
+      {
+      U_TRACE(0, "UMemoryArena::release(%p)", p)
+
+      U_INTERNAL_ASSERT(contains(p))
+      U_INTERNAL_ASSERT_MAJOR(live, 0)
+
+      --live;
+      }
+
+   static bool isScope() { return bscope; }
+
+   static void enter() { bscope = (first != U_NULLPTR && total < max_size); }
+   static void leave() { bscope = false; }
+
+protected:
+   typedef struct uarena {
+      struct uarena* next;
+      char* end;
+      uint32_t size;
+      // ----------------> chunk data...
+   } uarena;
+
+   static uarena* first;
+   static uarena* current;
+   static char* ptr, *lo, *hi;
+   static uint32_t chunk_size, live, total, max_size;
+   static bool bscope;
+
+   static void range(uarena* c)
+      {
+      U_TRACE(0, "UMemoryArena::range(%p)", c)
+
+      if (lo == U_NULLPTR ||
+          lo > (char*)c)
+         {
+         lo = (char*)c;
+         }
+
+      if (hi < c->end) hi = c->end;
+      }
+
+   static void grow(uint32_t sz);
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(UMemoryArena)
+};
+
 #ifdef DEBUG
 template <class T> bool u_check_memory_vector(T* _vec, uint32_t n)
 {
@@ -0,0 +1,395 @@
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    codec.h - object <=> JSON representation generated at compile time from the list of the fields
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
+
+#ifndef ULIB_JSON_CODEC_H
+#define ULIB_JSON_CODEC_H 1
+
+#include <ulib/json/value.h>
+
+/**
+ * JSON_parse() and JSON_stringify() need for every class the methods fromJSON(), toJSON() and toJSON(UString&) that call for
+ * every member the UJsonTypeHandler<T> of the type, JSON_parse() builds first the tree of UValue and then search in the tree
+ * every member, JSON_stringify() builds first the tree of UValue and then stringify it. With this codec a class declares its
+ * fields only once, in a template method visitJSON(), and the compiler generates from it the code of JSON_encode() and
+ * JSON_decode() for the class:
+ *
+ * - JSON_encode() writes the document straight in the UString (the name of the fields, with the quotes and the colon, are
+ *   constants of the program so they are copied with a memcpy() of known size)
+ * - JSON_decode() reads the document straight in the fields, without the tree of UValue: the value of every key is parsed by
+ *   the code for the type of the field with the same name (the key without a field are skipped, the field without a key keep
+ *   their value, the strings without escape sequence are substrings of the document like with UValue::parse())
+ *
+ * The value of a field can be a bool, an integer, a float, a UString, a UVector<UString>, a UVector<T*> or an object with
+ * the method visitJSON(). Ex:
+ *
+ * class Person {
+ * public:
+ *    int age;
+ *    UString lastName, firstName;
+ *    UVector<Person*> children;
+ *
+ *    template <class V> void visitJSON(V& v)
+ *       {
+ *       U_JSON_FIELD(v, age);
+ *       U_JSON_FIELD(v, lastName);
+ *       U_JSON_FIELD(v, firstName);
+ *       U_JSON_FIELD(v, children);
+ *       }
+ * };
+ *
+ * Person person;
+ *
+ * if (JSON_decode(json, person)) JSON_encode(output, person);
+ */
+
+#define U_JSON_FIELD(visitor, member) visitor("\"" #member "\":", U_CONSTANT_SIZE("\"" #member "\":"), member)
+
+class U_EXPORT UJsonCodec {
+public:
+
+   // cursor on the document to decode
+
+   class Parser {
+   public:
+
+      explicit Parser(const UString& _json) : json(_json), ptr(_json.data()), end(_json.pend()) {}
+
+      bool skipSpace() // NB: return false at the end of the document...
+         {
+         while (ptr < end && u__isspace(*ptr)) ++ptr;
+
+         return (ptr < end);
+         }
+
+      bool expect(char c)
+         {
+         if (skipSpace() &&
+             *ptr == c)
+            {
+            ++ptr;
+
+            return true;
+            }
+
+         return false;
+         }
+
+      const UString& json;
+      const char* ptr;
+      const char* end;
+
+   private:
+      U_DISALLOW_COPY_AND_ASSIGN(Parser)
+   };
+
+   // ENCODE
+
+   static void push(UString& json, char c)
+      {
+      (void) json.reserve(1U);
+
+      char* ptr = json.pend();
+
+      *ptr = c;
+
+      json.size_adjust(ptr+1);
+      }
+
+   static void write(UString& json, bool value)
+      {
+      U_TRACE(0, "UJsonCodec::write(%V,%b)", json.rep, value)
+
+      (void) json.reserve(5U);
+
+      char* ptr = json.pend();
+
+      u_put_unalignedp32(ptr, value ? U_MULTICHAR_CONSTANT32('t','r','u','e') : U_MULTICHAR_CONSTANT32('f','a','l','s'));
+
+      if (value == false) ptr[4] = 'e';
+
+      json.size_adjust(ptr + 5 - value);
+      }
+
+   static void write(UString& json, int value)                { (void) json.reserve(12U); json.appendNumber32s(value); }
+   static void write(UString& json, unsigned int value)       { (void) json.reserve(12U); json.appendNumber32(value); }
+   static void write(UString& json, short value)              { write(json, (int)value); }
+   static void write(UString& json, unsigned short value)     { write(json, (unsigned int)value); }
+   static void write(UString& json, long value)               { (void) json.reserve(22U); json.appendNumber64s(value); }
+   static void write(UString& json, unsigned long value)      { (void) json.reserve(22U); json.appendNumber64(value); }
+   static void write(UString& json, long long value)          { (void) json.reserve(22U); json.appendNumber64s(value); }
+   static void write(UString& json, unsigned long long value) { (void) json.reserve(22U); json.appendNumber64(value); }
+   static void write(UString& json, double value)             { (void) json.reserve(32U); json.appendNumberDouble(value); }
+   static void write(UString& json, float value)              { write(json, (double)value); }
+
+   static void write(UString& json, const UString& value) { writeString(json, U_STRING_TO_PARAM(value)); }
+   static void write(UString& json, const UVector<UString>& vec);
+
+   template <class T> static void write(UString& json, const UVector<T*>& v)
+      {
+      U_TRACE(0, "UJsonCodec::write<UVector<T*>>(%V,%p)", json.rep, &v)
+
+      push(json, '[');
+
+      for (uint32_t i = 0, n = v.size(); i < n; ++i)
+         {
+         if (i) push(json, ',');
+
+         write(json, *(v[i]));
+         }
+
+      push(json, ']');
+      }
+
+   template <class T> static void write(UString& json, const T& obj)
+      {
+      U_TRACE(0, "UJsonCodec::write<T>(%V,%p)", json.rep, &obj)
+
+      Writer w(json);
+
+      push(json, '{');
+
+      ((T&)obj).visitJSON(w);
+
+      if (json.last_char() == ',') json.setLastChar('}');
+      else                         push(json, '}');
+      }
+
+   static void writeString(UString& json, const char* s, uint32_t len);
+
+   // DECODE
+
+   static bool read(Parser& p, bool& value);
+   static bool read(Parser& p, UString& value);
+   static bool read(Parser& p, UVector<UString>& vec);
+
+   static bool read(Parser& p, int& value)                { return readNumber(p, value); }
+   static bool read(Parser& p, unsigned int& value)       { return readNumber(p, value); }
+   static bool read(Parser& p, short& value)              { return readNumber(p, value); }
+   static bool read(Parser& p, unsigned short& value)     { return readNumber(p, value); }
+   static bool read(Parser& p, long& value)               { return readNumber(p, value); }
+   static bool read(Parser& p, unsigned long& value)      { return readNumber(p, value); }
+   static bool read(Parser& p, long long& value)          { return readNumber(p, value); }
+   static bool read(Parser& p, unsigned long long& value) { return readNumber(p, value); }
+   static bool read(Parser& p, double& value)             { return readNumber(p, value); }
+   static bool read(Parser& p, float& value)              { return readNumber(p, value); }
+
+   template <class T> static bool read(Parser& p, UVector<T*>& v)
+      {
+      U_TRACE(0, "UJsonCodec::read<UVector<T*>>(%p,%p)", &p, &v)
+
+      if (p.expect('[') == false) U_RETURN(false);
+
+      if (p.expect(']')) U_RETURN(true);
+
+      do {
+         T* pitem;
+
+         U_NEW_WITHOUT_CHECK_MEMORY(T, pitem, T);
+
+         v.push_back(pitem);
+
+         if (read(p, *pitem) == false) U_RETURN(false);
+         }
+      while (p.expect(','));
+
+      if (p.expect(']')) U_RETURN(true);
+
+      U_RETURN(false);
+      }
+
+   template <class T> static bool read(Parser& p, T& obj)
+      {
+      U_TRACE(0, "UJsonCodec::read<T>(%p,%p)", &p, &obj)
+
+      if (p.expect('{') == false) U_RETURN(false);
+
+      if (p.expect('}')) U_RETURN(true);
+
+      Matcher m(p);
+
+      do {
+         if (readKey(p, m.key, m.key_len) == false) U_RETURN(false);
+
+         m.bfound = false;
+
+         obj.visitJSON(m);
+
+         if (m.bfound)
+            {
+            if (m.bok == false) U_RETURN(false);
+            }
+         else
+            {
+            if (skipValue(p) == false) U_RETURN(false); // NB: the key without a field...
+            }
+         }
+      while (p.expect(','));
+
+      if (p.expect('}')) U_RETURN(true);
+
+      U_RETURN(false);
+      }
+
+   static bool skipValue(Parser& p);
+   static bool readKey(Parser& p, const char*& key, uint32_t& len); // NB: read also the colon...
+   static const char* scanNumber(Parser& p, uint32_t& len, bool& breal);
+
+   // the visitor of the fields for encode and decode
+
+   class Writer {
+   public:
+
+      explicit Writer(UString& _json) : json(_json) {}
+
+      template <class T> void operator()(const char* name, uint32_t len, const T& value)
+         {
+         U_TRACE(0, "UJsonCodec::Writer::operator()(%.*S,%u,%p)", len, name, len, &value)
+
+         (void) json.reserve(len);
+
+         char* ptr = json.pend();
+
+         U_MEMCPY(ptr, name, len);
+
+         json.size_adjust(ptr + len);
+
+         UJsonCodec::write(json, value);
+
+         UJsonCodec::push(json, ',');
+         }
+
+   private:
+      UString& json;
+
+      U_DISALLOW_COPY_AND_ASSIGN(Writer)
+   };
+
+   class Matcher {
+   public:
+
+      explicit Matcher(Parser& _p) : p(_p), key(U_NULLPTR), key_len(0), bfound(false), bok(true) {}
+
+      template <class T> void operator()(const char* name, uint32_t len, T& value)
+         {
+         U_TRACE(0, "UJsonCodec::Matcher::operator()(%.*S,%u,%p)", len, name, len, &value)
+
+         // NB: name is "\"<field>\":"...
+
+         if (bfound == false &&
+             key_len == len-3 &&
+             memcmp(key, name+1, key_len) == 0)
+            {
+            bfound = true;
+            bok    = UJsonCodec::read(p, value);
+            }
+         }
+
+      Parser& p;
+      const char* key;
+      uint32_t key_len;
+      bool bfound, bok;
+
+   private:
+      U_DISALLOW_COPY_AND_ASSIGN(Matcher)
+   };
+
+protected:
+   static double toReal(const char* s, uint32_t len);
+   static bool isInteger64(const char* s, uint32_t len) __pure; // NB: check that the integer is in the range of 64 bit...
+
+   template <typename T> static bool readNumber(Parser& p, T& value)
+      {
+      U_TRACE(0, "UJsonCodec::readNumber<T>(%p,%p)", &p, &value)
+
+      bool breal;
+      uint32_t len;
+      const char* s = scanNumber(p, len, breal);
+
+      if (s == U_NULLPTR) U_RETURN(false);
+
+      if constexpr (std::is_integral_v<T>)
+         {
+         // NB: the cast to the type of the field of a number out of its range is undefined (or truncate the number)...
+
+         if (breal)
+            {
+            double real = toReal(s, len);
+
+            if (real <  (double)std::numeric_limits<T>::min() ||
+                real >= (double)std::numeric_limits<T>::max() + 1.0)
+               {
+               U_RETURN(false);
+               }
+
+            value = (T)real;
+
+            U_RETURN(true);
+            }
+
+         if (isInteger64(s, len) == false) U_RETURN(false);
+
+         if (*s == '-')
+            {
+            int64_t ival = u_strtoll(s, s+len);
+
+            if (ival < (int64_t)std::numeric_limits<T>::min()) U_RETURN(false);
+
+            value = (T)ival;
+            }
+         else
+            {
+            uint64_t uval = u_strtoull(s, s+len);
+
+            if (uval > (uint64_t)std::numeric_limits<T>::max()) U_RETURN(false);
+
+            value = (T)uval;
+            }
+
+         U_RETURN(true);
+         }
+
+           if (breal)     value = (T)toReal(s, len);
+      else if (*s == '-') value = (T)u_strtoll(s, s+len);
+      else                value = (T)u_strtoull(s, s+len);
+
+      U_RETURN(true);
+      }
+};
+
+// manage object <=> JSON representation
+
+template <class T> void JSON_encode(UString& json, const T& obj)
+{
+   U_TRACE(0, "JSON_encode(%V,%p)", json.rep, &obj)
+
+   UJsonCodec::write(json, obj);
+
+   U_INTERNAL_DUMP("json(%u) = %V", json.size(), json.rep)
+}
+
+template <class T> bool JSON_decode(const UString& json, T& obj)
+{
+   U_TRACE(0, "JSON_decode(%V,%p)", json.rep, &obj)
+
+   UJsonCodec::Parser p(json);
+
+   if (UJsonCodec::read(p, obj) &&
+       p.skipSpace() == false)
+      {
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+
+#endif
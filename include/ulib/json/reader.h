@@ -0,0 +1,168 @@
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    reader.h - incremental (pull) reader of a JSON (JavaScript Object Notation) document
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
+
+#ifndef ULIB_JSON_READER_H
+#define ULIB_JSON_READER_H 1
+
+#include <ulib/json/value.h>
+
+/**
+ * \brief Incremental (pull) reader of a <a HREF="http://www.json.org">JSON</a> document.
+ *
+ * UValue::parse() needs the whole document in memory and builds the tree of values. UJsonReader instead accepts the document
+ * chunk by chunk (for example the data of the read buffer of a socket) with feed() and returns with next() one event at a time
+ * (START_OBJECT, KEY, STRING, ...). When the data of a chunk are not enough to complete the current token next() returns
+ * NEED_MORE and the reader resume from the same point at the next feed(). The data already consumed are dropped from the
+ * internal buffer, so the memory used is bounded by the size of the biggest token (and not by the size of the document).
+ * A subtree of no interest can be skipped with skip(): the data of the subtree are consumed (also across the chunks) without
+ * returning the events...
+ *
+ * Ex:
+ *
+ * UJsonReader reader;
+ *
+ * while (read(chunk))
+ *    {
+ *    reader.feed(chunk);
+ *
+ *    while ((event = reader.next()) > UJsonReader::INVALID)
+ *       {
+ *       if (event == UJsonReader::KEY &&
+ *           reader.getString() != U_STRING_FROM_CONSTANT("hits"))
+ *          {
+ *          reader.skip();
+ *          }
+ *       ...
+ *       }
+ *
+ *    if (event == UJsonReader::INVALID) break;
+ *    }
+ *
+ * NB: the pointer returned by getData() is valid only until the next call to next() or feed(). The data after the end of the
+ *     document are ignored (END_DOCUMENT is returned as soon as the top level value is complete)...
+ */
+
+#ifndef U_JSON_READER_STACK_SIZE
+#define U_JSON_READER_STACK_SIZE 64 // initial size of the stack of the nesting level (it grows with the depth of the document)
+#endif
+
+class U_EXPORT UJsonReader {
+public:
+
+   // Check for memory error
+   U_MEMORY_TEST
+
+   // Allocator e Deallocator
+   U_MEMORY_ALLOCATOR
+   U_MEMORY_DEALLOCATOR
+
+   enum Event {
+      NEED_MORE    =  0, // the data are not enough to complete the current token (call feed() or finish())
+      END_DOCUMENT =  1, // the document is complete
+      INVALID      =  2, // the document is not valid JSON (NB: ERROR is a macro on windows...)
+      START_OBJECT =  3,
+      END_OBJECT   =  4,
+      START_ARRAY  =  5,
+      END_ARRAY    =  6,
+      KEY          =  7,
+      STRING       =  8,
+      NUMBER       =  9,
+      TRUE_VALUE   = 10,
+      FALSE_VALUE  = 11,
+      NULL_VALUE   = 12
+   };
+
+    UJsonReader();
+   ~UJsonReader();
+
+   // SERVICES
+
+   void reset();
+
+   void feed(const char* ptr, uint32_t len);
+   void feed(const UString& data) { feed(U_STRING_TO_PARAM(data)); }
+
+   void finish() // NB: no more data, the current token (a number at top level) is terminated by the end of the input...
+      {
+      U_TRACE_NO_PARAM(0, "UJsonReader::finish()")
+
+      bfinish = true;
+      }
+
+   int next();
+   void skip(); // NB: skip the subtree (or the value of the key) of the last event returned by next()...
+
+   uint32_t getDepth() const { return depth; }
+   uint32_t getBufferSize() const { return buffer.size(); }
+
+   // value of the last event (KEY, STRING, NUMBER)
+
+   uint32_t    getLength() const { return tok_len; }
+   const char* getData() const   { return buffer.c_pointer(tok_start); } // NB: the escape sequence of a string are not decoded...
+
+   UString  getString() const; // NB: the escape sequence are decoded...
+   double   getReal() const;
+   int64_t  getInteger() const;
+   uint64_t getUInteger() const { return u_strtoull(getData(), getData()+tok_len); }
+
+   bool isReal() const __pure;
+   bool isError() const { return berror; }
+   bool isFinished() const { return (state == DONE && depth == 0); }
+
+   // DEBUG
+
+#ifdef DEBUG
+   const char* dump(bool _reset) const;
+#endif
+
+protected:
+   enum State {
+      EXPECT_VALUE       = 0, // expect a value (top level, after ':' or after ',' in array)
+      EXPECT_FIRST_VALUE = 1, // expect a value or ']' (after '[')
+      EXPECT_FIRST_KEY   = 2, // expect a key or '}' (after '{')
+      EXPECT_KEY         = 3, // expect a key (after ',' in object)
+      EXPECT_COLON       = 4, // expect ':'
+      EXPECT_COMMA       = 5, // expect ',' or the end of the container
+      DONE               = 6  // top level value complete
+   };
+
+   UString buffer;
+   uint8_t* stack;        // for every nesting level: the state of the parent level and if it is an object (bit 7)
+   uint32_t pos,          // offset in buffer of the first byte not consumed
+            scan,         // offset in buffer where to resume the scan of the current token
+            tok_start,    // offset in buffer of the value of the last event
+            tok_len,      // length of the value of the last event
+            depth,
+            stack_max,
+            skip_nest;    // > 0 => skipping a subtree
+   int last;              // last event returned by next()
+   uint8_t state;
+   bool bfinish, berror, bskip_value, bstr, bescape;
+
+   bool isObject() const { return (depth && (stack[depth-1] & 0x80) != 0); }
+
+   void pop() { state = (stack[--depth] & 0x7f); }
+   void push(bool bobject);
+
+   int  fail();
+   bool skipSubtree();
+   int  scanString(int event);
+   int  scanNumber();
+   int  scanLiteral(const char* literal, uint32_t len, int event);
+   int  nextToken();
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(UJsonReader)
+};
+
+#endif
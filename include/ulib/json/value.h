@@ -57,7 +57,32 @@
  */
 
 #ifndef U_JSON_PARSE_STACK_SIZE
-#define U_JSON_PARSE_STACK_SIZE 256
+#define U_JSON_PARSE_STACK_SIZE 256 // initial size of the parser stack (it grows with the depth of the document)
+#endif
+
+/**
+ * The state of the parser (and of stringify and jread) is kept per thread, so that the workers of UThreadPool and the
+ * threads of PREFORK_CHILD=-1 can parse JSON in parallel without a lock. NB: we use the initial-exec model because with
+ * the default model (libulib is a shared library) every access to the state of the parser is a call to __tls_get_addr()
+ * and the parser is two times slower...
+ */
+
+#if defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+#  define U_JSON_TLS __thread __attribute__((tls_model("initial-exec")))
+#else
+#  define U_JSON_TLS
+#endif
+
+/**
+ * A document of at least U_JSON_PARSE_INDEX_SIZE bytes is parsed in two stages (like simdjson). The first stage classifies
+ * the document 64 bytes at a time with SIMD instructions (SSE2/AVX2/NEON) and builds the index of the structural characters
+ * ({}[]:, outside strings, the quotes and the first character of the scalars); the second stage (the usual parser) uses the
+ * index to skip whitespace and to find the end of the strings. The index is not built when the first 1k of the document has
+ * little whitespace (minified document) or there are comments...
+ */
+
+#ifndef U_JSON_PARSE_INDEX_SIZE
+#define U_JSON_PARSE_INDEX_SIZE 128
 #endif
 
 #define U_JFIND(json,str,result) UValue::jfind(json,#str,U_CONSTANT_SIZE(#str),result)
@@ -354,6 +379,8 @@ public:
 
    bool parse(const UString& document);
 
+   static void clearParser(void* ptr = U_NULLPTR); // NB: release the memory of the parser of this thread (called also at the exit of the thread)...
+
    /**
     * \brief Outputs a UValue in <a HREF="http://www.json.org">JSON</a> format without formatting (not human friendly).
     *
@@ -361,8 +388,8 @@ public:
     * consumption, but may be usefull to support feature such as RPC where bandwith is limited
     */
 
-   static uint32_t size_output;
-   static char* pstringify; // buffer to stringify json
+   static U_JSON_TLS uint32_t size_output;
+   static U_JSON_TLS char* pstringify; // buffer to stringify json
 
    void stringify() const;
 
@@ -481,8 +508,8 @@ public:
    // An in-place JSON element reader (@see http://www.codeproject.com/Articles/885389/jRead-an-in-place-JSON-element-reader)
    // =======================================================================================================================
 
-   static int      jread_error;
-   static uint32_t jread_elements, jread_pos;
+   static U_JSON_TLS int      jread_error;
+   static U_JSON_TLS uint32_t jread_elements, jread_pos;
 
    static int  jread(const UString& json, const UString& query,                  UString& result, uint32_t* queryParams = U_NULLPTR);
    static bool jfind(const UString& json, const char* query, uint32_t query_len, UString& result);
@@ -626,9 +653,19 @@ protected:
       bool obj;
    } parser_stack_data;
 
-   static int pos;
-   static union jval o;
-   static parser_stack_data sd[U_JSON_PARSE_STACK_SIZE];
+   static U_JSON_TLS int pos;
+   static U_JSON_TLS union jval o;
+   static U_JSON_TLS parser_stack_data* sd;
+   static U_JSON_TLS uint32_t sd_max;
+
+   static U_JSON_TLS uint32_t* sindex; // NB: the index of the structural characters of the document (the last entry is the size of the document)...
+   static U_JSON_TLS uint32_t sindex_max;
+
+   static void growStackParser();
+
+   static uint32_t buildStructuralIndex(const char* s, uint32_t len) U_NO_EXPORT; // NB: return 0 if the document must be parsed without index...
+
+   template <bool bindex> bool _parse(const UString& document) U_NO_EXPORT;
 
    static void initParser()
       {
@@ -644,11 +681,11 @@ protected:
       {
       U_TRACE(0, "UValue::initStackParser(%b)", obj)
 
-      ++pos;
+      if (++pos == (int)sd_max) growStackParser();
 
-      U_INTERNAL_DUMP("pos = %u", pos)
+      U_INTERNAL_DUMP("pos = %u sd_max = %u", pos, sd_max)
 
-      U_INTERNAL_ASSERT_MINOR(pos, U_JSON_PARSE_STACK_SIZE)
+      U_INTERNAL_ASSERT_MINOR(pos, (int)sd_max)
 
 #  ifndef HAVE_OLD_IOSTREAM
       sd[pos] = {0, U_NULLPTR, obj};
@@ -701,7 +738,7 @@ protected:
       }
 
 #ifdef DEBUG
-   static uint32_t cnt_real, cnt_mreal;
+   static U_JSON_TLS uint32_t cnt_real, cnt_mreal;
 #endif
 
    explicit UValue(uint64_t val)
@@ -23,8 +23,10 @@ class UHTTP;
 class UHTTP2;
 class Application;
 class UTimeThread;
+class UHttpPlugIn;
 class UProxyPlugIn;
 class UNoCatPlugIn;
+class UAccessLog;
 class UServer_Base;
 class UClient_Base;
 class UHttpClient_Base;
@@ -34,6 +36,7 @@ class UClientImage_Base;
 
 #define U_Log_syslog(obj)         (obj)->ULog::flag[0]
 #define U_Log_start_stop_msg(obj) (obj)->ULog::flag[1]
+#define U_Log_binary(obj)         (obj)->ULog::flag[2] // records written by UAccessLog (binary structured access log)
 
 class U_EXPORT ULog : public UFile {
 public:
@@ -47,11 +50,14 @@ public:
    } log_date;
 
    typedef struct log_data {
-      uint32_t file_ptr;
+      uint64_t file_ptr;    // generation (high 32 bits) and end of the space reserved by the writers (atomic add, the data are copied without lock)
+      uint64_t file_commit; // generation (high 32 bits) and bytes copied by the writers (the writer that wrap the log wait for the previous writers)
       uint32_t file_page;
-      uint32_t gzip_len;
+      uint32_t rotate_len;  // length of the data of the log to compress (copied by the writer that wrap the log)
+      uint32_t rotate_cnt;  // number of rotation of the log (the writers that cache what is already written in the current file)
       sem_t lock_shared;
-      // --------------> maybe unnamed array of char for gzip compression...
+      char rotate_lock;
+      // --------------> maybe unnamed array of char for log rotate (copy of the data + gzip compression)...
    } log_data;
 
    static log_date date;
@@ -145,7 +151,10 @@ public:
 
       U_ASSERT(isMemoryMapped())
 
-      uint32_t x = log_file_sz + (log_file_sz / 10) + 12U; // The zlib documentation states that destination buffer size must be at least 0.1% larger than avail_in plus 12 bytes
+      // NB: the copy of the data of the log and the gzip compression of it (the zlib documentation states that destination
+      //     buffer size must be at least 0.1% larger than avail_in plus 12 bytes)...
+
+      uint32_t x = log_file_sz + log_file_sz + (log_file_sz / 10) + 12U;
 
       U_RETURN(x);
       }
@@ -230,8 +239,9 @@ protected:
 #endif
 
    void startup();
+   void rotate(uint32_t gen, uint32_t end);
    void closeLogInternal();
-   void write(const struct iovec* iov, int n);
+   bool write(const struct iovec* iov, int n); // NB: return false if the record is dropped...
    void logResponse(const UString& data,  const char* format, uint32_t fmt_size, ...);
    void log(const struct iovec* iov, const char* type, int ncount, const char* msg, uint32_t msg_len, const char* format, uint32_t fmt_size, ...);
 
@@ -255,8 +265,10 @@ private:
    friend class ULib;
    friend class UHTTP;
    friend class UHTTP2;
+   friend class UAccessLog;
    friend class Application;
    friend class UTimeThread;
+   friend class UHttpPlugIn;
    friend class UProxyPlugIn;
    friend class UNoCatPlugIn;
    friend class UServer_Base;
@@ -18,6 +18,8 @@
 #include <ulib/net/rpc/rpc.h>
 #include <ulib/net/client/client.h>
 
+#define U_RDB_BATCH_MAX 1024U // max number of operations of a batch request (the server refuse a bigger batch)
+
 /**
  * @class URDBClient_Base
  *
@@ -95,6 +97,34 @@ public:
 
    UString operator[](const UString& key);
 
+   // -------------------------------------------------------------------------------------------------------------
+   // BATCH: the operations on all the entries of the vector are done with only one request (and one lock of the
+   // database on the server)
+   // -------------------------------------------------------------------------------------------------------------
+   // find()   => vdata[i] is the data of vkey[i] (empty if not found), return the number of keys found
+   // store()  => vkey_data is key0,data0,key1,data1,..., vresult[i] is the result of store() for the pair i
+   // remove() => vresult[i] is the result of remove() for vkey[i]
+   // -------------------------------------------------------------------------------------------------------------
+   // RETURN VALUE (store,remove): the number of operations that was OK (0 also in case of error of the request)
+   // -------------------------------------------------------------------------------------------------------------
+   // NB: a batch with more than U_RDB_BATCH_MAX operations is split in chunks sent with the pipeline...
+   // -------------------------------------------------------------------------------------------------------------
+
+   uint32_t find(  UVector<UString>& vkey, UVector<UString>& vdata);
+   uint32_t store( UVector<UString>& vkey_data, int flag = RDB_INSERT, int* vresult = U_NULLPTR);
+   uint32_t remove(UVector<UString>& vkey,                            int* vresult = U_NULLPTR);
+
+   // -------------------------------------------------------------------------------------------------------------
+   // PIPELINE: queueRequest() add to the pipeline the request with the token and the arguments in URPC::rpc_info,
+   // flushPipeline() send all the requests queued with only one write and read all the responses (vcode[i] is the
+   // response code of the request i, vresponse the data of the responses)
+   // -------------------------------------------------------------------------------------------------------------
+
+   void queueRequest(const char* token);
+   bool flushPipeline(int* vcode, UVector<UString>* vresponse = U_NULLPTR);
+
+   uint32_t getPipelineSize() const { return npipeline; }
+
    // TRANSACTION
 
    bool  beginTransaction();
@@ -106,6 +136,24 @@ public:
    void callForAllEntry(      vPFprpr function) { _callForAllEntry(function, false); }
    void callForAllEntrySorted(vPFprpr function) { _callForAllEntry(function, true); }
 
+   // -------------------------------------------------------------------------------------------------------------
+   // REPLICATION: apply to the local database the records of the replication log of the server after the position
+   // (id,lsn) and advance the position (if the position is not in the log the local database is reloaded with a
+   // copy of the database of the server)
+   // -------------------------------------------------------------------------------------------------------------
+   // RETURN VALUE
+   // -------------------------------------------------------------------------------------------------------------
+   // >= 0: number of records applied
+   //   -1: error (connection, response or disk full writing the journal)
+   // -------------------------------------------------------------------------------------------------------------
+
+   int pullJournal(URDB* prdb, uint64_t& id, uint64_t& lsn);
+
+   // apply to the local database the data of a response to the request RPLY (records) or RSNP (copy)...
+
+   static int applyJournal(URDB* prdb, const UString& data, uint64_t& id, uint64_t& lsn);
+   static int applyCopy(   URDB* prdb, const UString& data, uint64_t& id, uint64_t& lsn);
+
    // DEBUG
 
 #if defined(U_STDCPP_ENABLE) && defined(DEBUG)
@@ -113,14 +161,22 @@ public:
 #endif
 
 protected:
+   UString pipeline;
+   uint32_t npipeline;
    int nResponseCode;
+   bool brpc_info;
 
    URDBClient_Base(UFileConfig* _cfg) : UClient_Base(_cfg)
       {
       U_TRACE_CTOR(0, URDBClient_Base, "%p", _cfg)
 
-      URPC::allocate();
+      // NB: the client of a replica share the vector of the arguments with the server...
+
+      brpc_info = (URPC::rpc_info == U_NULLPTR);
 
+      if (brpc_info) URPC::allocate();
+
+      npipeline     = 0;
       nResponseCode = 0;
       }
 
@@ -128,7 +184,12 @@ protected:
       {
       U_TRACE_DTOR(0, URDBClient_Base)
 
-      U_DELETE(URPC::rpc_info)
+      if (brpc_info)
+         {
+         U_DELETE(URPC::rpc_info)
+
+         URPC::rpc_info = U_NULLPTR;
+         }
       }
 
    // Call function for all entry
@@ -137,6 +198,9 @@ protected:
 
 private:
    void setStatus() U_NO_EXPORT;
+   bool sendBatch(const char* token, UVector<UString>& vec, uint32_t width) U_NO_EXPORT;
+   bool processBatch(const char* token, UVector<UString>& vec, uint32_t width, int* vresult) U_NO_EXPORT;
+   int  loadCopy(URDB* prdb, uint64_t& id, uint64_t& lsn) U_NO_EXPORT;
 
    U_DISALLOW_COPY_AND_ASSIGN(URDBClient_Base)
 };
@@ -59,6 +59,17 @@ public:
 
    UHttpClient<UTCPSocket>* getClient() const { return client; }
 
+   // NB: the response is passed chunk by chunk to the reader without buffering it (see UHttpClient_Base::setJsonReader())...
+
+   void setJsonReader(UJsonReader* reader, bPFpv func)
+      {
+      U_TRACE(0, "UElasticSearchClient::setJsonReader(%p,%p)", reader, func)
+
+      U_INTERNAL_ASSERT_POINTER(client)
+
+      client->setJsonReader(reader, func);
+      }
+
    // Search API of ES. Specify the doc type
 
    bool search(const char* _index, uint32_t index_len, const char* type, uint32_t type_len, const char* query, uint32_t query_len)
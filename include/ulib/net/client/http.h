@@ -38,6 +38,7 @@ class WiAuthNodog;
 class UServer_Base;
 class UProxyPlugIn;
 class UNoCatPlugIn;
+class UJsonReader;
 class UTwilioClient;
 class USOAPClient_Base;
 
@@ -161,6 +162,20 @@ public:
                  const char* content_type     =                 "application/x-www-form-urlencoded",
                  uint32_t    content_type_len = U_CONSTANT_SIZE("application/x-www-form-urlencoded"));
 
+   // The body of the response (with Content-Length) is passed to the reader chunk by chunk as it is read from the socket and after
+   // every chunk the function is called (with the reader as argument) to consume the events available, so that the body is never
+   // stored in memory (getContent() is empty). If the function return false the read of the body stop and the connection is closed...
+
+   void setJsonReader(UJsonReader* reader, bPFpv func)
+      {
+      U_TRACE(0, "UHttpClient_Base::setJsonReader(%p,%p)", reader, func)
+
+      U_INTERNAL_ASSERT(reader == U_NULLPTR || func)
+
+      json_reader = reader;
+      json_func   = func;
+      }
+
    UString getContent() const     { return body; }
    UString getSetCookie() const   { return setcookie; }
    UString getLastRequest() const { return last_request; }
@@ -178,11 +193,14 @@ protected:
    UMimeHeader* requestHeader;
    UMimeHeader* responseHeader;
    UString body, user, password, setcookie, last_request;
+   UJsonReader* json_reader;
+   bPFpv json_func;
    uint32_t method_num;
    bool bFollowRedirects, bproxy;
 
    static bool server_context_flag, data_chunked;
 
+   bool readBodyJson();
    bool sendRequestEngine();
    bool parseRequest(uint32_t n);
    int  sendRequestAsync(const UString& url, bool bqueue, const char* log_msg, int log_fd);
@@ -59,9 +59,9 @@ public:
 
    static uint32_t readTokenString(USocket* s, const char* token, UString& buffer, uint32_t& rstart, UString& data);
 
-   // Read an vector of string from the network
+   // Read an vector of string from the network (starting at offset rstart of the buffer for the pipeline of request)
 
-   static uint32_t readTokenVector(USocket* s, const char* token, UString& buffer, UVector<UString>& vec);
+   static uint32_t readTokenVector(USocket* s, const char* token, UString& buffer, UVector<UString>& vec, uint32_t rstart = 0);
 
    // Transmit token name (U_TOKEN_NM characters) and value (32-bit int, as 8 hex characters)
 
@@ -381,6 +381,7 @@ protected:
    int sfd;
    uucflag flag;
    long last_event;
+   uint32_t serial; // NB: the descriptor is reused by the next connection, the serial number is not...
    // HTTP3
    void* conn;
    void* http3;
@@ -462,7 +463,7 @@ protected:
    bool askForClientCertificate();
 
    static UTimeVal* chronometer;
-   static uint32_t nrequest, resto;
+   static uint32_t nrequest, resto, nserial;
    static long time_between_request, time_run;
 
 #if defined(U_SERVER_CHECK_TIME_BETWEEN_REQUEST) || (defined(DEBUG) && !defined(U_LOG_DISABLE))
@@ -503,6 +504,7 @@ protected:
       }
 
    void prepareForSendfile();
+   void setOpMask(uint32_t mask);
 
 #if defined(U_THROTTLING_SUPPORT) || defined(U_CLIENT_RESPONSE_PARTIAL_WRITE_SUPPORT)
    void setPendingSendfile()
@@ -544,6 +546,8 @@ private:
                       friend class USSIPlugIn;
                       friend class UHttpPlugIn;
                       friend class UNoCatPlugIn;
+                      friend class UProxyPlugIn;
+                      friend class UProxyUpstream;
                       friend class UServer_Base;
                       friend class UStreamPlugIn;
                       friend class UBandWidthThrottling;
@@ -52,6 +52,8 @@ protected:
    virtual int handlerRead() U_DECL_FINAL;
 
 private:
+   static void processRequest(const char* ptr) U_NO_EXPORT;
+
    U_DISALLOW_COPY_AND_ASSIGN(URDBClientImage)
 
    friend class URDBServer;
@@ -14,16 +14,186 @@
 #ifndef U_MOD_PROXY_H
 #define U_MOD_PROXY_H 1
 
+#include <ulib/timer.h>
 #include <ulib/net/tcpsocket.h>
 #include <ulib/net/client/http.h>
 #include <ulib/net/server/server_plugin.h>
 
-class U_EXPORT UProxyPlugIn : public UServerPlugIn {
+class UProxyPlugIn;
+class UProxyUpstream;
+class UModProxyBackend;
+class UModProxyService;
+class UClientImage_Base;
+
+/**
+ * Wait for the socket of the client to be writable on behalf of a connection to the upstream server
+ *
+ * When the client is slower than the server the unsent part of the response is queued by the upstream connection, that stop to read
+ * from the server until the queue is flushed. The client is suspended while waiting the response, so its descriptor can be watched
+ * for EPOLLOUT by this object without to touch the entry of the client in the map of UNotifier...
+ */
+
+class U_EXPORT UProxyClientWriter : public UEventFd {
 public:
 
    // Check for memory error
    U_MEMORY_TEST
 
+   UProxyClientWriter()
+      {
+      U_TRACE_CTOR(0, UProxyClientWriter, "")
+
+      upstream = U_NULLPTR;
+      op_mask  = EPOLLOUT;
+      }
+
+   ~UProxyClientWriter()
+      {
+      U_TRACE_DTOR(0, UProxyClientWriter)
+      }
+
+   // define method VIRTUAL of class UEventFd
+
+   virtual int  handlerWrite() U_DECL_FINAL;
+   virtual void handlerDelete() U_DECL_FINAL;
+
+protected:
+   UProxyUpstream* upstream;
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(UProxyClientWriter)
+
+   friend class UProxyUpstream;
+};
+
+/**
+ * Connection to the upstream server of a proxy service
+ *
+ * The request of the client is forwarded without blocking the worker: the connection is registered with UNotifier,
+ * the client is suspended while waiting, and the response of the server is streamed to the client as it arrives.
+ * After a complete response the connection is kept in the (per worker) pool of the service for the next requests...
+ *
+ * The same class is used for the probes of the health check of the backends of a service (bprobe)
+ */
+
+class U_EXPORT UProxyUpstream : public UEventFd {
+public:
+
+   // Check for memory error
+   U_MEMORY_TEST
+
+   // Allocator e Deallocator
+   U_MEMORY_ALLOCATOR
+   U_MEMORY_DEALLOCATOR
+
+    UProxyUpstream(UModProxyService* service, UModProxyBackend* backend, const UString& server, int port);
+   ~UProxyUpstream();
+
+   // SERVICES
+
+   bool connect();
+   bool forward(UClientImage_Base* pClientImage, const UString& request);
+
+   bool isIdle() const
+      {
+      U_TRACE_NO_PARAM(0, "UProxyUpstream::isIdle()")
+
+      if (state == IDLE) U_RETURN(true);
+
+      U_RETURN(false);
+      }
+
+   bool isFor(UModProxyService* _service, const UString& _server, int _port) const
+      {
+      U_TRACE(0, "UProxyUpstream::isFor(%p,%V,%d)", _service, _server.rep, _port)
+
+      if (service == _service &&
+          port    == _port    &&
+          server.equal(_server))
+         {
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   // define method VIRTUAL of class UEventFd
+
+   virtual int  handlerRead() U_DECL_FINAL;
+   virtual int  handlerWrite() U_DECL_FINAL;
+   virtual void handlerDelete() U_DECL_FINAL;
+
+   // DEBUG
+
+#if defined(U_STDCPP_ENABLE) && defined(DEBUG)
+   const char* dump(bool reset) const;
+#endif
+
+protected:
+   enum State {
+      IDLE    = 0, // in the pool, waiting for a request
+      CONNECT = 1, // asynchronous connect in progress
+      WRITE   = 2, // sending the request
+      HEADER  = 3, // reading the header of the response
+      BODY    = 4, // streaming the body of the response
+      FLUSH   = 5, // the response is complete, waiting the client to receive the queued data
+      CLOSE   = 6  // to delete with the next check for timeout (see UProxyPlugIn::handlerTime())
+   };
+
+   enum BodyType {
+      BODY_NONE   = 0,
+      BODY_LENGTH = 1,
+      BODY_CHUNK  = 2,
+      BODY_EOF    = 3
+   };
+
+   UTCPSocket* socket;
+   UModProxyService* service;
+   UModProxyBackend* backend;
+   UClientImage_Base* pClientImage;
+   UProxyClientWriter writer;
+   UString server, request, header, pending; // NB: pending is the part of the response not yet sent to the client...
+   uint64_t remain;
+   long timestamp;
+   uint32_t sent, nresponse, client_serial, hkey; // NB: hkey is the key for the selection of the backend of a retry (see fail())...
+   int port, client_fd, status;
+   uint8_t state, body_type, chunk_state;
+   bool bclose_client, bhead, breuse, bretry, bkeep_alive, bprobe, bwait;
+
+   void reset();
+   void flush();
+   void fail(int code);
+   void release(bool bok);
+   void finish();
+   int  endResponse();
+   bool sendRequest();
+   bool isClient(UClientImage_Base* pclient) const;
+   bool writeToClient(const char* ptr, uint32_t len);
+   uint32_t parseHeader(); // NB: return 0 if the header is not complete...
+   bool scanBody(const char* ptr, uint32_t len, uint32_t& n); // NB: return true if the response is complete...
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(UProxyUpstream)
+
+   friend class UProxyPlugIn;
+   friend class UProxyClientWriter;
+};
+
+// override the default...
+template <> inline void u_destroy(  const UProxyUpstream*  ptr)             { U_TRACE(0,"u_destroy<UProxyUpstream*>(%p)",      ptr) }
+template <> inline void u_destroy(  const UProxyUpstream** ptr, uint32_t n) { U_TRACE(0,"u_destroy<UProxyUpstream*>(%p,%u)",   ptr, n) }
+template <> inline void u_construct(const UProxyUpstream** ptr, bool b)     { U_TRACE(0,"u_construct<UProxyUpstream*>(%p,%b)", ptr, b) }
+
+class U_EXPORT UProxyPlugIn : public UServerPlugIn, UEventTime {
+public:
+
+   // Check for memory error
+   U_MEMORY_TEST
+
+   // Allocator e Deallocator
+   U_MEMORY_ALLOCATOR
+   U_MEMORY_DEALLOCATOR
+
             UProxyPlugIn();
    virtual ~UProxyPlugIn();
 
@@ -32,11 +202,16 @@ public:
    // Server-wide hooks
 
    virtual int handlerInit() U_DECL_FINAL;
+   virtual int handlerRun() U_DECL_FINAL;
 
    // Connection-wide hooks
 
    virtual int handlerRequest() U_DECL_FINAL;
 
+   // define method VIRTUAL of class UEventTime
+
+   virtual int handlerTime() U_DECL_FINAL;
+
    // DEBUG
 
 #if defined(U_STDCPP_ENABLE) && defined(DEBUG)
@@ -45,9 +220,19 @@ public:
 
 protected:
    static UHttpClient<UTCPSocket>* client_http;
+   static UVector<UProxyUpstream*>* vupstream; // NB: the connections to the upstream servers of this worker (owned by UServer_Base::handler_other)...
+
+   static bool isAsynchronous();
+   static bool forwardRequest();
+   static void erase(UProxyUpstream* upstream);
+   static uint32_t getIdle(UModProxyService* service) __pure;
+   static void probe(UModProxyService* service, UModProxyBackend* backend);
+   static UProxyUpstream* getUpstream(UModProxyService* service, UModProxyBackend* backend, bool bnew = false); // NB: bnew => not from the pool...
 
 private:
    U_DISALLOW_COPY_AND_ASSIGN(UProxyPlugIn)
+
+   friend class UProxyUpstream;
 };
 
 #endif
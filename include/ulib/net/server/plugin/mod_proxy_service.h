@@ -23,6 +23,61 @@
 class UHTTP;
 class UCommand;
 class UFileConfig;
+class UProxyPlugIn;
+class UModProxyService;
+
+/**
+ * Backend (upstream server) of a proxy service with a list of servers (BACKEND)
+ *
+ * The state is kept per worker: the outstanding requests and the consecutive failures seen by this process,
+ * the time until the backend is ejected from the balancing (passive check) and the result of the last probe (active check)...
+ */
+
+class U_EXPORT UModProxyBackend {
+public:
+
+   // Check for memory error
+   U_MEMORY_TEST
+
+   // Allocator e Deallocator
+   U_MEMORY_ALLOCATOR
+   U_MEMORY_DEALLOCATOR
+
+   UModProxyBackend(const UString& server, int port);
+
+   ~UModProxyBackend()
+      {
+      U_TRACE_DTOR(0, UModProxyBackend)
+      }
+
+   bool isAvailable() const
+      {
+      U_TRACE_NO_PARAM(0, "UModProxyBackend::isAvailable()")
+
+      if (healthy &&
+          eject_until <= u_now->tv_sec)
+         {
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   UString server;
+   long eject_until, last_probe;
+   uint32_t outstanding, fails;
+   int port;
+   bool healthy, bprobe;
+
+   // DEBUG
+
+#if defined(U_STDCPP_ENABLE) && defined(DEBUG)
+   const char* dump(bool reset) const;
+#endif
+
+private:
+   U_DISALLOW_ASSIGN(UModProxyBackend)
+};
 
 class U_EXPORT UModProxyService {
 public:
@@ -47,10 +102,18 @@ public:
       ERROR_A_X509_NOBASICAUTH  = 10
    };
 
+   enum Balance {
+      ROUND_ROBIN = 0,
+      LEAST_CONN  = 1, // least outstanding requests
+      HASH        = 2  // consistent hash on a header of the request or the client address
+   };
+
     UModProxyService();
    ~UModProxyService();
 
    int     getPort() const           { return port; }
+   int     getTimeout() const        { return timeout; }
+   int     getKeepAlive() const      { return keep_alive; }
    UString getUser() const           { return user; }
    UString getServer() const;
    UString getPassword() const       { return password; }
@@ -61,6 +124,9 @@ public:
    bool isResponseForClient() const  { return response_client; }
    bool isRequestCertificate() const { return request_cert; }
 
+   bool isHealthCheck() const        { return (health_interval > 0 && health_uri.empty() == false); }
+   bool isBalanced() const           { return (vbackend.empty() == false); }
+
    bool isAuthorization() const
       {
       U_TRACE_NO_PARAM(0, "UModProxyService::isAuthorization()")
@@ -76,6 +142,20 @@ public:
 
    UString replaceResponse(const UString& msg);
 
+   // BALANCING
+
+   // NB: the key of the consistent hash is taken from the current request, so it must be saved with a request forwarded asynchronously
+   //     for the selection of the backend of a retry (that is done in the context of another connection)...
+
+   uint32_t getHashKey();
+   UModProxyBackend* selectBackend(uint32_t hkey, UModProxyBackend* exclude = U_NULLPTR); // NB: exclude => a backend that just failed...
+
+   UModProxyBackend* selectBackend() { return selectBackend(getHashKey()); }
+
+   void setBackendSuccess(UModProxyBackend* backend);
+   void setBackendFailure(UModProxyBackend* backend);
+   void setBackendHealth( UModProxyBackend* backend, bool healthy);
+
    // SERVICES
 
    UCommand* command;
@@ -97,21 +177,34 @@ public:
 #endif
 
 protected:
+   typedef struct ring_point {
+      uint32_t hash;
+      UModProxyBackend* backend;
+   } ring_point;
+
    UVector<UString> vreplace_response;
+   UVector<UModProxyBackend*> vbackend;
    UVector<UIPAllow*>* vremote_address;
-   UString host_mask, server, user, password;
+   ring_point* ring;
+   UString host_mask, server, user, password, hash_key, health_uri;
 #ifdef USE_LIBPCRE
    UPCRE   uri_mask;
 #else
    UString uri_mask;
 #endif
-   int port, method_mask;
+   uint32_t rr, ring_len;
+   int port, method_mask, timeout, keep_alive, balance, max_fails, fail_timeout, health_interval;
    bool request_cert, follow_redirects, response_client, websocket;
 
+   void loadBackend(UVector<UString>& vec);
+
+   static int compareRingPoint(const void* p1, const void* p2) __pure;
+
 private:
    U_DISALLOW_ASSIGN(UModProxyService)
 
    friend class UHTTP;
+   friend class UProxyPlugIn;
 };
 
 #endif
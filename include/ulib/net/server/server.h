@@ -122,6 +122,7 @@ class USSEThread;
 class Application;
 class UTimeThread;
 class UFileConfig;
+class ULogRotateThread;
 class UHttpPlugIn;
 class UFCGIPlugIn;
 class USCGIPlugIn;
@@ -885,7 +886,7 @@ protected:
    static USmtpClient* emailClient;
    static long last_time_email_crash;
    static UString* crashEmailAddress;
-   static bool monitoring_process, set_realtime_priority, public_address, binsert, set_tcp_keep_alive, called_from_handlerTime;
+   static bool monitoring_process, set_realtime_priority, set_cpu_affinity, public_address, binsert, set_tcp_keep_alive, called_from_handlerTime;
 
    static uint32_t                 vplugin_size;
    static UVector<UString>*        vplugin_name;
@@ -1030,6 +1031,10 @@ protected:
    static bool checkHitStats(const char* key, uint32_t key_len, uint32_t interval, uint32_t count);
 #endif
 
+#if defined(ENABLE_THREAD) && defined(U_LINUX) && !defined(U_LOG_DISABLE) && defined(USE_LIBZ)
+   static UThread* pthread_log_rotate; // NB: the gzip compression of the data of the log rotation...
+#endif
+
 #ifdef U_SSE_ENABLE // SERVER SENT EVENTS (SSE)
    struct ucmsghdr {
       size_t cmsg_len; /* Length data in cmsg_data + length of cmsghdr struct */
@@ -1203,11 +1208,13 @@ private:
    friend class USSEThread;
    friend class Application;
    friend class UTimeThread;
+   friend class ULogRotateThread;
    friend class UHttpPlugIn;
    friend class USCGIPlugIn;
    friend class UFCGIPlugIn;
    friend class UApplication;
    friend class UProxyPlugIn;
+   friend class UProxyUpstream;
    friend class UNoCatPlugIn;
    friend class UNoDogPlugIn;
    friend class UGeoIPPlugIn;
@@ -21,9 +21,19 @@
  * @class URDBServer
  *
  * @brief Handles incoming TCP/IP connections from URDBClient
+ *
+ * Replication: if open() is called with rpl_size > 0 every write accepted by the server (for a transaction at the commit) is
+ * appended to the replication log <db>.rpl with the format of the records of the journal. A position in the log (lsn) is the
+ * number of bytes written since the creation of the log (identified by a random id), when the log is over rpl_size it restart
+ * empty and a follower that is behind reload a copy of the database. A server that call follow(host, port) is a read replica:
+ * every poll_ms it pulls from the primary the records after its position, applies them to the local database and saves the
+ * position in <db>.pos (the writes of the clients are refused). The reads are then served by the local copy of the database.
+ * The requests of the follower don't block the event loop of the server (the connection to the primary is registered with UNotifier).
+ * The replication is available only with PREFORK_CHILD == 0 (the state of the log and of the follower is in the memory of the process)
  */
 
 class URDB;
+class URDBReplica;
 
 class U_EXPORT URDBServer : public UServer<UTCPSocket> {
 public:
@@ -33,7 +43,13 @@ public:
 
    // Open a reliable database
 
-   static bool open(const UString& pathdb, uint32_t log_size = 1024 * 1024);
+   static bool open(const UString& pathdb, uint32_t log_size = 1024 * 1024, uint32_t rpl_size = 0);
+
+   // Replica (read only) of the database of the server host:port
+
+   static bool follow(const UString& host, unsigned int port, uint32_t poll_ms = 100);
+
+   static bool isReplica() { return (preplica != U_NULLPTR); }
 
    // DEBUG
 
@@ -43,6 +59,23 @@ public:
 
 protected:
    static URDB* rdb;
+   static UFile* rpl;            // replication log (primary)
+   static UString* rpl_pending;  // records of the transaction in progress
+   static URDBReplica* preplica; // follower
+   static uint64_t rpl_id, rpl_base;
+   static uint32_t rpl_end, rpl_max;
+
+   // REPLICATION
+
+   static void logStore(const UString& key, const UString& data) { logRecord(key, &data); }
+   static void logRemove(const UString& key)                     { logRecord(key, U_NULLPTR); }
+
+   static void logBeginTransaction();
+   static void logAbortTransaction();
+   static void logCommitTransaction();
+
+   static bool readLog(uint64_t id, uint64_t lsn, UString& buffer);
+   static bool readSnapshot(UString& buffer);
 
    // method VIRTUAL to redefine
 
@@ -53,7 +86,16 @@ protected:
 #endif
 
 private:
+   static void logRecord(const UString& key, const UString* data) U_NO_EXPORT;
+   static void logAppend(const char* ptr, uint32_t len) U_NO_EXPORT;
+   static void logWriteHeader() U_NO_EXPORT;
+   static void logRestart() U_NO_EXPORT;
+   static bool isSingleProcess() U_NO_EXPORT;
+
    U_DISALLOW_COPY_AND_ASSIGN(URDBServer)
+
+   friend class URDBReplica;
+   friend class URDBClientImage;
 };
 
 #endif
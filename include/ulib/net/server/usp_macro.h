@@ -27,9 +27,11 @@
 #define USP_PRINTF_ADD(fmt,args...)  UClientImage_Base::wbuffer->snprintf_add(U_CONSTANT_TO_PARAM(fmt) , ##args)
 
 #define USP_JSON_REQUEST_PARSE(obj) JSON_parse(*UHTTP::body,(obj))
+#define USP_JSON_REQUEST_DECODE(obj) JSON_decode(*UHTTP::body,(obj))
 #define USP_JFIND_REQUEST(type,str) UValue::jfind(*UHTTP::body,#type,U_CONSTANT_SIZE(#type),(str))
 
 #define USP_OBJ_JSON_stringify(obj) JSON_OBJ_stringify(*UClientImage_Base::wbuffer,(obj))
+#define USP_OBJ_JSON_encode(obj)    JSON_encode(*UClientImage_Base::wbuffer,(obj))
 
 #define USP_SERIALIZE_OBJECT(class,obj) UFlatBuffer::toObject<class>(*UHTTP::body,(obj))
 
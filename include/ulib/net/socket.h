@@ -789,8 +789,12 @@ protected:
 #if defined(U_LINUX) && (!defined(U_SERVER_CAPTIVE_PORTAL) || defined(ENABLE_THREAD)) && !defined(HAVE_OLD_IOSTREAM)
 #  ifndef SO_ATTACH_REUSEPORT_CBPF
 #  define SO_ATTACH_REUSEPORT_CBPF 51
+#  endif
+#  ifndef SO_DETACH_REUSEPORT_BPF
+#  define SO_DETACH_REUSEPORT_BPF 68
 #  endif
    bool enable_bpf();
+   bool disable_bpf() { return setSockOpt(SOL_SOCKET, SO_DETACH_REUSEPORT_BPF, (const int[]){ 0 }); }
 #endif
 
    bool listen()
@@ -824,7 +828,7 @@ protected:
    static struct sockaddr_storage peer_addr; 
 
    static SocketAddress* cLocal;
-   static bool breuseport, bincoming_cpu;
+   static bool breuseport, breuseport_cbpf, bincoming_cpu;
    static int iBackLog, incoming_cpu, accept4_flags; // If flags is 0, then accept4() is the same as accept()
 
    static void setLocalInfo( USocket* p, SocketAddress* cLocal);
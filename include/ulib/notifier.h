@@ -48,11 +48,16 @@
 #  define U_EPOLLET_POSTPONE_STRATEGY
 #endif
 
+#if defined(U_LINUX) && defined(HAVE_EPOLL_WAIT) && !defined(USE_LIBEVENT) && !defined(USE_FSTACK) && LINUX_VERSION_CODE >= KERNEL_VERSION(6,0,0)
+#  define U_IORING_ENABLE // NB: io_uring with multishot accept/recv and ring of provided buffers...
+#endif
+
 #include <ulib/event/event_fd.h>
 #include <ulib/event/event_time.h>
 
 #define U_NOTIFY_DELETE 0x010
 
+class UIORing;
 class USocket;
 class UTimeStat;
 class USocketExt;
@@ -67,6 +72,7 @@ class U_EXPORT UNotifier {
 public:
 
    static long last_event;
+   static bool bioring; // NB: use io_uring as event backend (EVENT_BACKEND io_uring)...
    static uint32_t min_connection,
                    num_connection,
                    max_connection;
@@ -261,6 +267,11 @@ private:
    static void notifyHandlerEvent() U_NO_EXPORT;
 #endif
 
+#ifdef U_IORING_ENABLE
+   static bool initIORing() U_NO_EXPORT;
+   static void waitForEventIORing(UEventTime* ptimeout) U_NO_EXPORT;
+#endif
+
 #if defined(ENABLE_THREAD) && defined(U_SERVER_THREAD_APPROACH_SUPPORT)
    static UThread* pthread;
 # ifdef _MSWINDOWS_
@@ -278,6 +289,7 @@ private:
    U_DISALLOW_COPY_AND_ASSIGN(UNotifier)
 
    friend class ULib;
+   friend class UIORing;
    friend class USocket;
    friend class UTimeStat;
    friend class USocketExt;
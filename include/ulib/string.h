@@ -74,20 +74,31 @@ enum StringAllocationIndex {
  * 3. references has two states:
  *       0: one reference
  *     n>0: n+1 references
- * 4. all fields == 0 is an empty string, given the extra storage beyond-the-end for a null terminator;
- *    thus, the shared empty string representation needs no constructor
+ *    the two high bits mark the rep shared between threads (U_STRINGREP_SHARED, U_STRINGREP_IMMORTAL)
+ * 4. all fields == 0 (but references) is an empty string, given the extra storage beyond-the-end for a null
+ *    terminator; thus, the shared empty string representation needs no constructor
  * ---------------------------------------------------------------------------------------------------------
  * Note that the UStringRep object is a POD so that you can have a static "empty string" UStringRep object
- * already "constructed" before static constructors have run. The reference-count encoding is chosen so that
- * a 0 indicates 1 reference, so you never try to destroy the empty-string UStringRep object
+ * already "constructed" before static constructors have run. The empty-string UStringRep object (and the
+ * static constant of U_STRINGREP_FROM_CONSTANT) is immortal, so you never try to destroy it and the threads
+ * can use it without race on the reference-count
  */
 
 #ifdef DEBUG
-#  define U_STRINGREP_FROM_CONSTANT(cstr) (void*)U_CHECK_MEMORY_SENTINEL, U_NULLPTR, 0, U_CONSTANT_SIZE(cstr), 0, 0, cstr
+#  define U_STRINGREP_FROM_CONSTANT(cstr) (void*)U_CHECK_MEMORY_SENTINEL, U_NULLPTR, 0, U_CONSTANT_SIZE(cstr), 0, U_STRINGREP_IMMORTAL, cstr
 #elif defined(U_SUBSTR_INC_REF)
-#  define U_STRINGREP_FROM_CONSTANT(cstr)                                 U_NULLPTR,    U_CONSTANT_SIZE(cstr), 0, 0, cstr
+#  define U_STRINGREP_FROM_CONSTANT(cstr)                                 U_NULLPTR,    U_CONSTANT_SIZE(cstr), 0, U_STRINGREP_IMMORTAL, cstr
 #else
-#  define U_STRINGREP_FROM_CONSTANT(cstr)                                               U_CONSTANT_SIZE(cstr), 0, 0, cstr
+#  define U_STRINGREP_FROM_CONSTANT(cstr)                                               U_CONSTANT_SIZE(cstr), 0, U_STRINGREP_IMMORTAL, cstr
+#endif
+
+// size of the table of the interned string (see UString::getIntern())
+
+#ifndef U_INTERN_TABLE_SIZE
+#define U_INTERN_TABLE_SIZE 4096 // NB: must be a power of 2...
+#endif
+#ifndef U_INTERN_MAX_LENGTH
+#define U_INTERN_MAX_LENGTH 255 // NB: the string more long are not interned...
 #endif
 
 class Url;
@@ -169,7 +180,8 @@ public:
 
       U_INTERNAL_DUMP("this = %p parent = %p references = %d child = %d", this, parent, references, child)
 
-      ++references;
+      if (references < U_STRINGREP_IMMORTAL) ++references;
+      else if ((references & U_STRINGREP_IMMORTAL) == 0) (void) __sync_add_and_fetch(&references, 1);
       }
 
    void release() // NB: we don't use delete (dtor) because add a deallocation to the destroy object process...
@@ -186,10 +198,23 @@ public:
          }
 #  endif
 
-      if (references) --references;
-      else _release();
+      if (references < U_STRINGREP_IMMORTAL)
+         {
+         if (references) --references;
+         else _release();
+         }
+      else if ((references & U_STRINGREP_IMMORTAL) == 0 &&
+               __sync_fetch_and_sub(&references, 1) == U_STRINGREP_SHARED) // NB: it was the last reference...
+         {
+         references = 0;
+
+         _release();
+         }
       }
 
+   bool isShared() const   { return ((references & U_STRINGREP_SHARED)   != 0); }
+   bool isImmortal() const { return ((references & U_STRINGREP_IMMORTAL) != 0); }
+
    // Size and Capacity
 
    uint32_t size() const   { return _length; }
@@ -1376,6 +1401,8 @@ protected:
 
    void setFromData(const char** ptr, uint32_t sz, unsigned char delim);
 
+   static UStringRep* findIntern(const char* s, uint32_t n, UStringRep* item, bool binsert);
+
    // NB: for UStringExt::deflate()...
 
    void   setConstant(uint32_t sz);
@@ -2203,6 +2230,47 @@ public:
    void     release() const   {        rep->release(); }
    uint32_t reference() const { return rep->references; }
 
+   // sharing between threads (NB: the string became immutable, the method that modify it work on a private copy...)
+
+   bool isShared() const   { return rep->isShared(); }
+   bool isImmortal() const { return rep->isImmortal(); }
+
+   void setShared()   { setFlagReferences(U_STRINGREP_SHARED); }   // the references are counted with atomic operations
+   void setImmortal() { setFlagReferences(U_STRINGREP_IMMORTAL); } // the rep is never freed (NB: to use only for string that live until the end of the process...)
+
+   // interning: the canonical (immortal) rep of a content, the interned strings with the same content have the same rep so the equality
+   // is a pointer comparison and the copy need no allocation. The table is bounded and lock free (the entries are never removed), it is
+   // pre-populated by str_allocate() with the constant str_* (the name and the value of the HPACK static table, etc...)
+   // NB: to use only for a small set of values (ex. the name of the headers, the mime types, the keys of the configuration)...
+
+   static UStringRep* getIntern(const char* s, uint32_t n, bool binsert = true); // NB: return U_NULLPTR if not found or the table is full...
+   static void        addIntern(UStringRep* r);                                  // NB: the constant rep became the canonical rep of the content...
+
+   void intern(bool binsert = true)
+      {
+      U_TRACE(0, "UString::intern(%b)", binsert)
+
+      UStringRep* r = getIntern(rep->str, rep->_length, binsert);
+
+      if (r &&
+          r != rep)
+         {
+         _set(r);
+         }
+      }
+
+   void setIntern(const char* s, uint32_t n, bool binsert = true) // NB: assign the canonical rep of the content (a private copy if not found)...
+      {
+      U_TRACE(0, "UString::setIntern(%.*S,%u,%b)", n, s, n, binsert)
+
+      UStringRep* r = getIntern(s, n, binsert);
+
+      if (r == U_NULLPTR) (void) assign(s, n);
+      else if (r != rep)  _set(r);
+      }
+
+   bool isInterned() const { return (getIntern(rep->str, rep->_length, false) == rep); }
+
    // for constant string
 
    void trim() const { rep->trim(); }
@@ -2754,6 +2822,8 @@ private:
    char* __append(uint32_t n);
    char* __replace(uint32_t pos, uint32_t n1, uint32_t n2);
 
+   void setFlagReferences(uint32_t flag);
+
    void resize(uint32_t n)
       {
       U_TRACE(0, "UString::resize(%u)", n)
@@ -20,7 +20,18 @@
 class UNotifier;
 class UServer_Base;
 
-// UNotifier use this class to notify a timeout from select()
+/**
+ * UNotifier use this class to notify a timeout from select()
+ *
+ * The timers are kept in a hierarchical timing wheel with a resolution of one millisecond: U_TIMER_LEVEL levels
+ * of 64 slots, the level of a timer is given by the highest bit in which its expiration differs from the current
+ * tick, so that insert and erase are O(1) and all the timers of a slot are expired (or moved to a lower level)
+ * together when the current tick pass over it...
+ */
+
+#define U_TIMER_SLOT_BIT  6
+#define U_TIMER_SLOT     (1U<<U_TIMER_SLOT_BIT)
+#define U_TIMER_LEVEL    ((64+U_TIMER_SLOT_BIT-1)/U_TIMER_SLOT_BIT)
 
 class U_EXPORT UTimer {
 public:
@@ -39,7 +50,9 @@ public:
       U_TRACE_CTOR(0, UTimer, "")
 
       next  = U_NULLPTR;
+      prev  = U_NULLPTR;
       alarm = U_NULLPTR;
+      tick  = 0;
       }
 
    ~UTimer()
@@ -53,7 +66,7 @@ public:
       {
       U_TRACE_NO_PARAM(0, "UTimer::empty()")
 
-      if (first == U_NULLPTR) U_RETURN(true);
+      if (num == 0) U_RETURN(true);
 
       U_RETURN(false);
       }
@@ -94,7 +107,9 @@ public:
       {
       U_TRACE(0, "UTimer::erase(%p)", item)
 
-      U_INTERNAL_ASSERT_POINTER(first)
+      U_INTERNAL_ASSERT_EQUALS(item->prev, U_NULLPTR)
+
+      item->alarm = U_NULLPTR;
 
       if (mode != NOSIGNAL) U_DELETE(item)
       else
@@ -117,9 +132,11 @@ public:
       {
       U_TRACE_NO_PARAM(0, "UTimer::getTimeout()")
 
-      if (        first &&
-          (run(), first))
+      if (        num &&
+          (run(), num))
          {
+         if (first == U_NULLPTR) setFirst();
+
          UEventTime* a = first->alarm;
 
          U_ASSERT(a->checkTolerance())
@@ -134,15 +151,9 @@ public:
       {
       U_TRACE(0, "UTimer::isHandler(%p)", palarm)
 
-      for (UTimer* item = first; item; item = item->next)
-         {
-         if (item->alarm == palarm)
-            {
-            U_INTERNAL_DUMP("item = %p", item)
+      U_INTERNAL_DUMP("palarm->ptimer = %p", palarm->ptimer)
 
-            U_RETURN(true);
-            }
-         }
+      if (palarm->ptimer) U_RETURN(true);
 
       U_RETURN(false);
       }
@@ -173,21 +184,47 @@ public:
 
 protected:
    UTimer* next;
+   UTimer** prev; // NB: the pointer that point to this entry (U_NULLPTR if not linked)...
    UEventTime* alarm;
+   uint64_t tick; // expiration in millisecond
 
    static int mode;
-   static UTimer* pool;  //   free list 
-   static UTimer* first; // active list 
-
+   static uint32_t num;     // number of active timers
+   static uint64_t current; // tick up to which the timers are expired
+   static UTimer* pool;     // free list
+   static UTimer* first;    // the active timer that expire first (U_NULLPTR if not known)
+   static UTimer* expired;  // the timers waiting for the call of the handler
+   static uint64_t pending[U_TIMER_LEVEL]; // bitmap of the slots not empty
+   static UTimer* wheel[U_TIMER_LEVEL][U_TIMER_SLOT];
+
+   static void setFirst();
    static void callHandlerTimeout();
    static void updateTimeToExpire(UEventTime* ptime);
+   static void expire(uint64_t tick); // move on the wheel up to tick and call the handler of the expired timers
 
 #ifdef DEBUG
    static bool invariant();
 #endif
 
 private:
+   void link(UTimer** head)
+      {
+      if ((next = *head)) next->prev = &next;
+
+      *(prev = head) = this;
+      }
+
+   void unlink()
+      {
+      U_INTERNAL_ASSERT_POINTER(prev)
+
+      if ((*prev = next)) next->prev = prev;
+
+      prev = U_NULLPTR;
+      }
+
    void insertEntry() U_NO_EXPORT;
+   void removeEntry() U_NO_EXPORT;
 
    bool operator< (const UTimer& t) const { return (*alarm < *t.alarm); }
    bool operator> (const UTimer& t) const { return  t.operator<(*this); }
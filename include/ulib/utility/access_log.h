@@ -0,0 +1,135 @@
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    access_log.h - binary structured access log (alternative to the apache like log)
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
+
+#ifndef ULIB_ACCESS_LOG_H
+#define ULIB_ACCESS_LOG_H 1
+
+#include <ulib/base/hash.h>
+#include <ulib/internal/common.h>
+
+/**
+ * The log is a sequence of entries, every entry start with a header of 4 bytes: magic (0xAC), type ('R' or 'S') and length
+ * of the entry (uint16_t). The entry of type 'R' is a record of fixed width (48 bytes) with the data of a request, the strings
+ * (URI, referer and user agent) are stored as 64 bit identifier (the hash of the string). The entry of type 'S' is the definition
+ * of a string (the identifier followed by the bytes of the string) and it is written only the first time that the string is used
+ * after the rotation of the log, in the same write of the record that use it (so normally the definition is in the same file of
+ * the record, but when the record is the one that cause the rotation the definition can be in the previous file...)
+ *
+ * NB: the entries are written without padding and the data are in the byte order of the server. The layout of the record avoid
+ *     sequence of 8 null bytes because after a crash the end of the data of the log is found by the search of the null chars...
+ */
+
+#define U_ACCESS_LOG_MAGIC      0xAC
+#define U_ACCESS_LOG_ID_MASK    (1ULL << 63) // NB: the identifiers are never null (and the last byte of the record is never null)
+#define U_ACCESS_LOG_STRING_HDR (4+8)
+#define U_ACCESS_LOG_STRING_MAX (0xffff - U_ACCESS_LOG_STRING_HDR)
+
+#ifndef U_ACCESS_LOG_CACHE_SIZE
+#define U_ACCESS_LOG_CACHE_SIZE 4096 // identifiers of the strings already written by the process (direct mapped, must be a power of 2)
+#endif
+
+class ULog;
+
+class U_EXPORT UAccessLog {
+public:
+
+   typedef struct record {
+      uint8_t  magic;
+      uint8_t  type;
+      uint16_t len;
+      uint32_t ip;       // IPv4 address of the client (0 => not available)
+      uint16_t status;
+      uint8_t  method;   // index of the method (U_HTTP_METHOD_NUM_TO_PARAM)
+      uint8_t  version;  // '0' => HTTP/1.0, '1' => HTTP/1.1, '2' => HTTP/2, '-' => unknown
+      uint32_t body_len;
+      uint64_t time;     // microseconds since the epoch
+      uint64_t uri,
+               referer,
+               agent;
+   } record;
+
+   static uint64_t getId(const char* s, uint32_t len) { return (XXH64(s, len, 0) | U_ACCESS_LOG_ID_MASK); }
+
+   // write the record (with the definition of the strings not yet written), request is the request line (method uri protocol)
+
+   static void write(ULog* log, record& r, const char* request, uint32_t request_len, const char* referer, uint32_t referer_len, const char* agent, uint32_t agent_len);
+
+   // read the entry at ptr and advance ptr to the next entry (the bytes that are not an entry are skipped), return the type of the
+   // entry ('R' or 'S') or 0 at the end of the data. For the type 'S' the definition of the string is available with getString()
+
+   static char next(const char*& ptr, const char* end)
+      {
+      U_TRACE(0, "UAccessLog::next(%p,%p)", ptr, end)
+
+      while ((end - ptr) >= U_ACCESS_LOG_STRING_HDR)
+         {
+         if ((unsigned char)ptr[0] != U_ACCESS_LOG_MAGIC)
+            {
+            const char* p = (const char*) memchr(ptr+1, U_ACCESS_LOG_MAGIC, end-ptr-1);
+
+            if (p == U_NULLPTR) break;
+
+            ptr = p;
+
+            continue;
+            }
+
+         char type    = ptr[1];
+         uint32_t len = u_get_unalignedp16(ptr+2);
+
+         if (((type == 'R' && len == sizeof(record)) ||
+              (type == 'S' && len  > U_ACCESS_LOG_STRING_HDR)) &&
+             len <= (uint32_t)(end - ptr))
+            {
+            entry = ptr;
+            ptr  += len;
+
+            U_RETURN(type);
+            }
+
+         ++ptr; // NB: not an entry (torn write), we search for the next magic...
+         }
+
+      ptr = end;
+
+      U_RETURN(0);
+      }
+
+   // access to the last entry returned by next()
+
+   static void getRecord(record& r) { (void) memcpy(&r, entry, sizeof(record)); }
+
+   static uint64_t getString(const char*& s, uint32_t& len)
+      {
+      U_TRACE(0, "UAccessLog::getString(%p,%p)", &s, &len)
+
+      s   = entry + U_ACCESS_LOG_STRING_HDR;
+      len = u_get_unalignedp16(entry+2) - U_ACCESS_LOG_STRING_HDR;
+
+      uint64_t id = u_get_unalignedp64(entry+4);
+
+      U_RETURN(id);
+      }
+
+protected:
+   static const char* entry;
+   static uint32_t rotate_cnt;
+   static uint64_t cache[U_ACCESS_LOG_CACHE_SIZE];
+
+private:
+   static uint64_t* addString(struct iovec* iov, int& n, char* hdr, uint64_t& id, const char* s, uint32_t len) U_NO_EXPORT;
+
+   U_DISALLOW_COPY_AND_ASSIGN(UAccessLog)
+};
+
+#endif
@@ -26,6 +26,13 @@
 #define HTTP2_DEFAULT_WINDOW_SIZE         65535 
 #define HTTP2_HEADER_TABLE_OFFSET            62
 #define HTTP2_MAX_CONCURRENT_STREAMS        128
+#define HTTP2_STREAM_TABLE_MIN                8 // the stream table of a connection is allocated on the first request and grows by doubling
+#define HTTP2_STREAM_TABLE_CLASS              5 // 8, 16, 32, 64, 128 (HTTP2_MAX_CONCURRENT_STREAMS)
+#define HTTP2_STREAM_TABLE_FREE              16 // the stream tables released by the connections that we keep for class (per process)
+#define HTTP2_WRITEV_MAX                    256 // the max number of iovec for a writev() of the scheduler of the responses (see USocketExt::writev())
+#define HTTP2_SENDFILE_MAX                   64 // the max number of DATA frames with the payload sent with sendfile() for round of the scheduler
+#define HTTP2_FRAME_MAX     (HTTP2_WRITEV_MAX / 2) // the max number of DATA frames for round of the scheduler
+#define HTTP2_DEFAULT_URGENCY                 3 // RFC 9218: the urgency of a response without priority signal (0 is the highest, 7 the lowest)
 #define HTTP2_HEADER_TABLE_ENTRY_SIZE_OFFSET 32
 
 #define HTTP2_CONNECTION_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n" // (24 bytes)
@@ -87,6 +94,24 @@ public:
    struct Stream {
       UString headers, body;
       uint32_t id, state, clength;
+      // response (the DATA frames are sent by sendResponses())
+      UString wbody;      // the body of the response
+      uint32_t woffset;   // the bytes of the body already sent
+      off_t soffset,      // the body of the response is a range of a file sent with sendfile() (see UHTTP::setSendfile())
+            scount;       // the bytes of the range not yet sent
+      int sfd;            // the file (-1 => the body is in wbody)
+      bool sclose;        // the file must be closed at the end of the response (ex: X-Sendfile)
+      int32_t out_window; // send flow control window of the stream
+      uint8_t urgency;    // RFC 9218 extensible priorities (0-7)
+      bool incremental;
+   };
+
+   struct DataFrame {     // a DATA frame of a round of the scheduler (see sendResponses())
+      Stream* ptr;
+      uint32_t iovcnt,    // the iovec and the bytes of the round up to the frame (without the payload sent with sendfile())
+               count,
+               len;       // the length of the payload
+      bool bfile;         // the payload is sent with sendfile() after the writev() of the iovec before it (the last is the header of the frame)
    };
 
    class Connection {
@@ -105,8 +130,17 @@ public:
    Settings peer_settings;             // settings
    UHashMap<UString> itable;           // headers request
    HpackDynamicTable idyntbl, odyntbl; // hpack dynamic table (request, response)
-   // streams
-   Stream streams[HTTP2_MAX_CONCURRENT_STREAMS];
+   // streams (allocated on demand from the free stream tables of the process)
+   Stream* streams;
+   uint32_t streams_capacity;
+   // responses not yet sent (the HEADERS frames in the order of the encoding and the number of streams with DATA to send)
+   UString wheaders;
+   uint32_t npending;
+   // the write stopped by the socket not writable (EAGAIN) that is resumed by handlerWrite(): the bytes of the frames already started
+   // and the rest of the payload of the DATA frame of a file (the frames of the round not yet started are given back to their streams)
+   UString wpending;
+   Stream* wfile;
+   uint32_t wflen;
    const char* bug_client;
    uint32_t max_processed_stream_id;
 #ifdef DEBUG
@@ -118,6 +152,15 @@ public:
    ~Connection()
       {
       U_TRACE_DTOR(0, Connection)
+
+      // NB: like releaseStreamTable() for the connections still open at the exit of the process (the files of the streams must be closed)...
+
+      if (streams)
+         {
+         for (Stream* end = streams+streams_capacity, *ptr = streams; ptr < end; ++ptr) resetStream(ptr);
+
+         delete[] streams;
+         }
       }
 
    void reset()
@@ -169,7 +212,8 @@ protected:
       PING          = 0x06,
       GOAWAY        = 0x07,
       WINDOW_UPDATE = 0x08,
-      CONTINUATION  = 0x09
+      CONTINUATION  = 0x09,
+      PRIORITY_UPDATE = 0x10 // RFC 9218
    };
 
    enum FrameFlagsId {
@@ -252,12 +296,14 @@ protected:
    static int nerror, hpack_errno;
    static Connection* vConnection;
    static Connection* pConnection;
+   static uint32_t nStreamFree[HTTP2_STREAM_TABLE_CLASS];
+   static Stream*  vStreamFree[HTTP2_STREAM_TABLE_CLASS][HTTP2_STREAM_TABLE_FREE];
    static const Settings settings;
    static UString* http2_bug_client_txt;
    static uint32_t wait_for_continuation;
    static bool bcontinue100, bsetting_ack, bsetting_send;
 
-   static uint8_t  priority_weight;     // 0 if not set
+   static uint16_t priority_weight;     // 0 if not set
    static bool     priority_exclusive;
    static uint32_t priority_dependency; // 0 if not set
 
@@ -276,6 +322,11 @@ protected:
 
       delete[] vConnection;
 
+      for (uint32_t i = 0; i < HTTP2_STREAM_TABLE_CLASS; ++i)
+         {
+         while (nStreamFree[i]) delete[] vStreamFree[i][--nStreamFree[i]];
+         }
+
       if (http2_bug_client_txt) delete http2_bug_client_txt;
       }
 
@@ -291,11 +342,14 @@ protected:
    static void handlerResponse();
    static void sendResetStream();
    static void sendWindowUpdate();
+   static void sendResponses();
+   static void growStreamTable();
+   static void releaseStreamTable();
    static void sendGoAway(USocket* psocket);
 
    static void updateSetting(unsigned char* ptr, uint32_t len);
-   static void writeData(struct iovec* iov, bool bdata, bool flag);
    static void handlerDelete(UClientImage_Base* pclient, bool& bsocket_open);
+   static int  handlerWrite(UClientImage_Base* pclient);
 
    static unsigned char* setHpackHeaders(unsigned char* dst, const UString& headers);
 
@@ -307,7 +361,8 @@ protected:
 
       UHTTP::startRequest();
 
-      U_http_version = '2';
+      U_http_version            = '2';
+      U_http_info.nResponseCode = HTTP_OK; // NB: like UHTTP::handlerREAD(), otherwise the responses after the first have status 000...
 
       UClientImage_Base::resetBuffer();
       }
@@ -325,18 +380,17 @@ protected:
       {
       U_TRACE_NO_PARAM(0+256, "UHTTP2::clear()")
 
-      for (pStream = pConnection->streams; pStream <= pStreamEnd; ++pStream)
-         {
-         pStream->body.clear();
-         pStream->headers.clear();
+      for (pStream = pConnection->streams; pStream <= pStreamEnd; ++pStream) resetStream(pStream);
 
-         pStream->id      =
-         pStream->state   =
-         pStream->clength = 0;
-         }
+      pConnection->wheaders.clear();
+      pConnection->wpending.clear();
+
+      pConnection->npending = 0;
+      pConnection->wfile    = U_NULLPTR;
+      pConnection->wflen    = 0;
 
 #  ifdef DEBUG
-      for (pStreamEnd = (pConnection->streams+HTTP2_MAX_CONCURRENT_STREAMS); pStream < pStreamEnd; ++pStream)
+      for (pStreamEnd = (pConnection->streams+pConnection->streams_capacity); pStream < pStreamEnd; ++pStream)
          {
       // U_INTERNAL_DUMP("pStream index = %u", pStream - pConnection->streams)
 
@@ -348,6 +402,59 @@ protected:
 #  endif
       }
 
+   static void resetStream(Stream* ptr)
+      {
+      U_TRACE(0, "UHTTP2::resetStream(%p)", ptr)
+
+      ptr->body.clear();
+      ptr->wbody.clear();
+      ptr->headers.clear();
+
+      if (ptr->sclose) UFile::close(ptr->sfd);
+
+      ptr->id          =
+      ptr->state       =
+      ptr->clength     =
+      ptr->woffset     = 0;
+      ptr->soffset     =
+      ptr->scount      = 0;
+      ptr->sfd         = -1;
+      ptr->sclose      = false;
+      ptr->out_window  = 0;
+      ptr->urgency     = HTTP2_DEFAULT_URGENCY;
+      ptr->incremental = false;
+      }
+
+   static Stream* findStream(uint32_t id)
+      {
+      U_TRACE(0, "UHTTP2::findStream(%u)", id)
+
+      if (id)
+         {
+         for (Stream* ptr = pConnection->streams, *end = ptr+pConnection->streams_capacity; ptr < end; ++ptr)
+            {
+            if (ptr->id == id) U_RETURN_POINTER(ptr, Stream);
+            }
+         }
+
+      U_RETURN_POINTER(U_NULLPTR, Stream);
+      }
+
+   static uint8_t getUrgency()
+      {
+      U_TRACE_NO_PARAM(0, "UHTTP2::getUrgency()")
+
+      // NB: the weight of RFC 7540 (1-256) is mapped on the urgency of RFC 9218 (256 => 0, 1 => 7)...
+
+      if (priority_weight == 0) U_RETURN(HTTP2_DEFAULT_URGENCY);
+
+      uint8_t urgency = ((256 - priority_weight) * 7 + 127) / 255;
+
+      U_RETURN(urgency);
+      }
+
+   static void setPriority(Stream* ptr, const char* s, uint32_t len);
+
    static void readPriority(unsigned char* ptr)
       {
       U_TRACE(0, "UHTTP2::readPriority(%p)", ptr)
@@ -404,13 +511,67 @@ protected:
 
    static void updateSetting(const UString& data) { updateSetting((unsigned char*)U_STRING_TO_PARAM(data)); }
 
-   static bool writev(struct iovec* iov, int iovcnt, uint32_t count)
+   // NB: the writes of the scheduler don't wait for the socket, they return the bytes written (less than count with EAGAIN)...
+
+   static uint32_t writev(struct iovec* iov, int iovcnt, uint32_t count)
       {
       U_TRACE(0, "UHTTP2::writev(%p,%d,%u)", iov, iovcnt, count)
 
-      if (USocketExt::writev(UServer_Base::csocket, iov, iovcnt, count, 0) == count) U_RETURN(true);
+      uint32_t sent = USocketExt::writev(UServer_Base::csocket, iov, iovcnt, count, 0);
+
+      if (sent < count &&
+          UServer_Base::csocket->isOpen() == false)
+         {
+         nerror = CONNECT_ERROR;
+         }
+
+      U_RETURN(sent);
+      }
+
+   static uint32_t sendfile(Stream* ptr, uint32_t count)
+      {
+      U_TRACE(0, "UHTTP2::sendfile(%p,%u)", ptr, count)
+
+      uint32_t sent = USocketExt::sendfile(UServer_Base::csocket, ptr->sfd, &(ptr->soffset), count, 0);
+
+      if (sent < count &&
+          UServer_Base::csocket->isOpen() == false)
+         {
+         nerror = CONNECT_ERROR;
+         }
+
+      U_RETURN(sent);
+      }
+
+   static bool isWritePending()
+      {
+      U_TRACE_NO_PARAM(0, "UHTTP2::isWritePending()")
+
+      U_INTERNAL_DUMP("pConnection->wpending(%u) = %V pConnection->wflen = %u", pConnection->wpending.size(), pConnection->wpending.rep, pConnection->wflen)
+
+      if (pConnection->wpending ||
+          pConnection->wflen)
+         {
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   static bool isResponsePending()
+      {
+      U_TRACE_NO_PARAM(0, "UHTTP2::isResponsePending()")
+
+      U_INTERNAL_DUMP("pConnection->wheaders(%u) = %V pConnection->npending = %u pConnection->out_window = %d",
+                       pConnection->wheaders.size(), pConnection->wheaders.rep, pConnection->npending, pConnection->out_window)
 
-      nerror = CONNECT_ERROR;
+      if (pConnection->wheaders ||
+          isWritePending()      ||
+          (pConnection->npending &&
+           pConnection->out_window > 0))
+         {
+         U_RETURN(true);
+         }
 
       U_RETURN(false);
       }
@@ -846,6 +1007,12 @@ protected:
 #endif
 
 private:
+   static Stream* newStreamTable(uint32_t capacity) U_NO_EXPORT;
+   static void    deleteStreamTable(Stream* table, uint32_t capacity) U_NO_EXPORT;
+   static bool    writePending() U_NO_EXPORT;
+   static bool    addDataFrame(Stream* ptr, struct iovec* iov, uint32_t& iovcnt, uint32_t& count, char* hdr, uint32_t iovmax, DataFrame* vframe, uint32_t& nframe, uint32_t& nfile) U_NO_EXPORT;
+   static void    savePending(struct iovec* iov, DataFrame* vframe, uint32_t nframe, uint32_t k, uint32_t sent, uint32_t fsent) U_NO_EXPORT;
+
    U_DISALLOW_COPY_AND_ASSIGN(UHTTP2)
 
    friend class UHTTP;
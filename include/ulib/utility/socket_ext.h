@@ -226,6 +226,7 @@ private:
    friend class UServer_Base;
    friend class UClient_Base;
    friend class UStreamPlugIn;
+   friend class UProxyUpstream;
    friend class URPCClient_Base;
    friend class UHttpClient_Base;
    friend class UClientImage_Base;
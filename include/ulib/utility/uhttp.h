@@ -303,17 +303,12 @@ public:
 
       U_INTERNAL_DUMP("U_http_version = %C UServer_Base::min_size_for_sendfile = %u UServer_Base::bssl = %b", U_http_version, UServer_Base::min_size_for_sendfile, UServer_Base::bssl)
 
-#  ifndef U_HTTP2_DISABLE
-      if (U_http_version != '2') // NB: within HTTP/2 we can't use sendfile...
-#  endif
-      {
-      if (sz >= UServer_Base::min_size_for_sendfile)
+      if (sz >= UServer_Base::min_size_for_sendfile) // NB: within HTTP/2 the DATA frames of the file are sent with sendfile() by UHTTP2::sendResponses()...
          {
          U_INTERNAL_ASSERT_EQUALS(UServer_Base::bssl, false) // NB: we can't use sendfile with SSL...
 
          U_RETURN(true);
          }
-      }
 
       U_RETURN(false);
       }
@@ -1258,7 +1253,14 @@ private:
    mode_t mode;             // file type
    int mime_index;          // index file mime type
    int fd;                  // file descriptor
+   uint32_t weight;         // memory used by the content (0 => not managed by the policy of the cache)
+   uint32_t hkey;           // hash of the key (for the frequency sketch)
+   uint32_t gen;            // generation of the content in shared memory that we reference
+   int slot;                // index of the entry in shared memory (-1 => the content is private to the process)
+   UFileCacheData* prev;    // size-aware LRU list of the entries with the content in memory...
+   UFileCacheData* next;
    bool link;               // true => ptr data point to another entry
+   bool evict;              // true => the content was dropped by the policy of the cache (served from disk)
 
     UFileCacheData();
     UFileCacheData(const UFileCacheData& elem);
@@ -1291,6 +1293,53 @@ private:
    static UHashMap<UFileCacheData*>* cache_file;
    static UFileCacheData* file_not_in_cache_data;
 
+   // NB: with CACHE_FILE_MAX_SIZE the content in memory of the cache is limited: the admission is TinyLFU (a count-min sketch
+   //     of the frequency of access with periodic aging) and the eviction is size-aware LRU. An entry whose content is dropped
+   //     keep its metadata in the cache and it is served from disk until it is hot enough to be loaded again...
+
+   static uint8_t* cache_file_sketch;
+   static UFileCacheData* cache_file_lru; // NB: circular list, the head is the most recently used...
+   static uint32_t cache_file_max_size, cache_file_used, cache_file_sample, cache_file_hit, cache_file_miss, cache_file_evict;
+
+   static void checkFileCachePolicy();
+   static void unlinkFileCache(UFileCacheData* ptr);
+
+   // NB: with CACHE_FILE_SHARED_SIZE the content of the cache is stored once in the shared memory of the server (before the fork),
+   //     so that the preforked children don't have a private copy of it. The index (one slot for entry) is read without lock: every
+   //     child get the inotify event, the first one that find the stat of the file different from the content published rebuild it,
+   //     the other children attach to it without read and compress again the file. The slot has two regions: the new content is
+   //     written in the region not in use and it is published switching the generation (the region in use is gen & 1). Every child
+   //     acknowledge the generation that it reference, a region is written again only when no child reference it anymore...
+
+   typedef struct file_cache_region {
+      uint32_t gen, narray, nhttp2;
+      uint32_t base, cap; // area of the data owned by the region (reused by the rebuild if the new content fit)
+      uint32_t off[9], len[9]; // content, header, gzip(content, header), brotli(content, header) + header http2 (see UFileCacheData)
+   } file_cache_region;
+
+   typedef struct file_cache_slot {
+      uint32_t gen, size; // NB: gen is the generation published, size and mtime are the stat of the file of the content published...
+      time_t mtime;
+      file_cache_region region[2];
+   } file_cache_slot;
+
+   typedef struct file_cache_shared {
+      sem_t lock; // NB: serialize the rebuild of the entries...
+      uint32_t nslot, nkid, size, used;
+      file_cache_slot slot[1]; // NB: the generation acknowledged by the children (nkid for slot) and the data area follow the slots...
+   } file_cache_shared;
+
+   static ULock* cache_file_lock;
+   static file_cache_shared* cache_file_shared;
+   static uint32_t cache_file_shared_size, cache_file_shared_nslot;
+   static int cache_file_shared_slot;
+   static bool cache_file_shared_attach;
+
+   static void initFileCacheShared();
+   static void checkFileCacheShared();
+   static void reserveFileCacheShared();
+   static void afterForkFileCacheShared();
+
    static bool isDataFromCache()
       {
       U_TRACE_NO_PARAM(0, "UHTTP::isDataFromCache()")
@@ -1599,6 +1648,20 @@ private:
    static void manageDataForCache(const UString& basename, const UString& suffix) U_NO_EXPORT;
    static bool checkDataSession(const UString& token, time_t expire, UString* data) U_NO_EXPORT;
    static void putDataInCache(const UString& path, const UString& fmt, UString& content) U_NO_EXPORT;
+   static void touchFileCache(UFileCacheData* ptr) U_NO_EXPORT;
+   static void evictFileCache(UFileCacheData* ptr) U_NO_EXPORT;
+   static void incFileCacheFrequency(uint32_t hkey) U_NO_EXPORT;
+   static void checkFileCacheAdmission(const UString& path) U_NO_EXPORT;
+   static uint32_t getFileCacheFrequency(uint32_t hkey) __pure U_NO_EXPORT;
+   static bool admitFileCache(uint32_t weight, uint32_t freq, bool bevict) U_NO_EXPORT;
+   static bool  attachFileCacheShared(UFileCacheData* ptr) U_NO_EXPORT;
+   static bool publishFileCacheShared(UFileCacheData* ptr, int slot) U_NO_EXPORT;
+   static bool   countFileCacheShared(UStringRep* key, void* value) U_NO_EXPORT;
+   static void     setFileCacheDataShared(UFileCacheData* ptr) U_NO_EXPORT;
+   static bool    copyFileCacheShared(UStringRep* key, void* value) U_NO_EXPORT;
+   static bool     ackFileCacheShared(UStringRep* key, void* value) U_NO_EXPORT;
+   static bool   isFileCacheSharedInUse(int slot, file_cache_region* pregion) __pure U_NO_EXPORT;
+   static void     setFileCacheSharedAck(int slot, uint32_t gen) U_NO_EXPORT;
    static void addContentLengthToHeader(UString& header, char* ptr, uint32_t size, const char* pEndHeader = U_NULLPTR) U_NO_EXPORT;
    static void setDataInCache(const UString& fmt, const UString& content, const char* encoding, uint32_t encoding_len) U_NO_EXPORT;
    static bool processAuthorization(const char* ptr, uint32_t sz, const char* pattern = U_NULLPTR, uint32_t len = 0) U_NO_EXPORT;
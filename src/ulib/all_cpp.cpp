@@ -15,6 +15,7 @@
 #include "file.cpp"
 #include "process.cpp"
 #include "notifier.cpp"
+#include "ioring.cpp"
 #include "file_config.cpp"
 #include "log.cpp"
 #include "date.cpp"
@@ -41,8 +42,11 @@
 #include "net/server/plugin/mod_proxy_service.cpp"
 #include "orm/orm_driver.cpp"
 #include "json/value.cpp"
+#include "json/reader.cpp"
+#include "json/codec.cpp"
 #include "utility/lock.cpp"
 #include "utility/uhttp.cpp"
+#include "utility/access_log.cpp"
 #include "utility/base64.cpp"
 #include "utility/dir_walk.cpp"
 #include "utility/interrupt.cpp"
@@ -29,23 +29,16 @@ UCache::~UCache()
       }
 }
 
-U_NO_EXPORT void UCache::init(UFile& _x, uint32_t size, bool bexist, bool brdonly)
+U_NO_EXPORT void UCache::init(char* ptr, uint32_t size, bool bexist)
 {
-   U_TRACE(0, "UCache::init(%.*S,%u,%b,%b)", U_FILE_TO_TRACE(_x), size, bexist, brdonly)
+   U_TRACE(0, "UCache::init(%p,%u,%b)", ptr, size, bexist)
 
    U_CHECK_MEMORY
 
-   fd = _x.getFd();
-
-   (void) _x.memmap(PROT_READ | (brdonly ? 0 : PROT_WRITE));
-
-   char* ptr = _x.resetMap();
-
    info = (cache_info*)ptr;
       x =              ptr + sizeof(UCache::cache_info);
 
-   if (bexist) start = (_x.fstat(), _x.st_mtime);
-   else
+   if (bexist == false)
       {
       // 100 <= size <= 1000000000
 
@@ -63,6 +56,21 @@ U_NO_EXPORT void UCache::init(UFile& _x, uint32_t size, bool bexist, bool brdonl
       }
 }
 
+U_NO_EXPORT void UCache::init(UFile& _x, uint32_t size, bool bexist, bool brdonly)
+{
+   U_TRACE(0, "UCache::init(%.*S,%u,%b,%b)", U_FILE_TO_TRACE(_x), size, bexist, brdonly)
+
+   U_CHECK_MEMORY
+
+   fd = _x.getFd();
+
+   (void) _x.memmap(PROT_READ | (brdonly ? 0 : PROT_WRITE));
+
+   init(_x.resetMap(), size, bexist);
+
+   if (bexist) start = (_x.fstat(), _x.st_mtime);
+}
+
 bool UCache::open(const UString& path, uint32_t size, const UString* environment, bool btemp)
 {
    U_TRACE(0, "UCache::open(%V,%u,%p,%b)", path.rep, size, environment, btemp)
@@ -407,6 +415,186 @@ void UCache::loadContentOf(const UString& dir, const char* filter, uint32_t filt
       }
 }
 
+// USharedCache
+
+USharedCache::~USharedCache()
+{
+   U_TRACE_DTOR(0, USharedCache)
+
+   if (fd != -1)
+      {
+      delete[] lock;
+      delete[] shard;
+
+      UFile::close(fd);
+
+      UFile::munmap(map, map_size);
+      }
+}
+
+bool USharedCache::open(const UString& path, uint32_t size, uint32_t n, const UString* environment, bool btemp)
+{
+   U_TRACE(0, "USharedCache::open(%V,%u,%u,%p,%b)", path.rep, size, n, environment, btemp)
+
+   U_CHECK_MEMORY
+
+   U_INTERNAL_ASSERT_EQUALS(fd, -1)
+   U_INTERNAL_ASSERT_RANGE(1U, n, U_SHARED_CACHE_MAX_SHARD)
+
+   UFile _x(path, environment);
+
+   if (_x.creat(O_RDWR) == false) U_RETURN(false);
+
+   uint32_t ssize = 0;
+   bool bexist = (_x.size() != 0);
+
+   if (bexist == false)
+      {
+      nshard = u_nextPowerOfTwo(n);
+      ssize  = (size / nshard) & ~(U_SHARED_CACHE_ALIGN - 1);
+
+      if (ssize < (U_SHARED_CACHE_ALIGN * 4)) ssize = U_SHARED_CACHE_ALIGN * 4;
+
+      (void) _x.ftruncate(U_SHARED_CACHE_ALIGN + nshard * ssize);
+      }
+
+   if (_x.memmap(PROT_READ | PROT_WRITE) == false) U_RETURN(false);
+
+   map_size = (uint32_t)_x.getSize();
+   map      = _x.resetMap();
+
+   shared_cache_info* info = (shared_cache_info*)map;
+
+   if (bexist == false)
+      {
+      info->nshard = nshard;
+      info->ssize  = ssize;
+      }
+   else
+      {
+      nshard = info->nshard;
+      ssize  = info->ssize;
+
+      U_INTERNAL_DUMP("nshard = %u ssize = %u map_size = %u", nshard, ssize, map_size)
+
+      if (nshard == 0                             ||
+          nshard  > U_SHARED_CACHE_MAX_SHARD      ||
+          (nshard & (nshard - 1)) != 0            ||
+          ssize  <= (U_SHARED_CACHE_ALIGN + 100U) ||
+          (U_SHARED_CACHE_ALIGN + nshard * ssize) > map_size)
+         {
+         U_WARNING("USharedCache::open(): the file %V is not a shared cache", path.rep);
+
+         UFile::munmap(map, map_size);
+
+         _x.close();
+
+         nshard = 0;
+         map    = U_NULLPTR;
+
+         U_RETURN(false);
+         }
+      }
+
+   time_t start;
+
+   if (bexist) start = (_x.fstat(), _x.st_mtime);
+   else
+      {
+      U_gettimeofday // NB: optimization if it is enough a time resolution of one second...
+
+      start = u_now->tv_sec;
+      }
+
+   lock  = new ULock[nshard];
+   shard = new UCache[nshard];
+
+   char* ptr = map + U_SHARED_CACHE_ALIGN;
+
+   for (uint32_t i = 0; i < nshard; ++i, ptr += ssize)
+      {
+      lock[i].init((sem_t*)ptr); // NB: the cache must be opened before the fork() of the workers, so we can (re)initialize the semaphore...
+
+      shard[i].init(ptr + U_SHARED_CACHE_ALIGN, ssize - U_SHARED_CACHE_ALIGN, bexist);
+
+      shard[i].start = start;
+      }
+
+   fd = _x.getFd();
+
+   if (btemp) (void) _x._unlink();
+
+   U_RETURN(true);
+}
+
+void USharedCache::add(const UString& key, const UString& data, uint32_t _ttl)
+{
+   U_TRACE(0, "USharedCache::add(%V,%V,%u)", key.rep, data.rep, _ttl)
+
+   U_CHECK_MEMORY
+
+   uint32_t n = getShard(U_STRING_TO_PARAM(key));
+
+   lock[n].lock();
+
+   shard[n].add(key, data, _ttl);
+
+   lock[n].unlock();
+}
+
+void USharedCache::addContent(const UString& key, const UString& content, uint32_t _ttl)
+{
+   U_TRACE(0, "USharedCache::addContent(%V,%V,%u)", key.rep, content.rep, _ttl)
+
+   U_CHECK_MEMORY
+
+   uint32_t n = getShard(U_STRING_TO_PARAM(key));
+
+   lock[n].lock();
+
+   shard[n].addContent(key, content, _ttl);
+
+   lock[n].unlock();
+}
+
+UString USharedCache::get(const char* key, uint32_t keylen)
+{
+   U_TRACE(0, "USharedCache::get(%.*S,%u)", keylen, key, keylen)
+
+   U_CHECK_MEMORY
+
+   uint32_t n = getShard(key, keylen);
+
+   lock[n].lock();
+
+   UString data = shard[n].get(key, keylen);
+
+   if (data) data = UString((const void*)data.data(), data.size()); // NB: we copy the data before the unlock...
+
+   lock[n].unlock();
+
+   U_RETURN_STRING(data);
+}
+
+UString USharedCache::getContent(const char* key, uint32_t keylen)
+{
+   U_TRACE(0, "USharedCache::getContent(%.*S,%u)", keylen, key, keylen)
+
+   U_CHECK_MEMORY
+
+   uint32_t n = getShard(key, keylen);
+
+   lock[n].lock();
+
+   UString content = shard[n].getContent(key, keylen);
+
+   if (content) content = UString((const void*)content.data(), content.size()); // NB: we copy the data before the unlock...
+
+   lock[n].unlock();
+
+   U_RETURN_STRING(content);
+}
+
 // STREAM
 
 #ifdef U_STDCPP_ENABLE
@@ -539,5 +727,22 @@ const char* UCache::dump(bool _reset) const
 
    return U_NULLPTR;
 }
+
+const char* USharedCache::dump(bool _reset) const
+{
+   *UObjectIO::os << "fd                    " << fd           << '\n'
+                  << "map                   " << (void*)map   << '\n'
+                  << "nshard                " << nshard       << '\n'
+                  << "map_size              " << map_size;
+
+   if (_reset)
+      {
+      UObjectIO::output();
+
+      return UObjectIO::buffer_output;
+      }
+
+   return U_NULLPTR;
+}
 #  endif
 #endif
@@ -39,23 +39,60 @@ sem_t    URDB::nolock;
 ULock*   URDB::preclock;
 uint32_t URDB::nerror;
 
-#define U_FOR_EACH_ENTRY1(pcdb,function1)                      \
-                                                               \
-   U_cdb_result_call(pcdb) = 1;                                \
-                                                               \
-   /* 1) first we read the entry in the cache... */            \
-                                                               \
-   for (uint32_t _offset, i = 0; i < CACHE_HASHTAB_LEN; ++i)   \
-      {                                                        \
-      if ((_offset = RDB_hashtab(this)[i]))                    \
-         {                                                     \
-         U_INTERNAL_DUMP("slot = %u _offset = %u", i, _offset) \
-                                                               \
-         function1(pcdb, _offset);                             \
-                                                               \
-         if (U_cdb_result_call(pcdb) == 0) break;              \
-         if (U_cdb_result_call(pcdb) == 2) (void) remove();    \
-         }                                                     \
+#ifdef ENABLE_THREAD
+#  include <ulib/thread.h>
+
+// build the new cdb from the old cdb and the frozen journal (they don't change while the thread is running)
+
+class URDBReorganize : public UThread {
+public:
+
+   URDBReorganize(int _ignore_case) : UThread(PTHREAD_CREATE_JOINABLE), rdb(_ignore_case), cdb(_ignore_case)
+      {
+      pos   = 0;
+      bdone = false;
+      }
+
+   virtual void run() U_DECL_FINAL
+      {
+      U_TRACE_NO_PARAM(0, "URDBReorganize::run()")
+
+      pos = rdb.makeCdb(&cdb);
+
+      __atomic_store_n(&bdone, true, __ATOMIC_RELEASE);
+      }
+
+   bool isDone() { return __atomic_load_n(&bdone, __ATOMIC_ACQUIRE); }
+
+   URDB rdb; // NB: it share the mapping of the old cdb and of the frozen journal with the owner of the database...
+   UCDB cdb;
+   uint32_t pos;
+   bool bdone;
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(URDBReorganize)
+};
+#endif
+
+#define U_FOR_EACH_ENTRY1(pcdb,function1)                        \
+                                                                 \
+   if (preorganize) endReorganize();                             \
+                                                                 \
+   U_cdb_result_call(pcdb) = 1;                                  \
+                                                                 \
+   /* 1) first we read the entry in the cache... */              \
+                                                                 \
+   for (uint32_t _offset, i = 0; i < RDB_hashtab_len(this); ++i) \
+      {                                                          \
+      if ((_offset = RDB_hashtab(this)[i]))                      \
+         {                                                       \
+         U_INTERNAL_DUMP("slot = %u _offset = %u", i, _offset)   \
+                                                                 \
+         function1(pcdb, _offset);                               \
+                                                                 \
+         if (U_cdb_result_call(pcdb) == 0) break;                \
+         if (U_cdb_result_call(pcdb) == 2) (void) remove();      \
+         }                                                       \
       }
 
 #define U_FOR_EACH_ENTRY2(pcdb,function2)                                                              \
@@ -82,7 +119,7 @@ U_NO_EXPORT inline void URDB::setNodeLeft()
 
    U_INTERNAL_DUMP("pnode = %p node = %u", pnode, node)
 
-   U_INTERNAL_ASSERT_RANGE(RDB_hashtab(this), pnode, RDB_allocate(this))
+   U_INTERNAL_ASSERT_RANGE((uint32_t*)RDB_start(this), pnode, RDB_allocate(this))
 }
 
 U_NO_EXPORT inline void URDB::setNodeRight()
@@ -97,7 +134,7 @@ U_NO_EXPORT inline void URDB::setNodeRight()
 
    U_INTERNAL_DUMP("pnode = %p node = %u", pnode, node)
 
-   U_INTERNAL_ASSERT_RANGE(RDB_hashtab(this), pnode, RDB_allocate(this))
+   U_INTERNAL_ASSERT_RANGE((uint32_t*)RDB_start(this), pnode, RDB_allocate(this))
 }
 
 U_NO_EXPORT bool URDB::htLookup(URDB* prdb)
@@ -113,9 +150,9 @@ U_NO_EXPORT bool URDB::htLookup(URDB* prdb)
    // Because the insertion routine has to know where to insert the cache_node, this code has to assign
    // a pointer to the empty pointer to manipulate in that case, so we have to do a nasty indirection...
 
-   prdb->pnode = RDB_hashtab(prdb) + (prdb->UCDB::khash % CACHE_HASHTAB_LEN);
+   prdb->pnode = RDB_hashtab(prdb) + (prdb->UCDB::khash % RDB_hashtab_len(prdb));
 
-   U_INTERNAL_DUMP("pnode = %p slot = %u", prdb->pnode, prdb->UCDB::khash % CACHE_HASHTAB_LEN)
+   U_INTERNAL_DUMP("pnode = %p slot = %u", prdb->pnode, prdb->UCDB::khash % RDB_hashtab_len(prdb))
 
    uint32_t len;
 
@@ -267,7 +304,7 @@ U_NO_EXPORT void URDB::htInsert(URDB* prdb)
    U_INTERNAL_DUMP("pnode = %p node = %u", prdb->pnode, prdb->node)
 
    U_INTERNAL_ASSERT_RANGE(sizeof(URDB::cache_struct), prdb->node, prdb->journal.st_size - sizeof(URDB::cache_node))
-   U_INTERNAL_ASSERT_RANGE(RDB_hashtab(prdb),          prdb->pnode, RDB_allocate(prdb))
+   U_INTERNAL_ASSERT_RANGE((uint32_t*)RDB_start(prdb), prdb->pnode, RDB_allocate(prdb))
 
    uint32_t offset1 =                           (char*)prdb->UCDB::key.dptr  - prdb->journal.map,
             offset2 = (prdb->UCDB::data.dptr ? ((char*)prdb->UCDB::data.dptr - prdb->journal.map) : 0);
@@ -276,6 +313,117 @@ U_NO_EXPORT void URDB::htInsert(URDB* prdb)
    u_put_unaligned32(RDB_node(prdb)->key.dsize,  prdb->UCDB::key.dsize);
    u_put_unaligned32(RDB_node(prdb)->data.dptr,  offset2);
    u_put_unaligned32(RDB_node(prdb)->data.dsize, prdb->UCDB::data.dsize);
+   u_put_unaligned32(RDB_node(prdb)->hash,       prdb->UCDB::khash);
+}
+
+// Initialize the hash table in the header
+
+U_NO_EXPORT void URDB::htInit(URDB* prdb)
+{
+   U_TRACE(0, "URDB::htInit(%p)", prdb)
+
+   RDB_version(prdb)     = CACHE_JOURNAL_VERSION;
+   RDB_hashtab_len(prdb) = CACHE_HASHTAB_LEN;
+   RDB_hashtab_off(prdb) = (char*)(((URDB::cache_struct*)prdb->journal.map)->hashtab) - prdb->journal.map;
+
+   (void) U_SYSCALL(memset, "%p,%d,%d", RDB_hashtab(prdb), 0, sizeof(uint32_t) * CACHE_HASHTAB_LEN);
+}
+
+// NB: the layout of the header and of the node of the journal depend on the format, a journal with records of another format
+//     must be reorganized (in the cdb) by the version of the library that created it...
+
+U_NO_EXPORT bool URDB::checkVersion(const char* path, uint32_t version)
+{
+   U_TRACE(0, "URDB::checkVersion(%S,%u)", path, version)
+
+   if (version == CACHE_JOURNAL_VERSION) U_RETURN(true);
+
+   U_WARNING("URDB: the journal %S has a format different from the current one (%u), it must be reorganized with the version of the library that created it",
+             path, CACHE_JOURNAL_VERSION);
+
+   U_RETURN(false);
+}
+
+// relink the nodes of the hash tree on the new hash table
+
+U_NO_EXPORT void URDB::relink1(uint32_t* tab, uint32_t len, uint32_t _offset)
+{
+   U_TRACE(0, "URDB::relink1(%p,%u,%u)", tab, len, _offset)
+
+   URDB::cache_node* n = RDB_ptr_node(this, _offset);
+
+   uint32_t  left = RDB_cache_node(n,left),
+            right = RDB_cache_node(n,right),
+             klen = RDB_cache_node(n,key.dsize);
+
+   const char* ptr_key = journal.map + RDB_cache_node(n,key.dptr);
+
+   u_put_unaligned32(n->left,  0);
+   u_put_unaligned32(n->right, 0);
+
+   // NB: we must descend the tree in the same way of htLookup()...
+
+   uint32_t* p = tab + (RDB_cache_node(n,hash) % len);
+
+   for (uint32_t _node; (_node = u_get_unalignedp32(p)); )
+      {
+      URDB::cache_node* m = RDB_ptr_node(this, _node);
+
+      uint32_t len1 = RDB_cache_node(m,key.dsize);
+
+      if (u_equal(ptr_key, journal.map + RDB_cache_node(m,key.dptr), U_min(klen, len1), UCDB::ignoreCase(this)) < 0) p = &(m->left);
+      else                                                                                                           p = &(m->right);
+      }
+
+   u_put_unalignedp32(p, _offset);
+
+   if (left)  relink1(tab, len, left);
+   if (right) relink1(tab, len, right);
+}
+
+// Alloc a new hash table with len slot and relink the nodes on it (NB: the nodes don't change position in the journal...)
+
+U_NO_EXPORT void URDB::htGrow(URDB* prdb, uint32_t len)
+{
+   U_TRACE(0, "URDB::htGrow(%p,%u)", prdb, len)
+
+   uint32_t _size = len * sizeof(uint32_t);
+
+   U_INTERNAL_DUMP("RDB_capacity = %u RDB_hashtab_len = %u RDB_nrecord = %u", RDB_capacity(prdb), RDB_hashtab_len(prdb), RDB_nrecord(prdb))
+
+   if (RDB_capacity(prdb) < (_size + sizeof(URDB::cache_node) * 32))
+      {
+      uint32_t nrecord = RDB_nrecord(prdb);
+
+      // NB: if we can't extend the journal we continue with the current hash table...
+
+      if (prdb->resizeJournal(_size + sizeof(URDB::cache_node) * 32) == false ||
+          RDB_nrecord(prdb) != nrecord) // NB: the journal was reorganized...
+         {
+         return;
+         }
+      }
+
+   uint32_t  _offset = RDB_off(prdb),
+             len_old = RDB_hashtab_len(prdb);
+   uint32_t* tab_old = RDB_hashtab(prdb);
+   uint32_t* tab     = (uint32_t*)(prdb->journal.map + _offset);
+
+   (void) U_SYSCALL(memset, "%p,%d,%d", tab, 0, _size);
+
+   RDB_off(prdb) += _size;
+
+   for (uint32_t i = 0; i < len_old; ++i)
+      {
+      if (tab_old[i]) prdb->relink1(tab, len, tab_old[i]);
+      }
+
+   RDB_hashtab_off(prdb) = _offset;
+   RDB_hashtab_len(prdb) = len;
+
+   prdb->pnode = U_NULLPTR; // NB: the pointer of the last lookup is not valid anymore...
+
+   U_INTERNAL_DUMP("RDB_off = %u RDB_hashtab_off = %u RDB_hashtab_len = %u", RDB_off(prdb), RDB_hashtab_off(prdb), RDB_hashtab_len(prdb))
 }
 
 U_NO_EXPORT bool URDB::resizeJournal(uint32_t oversize)
@@ -314,7 +462,7 @@ U_NO_EXPORT bool URDB::resizeJournal(uint32_t oversize)
 
          U_INTERNAL_DUMP("pnode = %p node = %u offset = %u", pnode, node, _offset)
 
-         U_INTERNAL_ASSERT_RANGE(RDB_hashtab(this), pnode, RDB_allocate(this))
+         U_INTERNAL_ASSERT_RANGE((uint32_t*)RDB_start(this), pnode, RDB_allocate(this))
 
          U_RETURN(true);
          }
@@ -362,7 +510,7 @@ U_NO_EXPORT bool URDB::writev(const struct iovec* _iov, int n, uint32_t _size)
 
    for (int i = 0; i < n; ++i)
       {
-      U_MEMCPY(journal_ptr, _iov[i].iov_base, _iov[i].iov_len);
+      if (_iov[i].iov_len) U_MEMCPY(journal_ptr, _iov[i].iov_base, _iov[i].iov_len); // NB: the data can be empty...
 
       // NB: one time writed the data on journal we change the reference at memory
       //     at data end keys so they pointing to journal memory mapped...
@@ -484,7 +632,7 @@ U_NO_EXPORT void URDB::copy1(URDB* prdb, uint32_t _offset) // entry present on c
 
       prdb->UCDB::setKey(ptr_key, size_key);
 
-      prdb->UCDB::cdb_hash();
+      prdb->UCDB::khash = RDB_cache_node(n,hash); // NB: the hash can be set by the caller (not from the key)...
 
       // Search one key/data pair in the cache
 
@@ -597,6 +745,16 @@ bool URDB::compactionJournal()
       RDB_off(&rdb)       = sizeof(URDB::cache_struct);
       RDB_reference(&rdb) = 1;
 
+      htInit(&rdb);
+
+      // NB: we alloc the hash table for the number of record (without the intermediate table)...
+
+      uint32_t len = CACHE_HASHTAB_LEN;
+
+      while (RDB_nrecord(this) > (len * CACHE_HASHTAB_LOAD)) len *= 2;
+
+      if (len > CACHE_HASHTAB_LEN) htGrow(&rdb, len);
+
       U_INTERNAL_DUMP("RDB_off = %u RDB_sync = %u capacity = %u nrecord = %u RDB_reference = %u",
                        RDB_off(&rdb), RDB_sync(&rdb), RDB_capacity(&rdb), RDB_nrecord(&rdb), RDB_reference(&rdb))
 
@@ -691,7 +849,58 @@ bool URDB::open(uint32_t log_size, bool btruncate, bool cdb_brdonly, bool brefer
 
          if (journal.memmap(PROT_READ | PROT_WRITE, U_NULLPTR, 0, journal_sz_new))
             {
-            if (RDB_off(this) == 0) RDB_off(this) = sizeof(URDB::cache_struct);
+            if (RDB_off(this) == 0)
+               {
+               RDB_off(this) = sizeof(URDB::cache_struct);
+
+               htInit(this);
+               }
+            else if (RDB_version(this) != CACHE_JOURNAL_VERSION)
+               {
+               U_INTERNAL_DUMP("RDB_version = %u RDB_nrecord = %u", RDB_version(this), RDB_nrecord(this))
+
+               // NB: the journal of another format without records is initialized again (nrecord have the same offset in all the format)...
+
+               if (RDB_nrecord(this) == 0) reset();
+               else
+                  {
+                  (void) checkVersion(journal.path_relativ, RDB_version(this));
+
+                  journal.munmap();
+                  journal.close();
+
+                  U_RETURN(false);
+                  }
+               }
+
+            // NB: if we find a frozen journal the process is died during a background reorganize, so we complete the work...
+
+            char frozen_path[MAX_FILENAME_LEN];
+
+            (void) UFile::setPathFromFile(*(const UFile*)this, frozen_path, U_CONSTANT_TO_PARAM(".jnl.old"));
+
+            if (UFile::access(frozen_path, R_OK | W_OK))
+               {
+               uint32_t version = 0;
+               int _fd = UFile::open(frozen_path, O_RDONLY, PERM_FILE);
+
+               if (_fd != -1)
+                  {
+                  (void) UFile::pread(_fd, &version, sizeof(uint32_t), offsetof(URDB::cache_struct, version));
+
+                  UFile::close(_fd);
+                  }
+
+               if (checkVersion(frozen_path, version) == false)
+                  {
+                  journal.munmap();
+                  journal.close();
+
+                  U_RETURN(false);
+                  }
+
+               if (beginReorganize(false)) endReorganize();
+               }
 
             U_INTERNAL_DUMP("RDB_off = %u RDB_sync = %u capacity = %u nrecord = %u RDB_reference = %u",
                              RDB_off(this), RDB_sync(this), RDB_capacity(this), RDB_nrecord(this), RDB_reference(this))
@@ -756,6 +965,9 @@ void URDB::close(bool breference)
 
    lock();
 
+   if (preorganize) endReorganize();
+   if (psnapshot)   deleteSnapshot(); // NB: the background reorganize is failed, the frozen journal is merged at the next open()...
+
    if (UFile::map_size) UFile::munmap(); // Constant DB
 
    if (breference == false) journal.munmap();
@@ -797,7 +1009,7 @@ void URDB::reset()
 
    // Initialize the cache to contain no entries
 
-   (void) U_SYSCALL(memset, "%p,%d,%d", RDB_hashtab(this), 0, sizeof(uint32_t) * CACHE_HASHTAB_LEN);
+   htInit(this);
 }
 
 bool URDB::beginTransaction()
@@ -1096,6 +1308,15 @@ bool URDB::reorganize()
 
    lock();
 
+   if (preorganize) endReorganize(); // NB: we wait for the end of the background reorganize...
+
+   if (psnapshot) // NB: the background reorganize is failed, the frozen journal is merged at the next open()...
+      {
+      unlock();
+
+      U_RETURN(false);
+      }
+
    U_INTERNAL_DUMP("RDB_off = %u", RDB_off(this))
 
    if (RDB_off(this) > sizeof(URDB::cache_struct))
@@ -1116,11 +1337,7 @@ bool URDB::reorganize()
          {
          if (cdb.memmap(PROT_READ | PROT_WRITE) == false) U_RETURN(false);
 
-         cdb.makeStart();
-
-         U_FOR_EACH_ENTRY(&cdb, makeAdd1, UCDB::makeAdd2)
-
-         uint32_t pos = cdb.makeFinish(false);
+         uint32_t pos = makeCdb(&cdb);
 
          U_INTERNAL_ASSERT(pos <= cdb.st_size)
 
@@ -1165,6 +1382,364 @@ bool URDB::reorganize()
    U_RETURN(result);
 }
 
+U_NO_EXPORT uint32_t URDB::makeCdb(UCDB* pcdb)
+{
+   U_TRACE(0, "URDB::makeCdb(%p)", pcdb)
+
+   pcdb->makeStart();
+
+   U_FOR_EACH_ENTRY(pcdb, makeAdd1, UCDB::makeAdd2)
+
+   uint32_t pos = pcdb->makeFinish(false);
+
+   U_RETURN(pos);
+}
+
+// Create a new (empty) journal
+
+U_NO_EXPORT bool URDB::newJournal(uint32_t sz)
+{
+   U_TRACE(0, "URDB::newJournal(%u)", sz)
+
+   U_INTERNAL_ASSERT_EQUALS(journal.isOpen(), false)
+
+   if (journal.creat(O_RDWR | O_TRUNC) &&
+       journal.ftruncate(sz))
+      {
+#  if !defined(__CYGWIN__) && !defined(_MSWINDOWS_)
+      if (sz < 32 * 1024 * 1024) sz = 32 * 1024 * 1024; // oversize mmap for optimize resizeJournal() with ftruncate()
+#  endif
+
+      if (journal.memmap(PROT_READ | PROT_WRITE, U_NULLPTR, 0, sz))
+         {
+         reset();
+
+         pnode = U_NULLPTR;
+
+         U_RETURN(true);
+         }
+      }
+
+   if (journal.isOpen()) journal.close();
+
+   U_RETURN(false);
+}
+
+// NB: ~URDB() delete the record lock (that are static)...
+
+U_NO_EXPORT void URDB::deleteSnapshot()
+{
+   U_TRACE_NO_PARAM(0, "URDB::deleteSnapshot()")
+
+   U_INTERNAL_ASSERT_POINTER(psnapshot)
+
+   ULock* save = preclock;
+                 preclock = U_NULLPTR;
+
+   if (psnapshot->journal.isMapped()) psnapshot->journal.munmap();
+   if (psnapshot->journal.isOpen())   psnapshot->journal.close();
+
+   U_DELETE(psnapshot)
+
+   psnapshot = U_NULLPTR;
+   preclock  = save;
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// Background reorganize: the new cdb is built by a thread from the old cdb and the frozen journal, that are shared
+// (read only) with the thread. The current journal is renamed in <db>.jnl.old and the writes go on a new journal.
+// With bfreeze == false the frozen journal is already on disk (the process is died before the end of the work)...
+// --------------------------------------------------------------------------------------------------------------------
+
+U_NO_EXPORT bool URDB::beginReorganize(bool bfreeze)
+{
+   U_TRACE(0, "URDB::beginReorganize(%b)", bfreeze)
+
+   U_INTERNAL_ASSERT_EQUALS(psnapshot, U_NULLPTR)
+   U_INTERNAL_ASSERT_EQUALS(preorganize, U_NULLPTR)
+
+#ifdef ENABLE_THREAD
+   U_NEW(URDB, psnapshot, URDB(UCDB::ignoreCase()));
+
+   psnapshot->journal.setPath(*(const UFile*)this, U_NULLPTR, U_CONSTANT_TO_PARAM(".jnl.old"));
+
+   if (bfreeze == false)
+      {
+      if (psnapshot->journal.open(O_RDWR) == false)
+         {
+         deleteSnapshot();
+
+         U_RETURN(false);
+         }
+
+      psnapshot->journal.readSize();
+
+      if (psnapshot->journal.st_size < (off_t)sizeof(URDB::cache_struct) ||
+          psnapshot->journal.memmap(PROT_READ | PROT_WRITE) == false)
+         {
+         deleteSnapshot();
+
+         U_RETURN(false);
+         }
+      }
+
+   UCDB* pcdb;
+
+   U_NEW(URDBReorganize, preorganize, URDBReorganize(UCDB::ignoreCase()));
+
+   pcdb = &(preorganize->cdb);
+
+   pcdb->setPath(*(const UFile*)this, U_NULLPTR, U_CONSTANT_TO_PARAM(".tmp"));
+
+   if (pcdb->creat(O_RDWR) == false ||
+       pcdb->ftruncate(UFile::st_size + (bfreeze ? journal.st_size : psnapshot->journal.st_size) + UCDB::sizeFor(4096)) == false ||
+       pcdb->memmap(PROT_READ | PROT_WRITE) == false)
+      {
+      if (pcdb->isOpen()) pcdb->close();
+
+      U_DELETE(preorganize)
+
+      preorganize = U_NULLPTR;
+
+      deleteSnapshot();
+
+      U_RETURN(false);
+      }
+
+   if (bfreeze)
+      {
+      // NB: the file of the journal (with the mapping) become the frozen journal and we create a new journal...
+
+      UFile& frozen = psnapshot->journal;
+
+      if (UFile::_rename(journal.path_relativ, frozen.path_relativ) == false)
+         {
+         pcdb->munmap();
+         pcdb->close();
+         (void) pcdb->_unlink();
+
+         U_DELETE(preorganize)
+
+         preorganize = U_NULLPTR;
+
+         deleteSnapshot();
+
+         U_RETURN(false);
+         }
+
+      frozen.fd       = journal.fd;
+      frozen.map      = journal.map;
+      frozen.st_size  = journal.st_size;
+      frozen.map_size = journal.map_size;
+
+      journal.reset();
+
+      if (newJournal(frozen.st_size) == false)
+         {
+         (void) UFile::_rename(frozen.path_relativ, journal.path_relativ);
+
+         journal.fd       = frozen.fd;
+         journal.map      = frozen.map;
+         journal.st_size  = frozen.st_size;
+         journal.map_size = frozen.map_size;
+
+         frozen.reset();
+
+         pcdb->munmap();
+         pcdb->close();
+         (void) pcdb->_unlink();
+
+         U_DELETE(preorganize)
+
+         preorganize = U_NULLPTR;
+
+         deleteSnapshot();
+
+         U_RETURN(false);
+         }
+      }
+
+   // NB: the thread read the old cdb and the frozen journal with the mapping of the owner...
+
+   URDB* prdb = &(preorganize->rdb);
+
+   prdb->UFile::map       = UFile::map;
+   prdb->UFile::st_size   = UFile::st_size;
+   prdb->UFile::map_size  = UFile::map_size;
+   prdb->UCDB::nrecord    = UCDB::nrecord;
+   prdb->start_hash_table_slot = start_hash_table_slot;
+
+   prdb->journal.map      = psnapshot->journal.map;
+   prdb->journal.st_size  = psnapshot->journal.st_size;
+   prdb->journal.map_size = psnapshot->journal.map_size;
+
+   U_INTERNAL_DUMP("RDB_off = %u RDB_nrecord = %u UCDB::nrecord = %u", RDB_off(psnapshot), RDB_nrecord(psnapshot), UCDB::nrecord)
+
+   if (bfreeze == false ||
+       preorganize->start() == false)
+      {
+      preorganize->run();
+      }
+
+   U_RETURN(true);
+#else
+   U_RETURN(false);
+#endif
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// End of the background reorganize (with the lock of the database): we wait for the thread, the new cdb substitute the
+// old one and the frozen journal is removed. NB: the scan of all the entry (print(), callForAllEntry(), ...) don't see
+// the frozen journal so they wait the end of the work...
+// --------------------------------------------------------------------------------------------------------------------
+
+U_NO_EXPORT void URDB::endReorganize()
+{
+   U_TRACE_NO_PARAM(0, "URDB::endReorganize()")
+
+   U_INTERNAL_ASSERT_POINTER(psnapshot)
+   U_INTERNAL_ASSERT_POINTER(preorganize)
+
+#ifdef ENABLE_THREAD
+   while (preorganize->isDone() == false) UTimeVal::nanosleep(1L);
+
+   bool result = false;
+   UCDB* pcdb  = &(preorganize->cdb);
+   uint32_t pos = preorganize->pos;
+
+   U_INTERNAL_ASSERT(pos <= pcdb->st_size)
+
+   preorganize->rdb.UFile::reset();
+   preorganize->rdb.journal.reset();
+
+#  if defined(__CYGWIN__) || defined(_MSWINDOWS_)
+   pcdb->munmap(); // for ftruncate()...
+#  endif
+
+   if (pcdb->ftruncate(pos))
+      {
+#  if defined(_MSWINDOWS_) || defined(__CYGWIN__)
+      UFile::munmap(); // for rename()...
+#    ifdef   _MSWINDOWS_
+      pcdb->UFile::close();
+#    endif
+#  endif
+
+      if (pcdb->_rename(UFile::path_relativ))
+         {
+#     if defined(_MSWINDOWS_) || defined(__CYGWIN__)
+#       ifdef   _MSWINDOWS_
+         (void) pcdb->UFile::open(UFile::path_relativ);
+                pcdb->st_size = pos;
+#       endif
+         (void) pcdb->memmap(); // read only...
+#     endif
+
+         pcdb->UFile::close();
+
+         UFile::substitute(*pcdb);
+
+         UCDB::nrecord               = pcdb->nrecord;
+         UCDB::start_hash_table_slot = pcdb->start_hash_table_slot;
+
+         (void) psnapshot->journal._unlink();
+
+         result = true;
+         }
+      }
+
+   U_INTERNAL_DUMP("result = %b UCDB::nrecord = %u RDB_nrecord = %u", result, UCDB::nrecord, RDB_nrecord(this))
+
+   if (result == false)
+      {
+      U_WARNING("URDB::endReorganize() - the new cdb is failed, the frozen journal is kept for the next open() - db(%.*S,%u recs)", U_FILE_TO_TRACE(*this), size());
+
+      if (pcdb->isMapped()) pcdb->munmap();
+      if (pcdb->isOpen())   pcdb->close();
+
+      (void) pcdb->_unlink();
+      }
+
+   ULock* save = preclock;
+                 preclock = U_NULLPTR;
+
+   U_DELETE(preorganize)
+
+   preorganize = U_NULLPTR;
+   preclock    = save;
+
+   if (result) deleteSnapshot(); // NB: otherwise we continue to search in the frozen journal...
+#endif
+}
+
+void URDB::checkReorganize()
+{
+   U_TRACE_NO_PARAM(0, "URDB::checkReorganize()")
+
+#ifdef ENABLE_THREAD
+   if (preorganize->isDone()) endReorganize();
+#endif
+}
+
+bool URDB::startReorganize()
+{
+   U_TRACE_NO_PARAM(0, "URDB::startReorganize()")
+
+   U_CHECK_MEMORY
+
+#ifndef ENABLE_THREAD
+   return reorganize();
+#else
+   bool result = true;
+
+   lock();
+
+   U_INTERNAL_DUMP("RDB_off = %u RDB_reference = %u", RDB_off(this), RDB_reference(this))
+
+   if (psnapshot) result = (preorganize != U_NULLPTR); // NB: already in progress (or failed)...
+   else if (RDB_off(this) > sizeof(URDB::cache_struct))
+      {
+      U_INTERNAL_ASSERT_EQUALS(RDB_reference(this), 1)
+
+      result = beginReorganize(true);
+      }
+
+   unlock();
+
+   U_RETURN(result);
+#endif
+}
+
+// Search one key/data pair in the frozen journal and after in the old cdb (NB: set the value of struct UCDB::data...)
+
+bool URDB::snapshotLookup()
+{
+   U_TRACE_NO_PARAM(0, "URDB::snapshotLookup()")
+
+   U_INTERNAL_ASSERT_POINTER(psnapshot)
+
+   psnapshot->UCDB::key   = UCDB::key;
+   psnapshot->UCDB::khash = UCDB::khash;
+
+   if (htLookup(psnapshot))
+      {
+      if (psnapshot->isDeleted()) U_RETURN(false);
+
+      UCDB::data.dptr  = RDB_node_data(psnapshot);
+      UCDB::data.dsize = RDB_node_data_sz(psnapshot);
+
+      U_RETURN(true);
+      }
+
+   if (UFile::st_size &&
+       UCDB::find())
+      {
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+
 char* URDB::parseLine(const char* ptr, UCDB::datum* _key, UCDB::datum* _data)
 {
    U_TRACE(0, "URDB::parseLine(%p,%p,%p)", ptr, _key, _data)
@@ -1377,6 +1952,10 @@ UString URDB::printSorted()
 
          getKeys(vkey);
 
+         // NB: a key repeated in the constant database and present in the cache is counted more times by size()...
+
+         n = vkey.size();
+
          if (n > 1) vkey.sort(UCDB::ignoreCase());
 
          UString buffer(_size);
@@ -1498,13 +2077,12 @@ int URDB::_store(int _flag, bool exist)
 
    if (exist)
       {
-      if (_flag == RDB_INSERT) // Insertion of new entries only
+      // NB: an entry marked deleted in the cache is a new entry also for RDB_REPLACE (see the count of the records)...
+
+      if (isDeleted()) exist = false;
+      else if (_flag == RDB_INSERT) // Insertion of new entries only
          {
-         if (isDeleted()) exist = false;
-         else
-            {
-            U_RETURN(-1); // -1: flag was RDB_INSERT and this key already existed
-            }
+         U_RETURN(-1); // -1: flag was RDB_INSERT and this key already existed
          }
       }
    else
@@ -1560,7 +2138,11 @@ int URDB::_store(int _flag, bool exist)
 
    htInsert(this); // Insertion of new entry in the cache
 
-   if (exist == false) RDB_nrecord(this)++;
+   if (exist == false &&
+       ++RDB_nrecord(this) > (RDB_hashtab_len(this) * CACHE_HASHTAB_LOAD))
+      {
+      htGrow(this, RDB_hashtab_len(this) * 2);
+      }
 
    U_INTERNAL_DUMP("nrecord = %u", RDB_nrecord(this))
 
@@ -1609,11 +2191,22 @@ int URDB::remove()
 {
    U_TRACE_NO_PARAM(0, "URDB::remove()")
 
+   lock();
+
+   int result = _remove();
+
+   unlock();
+
+   U_RETURN(result);
+}
+
+int URDB::_remove()
+{
+   U_TRACE_NO_PARAM(0, "URDB::_remove()")
+
    int result = 0;
    bool record_cache_deleted = false;
 
-   lock();
-
    UCDB::cdb_hash();
 
    // NB: Because the insertion routine has to know where to insert the cache_node, we need to call anyway htLookup()...  
@@ -1665,9 +2258,99 @@ int URDB::remove()
    U_INTERNAL_DUMP("nrecord = %u", RDB_nrecord(this))
 
 end:
+   U_RETURN(result);
+}
+
+// BATCH
+
+uint32_t URDB::findBatch(UVector<UString>& vkey, UVector<UString>& vdata, int* vresult)
+{
+   U_TRACE(0, "URDB::findBatch(%p,%p,%p)", &vkey, &vdata, vresult)
+
+   uint32_t n = 0;
+
+   lock();
+
+   for (uint32_t i = 0, sz = vkey.size(); i < sz; ++i)
+      {
+      UCDB::setKey(vkey[i]);
+
+      UCDB::cdb_hash();
+
+      if (_fetch() == false)
+         {
+         vdata.push_back(UString::getStringNull());
+
+         if (vresult) vresult[i] = -1;
+         }
+      else
+         {
+         vdata.push_back(UCDB::elem());
+
+         if (vresult) vresult[i] = 0;
+
+         ++n;
+         }
+      }
+
    unlock();
 
-   U_RETURN(result);
+   U_RETURN(n);
+}
+
+uint32_t URDB::storeBatch(UVector<UString>& vkey_data, int _flag, int* vresult)
+{
+   U_TRACE(0, "URDB::storeBatch(%p,%d,%p)", &vkey_data, _flag, vresult)
+
+   U_INTERNAL_ASSERT_EQUALS(vkey_data.size() & 1, 0)
+
+   int result;
+   uint32_t n = 0;
+
+   lock();
+
+   for (uint32_t i = 0, sz = vkey_data.size(); i < sz; i += 2)
+      {
+      UCDB::setKey( vkey_data[i]);
+      UCDB::setData(vkey_data[i+1]);
+
+      UCDB::cdb_hash();
+
+      result = _store(_flag, htLookup(this));
+
+      if (result == 0) ++n;
+
+      if (vresult) vresult[i/2] = result;
+      }
+
+   unlock();
+
+   U_RETURN(n);
+}
+
+uint32_t URDB::removeBatch(UVector<UString>& vkey, int* vresult)
+{
+   U_TRACE(0, "URDB::removeBatch(%p,%p)", &vkey, vresult)
+
+   int result;
+   uint32_t n = 0;
+
+   lock();
+
+   for (uint32_t i = 0, sz = vkey.size(); i < sz; ++i)
+      {
+      UCDB::setKey(vkey[i]);
+
+      result = _remove();
+
+      if (result == 0) ++n;
+
+      if (vresult) vresult[i] = result;
+      }
+
+   unlock();
+
+   U_RETURN(n);
 }
 
 // ---------------------------------------------------------------------
@@ -1714,7 +2397,8 @@ int URDB::substitute(UCDB::datum* key2, int _flag)
       {
       // save cache pointer
 
-      uint32_t   node1 =  node;
+      uint32_t   node1 =  node,
+                 hash1 = UCDB::khash;
       uint32_t* pnode1 = pnode;
 
       // search for store
@@ -1768,6 +2452,7 @@ int URDB::substitute(UCDB::datum* key2, int _flag)
          // remove of old entry
 
          UCDB::key        = key1;
+         UCDB::khash      = hash1;
          UCDB::data.dptr  = U_NULLPTR;
          UCDB::data.dsize = U_NOT_FOUND;
 
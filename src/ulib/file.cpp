@@ -1326,7 +1326,7 @@ bool UFile::pread(void* buf, uint32_t count, uint32_t offset)
    if (fd <= 0) U_RETURN(false);
 #endif
 
-   if (pwrite(fd, buf, count, offset)) U_RETURN(true);
+   if (pread(fd, buf, count, offset)) U_RETURN(true);
 
    U_RETURN(false);
 }
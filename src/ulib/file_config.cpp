@@ -434,6 +434,8 @@ bool UFileConfig::loadINI()
 
          (void) fullKey.shrink(true);
 
+         fullKey.intern();
+
          table.insert(fullKey, value);
          }
 
@@ -526,6 +528,8 @@ bool UFileConfig::loadProperties(UHashMap<UString>& table, const char* _start, c
          _start = ptr;
          }
 
+      key.intern();
+
       table.insert(key, value);
 
       if (_start >= _end) break;
@@ -127,7 +127,7 @@ static struct ustringrep u_empty_string_rep_storage = {
 # endif
    0, /* _length */
    0, /* _capacity */
-   0, /* references */
+   U_STRINGREP_IMMORTAL, /* references - NB: it is shared by all the threads... */
    "" /* str - NB: we need an address (see c_str() or isNullTerminated()) and must be null terminated... */
 };
 
@@ -266,6 +266,71 @@ private:
    U_DISALLOW_COPY_AND_ASSIGN(UStackMemoryPool)
 };
 
+#if defined(ENABLE_MEMPOOL) && defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+/**
+ * When the process start a thread (UMemoryPool::bthread) every thread keep a magazine of blocks for every 'type' stack,
+ * so that pop() and push() don't touch the 'type' stacks that are shared. The blocks are moved between a magazine and
+ * its stack U_MAGAZINE_BATCH at once under a lock, and at the exit of the thread the magazines are given back to the stacks...
+ */
+
+#define U_MAGAZINE_SIZE  32 // max number of blocks kept by a thread for every 'type' stack
+#define U_MAGAZINE_BATCH 16 // number of blocks moved at once between a magazine and its 'type' stack
+
+typedef struct umagazine {
+   uint32_t len;
+   void* entry[U_MAGAZINE_SIZE];
+} umagazine;
+
+bool UMemoryPool::bthread;
+
+static pthread_key_t   magazine_key;
+static pthread_once_t  magazine_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t magazine_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread bool      magazine_init;
+static __thread uint32_t  magazine_depth; // NB: the refill of a stack can allocate from the other stacks (and UFile::mmap) while holding the lock...
+static __thread umagazine magazine[U_NUM_STACK_TYPE];
+
+static inline void   lockStack() { if (UMemoryPool::bthread && magazine_depth++ == 0) (void) pthread_mutex_lock(  &magazine_lock); }
+static inline void unlockStack() { if (UMemoryPool::bthread && --magazine_depth == 0) (void) pthread_mutex_unlock(&magazine_lock); }
+
+static void flushMagazine(void* ptr) // NB: destructor of the key, called at the exit of the thread...
+{
+   U_TRACE(0, "::flushMagazine(%p)", ptr)
+
+   umagazine* pmag = (umagazine*)ptr;
+
+   lockStack();
+
+   for (int stack_index = 1; stack_index < U_NUM_STACK_TYPE; ++stack_index)
+      {
+      while (pmag[stack_index].len) ((UStackMemoryPool*)(UStackMemoryPool::mem_stack+stack_index))->push(pmag[stack_index].entry[--pmag[stack_index].len]);
+      }
+
+   unlockStack();
+
+   magazine_init = false; // NB: the destructors of the other keys can still free memory (then the key is set again)...
+}
+
+static void createMagazineKey() { (void) pthread_key_create(&magazine_key, flushMagazine); }
+
+static inline umagazine* getMagazine(int stack_index)
+{
+   if (magazine_init == false)
+      {
+      magazine_init = true;
+
+      (void) pthread_once(&magazine_once, createMagazineKey);
+      (void) pthread_setspecific(magazine_key, magazine);
+      }
+
+   return magazine+stack_index;
+}
+#else
+#  define   lockStack()
+#  define unlockStack()
+#endif
+
 #ifdef ENABLE_MEMPOOL
 void UMemoryPool::allocateMemoryBlocks(int stack_index, uint32_t n)
 {
@@ -369,7 +434,31 @@ void UMemoryPool::push(void* ptr, int stack_index)
    U_INTERNAL_ASSERT_POINTER(ptr)
    U_INTERNAL_ASSERT_MINOR(stack_index, U_NUM_STACK_TYPE) // 10
 
-   if (stack_index) ((UStackMemoryPool*)(UStackMemoryPool::mem_stack+stack_index))->push(ptr);
+   if (stack_index == 0) return;
+
+   UStackMemoryPool* pstack = (UStackMemoryPool*)(UStackMemoryPool::mem_stack+stack_index);
+
+#ifdef U_MAGAZINE_SIZE
+   if (bthread)
+      {
+      umagazine* pmag = getMagazine(stack_index);
+
+      if (pmag->len == U_MAGAZINE_SIZE)
+         {
+         lockStack();
+
+         do { pstack->push(pmag->entry[--pmag->len]); } while (pmag->len > (U_MAGAZINE_SIZE - U_MAGAZINE_BATCH));
+
+         unlockStack();
+         }
+
+      pmag->entry[pmag->len++] = ptr;
+
+      return;
+      }
+#endif
+
+   pstack->push(ptr);
 }
 
 void UMemoryPool::_free(void* ptr, uint32_t num, uint32_t type_size)
@@ -385,7 +474,14 @@ void UMemoryPool::_free(void* ptr, uint32_t num, uint32_t type_size)
    U_INTERNAL_DUMP("length = %u", length)
 
    if (length <= U_MAX_SIZE_PREALLOCATE)       push(ptr, U_SIZE_TO_STACK_INDEX(length));
-   else                                  deallocate(ptr, UFile::getSizeAligned(length));
+   else
+      {
+      lockStack();
+
+      deallocate(ptr, UFile::getSizeAligned(length));
+
+      unlockStack();
+      }
 }
 
 void* UMemoryPool::pop(int stack_index)
@@ -396,6 +492,42 @@ void* UMemoryPool::pop(int stack_index)
 
    UStackMemoryPool* pstack = (UStackMemoryPool*)(UStackMemoryPool::mem_stack+stack_index);
 
+#ifdef U_MAGAZINE_SIZE
+   if (bthread)
+      {
+      void* ptr;
+
+      if (stack_index)
+         {
+         umagazine* pmag = getMagazine(stack_index);
+
+         if (pmag->len == 0)
+            {
+            lockStack();
+
+            do {
+               ptr = pstack->pop(); // NB: can refill the magazine of another stack...
+
+               pmag->entry[pmag->len++] = ptr;
+               }
+            while (pmag->len < U_MAGAZINE_BATCH);
+
+            unlockStack();
+            }
+
+         return pmag->entry[--pmag->len];
+         }
+
+      lockStack();
+
+      ptr = pstack->pop(); // NB: the blocks of the stack 0 are never given back...
+
+      unlockStack();
+
+      return ptr;
+      }
+#endif
+
 #ifdef DEBUG
    if (pstack->index &&
        pstack->len == 0)
@@ -480,8 +612,12 @@ void* UMemoryPool::cmalloc(uint32_t num, uint32_t type_size, bool bzero)
       }
    else
       {
+      lockStack();
+
       ptr = UFile::mmap(&length, -1, PROT_READ | PROT_WRITE, MAP_PRIVATE | U_MAP_ANON, 0);
 
+      unlockStack();
+
       U_INTERNAL_DUMP("length = %u", length)
       }
 #endif
@@ -507,7 +643,14 @@ void* UMemoryPool::pmalloc(uint32_t* pnum, uint32_t type_size, bool bzero)
    U_INTERNAL_ASSERT_MINOR(length, 1U * 1024U * 1024U * 1024U) // NB: over 1G is very suspect on 32bit...
 # endif
 
-   if (length > U_MAX_SIZE_PREALLOCATE) ptr = UFile::mmap(&length, -1, PROT_READ | PROT_WRITE, MAP_PRIVATE | U_MAP_ANON, 0);
+   if (length > U_MAX_SIZE_PREALLOCATE)
+      {
+      lockStack();
+
+      ptr = UFile::mmap(&length, -1, PROT_READ | PROT_WRITE, MAP_PRIVATE | U_MAP_ANON, 0);
+
+      unlockStack();
+      }
    else
       {
       int stack_index = U_SIZE_TO_STACK_INDEX(length);
@@ -577,6 +720,132 @@ void UMemoryPool::deallocate(void* ptr, uint32_t length)
 }
 #endif
 
+char*                  UMemoryArena::lo;
+char*                  UMemoryArena::hi;
+char*                  UMemoryArena::ptr;
+UMemoryArena::uarena*  UMemoryArena::first;
+UMemoryArena::uarena*  UMemoryArena::current;
+uint32_t               UMemoryArena::live;
+uint32_t               UMemoryArena::total;
+uint32_t               UMemoryArena::max_size;
+uint32_t               UMemoryArena::chunk_size;
+bool                   UMemoryArena::bscope;
+
+void UMemoryArena::init(uint32_t size)
+{
+   U_TRACE(0, "UMemoryArena::init(%u)", size)
+
+   if (first) clear();
+
+   chunk_size = (size < PAGESIZE ? PAGESIZE : (size + U_PAGEMASK) & ~U_PAGEMASK);
+   max_size   = chunk_size * U_ARENA_MAX_CHUNK;
+
+   first = current = (uarena*) UMemoryPool::cmalloc(chunk_size);
+
+   first->next = U_NULLPTR;
+   first->end  = (char*)first + chunk_size;
+   first->size = chunk_size;
+
+   ptr   = (char*)(first + 1);
+   total = chunk_size;
+
+   range(first);
+
+   U_INTERNAL_DUMP("chunk_size = %u max_size = %u first = %p", chunk_size, max_size, first)
+}
+
+void UMemoryArena::grow(uint32_t sz)
+{
+   U_TRACE(0, "UMemoryArena::grow(%u)", sz)
+
+   U_INTERNAL_ASSERT_POINTER(current)
+
+   uint32_t size = sz + sizeof(uarena);
+
+   size = (size <= chunk_size ? chunk_size : (size + U_PAGEMASK) & ~U_PAGEMASK);
+
+   uarena* c = (uarena*) UMemoryPool::cmalloc(size);
+
+   c->next = U_NULLPTR;
+   c->end  = (char*)c + size;
+   c->size = size;
+
+   current->next = c;
+   current       = c;
+
+   ptr    = (char*)(c + 1);
+   total += size;
+
+   range(c);
+
+   U_INTERNAL_DUMP("current = %p size = %u total = %u live = %u", current, size, total, live)
+
+   if (total >= max_size)
+      {
+      // NB: the arena reached the cap (some object of the previous requests is still alive or the request is too big), the next objects go in the pool...
+
+      U_DEBUG("UMemoryArena::grow(): total = %u live = %u, the arena is full", total, live)
+
+      bscope = false;
+      }
+}
+
+void UMemoryArena::reset()
+{
+   U_TRACE_NO_PARAM(0, "UMemoryArena::reset()")
+
+   bscope = false;
+
+   U_INTERNAL_DUMP("first = %p live = %u", first, live)
+
+   if (first == U_NULLPTR) return;
+
+   if (live)
+      {
+      // NB: some object of the arena is still alive (it don't must happen), we postpone the rewind (the growth is bounded by max_size, see enter())...
+
+      U_DEBUG("UMemoryArena::reset(): live = %u total = %u", live, total)
+
+      return;
+      }
+
+   for (uarena* next, *c = first->next; c; c = next)
+      {
+      next = c->next;
+
+      UMemoryPool::_free(c, c->size);
+      }
+
+   first->next = U_NULLPTR;
+
+   current = first;
+   ptr     = (char*)(first + 1);
+   total   = first->size;
+
+   lo = U_NULLPTR;
+   hi = U_NULLPTR;
+
+   range(first);
+}
+
+void UMemoryArena::clear()
+{
+   U_TRACE_NO_PARAM(0, "UMemoryArena::clear()")
+
+   if (first)
+      {
+      live = 0;
+
+      reset();
+
+      UMemoryPool::_free(first, first->size);
+
+      first = current = U_NULLPTR;
+      ptr   = lo = hi = U_NULLPTR;
+      total = 0;
+      }
+}
+
 #if defined(DEBUG) && defined(U_STDCPP_ENABLE)
 void UStackMemoryPool::paint(ostream& os) // paint info
 {
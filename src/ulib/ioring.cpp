@@ -1,182 +1,1104 @@
-#include "UIORing.h"
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    ioring.cpp
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
 
-#define IORING_MAX_ENTRIES	32768
+#include <ulib/file.h>
+#include <ulib/ioring.h>
+#include <ulib/utility/interrupt.h>
 
-UIORing::UIORing(uint32_t maxConnections)
+#ifdef U_IORING_ENABLE
+#include <sys/syscall.h>
+
+#define U_IORING_SQ_ENTRIES   256
+#define U_IORING_CQ_ENTRIES  4096
+#define U_IORING_BUFFER_SIZE 4096
+#define U_IORING_BUFFER_GROUP   1
+
+#define io_uring_smp_load_acquire(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define io_uring_smp_store_release(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+// NB: glibc don't have the wrappers...
+
+static inline int io_uring_setup(unsigned entries, struct io_uring_params* p)
 {
-	// // +100 so we can add some client sockets if need be
-	maxConnections += 100;
+   return (int) ::syscall(__NR_io_uring_setup, entries, p);
+}
 
-	// struct io_uring_params {
-	//     __u32 sq_entries;
-	//     __u32 cq_entries;
-	//     __u32 flags;
-	//     __u32 sq_thread_cpu;
-	//     __u32 sq_thread_idle;
-	//     __u32 features;
-	//     __u32 resv[4];
-	//     struct io_sqring_offsets sq_off;
-	//     struct io_cqring_offsets cq_off;
-	// };
+static inline int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t argsz)
+{
+   return (int) ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
 
-	io_uring_params params;
-  	memset(&params, 0, sizeof(params));
+static inline int io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+   return (int) ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static inline long getMilliSecond()
+{
+   struct timespec ts;
 
-  	// Pin kernel submission polling thread to same CPU as we pinned in src/ulib/base/utility.c
-   cpu_set_t affinity;
-   CPU_ZERO(&affinity);
-   sched_get_affinity(0, sizeof(affinity), &affinity);
+   (void) clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
 
-   for (size_t n = 0; n < CPU_SET_SIZE; n++)
-   {
-      if (CPU_ISSET(n, &affinity))
+   return (ts.tv_sec * 1000L) + (ts.tv_nsec / 1000000L);
+}
+
+UIORing::ufd*             UIORing::table;
+int*                      UIORing::ready;
+int*                      UIORing::fifo;
+int*                      UIORing::bnext;
+char*                     UIORing::sq_ptr;
+char*                     UIORing::cq_ptr;
+char*                     UIORing::bmem;
+uint32_t*                 UIORing::blen;
+uint32_t*                 UIORing::sq_khead;
+uint32_t*                 UIORing::sq_ktail;
+uint32_t*                 UIORing::cq_khead;
+uint32_t*                 UIORing::cq_ktail;
+uint32_t                  UIORing::sq_mask;
+uint32_t                  UIORing::sq_entries;
+uint32_t                  UIORing::sqe_tail;
+uint32_t                  UIORing::cq_mask;
+uint32_t                  UIORing::sq_len;
+uint32_t                  UIORing::cq_len;
+uint32_t                  UIORing::br_len;
+uint32_t                  UIORing::bmem_len;
+uint32_t                  UIORing::nbuf;
+uint32_t                  UIORing::bsize;
+uint32_t                  UIORing::table_len;
+uint32_t                  UIORing::nready;
+uint32_t                  UIORing::ready_head;
+uint32_t                  UIORing::fifo_len;
+uint32_t                  UIORing::fifo_head;
+uint32_t                  UIORing::fifo_tail;
+uint16_t                  UIORing::btail;
+int                       UIORing::ring_fd = -1;
+int                       UIORing::acceptor = -1;
+int                       UIORing::accept_flags;
+bool                      UIORing::brecv_multishot = true;
+struct io_uring_sqe*      UIORing::sqes;
+struct io_uring_cqe*      UIORing::cqes;
+struct io_uring_buf_ring* UIORing::br;
+
+bool UIORing::init()
+{
+   U_TRACE_NO_PARAM(1, "UIORing::init()")
+
+   U_INTERNAL_ASSERT_MAJOR(UNotifier::max_connection, 0)
+
+   if (ring_fd != -1) clear(); // NB: reinitialized all after fork()...
+
+   struct io_uring_params p;
+
+   (void) U_SYSCALL(memset, "%p,%d,%u", &p, 0, sizeof(p));
+
+   p.flags      = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+   p.cq_entries = U_IORING_CQ_ENTRIES;
+
+   ring_fd = U_SYSCALL(io_uring_setup, "%u,%p", U_IORING_SQ_ENTRIES, &p);
+
+   if (ring_fd == -1 &&
+       errno == EINVAL) // NB: kernel < 5.19...
       {
-         params.sq_thread_cpu = n;
-         break;
+      p.flags = IORING_SETUP_CQSIZE;
+
+      ring_fd = U_SYSCALL(io_uring_setup, "%u,%p", U_IORING_SQ_ENTRIES, &p);
       }
+
+   if (ring_fd == -1) U_RETURN(false);
+
+   U_INTERNAL_DUMP("p.features = %B p.sq_entries = %u p.cq_entries = %u", p.features, p.sq_entries, p.cq_entries)
+
+   // NB: we need IORING_FEAT_EXT_ARG for the timeout of the wait and IORING_FEAT_NODROP to not lose completions...
+
+   if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0 ||
+       (p.features & IORING_FEAT_EXT_ARG)     == 0 ||
+       (p.features & IORING_FEAT_NODROP)      == 0)
+      {
+      (void) U_SYSCALL(close, "%d", ring_fd);
+
+      ring_fd = -1;
+
+      U_RETURN(false);
+      }
+
+   sq_len = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+   cq_len = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+
+   if (cq_len > sq_len) sq_len = cq_len; // NB: IORING_FEAT_SINGLE_MMAP...
+
+   sq_ptr = (char*) U_SYSCALL(mmap, "%p,%u,%d,%d,%d,%I", U_NULLPTR, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+   cq_ptr = sq_ptr;
+
+   if (sq_ptr == MAP_FAILED) goto error;
+
+   sq_entries = p.sq_entries;
+   sq_khead   = (uint32_t*)(sq_ptr + p.sq_off.head);
+   sq_ktail   = (uint32_t*)(sq_ptr + p.sq_off.tail);
+   sq_mask    = *(uint32_t*)(sq_ptr + p.sq_off.ring_mask);
+   cq_khead   = (uint32_t*)(cq_ptr + p.cq_off.head);
+   cq_ktail   = (uint32_t*)(cq_ptr + p.cq_off.tail);
+   cq_mask    = *(uint32_t*)(cq_ptr + p.cq_off.ring_mask);
+   cqes       = (struct io_uring_cqe*)(cq_ptr + p.cq_off.cqes);
+   sqe_tail   = *sq_ktail;
+
+   // NB: the index array is the identity, so that to submit we need only to advance the tail...
+
+   for (uint32_t i = 0, *array = (uint32_t*)(sq_ptr + p.sq_off.array); i < sq_entries; ++i) array[i] = i;
+
+   cq_len = p.sq_entries * sizeof(struct io_uring_sqe); // NB: from now it is the size of the array of submission entries...
+
+   sqes = (struct io_uring_sqe*) U_SYSCALL(mmap, "%p,%u,%d,%d,%d,%I", U_NULLPTR, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+
+   if (sqes == MAP_FAILED) goto error;
+
+   // the ring of provided buffers for the multishot recv (power of 2 entries)
+
+   for (nbuf = 64; nbuf < UNotifier::max_connection && nbuf < 2048; nbuf <<= 1) {}
+
+   bsize    = U_IORING_BUFFER_SIZE;
+   br_len   = nbuf * sizeof(struct io_uring_buf);
+   bmem_len = nbuf * bsize;
+
+   br   = (struct io_uring_buf_ring*) U_SYSCALL(mmap, "%p,%u,%d,%d,%d,%I", U_NULLPTR, br_len,   PROT_READ | PROT_WRITE, MAP_PRIVATE | U_MAP_ANON, -1, 0);
+   bmem = (char*)                     U_SYSCALL(mmap, "%p,%u,%d,%d,%d,%I", U_NULLPTR, bmem_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | U_MAP_ANON, -1, 0);
+
+   if ((char*)br == MAP_FAILED ||
+              bmem == MAP_FAILED)
+      {
+      goto error;
+      }
+
+   {
+   struct io_uring_buf_reg reg;
+
+   (void) U_SYSCALL(memset, "%p,%d,%u", &reg, 0, sizeof(reg));
+
+   reg.ring_addr    = (uint64_t)br;
+   reg.ring_entries = nbuf;
+   reg.bgid         = U_IORING_BUFFER_GROUP;
+
+   if (U_SYSCALL(io_uring_register, "%d,%u,%p,%u", ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1)) goto error;
    }
 
-   /*
-  		IORING_SETUP_SQPOLL
-  			* kernel side polling for submission queue additions, so as soon as we push to the ring, the kernel will pick it up. must be run as root to use this
-  		IORING_SETUP_SQ_AFF
-  			* pin IORING_SETUP_SQPOLL pin the IORING_SETUP_SQPOLL poll thread to the CPU specified by sq_thread_cpu
-  	*/
+   blen  = (uint32_t*) UMemoryPool::cmalloc(nbuf, sizeof(uint32_t), true);
+   bnext = (int*)      UMemoryPool::cmalloc(nbuf, sizeof(int),      true);
+
+   btail = 0;
+
+   for (uint32_t i = 0; i < nbuf; ++i) recycle(i);
+
+   table_len = UNotifier::lo_map_fd_len;
+   table     = (ufd*) UMemoryPool::cmalloc(table_len, sizeof(ufd), true);
+   ready     = (int*) UMemoryPool::cmalloc(table_len, sizeof(int), false);
+
+   for (uint32_t i = 0; i < table_len; ++i) table[i].head = table[i].tail = -1;
+
+   fifo_len = 256;
+   fifo     = (int*) UMemoryPool::cmalloc(fifo_len, sizeof(int), false);
+
+   nready = ready_head = fifo_head = fifo_tail = 0;
+
+   U_RETURN(true);
+
+error:
+   clear();
+
+   U_RETURN(false);
+}
+
+void UIORing::clear()
+{
+   U_TRACE_NO_PARAM(1, "UIORing::clear()")
+
+   if (ring_fd == -1) return;
+
+   if (bmem   &&        bmem   != MAP_FAILED) UFile::munmap(bmem,   bmem_len);
+   if (br     && (char*)br     != MAP_FAILED) UFile::munmap(br,     br_len);
+   if (sqes   && (char*)sqes   != MAP_FAILED) UFile::munmap(sqes,   cq_len);
+   if (sq_ptr &&        sq_ptr != MAP_FAILED) UFile::munmap(sq_ptr, sq_len);
+
+   if (blen)
+      {
+      UMemoryPool::_free(blen,  nbuf, sizeof(uint32_t));
+      UMemoryPool::_free(bnext, nbuf, sizeof(int));
+      }
+
+   if (table)
+      {
+      UMemoryPool::_free(table, table_len, sizeof(ufd));
+      UMemoryPool::_free(ready, table_len, sizeof(int));
+      UMemoryPool::_free(fifo,  fifo_len,  sizeof(int));
+      }
+
+   (void) U_SYSCALL(close, "%d", ring_fd);
+
+   ring_fd = -1;
+   table   = U_NULLPTR;
+   ready   =
+   fifo    =
+   bnext   = U_NULLPTR;
+   blen    = U_NULLPTR;
+   br      = U_NULLPTR;
+   sqes    = U_NULLPTR;
+   bmem    =
+   sq_ptr  =
+   cq_ptr  = U_NULLPTR;
+}
+
+void UIORing::grow(int fd)
+{
+   U_TRACE(0, "UIORing::grow(%d)", fd)
+
+   uint32_t len = table_len;
+
+   while (len <= (uint32_t)fd) len <<= 1;
+
+   ufd* _table = (ufd*) UMemoryPool::cmalloc(len, sizeof(ufd), true);
+   int* _ready = (int*) UMemoryPool::cmalloc(len, sizeof(int), false);
+
+   U_MEMCPY(_table, table, table_len * sizeof(ufd));
+   U_MEMCPY(_ready, ready, nready    * sizeof(int));
+
+   for (uint32_t i = table_len; i < len; ++i) _table[i].head = _table[i].tail = -1;
+
+   UMemoryPool::_free(table, table_len, sizeof(ufd));
+   UMemoryPool::_free(ready, table_len, sizeof(int));
+
+   table     = _table;
+   ready     = _ready;
+   table_len = len;
+}
+
+// BUFFERS
+
+void UIORing::recycle(int bid)
+{
+   U_TRACE(0, "UIORing::recycle(%d)", bid)
+
+   U_INTERNAL_ASSERT_RANGE(0, bid, (int)nbuf-1)
+
+   // NB: the child of parallelization have a copy of the ring of buffers that the kernel doesn't know...
+
+   if (U_ClientImage_parallelization == U_PARALLELIZATION_CHILD) return;
+
+   struct io_uring_buf* buf = &(br->bufs[btail & (nbuf - 1)]);
+
+   buf->addr = (uint64_t)(bmem + bid * bsize);
+   buf->len  = bsize;
+   buf->bid  = (uint16_t)bid;
+
+   io_uring_smp_store_release(&(br->tail), ++btail);
+}
+
+void UIORing::stage(ufd* st, int bid, uint32_t len)
+{
+   U_TRACE(0, "UIORing::stage(%p,%d,%u)", st, bid, len)
+
+   blen[bid]  = len;
+   bnext[bid] = -1;
+
+   if (st->tail == -1) st->head = st->tail = bid;
+   else
+      {
+      bnext[st->tail] = bid;
+                        st->tail = bid;
+      }
+}
 
-  	params.flags = (IORING_SETUP_SQPOLL | IORING_SETUP_SQ_AFF);
+void UIORing::flushStage(ufd* st)
+{
+   U_TRACE(0, "UIORing::flushStage(%p)", st)
 
-  	// as soon as we stop generating submission queue entries, a timer starts that will put the kernel side polling thread to sleep
-  	// as long as we keep driving IO, the kernel thread will always stay active... otherwise it will set IORING_SQ_NEED_WAKEUP bit in the flags field of the struct io_sq_ring and you have to call enter to wake it up
-  	params.sq_thread_idle = UINT32_MAX; // aka tell the kernel to never stop polling
+   for (int bid = st->head, next; bid != -1; bid = next)
+      {
+      next = bnext[bid];
 
-  	// kernel will set sqeEntries to IORING_MAX_ENTRIES and cqeEntries to IORING_MAX_ENTRIES * 2
-  	ringfd = io_uring_setup(IORING_MAX_ENTRIES, &params);
-  	flags = params.flags;
-  	mapInStructuresFromKernel(params);
+      recycle(bid);
+      }
 
-  	/* 
-		IORING_REGISTER_FILES
+   st->head =
+   st->tail = -1;
+   st->off  = 0;
+}
 
-	  		* IORING_SETUP_SQPOLL requires this
-	  		* adds amazing performance benefits
-	  		* To make use of the registered files, the IOSQE_FIXED_FILE flag must be set in the flags member of the struct io_uring_sqe, and the fd member is set to the index of the file in the file descriptor array.
-	  		* The file set may be sparse, meaning that the fd field in the array may be set to -1. See IORING_REGISTER_FILES_UPDATE for how to update files in place.
-  	*/
+// SUBMISSION
 
-  	fds = (int32_t*) UMemoryPool::u_malloc(maxConnections, sizeof(int32_t), true);
-  	// make sparse with -1
-	memset(&fds, -1, sizeof(int32_t));
-  	// register an array large enough to contain all possible file descriptors for io
-  	int result = io_uring_register(ringfd, IORING_REGISTER_FILES, &fds, maxConnections);
+struct io_uring_sqe* UIORing::getSqe(int fd, uint64_t user_data, uint8_t opcode)
+{
+   U_TRACE(0, "UIORing::getSqe(%d,%llu,%u)", fd, user_data, opcode)
+
+   if ((sqe_tail - io_uring_smp_load_acquire(sq_khead)) >= sq_entries) submit(); // NB: the submission ring is full...
+
+   struct io_uring_sqe* sqe = sqes + (sqe_tail++ & sq_mask);
 
-  	registerBuffers();
+   (void) U_SYSCALL(memset, "%p,%d,%u", sqe, 0, sizeof(struct io_uring_sqe));
+
+   sqe->fd        = fd;
+   sqe->opcode    = opcode;
+   sqe->user_data = user_data;
+
+   return sqe;
 }
 
-void UIORing::registerBuffers()
+void UIORing::cancel(uint64_t user_data)
 {
-	for (uint32_t index = 0; index < NUMBER_OF_WRITE_BUFFERS; index++) 
-	{
-		writeBufferVecs[index].iov_base = writeBuffers[index];
-		writeBufferVecs[index].iov_len = WRITE_BUFFER_SIZE;
-	}
+   U_TRACE(0, "UIORing::cancel(%llu)", user_data)
+
+   U_INTERNAL_ASSERT_DIFFERS(user_data, 0)
 
-	io_uring_register(ringfd, IORING_REGISTER_BUFFERS, &writeBufferVecs, NUMBER_OF_WRITE_BUFFERS);
+   struct io_uring_sqe* sqe = getSqe(-1, (user_data & ~0xffULL) | OP_CANCEL, IORING_OP_ASYNC_CANCEL);
 
-	for (uint32_t index = 0; i < NUMBER_OF_READ_BUFFERS; index++) 
-	{
-		struct io_uring_sqe *sqe = submissionQueue.entryFor(U_NULLPTR, IORING_OP_PROVIDE_BUFFERS, (readBuffers + index * READ_BUFFER_SIZE), READ_BUFFER_SIZE, index);
-		sqe->buf_group = READ_BUFFER_GROUP_ID;
-	}
+   sqe->addr = user_data;
+}
 
-	submissionQueue.flush();
+void UIORing::submit()
+{
+   U_TRACE_NO_PARAM(1, "UIORing::submit()")
 
-	for (uint32_t index = 0; i < NUMBER_OF_READ_BUFFERS; index++) 
-	{
-		io_uring_cqe* cqe = completionQueue.getNextAndWait(ringfd);
+   io_uring_smp_store_release(sq_ktail, sqe_tail);
 
-		// if (cqe->res < 0) error
+   uint32_t to_submit = sqe_tail - io_uring_smp_load_acquire(sq_khead);
 
-		completionQueue.advance();
-	}
+   if (to_submit)
+      {
+      while (U_SYSCALL(io_uring_enter, "%d,%u,%u,%u,%p,%u", ring_fd, to_submit, 0, 0, U_NULLPTR, 0) == -1 &&
+             (errno == EINTR || errno == EAGAIN || errno == EBUSY))
+         {
+         if (errno != EINTR) reap(); // NB: the completion ring is overflowed...
+         }
+      }
 }
 
-void UIORing::mapInStructuresFromKernel(io_uring_params& params)
+int UIORing::enter(uint32_t min_complete, int timeoutMS)
 {
-	submissionQueue.size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
-	completionQueue.size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+   U_TRACE(1, "UIORing::enter(%u,%d)", min_complete, timeoutMS)
 
-	if (params.features & IORING_FEAT_SINGLE_MMAP) 
-	{
-		if (completionQueue.size > submissionQueue.size) submissionQueue.size = completionQueue.size;
-		completionQueue.size = submissionQueue.size;
-	}
+   io_uring_smp_store_release(sq_ktail, sqe_tail);
 
-	submissionQueue.pointer = mmap(NULL, submissionQueue.size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), fd, IORING_OFF_SQ_RING);
-	submissionQueue.map(params, fd);
+   struct __kernel_timespec ts;
+   struct io_uring_getevents_arg arg;
 
-	if (params.features & IORING_FEAT_SINGLE_MMAP) 
-	{
-		completionQueue.pointer = submissionQueue.pointer;
-	}
-	else 
-	{
-		completionQueue.pointer = mmap(NULL, completionQueue.size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), fd, IORING_OFF_CQ_RING);
-	}
+   (void) U_SYSCALL(memset, "%p,%d,%u", &arg, 0, sizeof(arg));
 
-	completionQueue.map(params);
+   if (timeoutMS >= 0)
+      {
+      ts.tv_sec  =  timeoutMS / 1000;
+      ts.tv_nsec = (timeoutMS % 1000) * 1000000L;
+
+      arg.ts = (uint64_t)&ts;
+      }
+
+   int result = U_SYSCALL(io_uring_enter, "%d,%u,%u,%u,%p,%u", ring_fd, sqe_tail - io_uring_smp_load_acquire(sq_khead), min_complete,
+                                                              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+   U_RETURN(result);
 }
 
-/*
- * Ensure that the mmap'ed rings aren't available to a child after a fork(2).
- * This uses madvise(..., MADV_DONTFORK) on the mmap'ed ranges.
- */
-// int io_uring_ring_dontfork(struct io_uring *ring)
-// {
-// 	size_t len;
-// 	int ret;
+// COMPLETION
+
+void UIORing::markReady(int fd, uint32_t events)
+{
+   U_TRACE(0, "UIORing::markReady(%d,%B)", fd, events)
+
+   ufd* st = table+fd;
+
+   st->revents |= events;
+   st->ready    = true;
+
+   // NB: a descriptor already notified in this dispatch (by a reap nested in the dispatch) remains on the list, nextEvent() keep it for the next...
+
+   if (st->queued == false)
+      {
+      U_INTERNAL_ASSERT_MINOR(nready, table_len)
+
+      st->queued = true;
+
+      ready[nready++] = fd;
+      }
+}
+
+void UIORing::complete(uint64_t user_data, int res, uint32_t flags)
+{
+   U_TRACE(0, "UIORing::complete(%llu,%d,%B)", user_data, res, flags)
+
+   int op = (int)(user_data & 0xff),
+       fd = (int)(user_data >> 32);
+
+   if (op == OP_CANCEL) return;
+
+   ufd* st = (fd < (int)table_len ? table+fd : U_NULLPTR);
+
+   if (st == U_NULLPTR ||
+       (st->rd != user_data &&
+        st->wr != user_data))
+      {
+      // NB: completion of a request cancelled...
+
+      if ((flags & IORING_CQE_F_BUFFER) != 0) recycle(flags >> IORING_CQE_BUFFER_SHIFT);
+
+      if (op  == OP_ACCEPT &&
+          res >= 0)
+         {
+         (void) U_SYSCALL(close, "%d", res);
+         }
+
+      return;
+      }
+
+   bool more = ((flags & IORING_CQE_F_MORE) != 0);
+
+   switch (op)
+      {
+      case OP_ACCEPT:
+         {
+         if (more == false) st->rd = 0;
+
+         if (res >= 0)
+            {
+            if ((fifo_tail - fifo_head) == fifo_len)
+               {
+               int* _fifo = (int*) UMemoryPool::cmalloc(fifo_len * 2, sizeof(int), false);
+
+               for (uint32_t i = 0; i < fifo_len; ++i) _fifo[i] = fifo[(fifo_head + i) & (fifo_len - 1)];
+
+               UMemoryPool::_free(fifo, fifo_len, sizeof(int));
+
+               fifo       = _fifo;
+               fifo_head  = 0;
+               fifo_tail  = fifo_len;
+               fifo_len  *= 2;
+               }
 
-// 	if (!ring->sq.ring_ptr || !ring->sq.sqes || !ring->cq.ring_ptr)
-// 		return -EINVAL;
+            fifo[fifo_tail++ & (fifo_len - 1)] = res;
+            }
 
-// 	len = *ring->sq.kring_entries * sizeof(struct io_uring_sqe);
-// 	ret = madvise(ring->sq.sqes, len, MADV_DONTFORK);
-// 	if (ret == -1)
-// 		return -errno;
+         markReady(fd, EPOLLIN);
+         }
+      break;
 
-// 	len = ring->sq.ring_sz;
-// 	ret = madvise(ring->sq.ring_ptr, len, MADV_DONTFORK);
-// 	if (ret == -1)
-// 		return -errno;
+      case OP_RECV:
+         {
+         if (more == false) st->rd = 0;
 
-// 	if (ring->cq.ring_ptr != ring->sq.ring_ptr) {
-// 		len = ring->cq.ring_sz;
-// 		ret = madvise(ring->cq.ring_ptr, len, MADV_DONTFORK);
-// 		if (ret == -1)
-// 			return -errno;
-// 	}
+         if (res > 0)
+            {
+            U_INTERNAL_ASSERT_DIFFERS(flags & IORING_CQE_F_BUFFER, 0)
 
-// 	return 0;
-// }
+            stage(st, flags >> IORING_CQE_BUFFER_SHIFT, res);
+            }
+         else if (res == 0) st->eof = true;
+         else if (res == -ECANCELED) return;
+         else if (res == -EINVAL &&
+                  brecv_multishot)
+            {
+            // NB: kernel without multishot recv (< 6.0), from now we use poll...
 
-// bool isKernelThreadAsleep()
-	// {
-	// 	return (IO_URING_READ_ONCE(*submissionQueue.flags) & IORING_SQ_NEED_WAKEUP);
-	// }
+            brecv_multishot = false;
 
-	// int submit()
-	// {
-	// 	// notify the kernel thread that we added a new item
-	// 	unsigned numberOfSubmittedEntries = submissionQueue.flush();
+            st->kind = POLL;
+            }
+         else if (res != -ENOBUFS) st->err = -res; // NB: with -ENOBUFS we read with recv() until the request is rearmed...
 
-	// 	// unless the kernel has fallen asleep it will already have picked up our submissions
-	// 	if (isKernelThreadAsleep()) 
-	// 	{	
-	// 		int ret = io_uring_enter(ringfd, numberOfSubmittedEntries, 0, (IORING_ENTER_SQ_WAKEUP | IORING_ENTER_GETEVENTS), NULL);
+         markReady(fd, EPOLLIN);
+         }
+      break;
 
-	// 		// When the system call returns that a certain amount of SQEs have been consumed and submitted, it's safe to reuse SQE entries in the ring. 
+      case OP_POLL:
+         {
+         if (more == false) st->rd = 0;
 
-	// 		if (ret < 0) return -errno;
-	// 	} 
+         markReady(fd, (res > 0 ? (uint32_t)res : 0));
+         }
+      break;
+
+      case OP_POLLWR:
+         {
+         st->wr = 0;
+
+         markReady(fd, (res > 0 ? (uint32_t)res : 0));
+         }
+      break;
+      }
+}
+
+void UIORing::reap()
+{
+   U_TRACE_NO_PARAM(0, "UIORing::reap()")
+
+   int res;
+   uint64_t user_data;
+   uint32_t head, flags;
+   struct io_uring_cqe* cqe;
+
+   while ((head = *cq_khead) != io_uring_smp_load_acquire(cq_ktail))
+      {
+      cqe = cqes + (head & cq_mask);
+
+      res       = cqe->res;
+      flags     = cqe->flags;
+      user_data = cqe->user_data;
+
+      // NB: we release the entry before to process it because complete() can submit (and so reap) again...
+
+      io_uring_smp_store_release(cq_khead, head+1);
+
+      complete(user_data, res, flags);
+      }
+}
+
+// REQUEST
+
+void UIORing::arm(ufd* st, int fd)
+{
+   U_TRACE(0, "UIORing::arm(%p,%d)", st, fd)
+
+   UEventFd* item = st->item;
+
+   U_INTERNAL_ASSERT_POINTER(item)
+
+   struct io_uring_sqe* sqe;
+   uint32_t mask = (st->suspended ? 0 : st->mask ? st->mask : item->op_mask);
+
+   U_INTERNAL_DUMP("kind = %u mask = %B rd = %llu wr = %llu", st->kind, mask, st->rd, st->wr)
+
+   if (fd == acceptor)
+      {
+      if (st->rd == 0 &&
+          mask)
+         {
+         sqe = getSqe(fd, st->rd = getUserData(st, fd, OP_ACCEPT), IORING_OP_ACCEPT);
+
+         sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+         sqe->accept_flags = accept_flags;
+         }
+
+      if ((item->op_mask & EPOLLET) == 0 &&
+          fifo_tail != fifo_head)
+         {
+         markReady(fd, EPOLLIN); // NB: level triggered...
+         }
+
+      return;
+      }
+
+   if (st->kind == RECV)
+      {
+      if (st->rd == 0        &&
+          st->eof == false   &&
+          st->err == 0       &&
+          st->detached == false)
+         {
+         sqe = getSqe(fd, st->rd = getUserData(st, fd, OP_RECV), IORING_OP_RECV);
+
+         sqe->ioprio    = IORING_RECV_MULTISHOT;
+         sqe->flags     = IOSQE_BUFFER_SELECT;
+         sqe->buf_group = U_IORING_BUFFER_GROUP;
+         }
+
+      if ((mask & EPOLLOUT) == 0)
+         {
+         if (st->wr)
+            {
+            cancel(st->wr);
+
+            st->wr = 0;
+            }
+         }
+      else if (st->wr == 0)
+         {
+         sqe = getSqe(fd, st->wr = getUserData(st, fd, OP_POLLWR), IORING_OP_POLL_ADD);
+
+         sqe->poll32_events = EPOLLOUT;
+         }
+
+      return;
+      }
+
+   uint32_t pmask = (mask & (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLRDHUP | EPOLLET));
+
+   if (st->rd &&
+       st->pmask != pmask)
+      {
+      cancel(st->rd);
+
+      st->rd = 0;
+      }
+
+   if (st->rd == 0 &&
+       (pmask & ~EPOLLET))
+      {
+      sqe = getSqe(fd, st->rd = getUserData(st, fd, OP_POLL), IORING_OP_POLL_ADD);
+
+      sqe->poll32_events = (pmask & ~EPOLLET);
+
+      if ((pmask & EPOLLET) != 0) sqe->len = IORING_POLL_ADD_MULTI; // NB: edge triggered...
+
+      st->pmask = pmask;
+      }
+}
+
+void UIORing::insert(UEventFd* item)
+{
+   U_TRACE(0, "UIORing::insert(%p)", item)
 
-	// 	return numberOfSubmittedEntries;
-	// }
+   U_INTERNAL_ASSERT_POINTER(item)
+
+   int fd  = item->fd;
+   ufd* st = getState(fd);
+
+   U_INTERNAL_DUMP("fd = %d op_mask = %B kind = %u", fd, item->op_mask, st->kind)
+
+   st->item      = item;
+   st->mask      = 0;
+   st->suspended = false;
+
+   arm(st, fd);
+}
+
+bool UIORing::modify(UEventFd* item)
+{
+   U_TRACE(0, "UIORing::modify(%p)", item)
+
+   int fd  = item->fd;
+   ufd* st = getState(fd);
+
+   if (st->item != item ||
+       st->suspended)
+      {
+      U_RETURN(false);
+      }
+
+   st->mask = 0;
+
+   arm(st, fd);
+
+   // NB: as EPOLL_CTL_MOD we must report the data already arrived...
+
+   if (st->kind == RECV                              &&
+       (item->op_mask & (EPOLLIN | EPOLLRDHUP)) != 0 &&
+       (st->head != -1 || st->eof || st->err))
+      {
+      markReady(fd, EPOLLIN);
+      }
+
+   U_RETURN(true);
+}
+
+void UIORing::suspend(UEventFd* item)
+{
+   U_TRACE(0, "UIORing::suspend(%p)", item)
+
+   int fd  = item->fd;
+   ufd* st = getState(fd);
+
+   if (st->item != item) return;
+
+   st->suspended = true;
+
+   if (st->kind != RECV &&
+       st->rd)
+      {
+      cancel(st->rd);
+
+      st->rd = 0;
+      }
+
+   if (st->wr)
+      {
+      cancel(st->wr);
+
+      st->wr = 0;
+      }
+}
+
+void UIORing::resume(UEventFd* item, uint32_t flags)
+{
+   U_TRACE(0, "UIORing::resume(%p,%B)", item, flags)
+
+   int fd  = item->fd;
+   ufd* st = getState(fd);
+
+   st->item      = item;
+   st->mask      = flags;
+   st->suspended = false;
+
+   arm(st, fd);
+
+   if (st->kind == RECV                      &&
+       (flags & (EPOLLIN | EPOLLRDHUP)) != 0 &&
+       (st->head != -1 || st->eof || st->err))
+      {
+      markReady(fd, EPOLLIN);
+      }
+}
+
+void UIORing::update(UEventFd* item)
+{
+   U_TRACE(0, "UIORing::update(%p)", item)
+
+   int fd = item->fd;
+
+   if (fd > 0                &&
+       fd < (int)table_len   &&
+       table[fd].item == item)
+      {
+      arm(table+fd, fd);
+      }
+}
+
+void UIORing::erase(int fd)
+{
+   U_TRACE(0, "UIORing::erase(%d)", fd)
+
+   if (fd >= (int)table_len) return;
+
+   ufd* st = table+fd;
+
+   if (st->item == U_NULLPTR) return;
+
+   if (st->rd) cancel(st->rd);
+   if (st->wr) cancel(st->wr);
+
+   flushStage(st);
+
+   if (fd == acceptor)
+      {
+      while (fifo_tail != fifo_head) (void) U_SYSCALL(close, "%d", fifo[fifo_head++ & (fifo_len - 1)]);
+
+      acceptor = -1;
+      }
+
+   st->item     = U_NULLPTR;
+   st->rd       =
+   st->wr       = 0;
+   st->mask     =
+   st->pmask    =
+   st->revents  = 0;
+   st->err      = 0;
+   st->kind     = POLL;
+   st->eof      =
+   st->detached =
+   st->suspended = false;
+
+   // NB: the pending requests keep a reference to the file, so the socket is really closed only after the cancellation...
+
+   submit();
+}
+
+void UIORing::detach(int fd)
+{
+   U_TRACE(0, "UIORing::detach(%d)", fd)
+
+   if (fd >= (int)table_len) return;
+
+   ufd* st = table+fd;
+
+   if (st->kind != RECV ||
+       st->detached)
+      {
+      return;
+      }
+
+   st->detached = true;
+
+   if (st->rd)
+      {
+      cancel(st->rd);
+
+      // NB: we wait the end of the request so that the data already received are all staged...
+
+      while (st->rd)
+         {
+         if (enter(1, -1) == -1 &&
+             errno != EINTR)
+            {
+            break;
+            }
+
+         reap();
+         }
+      }
+}
+
+// EVENT
+
+int UIORing::waitForEvent(int timeoutMS)
+{
+   U_TRACE(0, "UIORing::waitForEvent(%d)", timeoutMS)
+
+   U_INTERNAL_ASSERT_DIFFERS(ring_fd, -1)
+
+   int result;
+   long deadline = (timeoutMS > 0 ? getMilliSecond() + timeoutMS : 0);
+
+loop:
+   reap();
+
+   if (nready)
+      {
+      submit();
+
+      U_RETURN(nready);
+      }
+
+   result = enter(1, timeoutMS);
+
+   if (result == -1)
+      {
+      if (errno == ETIME)
+         {
+         errno = EAGAIN;
+
+         U_RETURN(0);
+         }
+
+      if (errno != EAGAIN &&
+          errno != EBUSY)
+         {
+         U_RETURN(-1);
+         }
+      }
+
+   reap();
+
+   if (nready) U_RETURN(nready);
+
+   if (UInterrupt::event_signal_pending)
+      {
+      errno = EINTR;
+
+      U_RETURN(-1);
+      }
+
+   if (timeoutMS == 0) U_RETURN(0);
+
+   if (timeoutMS > 0 &&
+       (timeoutMS = (int)(deadline - getMilliSecond())) <= 0)
+      {
+      U_RETURN(0);
+      }
+
+   goto loop;
+}
+
+UEventFd* UIORing::nextEvent(uint32_t& revents)
+{
+   U_TRACE(0, "UIORing::nextEvent(%p)", &revents)
+
+   int fd;
+   ufd* st;
+   uint32_t n, mask;
+   UEventFd* item;
+
+   while (ready_head < nready)
+      {
+      st = table + (fd = ready[ready_head++]);
+
+      if (st->ready == false) continue;
+
+      revents = st->revents;
+                st->revents = 0;
+                st->ready   = false;
+
+      item = st->item;
+
+      U_INTERNAL_DUMP("fd = %d revents = %B item = %p", fd, revents, item)
+
+      if (item     == U_NULLPTR ||
+          item->fd != fd)
+         {
+         continue;
+         }
+
+      mask = (st->suspended ? 0 : st->mask ? st->mask : item->op_mask);
+
+      if ((mask & (EPOLLIN | EPOLLRDHUP)) == 0) revents &= ~(EPOLLIN | EPOLLRDHUP | EPOLLPRI);
+      if ((mask &  EPOLLOUT)              == 0) revents &= ~EPOLLOUT;
+
+      if (st->suspended) revents = 0;
+
+      if (revents) return item;
+
+      arm(st, fd); // NB: a request ended without event to notify...
+      }
+
+   // end of the dispatch: the descriptors with events arrived after their notification remain on the list for the next...
+
+   for (n = ready_head = 0; ready_head < nready; ++ready_head)
+      {
+      st = table + (fd = ready[ready_head]);
+
+      if (st->ready) ready[n++] = fd;
+      else           st->queued = false;
+      }
+
+   nready     = n;
+   ready_head = 0;
+
+   return U_NULLPTR;
+}
+
+int UIORing::waitForRead(int fd, int timeoutMS)
+{
+   U_TRACE(0, "UIORing::waitForRead(%d,%d)", fd, timeoutMS)
+
+   U_INTERNAL_ASSERT(isRecv(fd))
+
+   int result;
+   ufd* st = table+fd;
+   long deadline = (timeoutMS > 0 ? getMilliSecond() + timeoutMS : 0);
+
+loop:
+   if (st->head != -1 ||
+       st->eof         ||
+       st->err)
+      {
+      U_RETURN(1);
+      }
+
+   if (st->rd == 0 ||
+       U_ClientImage_parallelization == U_PARALLELIZATION_CHILD)
+      {
+      U_RETURN(-2);
+      }
+
+   if (timeoutMS == 0)
+      {
+      errno = EAGAIN;
+
+      U_RETURN(0);
+      }
+
+   // NB: the completions of the other descriptors remain on the list of ready for the next dispatch...
+
+   result = enter(1, timeoutMS);
+
+   if (result == -1)
+      {
+      if (errno == ETIME)
+         {
+         errno = EAGAIN;
+
+         U_RETURN(0);
+         }
+
+      if (errno == EINTR)
+         {
+         UInterrupt::checkForEventSignalPending();
+
+         if (UNotifier::flag_sigterm) U_RETURN(-1);
+         }
+      }
+
+   reap();
+
+   if (timeoutMS > 0 &&
+       (st->head == -1 && st->eof == false && st->err == 0) &&
+       (timeoutMS = (int)(deadline - getMilliSecond())) <= 0)
+      {
+      errno = EAGAIN;
+
+      U_RETURN(0);
+      }
+
+   goto loop;
+}
+
+// SOCKET
+
+int UIORing::accept()
+{
+   U_TRACE_NO_PARAM(0, "UIORing::accept()")
+
+   if (fifo_tail == fifo_head)
+      {
+      errno = EAGAIN;
+
+      U_RETURN(-1);
+      }
+
+   int fd = fifo[fifo_head++ & (fifo_len - 1)];
+
+   U_RETURN(fd);
+}
+
+bool UIORing::recv(int fd, void* buffer, uint32_t len, int& result)
+{
+   U_TRACE(0, "UIORing::recv(%d,%p,%u,%p)", fd, buffer, len, &result)
+
+   U_INTERNAL_ASSERT(isRecv(fd))
+
+   ufd* st = table+fd;
+
+   if (st->head != -1)
+      {
+      int bid;
+      uint32_t n;
+
+      result = 0;
+
+      while (len &&
+             (bid = st->head) != -1)
+         {
+         n = blen[bid] - st->off;
+
+         if (n > len) n = len;
+
+         U_MEMCPY((char*)buffer + result, bmem + bid * bsize + st->off, n);
+
+         result  += n;
+         len     -= n;
+         st->off += n;
+
+         if (st->off == blen[bid])
+            {
+            st->off  = 0;
+            st->head = bnext[bid];
+
+            if (st->head == -1) st->tail = -1;
+
+            recycle(bid);
+            }
+         }
+
+      U_RETURN(true);
+      }
+
+   if (U_ClientImage_parallelization == U_PARALLELIZATION_CHILD) U_RETURN(false);
+
+   if (st->err)
+      {
+      errno  = st->err;
+      result = -1;
+
+      U_RETURN(true);
+      }
+
+   if (st->eof)
+      {
+      result = 0;
+
+      U_RETURN(true);
+      }
+
+   if (st->rd) // NB: the data will arrive from the ring...
+      {
+      errno  = EAGAIN;
+      result = -1;
+
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+#endif
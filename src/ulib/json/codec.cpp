@@ -0,0 +1,426 @@
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    codec.cpp - object <=> JSON representation generated at compile time from the list of the fields
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
+
+#include <ulib/json/codec.h>
+#include <ulib/utility/escape.h>
+
+void UJsonCodec::writeString(UString& json, const char* s, uint32_t len)
+{
+   U_TRACE(0, "UJsonCodec::writeString(%V,%.*S,%u)", json.rep, len, s, len)
+
+   // NB: most of the strings need no escape, so we scan first for the first char to escape and copy the data before it in one shot...
+
+   const char* end   = s + len;
+   const char* start = s;
+
+   while (s < end &&
+          (unsigned char)*s >= 0x20 &&
+          *s != '"' &&
+          *s != '\\')
+      {
+      ++s;
+      }
+
+   uint32_t n = s - start;
+
+   (void) json.reserve(n + (end - s) * 6 + 2);
+
+   char* ptr = json.pend();
+
+   *ptr++ = '"';
+
+   if (n)
+      {
+      U_MEMCPY(ptr, start, n);
+
+      ptr += n;
+      }
+
+   for (; s < end; ++s)
+      {
+      unsigned char c = *s;
+
+      if (c >= 0x20 &&
+          c != '"'  &&
+          c != '\\')
+         {
+         *ptr++ = c;
+
+         continue;
+         }
+
+      *ptr++ = '\\';
+
+           if (c == '"')  *ptr++ = '"';
+      else if (c == '\\') *ptr++ = '\\';
+      else if (c == '\n') *ptr++ = 'n';
+      else if (c == '\r') *ptr++ = 'r';
+      else if (c == '\t') *ptr++ = 't';
+      else // \u four hex digits (unicode char)
+         {
+         u_put_unalignedp32(ptr, U_MULTICHAR_CONSTANT32('u','0','0',"0123456789ABCDEF"[c >> 4]));
+
+         ptr[4] = "0123456789ABCDEF"[c & 0x0F];
+
+         ptr += 5;
+         }
+      }
+
+   *ptr++ = '"';
+
+   json.size_adjust(ptr);
+}
+
+void UJsonCodec::write(UString& json, const UVector<UString>& vec)
+{
+   U_TRACE(0, "UJsonCodec::write(%V,%p)", json.rep, &vec)
+
+   const UVector<UStringRep*>& v = (const UVector<UStringRep*>&)vec;
+
+   push(json, '[');
+
+   for (uint32_t i = 0, n = v.size(); i < n; ++i)
+      {
+      if (i) push(json, ',');
+
+      writeString(json, U_STRING_TO_PARAM(*(v[i])));
+      }
+
+   push(json, ']');
+}
+
+// NB: return the end of the string (the closing quote) or U_NULLPTR if the string is not valid...
+
+static const char* scanString(const char* s, const char* end, bool& bescape)
+{
+   U_TRACE(0, "::scanString(%.*S,%b)", end-s, s, bescape)
+
+   U_INTERNAL_ASSERT_EQUALS(*s, '"')
+
+   bescape = false;
+
+   for (++s; s < end; ++s)
+      {
+      unsigned char c = *s;
+
+      if (c == '"') return s;
+
+      if (c < 0x20) break;
+
+      if (c == '\\')
+         {
+         bescape = true;
+
+         if (++s == end) break;
+         }
+      }
+
+   return U_NULLPTR;
+}
+
+bool UJsonCodec::readKey(Parser& p, const char*& key, uint32_t& len)
+{
+   U_TRACE(0, "UJsonCodec::readKey(%p,%p,%p)", &p, &key, &len)
+
+   bool bescape;
+   const char* s;
+
+   if (p.skipSpace() == false ||
+       *p.ptr != '"'          ||
+       (s = scanString(p.ptr, p.end, bescape)) == U_NULLPTR)
+      {
+      U_RETURN(false);
+      }
+
+   key = p.ptr+1;
+   len = s-key;
+
+   p.ptr = s+1;
+
+   U_INTERNAL_DUMP("key = %.*S", len, key)
+
+   if (p.expect(':')) U_RETURN(true);
+
+   U_RETURN(false);
+}
+
+bool UJsonCodec::read(Parser& p, bool& value)
+{
+   U_TRACE(0, "UJsonCodec::read(%p,%p)", &p, &value)
+
+   if (p.skipSpace())
+      {
+      uint32_t n = p.end - p.ptr;
+
+      if (n >= 4 &&
+          u_get_unalignedp32(p.ptr) == U_MULTICHAR_CONSTANT32('t','r','u','e'))
+         {
+         value  = true;
+         p.ptr += 4;
+
+         U_RETURN(true);
+         }
+
+      if (n >= 5 &&
+          p.ptr[4] == 'e' &&
+          u_get_unalignedp32(p.ptr) == U_MULTICHAR_CONSTANT32('f','a','l','s'))
+         {
+         value  = false;
+         p.ptr += 5;
+
+         U_RETURN(true);
+         }
+      }
+
+   U_RETURN(false);
+}
+
+bool UJsonCodec::read(Parser& p, UString& value)
+{
+   U_TRACE(0, "UJsonCodec::read(%p,%p)", &p, &value)
+
+   if (p.skipSpace() == false) U_RETURN(false);
+
+   if (*p.ptr != '"')
+      {
+      if ((p.end - p.ptr) >= 4 &&
+          u_get_unalignedp32(p.ptr) == U_MULTICHAR_CONSTANT32('n','u','l','l'))
+         {
+         value.clear();
+
+         p.ptr += 4;
+
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   bool bescape;
+   const char* s = scanString(p.ptr, p.end, bescape);
+
+   if (s == U_NULLPTR) U_RETURN(false);
+
+   const char* start = p.ptr+1;
+   uint32_t len      = s-start;
+
+   p.ptr = s+1;
+
+   if (bescape == false) value = p.json.substr(start, len);
+   else
+      {
+      UString str(len);
+
+      UEscape::decode(start, len, str);
+
+      value = str;
+      }
+
+   U_RETURN(true);
+}
+
+bool UJsonCodec::read(Parser& p, UVector<UString>& vec)
+{
+   U_TRACE(0, "UJsonCodec::read(%p,%p)", &p, &vec)
+
+   if (p.expect('[') == false) U_RETURN(false);
+
+   if (p.expect(']')) U_RETURN(true);
+
+   do {
+      UString str;
+
+      if (read(p, str) == false) U_RETURN(false);
+
+      vec.push_back(str);
+      }
+   while (p.expect(','));
+
+   if (p.expect(']')) U_RETURN(true);
+
+   U_RETURN(false);
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+
+const char* UJsonCodec::scanNumber(Parser& p, uint32_t& len, bool& breal)
+{
+   U_TRACE(0, "UJsonCodec::scanNumber(%p,%p,%p)", &p, &len, &breal)
+
+   if (p.skipSpace() == false) U_RETURN((const char*)U_NULLPTR);
+
+   const char* s     = p.ptr;
+   const char* end   = p.end;
+   const char* start = s;
+
+   breal = false;
+
+   if (*s == '-' && ++s == end) U_RETURN((const char*)U_NULLPTR);
+
+   if (s < end && *s == '0') ++s;
+   else
+      {
+      if (s == end || u__isdigit(*s) == false) U_RETURN((const char*)U_NULLPTR);
+
+      while (s < end && u__isdigit(*s)) ++s;
+      }
+
+   if (s < end &&
+       *s == '.')
+      {
+      breal = true;
+
+      if (++s == end || u__isdigit(*s) == false) U_RETURN((const char*)U_NULLPTR);
+
+      while (s < end && u__isdigit(*s)) ++s;
+      }
+
+   if (s < end &&
+       (*s == 'e' || *s == 'E'))
+      {
+      breal = true;
+
+      if (++s < end && (*s == '+' || *s == '-')) ++s;
+
+      if (s == end || u__isdigit(*s) == false) U_RETURN((const char*)U_NULLPTR);
+
+      while (s < end && u__isdigit(*s)) ++s;
+      }
+
+   len   = s-start;
+   p.ptr = s;
+
+   U_RETURN(start);
+}
+
+double UJsonCodec::toReal(const char* s, uint32_t len)
+{
+   U_TRACE(0, "UJsonCodec::toReal(%.*S,%u)", len, s, len)
+
+   // NB: the number can be at the end of the document (not null terminated)...
+
+   char buffer[64];
+
+   if (len < sizeof(buffer))
+      {
+      U_MEMCPY(buffer, s, len);
+
+      buffer[len] = '\0';
+
+      return ::strtod(buffer, U_NULLPTR);
+      }
+
+   UString tmp((const void*)s, len);
+
+   return ::strtod(tmp.c_str(), U_NULLPTR);
+}
+
+bool UJsonCodec::isInteger64(const char* s, uint32_t len)
+{
+   U_TRACE(0, "UJsonCodec::isInteger64(%.*S,%u)", len, s, len)
+
+   // NB: the number is valid JSON (without leading zero) so we can compare the digits with the limit...
+
+   if (*s == '-')
+      {
+      if (len < 20 ||
+          (len == 20 && memcmp(s+1, U_CONSTANT_TO_PARAM("9223372036854775808")) <= 0))
+         {
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   if (len < 20 ||
+       (len == 20 && memcmp(s, U_CONSTANT_TO_PARAM("18446744073709551615")) <= 0))
+      {
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+
+bool UJsonCodec::skipValue(Parser& p)
+{
+   U_TRACE(0, "UJsonCodec::skipValue(%p)", &p)
+
+   if (p.skipSpace() == false) U_RETURN(false);
+
+   char c = *p.ptr;
+
+   if (c == '"')
+      {
+      bool bescape;
+      const char* s = scanString(p.ptr, p.end, bescape);
+
+      if (s == U_NULLPTR) U_RETURN(false);
+
+      p.ptr = s+1;
+
+      U_RETURN(true);
+      }
+
+   if (c == '{' ||
+       c == '[')
+      {
+      // NB: we check only that the brackets are balanced...
+
+      uint32_t nest = 0;
+
+      while (p.ptr < p.end)
+         {
+         c = *p.ptr;
+
+         if (c == '"')
+            {
+            if (skipValue(p) == false) U_RETURN(false);
+
+            continue;
+            }
+
+         ++p.ptr;
+
+              if (c == '{' || c == '[') ++nest;
+         else if ((c == '}' || c == ']') &&
+                  --nest == 0)
+            {
+            U_RETURN(true);
+            }
+         }
+
+      U_RETURN(false);
+      }
+
+   if (c == 't' ||
+       c == 'f')
+      {
+      bool value;
+
+      return read(p, value);
+      }
+
+   if (c == 'n')
+      {
+      UString value;
+
+      return read(p, value);
+      }
+
+   bool breal;
+   uint32_t len;
+
+   if (scanNumber(p, len, breal)) U_RETURN(true);
+
+   U_RETURN(false);
+}
@@ -0,0 +1,627 @@
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    reader.cpp - incremental (pull) reader of a JSON (JavaScript Object Notation) document
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
+
+#include <ulib/json/reader.h>
+#include <ulib/utility/escape.h>
+
+#define U_JSON_ISSPACE(c) (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+
+static bool isJsonNumber(const char* s, const char* end)
+{
+   U_TRACE(0, "::isJsonNumber(%.*S)", end-s, s)
+
+   if (*s == '-' && ++s == end) U_RETURN(false);
+
+   if (*s == '0') ++s;
+   else
+      {
+      if (u__isdigit(*s) == false) U_RETURN(false);
+
+      while (s < end && u__isdigit(*s)) ++s;
+      }
+
+   if (s < end &&
+       *s == '.')
+      {
+      if (++s == end || u__isdigit(*s) == false) U_RETURN(false);
+
+      while (s < end && u__isdigit(*s)) ++s;
+      }
+
+   if (s < end &&
+       (*s == 'e' || *s == 'E'))
+      {
+      if (++s < end && (*s == '+' || *s == '-')) ++s;
+
+      if (s == end || u__isdigit(*s) == false) U_RETURN(false);
+
+      while (s < end && u__isdigit(*s)) ++s;
+      }
+
+   if (s == end) U_RETURN(true);
+
+   U_RETURN(false);
+}
+
+UJsonReader::UJsonReader() : buffer(U_CAPACITY)
+{
+   U_TRACE_CTOR(0, UJsonReader, "")
+
+   stack_max = U_JSON_READER_STACK_SIZE;
+   stack     = (uint8_t*) UMemoryPool::pmalloc(&stack_max);
+
+   reset();
+}
+
+UJsonReader::~UJsonReader()
+{
+   U_TRACE_DTOR(0, UJsonReader)
+
+   UMemoryPool::_free(stack, stack_max);
+}
+
+void UJsonReader::reset()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::reset()")
+
+   buffer.setEmpty();
+
+   pos         =
+   scan        =
+   tok_start   =
+   tok_len     =
+   depth       =
+   skip_nest   = 0;
+   last        = NEED_MORE;
+   state       = EXPECT_VALUE;
+   bfinish     =
+   berror      =
+   bskip_value =
+   bstr        =
+   bescape     = false;
+}
+
+void UJsonReader::feed(const char* ptr, uint32_t len)
+{
+   U_TRACE(0, "UJsonReader::feed(%.*S,%u)", len, ptr, len)
+
+   U_INTERNAL_DUMP("pos = %u scan = %u buffer.size() = %u", pos, scan, buffer.size())
+
+   U_INTERNAL_ASSERT_EQUALS(bfinish, false)
+
+   // drop the data already consumed (NB: the scan of the current token resume from the same point)...
+
+   if (pos)
+      {
+      if (pos == buffer.size()) buffer.setEmpty();
+      else                      buffer.moveToBeginDataInBuffer(pos);
+
+      if (scan) scan -= pos;
+
+      pos       =
+      tok_start =
+      tok_len   = 0;
+      }
+
+   (void) buffer.append(ptr, len);
+}
+
+void UJsonReader::push(bool bobject)
+{
+   U_TRACE(0, "UJsonReader::push(%b)", bobject)
+
+   U_INTERNAL_DUMP("depth = %u stack_max = %u", depth, stack_max)
+
+   if (depth == stack_max)
+      {
+      uint32_t n = stack_max * 2;
+
+      uint8_t* ptr = (uint8_t*) UMemoryPool::pmalloc(&n);
+
+      U_MEMCPY(ptr, stack, stack_max);
+
+      UMemoryPool::_free(stack, stack_max);
+
+      stack     = ptr;
+      stack_max = n;
+      }
+
+   stack[depth++] = state | (bobject ? 0x80 : 0);
+
+   state = (bobject ? EXPECT_FIRST_KEY : EXPECT_FIRST_VALUE);
+}
+
+int UJsonReader::fail()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::fail()")
+
+   U_INTERNAL_DUMP("pos = %u state = %u depth = %u", pos, state, depth)
+
+   berror = true;
+
+   U_RETURN(INVALID);
+}
+
+int UJsonReader::scanString(int event)
+{
+   U_TRACE(0, "UJsonReader::scanString(%d)", event)
+
+   U_INTERNAL_ASSERT_EQUALS(buffer.c_char(pos), '"')
+
+   const char* s   = buffer.data();
+   uint32_t i      = (scan > pos ? scan : pos+1),
+            len    = buffer.size();
+   unsigned char c;
+
+   while (i < len)
+      {
+      c = s[i];
+
+      if (c == '"')
+         {
+         tok_start = pos+1;
+         tok_len   = i-tok_start;
+         pos       = i+1;
+         scan      = 0;
+         state     = (event == KEY ? (uint8_t)EXPECT_COLON : (depth ? (uint8_t)EXPECT_COMMA : (uint8_t)DONE));
+
+         U_RETURN(event);
+         }
+
+      if (c < 0x20) U_RETURN(fail());
+
+      if (c != '\\')
+         {
+         ++i;
+
+         continue;
+         }
+
+      // NB: the escape sequence can be split between two chunk...
+
+      if ((i+1) == len) break;
+
+      c = s[i+1];
+
+      if (c != 'u')
+         {
+         if (c == '\0' ||
+             strchr("\"\\/bfnrt", c) == U_NULLPTR)
+            {
+            U_RETURN(fail());
+            }
+
+         i += 2;
+
+         continue;
+         }
+
+      if ((i+6) > len) break;
+
+      if (u__isxdigit(s[i+2]) == false ||
+          u__isxdigit(s[i+3]) == false ||
+          u__isxdigit(s[i+4]) == false ||
+          u__isxdigit(s[i+5]) == false)
+         {
+         U_RETURN(fail());
+         }
+
+      i += 6;
+      }
+
+   scan = i;
+
+   if (bfinish) U_RETURN(fail());
+
+   U_RETURN(NEED_MORE);
+}
+
+int UJsonReader::scanNumber()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::scanNumber()")
+
+   const char* s = buffer.data();
+   uint32_t i    = (scan > pos ? scan : pos),
+            len  = buffer.size();
+
+   while (i < len)
+      {
+      char c = s[i];
+
+      if (u__isdigit(c) == false &&
+          c != '-' && c != '+'   &&
+          c != '.' && c != 'e'   && c != 'E')
+         {
+         break;
+         }
+
+      ++i;
+      }
+
+   if (i == len &&
+       bfinish == false)
+      {
+      scan = i;
+
+      U_RETURN(NEED_MORE);
+      }
+
+   if (isJsonNumber(s+pos, s+i) == false) U_RETURN(fail());
+
+   tok_start = pos;
+   tok_len   = i-pos;
+   pos       = i;
+   scan      = 0;
+   state     = (depth ? EXPECT_COMMA : DONE);
+
+   U_RETURN(NUMBER);
+}
+
+int UJsonReader::scanLiteral(const char* literal, uint32_t len, int event)
+{
+   U_TRACE(0, "UJsonReader::scanLiteral(%.*S,%u,%d)", len, literal, len, event)
+
+   uint32_t n = buffer.size() - pos;
+
+   if (n < len)
+      {
+      if (bfinish ||
+          memcmp(buffer.c_pointer(pos), literal, n))
+         {
+         U_RETURN(fail());
+         }
+
+      U_RETURN(NEED_MORE);
+      }
+
+   if (memcmp(buffer.c_pointer(pos), literal, len)) U_RETURN(fail());
+
+   tok_start = pos;
+   tok_len   = len;
+   pos      += len;
+   state     = (depth ? EXPECT_COMMA : DONE);
+
+   U_RETURN(event);
+}
+
+int UJsonReader::nextToken()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::nextToken()")
+
+   char c;
+   const char* s = buffer.data();
+   uint32_t len  = buffer.size();
+
+loop:
+   if (state == DONE) U_RETURN(END_DOCUMENT);
+
+   while (pos < len && U_JSON_ISSPACE(s[pos])) ++pos;
+
+   if (pos == len)
+      {
+      if (bfinish) U_RETURN(fail());
+
+      U_RETURN(NEED_MORE);
+      }
+
+   c = s[pos];
+
+   U_INTERNAL_DUMP("c = %C state = %u depth = %u", c, state, depth)
+
+   switch (state)
+      {
+      case EXPECT_COMMA:
+         {
+         if (c == ',')
+            {
+            ++pos;
+
+            state = (isObject() ? EXPECT_KEY : EXPECT_VALUE);
+
+            goto loop;
+            }
+
+         if (c == (isObject() ? '}' : ']'))
+            {
+            ++pos;
+
+            int event = (isObject() ? END_OBJECT : END_ARRAY);
+
+            pop();
+
+            U_RETURN(event);
+            }
+
+         U_RETURN(fail());
+         }
+
+      case EXPECT_COLON:
+         {
+         if (c != ':') U_RETURN(fail());
+
+         ++pos;
+
+         state = EXPECT_VALUE;
+
+         goto loop;
+         }
+
+      case EXPECT_FIRST_KEY:
+         {
+         if (c == '}')
+            {
+            ++pos;
+
+            pop();
+
+            U_RETURN(END_OBJECT);
+            }
+         }
+      /* FALLTHRU */
+      case EXPECT_KEY:
+         {
+         if (c != '"') U_RETURN(fail());
+
+         U_RETURN(scanString(KEY));
+         }
+
+      case EXPECT_FIRST_VALUE:
+         {
+         if (c == ']')
+            {
+            ++pos;
+
+            pop();
+
+            U_RETURN(END_ARRAY);
+            }
+         }
+      /* FALLTHRU */
+      case EXPECT_VALUE: break;
+      }
+
+   switch (c)
+      {
+      case '{':
+      case '[':
+         {
+         ++pos;
+
+         state = (depth ? EXPECT_COMMA : DONE);
+
+         push(c == '{');
+
+         U_RETURN(c == '{' ? START_OBJECT : START_ARRAY);
+         }
+
+      case '"': U_RETURN(scanString(STRING));
+      case 't': U_RETURN(scanLiteral(U_CONSTANT_TO_PARAM("true"),  TRUE_VALUE));
+      case 'f': U_RETURN(scanLiteral(U_CONSTANT_TO_PARAM("false"), FALSE_VALUE));
+      case 'n': U_RETURN(scanLiteral(U_CONSTANT_TO_PARAM("null"),  NULL_VALUE));
+
+      case '-':
+      case '0': case '1': case '2': case '3': case '4':
+      case '5': case '6': case '7': case '8': case '9': U_RETURN(scanNumber());
+      }
+
+   U_RETURN(fail());
+}
+
+bool UJsonReader::skipSubtree()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::skipSubtree()")
+
+   U_INTERNAL_DUMP("skip_nest = %u bstr = %b bescape = %b", skip_nest, bstr, bescape)
+
+   U_INTERNAL_ASSERT_MAJOR(skip_nest, 0)
+
+   const char* s = buffer.data();
+   uint32_t len  = buffer.size();
+
+   for (; pos < len; ++pos)
+      {
+      char c = s[pos];
+
+      if (bstr)
+         {
+              if (bescape)   bescape = false;
+         else if (c == '\\') bescape = true;
+         else if (c == '"')  bstr    = false;
+
+         continue;
+         }
+
+      switch (c)
+         {
+         case '"': bstr = true; break;
+
+         case '{':
+         case '[': ++skip_nest; break;
+
+         case '}':
+         case ']':
+            {
+            if (--skip_nest == 0)
+               {
+               ++pos;
+
+               U_RETURN(true);
+               }
+            }
+         break;
+         }
+      }
+
+   if (bfinish) (void) fail();
+
+   U_RETURN(false);
+}
+
+int UJsonReader::next()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::next()")
+
+   int event;
+
+   if (berror) U_RETURN(INVALID);
+
+loop:
+   if (skip_nest &&
+       skipSubtree() == false)
+      {
+      U_RETURN(berror ? INVALID : NEED_MORE);
+      }
+
+   event = nextToken();
+
+   if (bskip_value &&
+       event > INVALID)
+      {
+      bskip_value = false;
+
+      if (event == START_OBJECT ||
+          event == START_ARRAY)
+         {
+         pop();
+
+         skip_nest = 1;
+         }
+
+      goto loop;
+      }
+
+   last = event;
+
+   U_RETURN(event);
+}
+
+void UJsonReader::skip()
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::skip()")
+
+   U_INTERNAL_DUMP("last = %d", last)
+
+   if (last == KEY) bskip_value = true;
+   else if (last == START_OBJECT ||
+            last == START_ARRAY)
+      {
+      pop();
+
+      skip_nest = 1;
+      }
+
+   last = NEED_MORE;
+}
+
+UString UJsonReader::getString() const
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::getString()")
+
+   const char* ptr = getData();
+
+   if (memchr(ptr, '\\', tok_len) == U_NULLPTR)
+      {
+      UString str((const void*)ptr, tok_len);
+
+      U_RETURN_STRING(str);
+      }
+
+   UString str(tok_len);
+
+   UEscape::decode(ptr, tok_len, str);
+
+   U_RETURN_STRING(str);
+}
+
+bool UJsonReader::isReal() const
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::isReal()")
+
+   const char* ptr = getData();
+
+   for (uint32_t i = 0; i < tok_len; ++i)
+      {
+      if (ptr[i] == '.' ||
+          ptr[i] == 'e' ||
+          ptr[i] == 'E')
+         {
+         U_RETURN(true);
+         }
+      }
+
+   U_RETURN(false);
+}
+
+double UJsonReader::getReal() const
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::getReal()")
+
+   // NB: the number can be at the end of the buffer (not null terminated)...
+
+   UString tmp((const void*)getData(), tok_len);
+
+   double real = ::strtod(tmp.c_str(), U_NULLPTR);
+
+   U_RETURN(real);
+}
+
+int64_t UJsonReader::getInteger() const
+{
+   U_TRACE_NO_PARAM(0, "UJsonReader::getInteger()")
+
+   const char* ptr = getData();
+
+   if (*ptr == '-')
+      {
+      int64_t value = u_strtoll(ptr, ptr+tok_len);
+
+      U_RETURN(value);
+      }
+
+   int64_t value = (int64_t) u_strtoull(ptr, ptr+tok_len);
+
+   U_RETURN(value);
+}
+
+// DEBUG
+
+#ifdef DEBUG
+const char* UJsonReader::dump(bool _reset) const
+{
+#ifdef U_STDCPP_ENABLE
+   *UObjectIO::os << "pos         " << pos         << '\n'
+                  << "scan        " << scan        << '\n'
+                  << "last        " << last        << '\n'
+                  << "depth       " << depth       << '\n'
+                  << "state       " << (int)state  << '\n'
+                  << "berror      " << berror      << '\n'
+                  << "bfinish     " << bfinish     << '\n'
+                  << "tok_len     " << tok_len     << '\n'
+                  << "tok_start   " << tok_start   << '\n'
+                  << "skip_nest   " << skip_nest   << '\n'
+                  << "bskip_value " << bskip_value << '\n'
+                  << "buffer      (UString        " << (void*)&buffer << ')';
+
+   if (_reset)
+      {
+      UObjectIO::output();
+
+      return UObjectIO::buffer_output;
+      }
+#endif
+
+   return U_NULLPTR;
+}
+#endif
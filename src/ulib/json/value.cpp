@@ -15,17 +15,41 @@
 #include <ulib/json/value.h>
 #include <ulib/utility/escape.h>
 
-int                       UValue::pos;
-int                       UValue::jsonParseFlags;
-char*                     UValue::pstringify;
-uint32_t                  UValue::size_output;
-UValue::jval              UValue::o;
-UFlatBuffer*              UValue::pfb;
-UValue::parser_stack_data UValue::sd[U_JSON_PARSE_STACK_SIZE];
+int                                  UValue::jsonParseFlags;
+UFlatBuffer*                         UValue::pfb;
+U_JSON_TLS int                       UValue::pos;
+U_JSON_TLS char*                     UValue::pstringify;
+U_JSON_TLS uint32_t                  UValue::size_output;
+U_JSON_TLS uint32_t                  UValue::sd_max;
+U_JSON_TLS uint32_t*                 UValue::sindex;
+U_JSON_TLS uint32_t                  UValue::sindex_max;
+U_JSON_TLS UValue::jval              UValue::o;
+U_JSON_TLS UValue::parser_stack_data* UValue::sd;
 
 #ifdef DEBUG
-uint32_t UValue::cnt_real;
-uint32_t UValue::cnt_mreal;
+U_JSON_TLS uint32_t UValue::cnt_real;
+U_JSON_TLS uint32_t UValue::cnt_mreal;
+#endif
+
+#if defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+static pthread_key_t   parser_key;
+static pthread_once_t  parser_once = PTHREAD_ONCE_INIT;
+static U_JSON_TLS bool parser_init;
+
+static void createParserKey() { (void) pthread_key_create(&parser_key, UValue::clearParser); }
+
+static inline void useParser() // NB: the memory of the parser of the thread is released at the exit of the thread...
+{
+   if (parser_init == false)
+      {
+      parser_init = true;
+
+      (void) pthread_once(&parser_once, createParserKey);
+      (void) pthread_setspecific(parser_key, (void*)1);
+      }
+}
+#else
+#  define useParser()
 #endif
 
 enum jsonParseFlagsType {
@@ -1057,10 +1081,339 @@ void UValue::toFlatBuffer(UFlatBuffer& fb, UString& result) const
    if (breset2) UFlatBuffer::setStack(prev_stack, prev_stack_size);
 }
 
+/**
+ * Stage 1 of the parser: classification of a block of 64 bytes of the document in bitmask (one bit for byte)
+ *
+ * space => ' ', '\t', '\n', '\v', '\f', '\r' (the same of u__isspace())
+ * op    => '{', '}', '[', ']', ':', ','
+ */
+
+typedef struct json_block {
+   uint64_t quote, backslash, slash, op, space;
+} json_block;
+
+typedef void (*json_classify_t)(const unsigned char* restrict, json_block* restrict);
+
+static void json_classify_generic(const unsigned char* restrict p, json_block* restrict b)
+{
+   U_INTERNAL_TRACE("json_classify_generic(%p,%p)", p, b)
+
+   unsigned char c;
+   uint64_t bit = 1ULL;
+
+   b->quote = b->backslash = b->slash = b->op = b->space = 0ULL;
+
+   for (uint32_t i = 0; i < 64; ++i, bit <<= 1)
+      {
+      c = p[i];
+
+      switch (c)
+         {
+         case '"':  b->quote     |= bit; break;
+         case '\\': b->backslash |= bit; break;
+         case '/':  b->slash     |= bit; break;
+
+         case '{':
+         case '}':
+         case '[':
+         case ']':
+         case ':':
+         case ',': b->op |= bit; break;
+
+         default: if (u__isspace(c)) b->space |= bit; break;
+         }
+      }
+}
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#  include <immintrin.h>
+
+static void json_classify_sse2(const unsigned char* restrict p, json_block* restrict b)
+{
+   U_INTERNAL_TRACE("json_classify_sse2(%p,%p)", p, b)
+
+   __m128i v, x, lower;
+   uint64_t m, shift = 0;
+   const __m128i quote     = _mm_set1_epi8('"'),
+                 backslash = _mm_set1_epi8('\\'),
+                 slash     = _mm_set1_epi8('/'),
+                 brace     = _mm_set1_epi8('{'),  // '{' and '[' differ only for the bit 0x20
+                 cbrace    = _mm_set1_epi8('}'),  // '}' and ']' differ only for the bit 0x20
+                 colon     = _mm_set1_epi8(':'),
+                 comma     = _mm_set1_epi8(','),
+                 bit20     = _mm_set1_epi8(0x20),
+                 blank     = _mm_set1_epi8(' '),
+                 tab       = _mm_set1_epi8(-'\t'),
+                 four      = _mm_set1_epi8(4);
+
+   b->quote = b->backslash = b->slash = b->op = b->space = 0ULL;
+
+   for (; shift < 64; shift += 16)
+      {
+      v     = _mm_loadu_si128((const __m128i*)(p + shift));
+      lower = _mm_or_si128(v, bit20);
+
+      m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote));     b->quote     |= m << shift;
+      m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)); b->backslash |= m << shift;
+      m = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, slash));     b->slash     |= m << shift;
+
+      x = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(lower, brace), _mm_cmpeq_epi8(lower, cbrace)),
+                       _mm_or_si128(_mm_cmpeq_epi8(v,     colon), _mm_cmpeq_epi8(v,     comma)));
+
+      m = (uint32_t)_mm_movemask_epi8(x); b->op |= m << shift;
+
+      x = _mm_add_epi8(v, tab); // '\t'..'\r' => 0..4
+
+      x = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(x, four), x), _mm_cmpeq_epi8(v, blank));
+
+      m = (uint32_t)_mm_movemask_epi8(x); b->space |= m << shift;
+      }
+}
+
+#  ifdef HAVE_BUILTIN_CPU_INIT
+static U_CPU_SUPPORT(avx2, void json_classify_avx2(const unsigned char* restrict p, json_block* restrict b))
+{
+   U_INTERNAL_TRACE("json_classify_avx2(%p,%p)", p, b)
+
+   __m256i v, x, lower;
+   uint64_t m, shift = 0;
+   const __m256i quote     = _mm256_set1_epi8('"'),
+                 backslash = _mm256_set1_epi8('\\'),
+                 slash     = _mm256_set1_epi8('/'),
+                 brace     = _mm256_set1_epi8('{'),
+                 cbrace    = _mm256_set1_epi8('}'),
+                 colon     = _mm256_set1_epi8(':'),
+                 comma     = _mm256_set1_epi8(','),
+                 bit20     = _mm256_set1_epi8(0x20),
+                 blank     = _mm256_set1_epi8(' '),
+                 tab       = _mm256_set1_epi8(-'\t'),
+                 four      = _mm256_set1_epi8(4);
+
+   b->quote = b->backslash = b->slash = b->op = b->space = 0ULL;
+
+   for (; shift < 64; shift += 32)
+      {
+      v     = _mm256_loadu_si256((const __m256i*)(p + shift));
+      lower = _mm256_or_si256(v, bit20);
+
+      m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote));     b->quote     |= m << shift;
+      m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)); b->backslash |= m << shift;
+      m = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, slash));     b->slash     |= m << shift;
+
+      x = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(lower, brace), _mm256_cmpeq_epi8(lower, cbrace)),
+                          _mm256_or_si256(_mm256_cmpeq_epi8(v,     colon), _mm256_cmpeq_epi8(v,     comma)));
+
+      m = (uint32_t)_mm256_movemask_epi8(x); b->op |= m << shift;
+
+      x = _mm256_add_epi8(v, tab);
+
+      x = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(x, four), x), _mm256_cmpeq_epi8(v, blank));
+
+      m = (uint32_t)_mm256_movemask_epi8(x); b->space |= m << shift;
+      }
+}
+#  endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+
+static inline uint64_t json_movemask_neon(uint8x16_t v) // NB: there is no movemask on NEON...
+{
+   static const uint8_t weight[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+   uint8x16_t m = vandq_u8(v, vld1q_u8(weight));
+
+   m = vpaddq_u8(m, m);
+   m = vpaddq_u8(m, m);
+   m = vpaddq_u8(m, m);
+
+   return vgetq_lane_u16(vreinterpretq_u16_u8(m), 0);
+}
+
+static void json_classify_neon(const unsigned char* restrict p, json_block* restrict b)
+{
+   U_INTERNAL_TRACE("json_classify_neon(%p,%p)", p, b)
+
+   uint64_t shift = 0;
+   uint8x16_t v, x, lower;
+   const uint8x16_t quote     = vdupq_n_u8('"'),
+                    backslash = vdupq_n_u8('\\'),
+                    slash     = vdupq_n_u8('/'),
+                    brace     = vdupq_n_u8('{'),
+                    cbrace    = vdupq_n_u8('}'),
+                    colon     = vdupq_n_u8(':'),
+                    comma     = vdupq_n_u8(','),
+                    bit20     = vdupq_n_u8(0x20),
+                    blank     = vdupq_n_u8(' '),
+                    tab       = vdupq_n_u8('\t'),
+                    four      = vdupq_n_u8(4);
+
+   b->quote = b->backslash = b->slash = b->op = b->space = 0ULL;
+
+   for (; shift < 64; shift += 16)
+      {
+      v     = vld1q_u8(p + shift);
+      lower = vorrq_u8(v, bit20);
+
+      b->quote     |= json_movemask_neon(vceqq_u8(v, quote))     << shift;
+      b->backslash |= json_movemask_neon(vceqq_u8(v, backslash)) << shift;
+      b->slash     |= json_movemask_neon(vceqq_u8(v, slash))     << shift;
+
+      x = vorrq_u8(vorrq_u8(vceqq_u8(lower, brace), vceqq_u8(lower, cbrace)),
+                   vorrq_u8(vceqq_u8(v,     colon), vceqq_u8(v,     comma)));
+
+      b->op |= json_movemask_neon(x) << shift;
+
+      x = vorrq_u8(vcleq_u8(vsubq_u8(v, tab), four), vceqq_u8(v, blank));
+
+      b->space |= json_movemask_neon(x) << shift;
+      }
+}
+#endif
+
+static json_classify_t json_classify;
+
+static inline uint64_t json_prefix_xor(uint64_t x) // NB: bit i of the result is the xor of the bits 0..i of x...
+{
+   x ^= x <<  1;
+   x ^= x <<  2;
+   x ^= x <<  4;
+   x ^= x <<  8;
+   x ^= x << 16;
+   x ^= x << 32;
+
+   return x;
+}
+
+uint32_t UValue::buildStructuralIndex(const char* s, uint32_t len)
+{
+   U_TRACE(0, "UValue::buildStructuralIndex(%.*S,%u)", len, s, len)
+
+   if (json_classify == U_NULLPTR)
+      {
+      json_classify = json_classify_generic;
+
+#  if defined(__x86_64__) && defined(__SSE2__)
+      json_classify = json_classify_sse2;
+
+#   ifdef HAVE_BUILTIN_CPU_INIT
+      __builtin_cpu_init();
+
+      if (__builtin_cpu_supports("avx2")) json_classify = json_classify_avx2;
+#   endif
+#  elif defined(__aarch64__) && defined(__ARM_NEON)
+      json_classify = json_classify_neon;
+#  endif
+      }
+
+   json_block b;
+   uint32_t base, nspace = 0;
+
+   // NB: the index pay off only if there is enough whitespace to skip (pretty-printed document), we decide on the first 1k...
+
+   for (base = 0; (base + 64) <= len && base < 1024; base += 64)
+      {
+      json_classify((const unsigned char*)s + base, &b);
+
+      nspace += __builtin_popcountll(b.space);
+      }
+
+   if ((nspace * 3) < base) U_RETURN(0);
+
+   if (sindex_max <= len)
+      {
+      if (sindex) UMemoryPool::_free(sindex, sindex_max, sizeof(uint32_t));
+
+      sindex_max = len + 64 + 1; // NB: the positions are extracted 64 at a time...
+
+      sindex = (uint32_t*) UMemoryPool::pmalloc(&sindex_max, sizeof(uint32_t));
+
+      useParser();
+      }
+
+   const uint64_t even = 0x5555555555555555ULL;
+   unsigned char tail[64];
+   const unsigned char* p;
+   uint32_t* restrict ptr;
+   uint64_t overflow, bs_start, even_start, odd_start, even_carry, odd_carry, odd_end, quote, in_string, scalar, structural,
+            prev_odd_backslash = 0ULL, prev_in_string = 0ULL, prev_scalar = 0ULL;
+
+   for (ptr = sindex, base = 0; base < len; base += 64)
+      {
+      p = (const unsigned char*)s + base;
+
+      if ((len - base) < 64) // NB: the last block is padded with space...
+         {
+         (void) memset(tail, ' ', sizeof(tail));
+
+         U_MEMCPY(tail, p, len - base);
+
+         p = tail;
+         }
+
+      json_classify(p, &b);
+
+      // find the characters escaped by an odd sequence of backslash (@see simdjson find_odd_backslash_sequences)
+
+      bs_start   = b.backslash & ~(b.backslash << 1);
+      even_start = bs_start &  (even ^ prev_odd_backslash);
+      odd_start  = bs_start & ~(even ^ prev_odd_backslash);
+
+      even_carry = b.backslash + even_start;
+      odd_carry  = b.backslash + odd_start;
+
+      overflow = (odd_carry < b.backslash); // NB: an odd sequence of backslash continue in the next block...
+
+      odd_carry |= prev_odd_backslash;
+
+      prev_odd_backslash = overflow;
+
+      odd_end = ((even_carry & ~b.backslash) & ~even) |
+                ((odd_carry  & ~b.backslash) &  even);
+
+      quote     = b.quote & ~odd_end;
+      in_string = json_prefix_xor(quote) ^ prev_in_string; // NB: the opening quote is inside, the closing quote outside...
+
+      prev_in_string = (uint64_t)((int64_t)in_string >> 63);
+
+      if ((b.slash & ~in_string) != 0ULL) U_RETURN(0); // NB: the comments are managed by the parser without index...
+
+      scalar = ~(b.op | b.space | quote);
+
+      structural = (b.op & ~in_string) |
+                   quote               |
+                   (scalar & ~((scalar << 1) | prev_scalar) & ~in_string);
+
+      prev_scalar = scalar >> 63;
+
+      while (structural)
+         {
+         *ptr++      = base + __builtin_ctzll(structural);
+         structural &= structural - 1;
+         }
+      }
+
+   if (prev_in_string) U_RETURN(0); // NB: the document end inside a string...
+
+   *ptr++ = len;
+
+   U_RETURN(ptr - sindex);
+}
+
 bool UValue::parse(const UString& document)
 {
    U_TRACE(0, "UValue::parse(%V)", document.rep)
 
+   bool result = (document.size() >= U_JSON_PARSE_INDEX_SIZE &&
+                  buildStructuralIndex(document.data(), document.size()) ? _parse<true>(document)
+                                                                         : _parse<false>(document));
+
+   U_RETURN(result);
+}
+
+template <bool bindex> bool UValue::_parse(const UString& document)
+{
+   U_TRACE(0, "UValue::_parse<%b>(%V)", bindex, document.rep)
+
    static const int dispatch_table[] = {
       0,/* '!' */
       (int)((char*)&&case_dquote-(char*)&&cdefault),/* '"' */
@@ -1173,7 +1526,9 @@ bool UValue::parse(const UString& document)
    UStringRep* rep;
    const char* start;
    uint64_t integerPart;
+   const uint32_t* pidx = (bindex ? sindex : U_NULLPTR);
    const char* s = document.data();
+   const char* const base = s;
    const char* end = s + (size_output = document.size());
    uint32_t sz, significandDigit, decimalDigit, exponent;
    bool minus = false, colon = false, comma = false, separator = true;
@@ -1184,7 +1539,15 @@ bool UValue::parse(const UString& document)
 
    while (s < end)
       {
-loop: while (u__isspace(*s)) ++s;
+loop: if (bindex == false) while (u__isspace(*s)) ++s;
+      else
+         {
+         // NB: the characters between a space and the next structural character are all space...
+
+         while (base + *pidx < s && *pidx < size_output) ++pidx;
+
+         if (u__isspace(*s)) s = base + *pidx;
+         }
 
       if (s > end) break;
 
@@ -1199,7 +1562,13 @@ case_dquote:
 
       if ((jsonParseFlags & CHECK_FOR_UTF) == 0)
          {
-         s = u_find_char(s, end, '"');
+         if (bindex == false) s = u_find_char(s, end, '"');
+         else
+            {
+            U_INTERNAL_ASSERT_EQUALS(base + pidx[0], start)
+
+            s = base + *++pidx; // NB: the closing quote...
+            }
 
          goto dquote_assign;
          }
@@ -1779,10 +2148,12 @@ next: U_INTERNAL_DUMP("next: comma = %b pos = %d colon = %b separator = %b s = %
       }
 
 cdefault:
-   U_INTERNAL_DUMP("cdefault: pos = %d sd[0].obj = %b sd[0].tails = %p sd[0].keys = %#llx", pos, sd[0].obj, sd[0].tails, sd[0].keys)
+   U_INTERNAL_DUMP("cdefault: pos = %d sd = %p", pos, sd)
 
    if (pos >= 0)
       {
+      U_INTERNAL_DUMP("sd[0].obj = %b sd[0].tails = %p sd[0].keys = %#llx", sd[0].obj, sd[0].tails, sd[0].keys)
+
       if (sd[0].obj == false) value.ival = (sd[0].tails ? listToValue(U_ARRAY_VALUE, sd[0].tails) : o.ival);
       else
          {
@@ -1805,6 +2176,54 @@ cdefault:
    U_RETURN(false);
 }
 
+void UValue::clearParser(void* ptr)
+{
+   U_TRACE(0, "UValue::clearParser(%p)", ptr)
+
+   if (sd)
+      {
+      UMemoryPool::_free(sd, sd_max, sizeof(parser_stack_data));
+
+      sd     = U_NULLPTR;
+      sd_max = 0;
+      }
+
+   if (sindex)
+      {
+      UMemoryPool::_free(sindex, sindex_max, sizeof(uint32_t));
+
+      sindex     = U_NULLPTR;
+      sindex_max = 0;
+      }
+
+#if defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+   parser_init = false;
+#endif
+}
+
+void UValue::growStackParser()
+{
+   U_TRACE_NO_PARAM(0, "UValue::growStackParser()")
+
+   U_INTERNAL_DUMP("pos = %d sd_max = %u", pos, sd_max)
+
+   uint32_t n = (sd_max ? sd_max * 2 : U_JSON_PARSE_STACK_SIZE);
+
+   parser_stack_data* ptr = (parser_stack_data*) UMemoryPool::pmalloc(&n, sizeof(parser_stack_data));
+
+   if (sd)
+      {
+      U_MEMCPY(ptr, sd, sd_max * sizeof(parser_stack_data));
+
+      UMemoryPool::_free(sd, sd_max, sizeof(parser_stack_data));
+      }
+
+   sd     = ptr;
+   sd_max = n;
+
+   useParser();
+}
+
 void UValue::nextParser()
 {
    U_TRACE_NO_PARAM(0, "UValue::nextParser()")
@@ -1890,9 +2309,9 @@ void UValue::nextParser()
 #define U_JR_QPARAM  (U_COMPACT_VALUE+5) // 14 "*" query string parameter
 #define U_JR_EOBJECT (U_COMPACT_VALUE+6) // 15 "}"
 
-int      UValue::jread_error;
-uint32_t UValue::jread_pos;
-uint32_t UValue::jread_elements;
+U_JSON_TLS int      UValue::jread_error;
+U_JSON_TLS uint32_t UValue::jread_pos;
+U_JSON_TLS uint32_t UValue::jread_elements;
 
 U_NO_EXPORT int UValue::jreadFindToken(UTokenizer& tok)
 {
@@ -64,6 +64,7 @@ ULog::ULog(const UString& path, uint32_t _size) : UFile(path, U_NULLPTR)
    ptr_log_data = U_NULLPTR;
 
    U_Log_syslog(this)         =
+   U_Log_binary(this)         =
    U_Log_start_stop_msg(this) = false;
 
 #ifdef USE_LIBZ
@@ -91,18 +92,23 @@ ULog::ULog(const UString& path, uint32_t _size) : UFile(path, U_NULLPTR)
 
    /**
     * typedef struct log_data {
-    *  uint32_t file_ptr;
+    *  uint64_t file_ptr;
+    *  uint64_t file_commit;
     *  uint32_t file_page;
-    *  uint32_t gzip_len;
+    *  uint32_t rotate_len;
+    *  uint32_t rotate_cnt;
     *  sem_t lock_shared;
-    *  // --------------> maybe unnamed array of char for gzip compression...
+    *  char rotate_lock;
+    *  // --------------> maybe unnamed array of char for log rotate (copy of the data + gzip compression)...
     * } log_data;
     */
 
    ptr_log_data = U_MALLOC_TYPE(log_data);
 
-   ptr_log_data->file_ptr = 0;
-   ptr_log_data->gzip_len = 0;
+   ptr_log_data->file_ptr    =
+   ptr_log_data->rotate_len  =
+   ptr_log_data->rotate_cnt  = 0;
+   ptr_log_data->rotate_lock = 0;
 
    if (_size)
       {
@@ -129,17 +135,18 @@ ULog::ULog(const UString& path, uint32_t _size) : UFile(path, U_NULLPTR)
 
          if (ptr) ptr_log_data->file_ptr = ptr - UFile::map;
 
-         U_INTERNAL_ASSERT_MINOR(ptr_log_data->file_ptr, UFile::st_size)
+         U_INTERNAL_ASSERT_MINOR((uint32_t)ptr_log_data->file_ptr, UFile::st_size)
          }
 
       log_file_sz = UFile::st_size;
       }
 
-   U_INTERNAL_DUMP("UFile::map = %p ptr_log_data->file_ptr = %u log_file_sz = %u", UFile::map, ptr_log_data->file_ptr, log_file_sz)
+   U_INTERNAL_DUMP("UFile::map = %p ptr_log_data->file_ptr = %llu log_file_sz = %u", UFile::map, ptr_log_data->file_ptr, log_file_sz)
 
-   U_INTERNAL_ASSERT(ptr_log_data->file_ptr <= UFile::st_size)
+   U_INTERNAL_ASSERT((uint32_t)ptr_log_data->file_ptr <= UFile::st_size)
 
-   ptr_log_data->file_page = ptr_log_data->file_ptr;
+   ptr_log_data->file_commit = ptr_log_data->file_ptr;
+   ptr_log_data->file_page   = (uint32_t)ptr_log_data->file_ptr;
 }
 
 void ULog::initDate()
@@ -423,7 +430,122 @@ void ULog::updateDate3(char* ptr_date)
 #endif
 }
 
-void ULog::write(const struct iovec* iov, int n)
+// NB: the writers (also of different processes) reserve the space for the record with an atomic add on the shared offset
+//     and copy the data without lock. The writer whose record go over the end of the log wait for the previous writers,
+//     copy the data of the log in the shared area and restart the log from the beginning (the gzip compression of the copy
+//     is done by a thread of the parent process with checkForLogRotateDataToWrite()). Every restart of the log is a new
+//     generation (the high 32 bits of the offset and of the counter of the bytes copied): a writer that is late with the
+//     copy (we don't wait forever for a writer died in the copy) find the new generation and drop its record...
+
+static inline uint32_t loadShared(uint32_t* ptr)
+{
+#ifdef HAVE_GCC_ATOMICS
+   return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+   return *(volatile uint32_t*)ptr;
+#endif
+}
+
+static inline void storeShared(uint32_t* ptr, uint32_t value)
+{
+#ifdef HAVE_GCC_ATOMICS
+   __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#else
+   *(volatile uint32_t*)ptr = value;
+#endif
+}
+
+static inline uint64_t loadShared(uint64_t* ptr)
+{
+#ifdef HAVE_GCC_ATOMICS
+   return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+   return *(volatile uint64_t*)ptr;
+#endif
+}
+
+static inline void storeShared(uint64_t* ptr, uint64_t value)
+{
+#ifdef HAVE_GCC_ATOMICS
+   __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#else
+   *(volatile uint64_t*)ptr = value;
+#endif
+}
+
+void ULog::rotate(uint32_t gen, uint32_t end)
+{
+   U_TRACE(1, "ULog::rotate(%u,%u)", gen, end)
+
+   U_INTERNAL_ASSERT_MINOR(end, log_file_sz)
+
+   // wait for the writers that have reserved the space before us (NB: we don't wait forever for a writer died in the copy...)
+
+   for (uint32_t i = 0; (uint32_t)loadShared(&(ptr_log_data->file_commit)) < end && i < 1000000; ++i) (void) U_SYSCALL_NO_PARAM(sched_yield);
+
+   // NB: we close the generation of the writers that have reserved the space before us, after this a late writer can't commit its record...
+
+   uint64_t commit, restart = (uint64_t)(gen+1) << 32;
+
+#ifdef HAVE_GCC_ATOMICS
+   commit = __atomic_exchange_n(&(ptr_log_data->file_commit), restart, __ATOMIC_ACQ_REL);
+#else
+   lock();
+
+   commit = ptr_log_data->file_commit;
+            ptr_log_data->file_commit = restart;
+
+   unlock();
+#endif
+
+   U_INTERNAL_DUMP("commit = %llu", commit)
+
+#ifdef USE_LIBZ
+   U_INTERNAL_DUMP("UFile::st_size = %u log_gzip_sz = %u", UFile::st_size, log_gzip_sz)
+
+   // NB: the shared area to compress log data may be not available at this time... (Ex: startup plugin u_server)
+
+   if (log_gzip_sz)
+      {
+      // check if there are previous data to write (the parent process is late or it is not running)
+
+      while (loadShared(&(ptr_log_data->rotate_len)))
+         {
+#     ifndef U_COVERITY_FALSE_POSITIVE // FORWARD_NULL
+         checkForLogRotateDataToWrite();
+#     endif
+
+         (void) U_SYSCALL_NO_PARAM(sched_yield);
+         }
+
+      U_MEMCPY((char*)ptr_log_data+sizeof(log_data), UFile::map, end);
+
+      storeShared(&(ptr_log_data->rotate_len), end);
+      }
+   else if (buf_path_compress)
+      {
+      UString data_to_write = UStringExt::deflate(UFile::map, end, 0);
+
+      char* ptr1 = buf_path_compress->c_pointer(index_path_compress);
+
+      ptr1[u__snprintf(ptr1, 17, U_CONSTANT_TO_PARAM("%4D"))] = '.';
+
+      (void) UFile::writeTo(*buf_path_compress, data_to_write, O_RDWR | O_EXCL, false);
+      }
+#endif
+
+   // NB: the log is cleared so that after a crash the end of the data is found by the search of the null chars. If a writer
+   //     of the old generation is still copying its record we can't clear the log (we never zero memory that is still written)...
+
+   if ((uint32_t)commit >= end) (void) U_SYSCALL(memset, "%p,%d,%u", UFile::map, 0, log_file_sz);
+
+   ptr_log_data->file_page = 0;
+
+   storeShared(&(ptr_log_data->rotate_cnt), ptr_log_data->rotate_cnt + 1);
+   storeShared(&(ptr_log_data->file_ptr),   restart); // NB: the writers waiting for the end of the rotation can restart...
+}
+
+bool ULog::write(const struct iovec* iov, int n)
 {
    U_TRACE(1+256, "ULog::write(%p,%d)", iov, n)
 
@@ -431,93 +553,98 @@ void ULog::write(const struct iovec* iov, int n)
 
    if (log_file_sz == 0)
       {
-      (void) UFile::writev(iov, n);
+      if (UFile::writev(iov, n) > 0) U_RETURN(true);
 
-      return;
+      U_RETURN(false);
       }
 
-   int len;
-   const char* ptr;
-   uint32_t file_ptr;
+   char* ptr;
+   int i, len;
+   uint64_t reserved;
+   uint32_t gen, file_ptr, sz = 0;
 
-   U_INTERNAL_DUMP("UFile::map = %p ptr_log_data->file_ptr = %u log_file_sz = %u", UFile::map, ptr_log_data->file_ptr, log_file_sz)
+   U_INTERNAL_DUMP("UFile::map = %p ptr_log_data->file_ptr = %llu log_file_sz = %u", UFile::map, ptr_log_data->file_ptr, log_file_sz)
 
-   lock();
+   for (i = 0; i < n; ++i) sz += iov[i].iov_len;
 
-   file_ptr = ptr_log_data->file_ptr;
+   if (sz == 0 ||
+       sz >= log_file_sz)
+      {
+      U_RETURN(false);
+      }
 
-   for (int i = 0; i < n; ++i)
+   while (true)
       {
-      if ((len = iov[i].iov_len))
-         {
-         ptr = (const char*)iov[i].iov_base;
+      // NB: if the offset is over the end of the log an other writer is doing the rotation...
 
-      // U_INTERNAL_DUMP("iov[%d](%u) -> %.*S", i, len, len, ptr)
+      while ((uint32_t)loadShared(&(ptr_log_data->file_ptr)) >= log_file_sz) (void) U_SYSCALL_NO_PARAM(sched_yield);
 
-         if ((file_ptr+len) > log_file_sz) // if overwrite log file we compress it as gzip...
-            {
-#        ifdef USE_LIBZ
-            U_INTERNAL_DUMP("UFile::st_size = %u log_gzip_sz = %u", UFile::st_size, log_gzip_sz)
+#  ifdef HAVE_GCC_ATOMICS
+      reserved = __sync_fetch_and_add(&(ptr_log_data->file_ptr), (uint64_t)sz);
+#  else
+      lock();
 
-            U_INTERNAL_ASSERT_MAJOR(file_ptr, 0)
-            U_INTERNAL_ASSERT(file_ptr <= UFile::st_size)
+      reserved = ptr_log_data->file_ptr;
+                 ptr_log_data->file_ptr += sz;
 
-            // NB: the shared area to compress log data may be not available at this time... (Ex: startup plugin u_server)
+      unlock();
+#  endif
 
-            if (file_ptr <= log_gzip_sz)
-               {
-#           ifndef U_COVERITY_FALSE_POSITIVE // FORWARD_NULL
-               checkForLogRotateDataToWrite(); // check if there are previous data to write
-#           endif
+      gen      = (uint32_t)(reserved >> 32);
+      file_ptr = (uint32_t) reserved;
 
-               ptr_log_data->gzip_len = u_gz_deflate(UFile::map, file_ptr, (char*)ptr_log_data+sizeof(log_data), Z_DEFAULT_COMPRESSION);
+      U_INTERNAL_DUMP("gen = %u file_ptr = %u", gen, file_ptr)
 
-               U_INTERNAL_DUMP("u_gz_deflate(%u) = %u", file_ptr, ptr_log_data->gzip_len)
-               }
-            else if (buf_path_compress)
-               {
-               U_INTERNAL_ASSERT_EQUALS(ptr_log_data->gzip_len, 0)
+      if ((file_ptr+sz) < log_file_sz) break;
 
-               UString data_to_write = UStringExt::deflate(UFile::map, file_ptr, 0);
+      // if overwrite log file we compress it as gzip (only the writer whose record go over the end do the rotation)...
 
-               char* ptr1 = buf_path_compress->c_pointer(index_path_compress);
+      if (file_ptr < log_file_sz) rotate(gen, file_ptr);
+      }
 
-               ptr1[u__snprintf(ptr1, 17, U_CONSTANT_TO_PARAM("%4D"))] = '.';
+   // NB: if the log is already restarted the rotation has not waited for us, so we drop the record...
 
-               (void) UFile::writeTo(*buf_path_compress, data_to_write, O_RDWR | O_EXCL, false);
-               }
-#        endif
+   if ((uint32_t)(loadShared(&(ptr_log_data->file_commit)) >> 32) != gen) U_RETURN(false);
 
-                          file_ptr  =
-            ptr_log_data->file_page = 0;
-            }
+   ptr = UFile::map + file_ptr;
+
+   for (i = 0; i < n; ++i)
+      {
+      if ((len = iov[i].iov_len))
+         {
+      // U_INTERNAL_DUMP("iov[%d](%u) -> %.*S", i, len, len, iov[i].iov_base)
 
-         if (len == 1) UFile::map[file_ptr++] = *ptr;
+         if (len == 1) *ptr++ = *(const char*)iov[i].iov_base;
          else
             {
-            U_MEMCPY(UFile::map + file_ptr, ptr, len);
-
-            file_ptr += len;
+            U_MEMCPY(ptr, iov[i].iov_base, len);
 
-         // U_INTERNAL_DUMP("memcpy(%u) => %.*S", len, len, UFile::map + file_ptr - len)
+            ptr += len;
             }
          }
       }
 
-   U_INTERNAL_DUMP("ptr_log_data->file_ptr = %u", file_ptr)
+#ifdef HAVE_GCC_ATOMICS
+   uint64_t commit = loadShared(&(ptr_log_data->file_commit)), prev;
 
-   if ((log_file_sz - file_ptr) > U_CONSTANT_SIZE(U_MARK_END))
+   while ((uint32_t)(commit >> 32) == gen &&
+          (prev = __sync_val_compare_and_swap(&(ptr_log_data->file_commit), commit, commit + sz)) != commit)
       {
-      char* p = UFile::map + file_ptr;
-
-      u_put_unalignedp64(p,    U_MULTICHAR_CONSTANT64('\n','\n','\n','\n','\n','\n','\n','\n'));
-      u_put_unalignedp64(p+8,  U_MULTICHAR_CONSTANT64('\n','\n','\n','\n','\n','\n','\n','\n'));
-      u_put_unalignedp64(p+16, U_MULTICHAR_CONSTANT64('\n','\n','\n','\n','\n','\n','\n','\n'));
+      commit = prev;
       }
+#else
+   lock();
 
-   ptr_log_data->file_ptr = file_ptr;
+   uint64_t commit = ptr_log_data->file_commit;
+
+   if ((uint32_t)(commit >> 32) == gen) ptr_log_data->file_commit += sz;
 
    unlock();
+#endif
+
+   if ((uint32_t)(commit >> 32) == gen) U_RETURN(true);
+
+   U_RETURN(false); // NB: the log is restarted while we copy the record...
 }
 
 void ULog::write(const char* msg, uint32_t len)
@@ -858,7 +985,9 @@ void ULog::closeLogInternal()
 
       if (log_file_sz)
          {
-         U_INTERNAL_ASSERT_MINOR(ptr_log_data->file_ptr, UFile::st_size)
+         uint32_t file_ptr = (uint32_t)ptr_log_data->file_ptr;
+
+         if (file_ptr > log_file_sz) file_ptr = log_file_sz; // NB: an other process can be doing the rotation...
 
       // msync();
 
@@ -866,10 +995,8 @@ void ULog::closeLogInternal()
          checkForLogRotateDataToWrite(); // check for previous data to write
 #     endif
 
-         U_INTERNAL_ASSERT_EQUALS(ptr_log_data->gzip_len, 0)
-
                 UFile::munmap();
-         (void) UFile::ftruncate(ptr_log_data->file_ptr);
+         (void) UFile::ftruncate(file_ptr);
              // UFile::fsync();
          }
 
@@ -976,35 +1103,56 @@ void ULog::setShared(log_data* ptr)
       ptr = (log_data*) UFile::shm_open(somename, sizeof(log_data) + log_gzip_sz);
       }
 
-   ptr->file_ptr  = ptr_log_data->file_ptr;
-   ptr->file_page = ptr_log_data->file_page;
+   ptr->file_ptr    = ptr_log_data->file_ptr;
+   ptr->file_page   = ptr_log_data->file_page;
+   ptr->file_commit = ptr_log_data->file_commit;
+   ptr->rotate_cnt  = ptr_log_data->rotate_cnt;
 
    U_FREE_TYPE(ptr_log_data, log_data);
 
-   (ptr_log_data = ptr)->gzip_len = 0;
+   (ptr_log_data = ptr)->rotate_len = 0;
+                   ptr->rotate_lock = 0;
 
    _lock.init(&(ptr_log_data->lock_shared));
 
-   U_INTERNAL_DUMP("ptr_log_data->file_ptr = %u UFile::st_size = %u log_gzip_sz = %u", ptr_log_data->file_ptr, UFile::st_size, log_gzip_sz)
+   U_INTERNAL_DUMP("ptr_log_data->file_ptr = %llu UFile::st_size = %u log_gzip_sz = %u", ptr_log_data->file_ptr, UFile::st_size, log_gzip_sz)
 
-   U_INTERNAL_ASSERT(ptr_log_data->file_ptr <= UFile::st_size)
+   U_INTERNAL_ASSERT((uint32_t)ptr_log_data->file_ptr <= UFile::st_size)
 }
 
 void ULog::checkForLogRotateDataToWrite()
 {
    U_TRACE_NO_PARAM(0, "ULog::checkForLogRotateDataToWrite()")
 
-   uint32_t gzip_len = ptr_log_data->gzip_len;
+   // NB: it is called by a thread of the parent process (ULogRotateThread), so the compression is out of the path of the request...
 
-   if (gzip_len) // there are previous data to write
+   if (ptr_log_data->rotate_len && // there are previous data to write
+       ULock::spinLockAcquire(&(ptr_log_data->rotate_lock)))
       {
-      ptr_log_data->gzip_len = 0;
+      uint32_t rotate_len = ptr_log_data->rotate_len;
+
+      if (rotate_len)
+         {
+         char* data = (char*)ptr_log_data+sizeof(log_data);
+         char* ptr  = buf_path_compress->c_pointer(index_path_compress);
+
+         uint32_t gzip_len = u_gz_deflate(data, rotate_len, data+log_file_sz, Z_DEFAULT_COMPRESSION);
 
-      char* ptr = buf_path_compress->c_pointer(index_path_compress);
+         U_INTERNAL_DUMP("u_gz_deflate(%u) = %u", rotate_len, gzip_len)
 
-      ptr[u__snprintf(ptr, 17, U_CONSTANT_TO_PARAM("%4D"))] = '.';
+         // NB: the millisec of the name are unique only for the process, so we retry with an other name if the file exist...
+
+         for (int i = 0; i < 1000; ++i)
+            {
+            ptr[u__snprintf(ptr, 17, U_CONSTANT_TO_PARAM("%4D"))] = '.';
+
+            if (UFile::writeTo(*buf_path_compress, data+log_file_sz, gzip_len, O_RDWR | O_EXCL, false)) break;
+            }
+
+         ptr_log_data->rotate_len = 0;
+         }
 
-      (void) UFile::writeTo(*buf_path_compress, (char*)ptr_log_data+sizeof(log_data), gzip_len, O_RDWR | O_EXCL, false);
+      ULock::spinLockRelease(&(ptr_log_data->rotate_lock));
       }
 }
 #endif
@@ -39,8 +39,10 @@ UString UMagic::getType(const char* buffer, uint32_t buffer_len)
    UString str;
    const char* result = (const char*) U_SYSCALL(magic_buffer, "%p,%p,%u", magic, buffer, buffer_len);
 
-   if (result) (void) str.assign(result);
-   else        (void) str.assign(U_CONSTANT_TO_PARAM("application/octet-stream"));
+   // NB: the type is interned so the data of the string are valid also after the death of the object (see UFile::getMimeType())...
+
+   if (result) str.setIntern(result, u__strlen(result, __PRETTY_FUNCTION__));
+   else        str.setIntern(U_CONSTANT_TO_PARAM("application/octet-stream"));
 
    U_RETURN_STRING(str);
 }
@@ -38,6 +38,7 @@ uint32_t UMimeHeader::parse(const char* ptr, uint32_t len)
    int32_t sz;
    uint32_t n;
    const char* pkv;
+   const char* pname;
    UString key, value;
 
    (void) header.replace(ptr, len);
@@ -95,7 +96,13 @@ uint32_t UMimeHeader::parse(const char* ptr, uint32_t len)
             break;
             }
 
-         (void) key.assign(prev, pkv - prev);
+         // NB: the names in the table of the intern strings are lowercase (HTTP/2), so we look up (only, the name of the headers come
+         //     from the network and it must not fill the table) a name without uppercase, the lookup of the others always fail...
+
+         for (pname = prev; pname < pkv && u__isupper(*pname) == false; ++pname) {}
+
+         if (pname == pkv) key.setIntern(prev, pkv - prev, false);
+         else       (void) key.assign(    prev, pkv - prev);
 
          do { ++pkv; } while (pkv < _end && u__isspace(*pkv));
 
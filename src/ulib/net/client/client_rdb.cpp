@@ -237,6 +237,258 @@ UString URDBClient_Base::operator[](const UString& key)
    return UString::getStringNull();
 }
 
+// BATCH
+
+// NB: a batch with more than U_RDB_BATCH_MAX operations (the server refuse it) is split in chunks, the requests of the chunks are sent
+//     with the pipeline (only one write) and the responses are joined, so the response is like the one of a single request...
+
+U_NO_EXPORT bool URDBClient_Base::sendBatch(const char* token, UVector<UString>& vec, uint32_t width)
+{
+   U_TRACE(0, "URDBClient_Base::sendBatch(%S,%p,%u)", token, &vec, width)
+
+   U_INTERNAL_ASSERT_EQUALS(npipeline, 0)
+
+   uint32_t i, sz = vec.size();
+
+   reset();
+
+   if ((sz / width) <= U_RDB_BATCH_MAX)
+      {
+      for (i = 0; i < sz; ++i) URPC::rpc_info->push_back(vec[i]);
+
+      if (processRequest(token) && isOK()) U_RETURN(true);
+
+      U_RETURN(false);
+      }
+
+   uint32_t j, end, step = U_RDB_BATCH_MAX * width, nchunk = (sz + step - 1) / step;
+
+   for (i = 0; i < sz; i = end)
+      {
+      for (j = i, end = U_min(i + step, sz); j < end; ++j) URPC::rpc_info->push_back(vec[j]);
+
+      queueRequest(token);
+      }
+
+   U_INTERNAL_ASSERT_EQUALS(npipeline, nchunk)
+
+   int* vcode = new int[nchunk];
+   UVector<UString> vresponse(nchunk);
+
+   bool result = flushPipeline(vcode, &vresponse);
+
+   if (result)
+      {
+      for (i = 0; i < nchunk; ++i)
+         {
+         if ((nResponseCode = vcode[i]) != 200)
+            {
+            result = false;
+
+            break;
+            }
+
+         (void) response.append(vresponse[i]);
+         }
+      }
+
+   delete[] vcode;
+
+   U_RETURN(result);
+}
+
+uint32_t URDBClient_Base::find(UVector<UString>& vkey, UVector<UString>& vdata)
+{
+   U_TRACE(0, "URDBClient_Base::find(%p,%p)", &vkey, &vdata)
+
+   uint32_t n = 0;
+
+   if (sendBatch("MFND", vkey, 1))
+      {
+      // NB: for every key an entry like print() with dlen -1 if not found ("+klen,-1:key->\n")...
+
+      UCDB::datum _key, _data;
+      const char* ptr = response.data();
+      const char* end = response.pend();
+
+      while (ptr < end &&
+             *ptr == '+')
+         {
+         ptr = URDB::parseLine(ptr, &_key, &_data);
+
+         if (_data.dsize == U_NOT_FOUND) vdata.push_back(UString::getStringNull());
+         else
+            {
+            vdata.push_back(response.substr((const char*)_data.dptr, _data.dsize));
+
+            ++n;
+            }
+         }
+      }
+
+   U_RETURN(n);
+}
+
+U_NO_EXPORT bool URDBClient_Base::processBatch(const char* token, UVector<UString>& vec, uint32_t width, int* vresult)
+{
+   U_TRACE(0, "URDBClient_Base::processBatch(%S,%p,%u,%p)", token, &vec, width, vresult)
+
+   uint32_t n = vec.size() / width;
+
+   if (sendBatch(token, vec, width) &&
+       response.size() == n)
+      {
+      // NB: the response is a char for every operation ('0' + -result)...
+
+      if (vresult)
+         {
+         const char* ptr = response.data();
+
+         for (uint32_t i = 0; i < n; ++i) vresult[i] = -(ptr[i] - '0');
+         }
+
+      U_RETURN(true);
+      }
+
+   if (vresult)
+      {
+      for (uint32_t i = 0; i < n; ++i) vresult[i] = -5;
+      }
+
+   U_RETURN(false);
+}
+
+uint32_t URDBClient_Base::store(UVector<UString>& vkey_data, int flag, int* vresult)
+{
+   U_TRACE(0, "URDBClient_Base::store(%p,%d,%p)", &vkey_data, flag, vresult)
+
+   U_INTERNAL_ASSERT_EQUALS(vkey_data.size() & 1, 0)
+
+   uint32_t n    = vkey_data.size() / 2;
+   char token[5] = { 'M', 'S', 'T', '0', '\0' };
+
+   if (flag == RDB_REPLACE) token[3] = '1';
+
+   if (processBatch(token, vkey_data, 2, vresult) == false) U_RETURN(0);
+
+   uint32_t result = 0;
+
+   for (uint32_t i = 0; i < n; ++i)
+      {
+      if (response.c_char(i) == '0') ++result;
+      }
+
+   U_RETURN(result);
+}
+
+uint32_t URDBClient_Base::remove(UVector<UString>& vkey, int* vresult)
+{
+   U_TRACE(0, "URDBClient_Base::remove(%p,%p)", &vkey, vresult)
+
+   uint32_t n = vkey.size();
+
+   if (processBatch("MRMV", vkey, 1, vresult) == false) U_RETURN(0);
+
+   uint32_t result = 0;
+
+   for (uint32_t i = 0; i < n; ++i)
+      {
+      if (response.c_char(i) == '0') ++result;
+      }
+
+   U_RETURN(result);
+}
+
+// PIPELINE
+
+void URDBClient_Base::queueRequest(const char* token)
+{
+   U_TRACE(0, "URDBClient_Base::queueRequest(%S)", token)
+
+   uint32_t size = U_TOKEN_LN;
+
+   for (uint32_t i = 0, n = URPC::rpc_info->size(); i < n; ++i) size += U_TOKEN_LN + (*URPC::rpc_info)[i].size();
+
+   (void) pipeline.reserve(size);
+
+   UStringExt::buildTokenVector(token, *URPC::rpc_info, pipeline);
+
+   ++npipeline;
+
+   reset();
+}
+
+bool URDBClient_Base::flushPipeline(int* vcode, UVector<UString>* vresponse)
+{
+   U_TRACE(0, "URDBClient_Base::flushPipeline(%p,%p)", vcode, vresponse)
+
+   U_INTERNAL_DUMP("npipeline = %u", npipeline)
+
+   bool result = true;
+   uint32_t n = npipeline;
+
+   if (n)
+      {
+      UClient_Base::prepareRequest(pipeline);
+
+      npipeline = 0;
+
+      result = sendRequest(false);
+
+      pipeline.clear();
+
+      if (result)
+         {
+         UString data;
+         uint32_t i, start, rstart = 0, *vpos = (vresponse ? new uint32_t[n * 2] : U_NULLPTR);
+
+         // NB: we force for U_SUBSTR_INC_REF case (string can be referenced more)...
+
+         response.clear(); // NB: it can reference the buffer of the previous request...
+
+         buffer.setEmptyForce();
+
+         for (i = 0; i < n; ++i)
+            {
+            start = rstart;
+
+            (void) URPC::readTokenString(socket, U_NULLPTR, buffer, rstart, data);
+
+            if (rstart == start)
+               {
+               result = false;
+
+               for (; i < n; ++i) vcode[i] = -1;
+
+               break;
+               }
+
+            vcode[i] = strtol(buffer.c_pointer(start), U_NULLPTR, 10);
+
+            if (vpos)
+               {
+               vpos[i * 2]     = rstart - data.size();
+               vpos[i * 2 + 1] = (vcode[i] == 200 ? data.size() : 0);
+               }
+
+            data.clear();
+            }
+
+         if (vpos)
+            {
+            // NB: the buffer can be reallocated reading the next responses, so we take the substrings of the data (that reference
+            //     the buffer) only after that all the responses are read...
+
+            for (uint32_t k = 0; k < i; ++k) vresponse->push_back(vpos[k * 2 + 1] ? buffer.substr(vpos[k * 2], vpos[k * 2 + 1]) : UString::getStringNull());
+
+            delete[] vpos;
+            }
+         }
+      }
+
+   U_RETURN(result);
+}
+
 // Call function for all entry
 
 void URDBClient_Base::_callForAllEntry(vPFprpr function, bool sorted)
@@ -279,6 +531,129 @@ void URDBClient_Base::_callForAllEntry(vPFprpr function, bool sorted)
       }
 }
 
+// REPLICATION
+
+int URDBClient_Base::pullJournal(URDB* prdb, uint64_t& id, uint64_t& lsn)
+{
+   U_TRACE(0, "URDBClient_Base::pullJournal(%p,%llu,%llu)", prdb, id, lsn)
+
+   reset();
+
+   UString _id(22U), _lsn(22U);
+
+    _id.appendNumber64(id);
+   _lsn.appendNumber64(lsn);
+
+   URPC::rpc_info->push_back(_id);
+   URPC::rpc_info->push_back(_lsn);
+
+   if (processRequest("RPLY") == false) U_RETURN(-1);
+
+   if (nResponseCode == 410) return loadCopy(prdb, id, lsn);
+
+   if (nResponseCode != 200) U_RETURN(-1);
+
+   return applyJournal(prdb, response, id, lsn);
+}
+
+int URDBClient_Base::applyJournal(URDB* prdb, const UString& data, uint64_t& id, uint64_t& lsn)
+{
+   U_TRACE(0, "URDBClient_Base::applyJournal(%p,%V,%llu,%llu)", prdb, data.rep, id, lsn)
+
+   if (data.size() < sizeof(uint64_t) * 2) U_RETURN(-1);
+
+   // NB: the records have the format of the journal (dlen == U_NOT_FOUND => remove)...
+
+   int n = 0;
+   const char* ptr = data.data() + sizeof(uint64_t) * 2;
+   const char* end = data.pend();
+
+   while (ptr < end)
+      {
+      uint32_t klen = u_get_unalignedp32(ptr),
+               dlen = u_get_unalignedp32(ptr+4);
+
+      ptr += sizeof(UCDB::cdb_record_header);
+
+      if (dlen == U_NOT_FOUND) (void) prdb->remove(ptr, klen); // NB: the entry can be already deleted (the position is saved after the records)...
+      else
+         {
+         if (prdb->store(ptr, klen, ptr+klen, dlen, RDB_REPLACE)) U_RETURN(-1); // -3: disk full writing to the journal file
+
+         ptr += dlen;
+         }
+
+      ptr += klen;
+
+      ++n;
+      }
+
+   id  = u_get_unalignedp64(data.data());
+   lsn = u_get_unalignedp64(data.data() + sizeof(uint64_t));
+
+   U_RETURN(n);
+}
+
+U_NO_EXPORT int URDBClient_Base::loadCopy(URDB* prdb, uint64_t& id, uint64_t& lsn)
+{
+   U_TRACE(0, "URDBClient_Base::loadCopy(%p,%llu,%llu)", prdb, id, lsn)
+
+   reset();
+
+   if (processRequest("RSNP") == false ||
+       nResponseCode != 200)
+      {
+      U_RETURN(-1);
+      }
+
+   return applyCopy(prdb, response, id, lsn);
+}
+
+int URDBClient_Base::applyCopy(URDB* prdb, const UString& data, uint64_t& id, uint64_t& lsn)
+{
+   U_TRACE(0, "URDBClient_Base::applyCopy(%p,%V,%llu,%llu)", prdb, data.rep, id, lsn)
+
+   if (data.size() < sizeof(uint64_t) * 2) U_RETURN(-1);
+
+   // NB: we store the entries of the copy and after we remove the entries that are not in the copy...
+
+   int n = 0;
+   UCDB::datum _key, _data;
+   UVector<UString> vkey, vcopy;
+   const char* ptr = data.data() + sizeof(uint64_t) * 2;
+   const char* end = data.pend();
+
+   prdb->getKeys(vkey);
+
+   while (ptr < end &&
+          *ptr == '+')
+      {
+      ptr = URDB::parseLine(ptr, &_key, &_data);
+
+      if (prdb->store((const char*)_key.dptr, _key.dsize, (const char*)_data.dptr, _data.dsize, RDB_REPLACE)) U_RETURN(-1);
+
+      vcopy.push_back(data.substr((const char*)_key.dptr, _key.dsize));
+
+      ++n;
+      }
+
+   if (vcopy.empty() == false) vcopy.sort();
+
+   for (uint32_t i = 0, sz = vkey.size(); i < sz; ++i)
+      {
+      if (vcopy.empty() ||
+          vcopy.findSorted(vkey[i]) == U_NOT_FOUND)
+         {
+         (void) prdb->remove(vkey[i]);
+         }
+      }
+
+   id  = u_get_unalignedp64(data.data());
+   lsn = u_get_unalignedp64(data.data() + sizeof(uint64_t));
+
+   U_RETURN(n);
+}
+
 // DEBUG
 
 #if defined(U_STDCPP_ENABLE) && defined(DEBUG)
@@ -14,6 +14,7 @@
 #include <ulib/file.h>
 #include <ulib/process.h>
 #include <ulib/utility/base64.h>
+#include <ulib/json/reader.h>
 #include <ulib/net/client/http.h>
 #include <ulib/utility/services.h>
 #include <ulib/net/server/server.h>
@@ -211,6 +212,8 @@ UHttpClient_Base::UHttpClient_Base(UFileConfig* _cfg) : UClient_Base(_cfg)
 {
    U_TRACE_CTOR(0, UHttpClient_Base, "%p", _cfg)
 
+   json_reader      = U_NULLPTR;
+   json_func        = U_NULLPTR;
    method_num       = 0;
    bFollowRedirects = true;
    bproxy           = false;
@@ -847,6 +850,52 @@ void UHttpClient_Base::composeRequest(const char* content_type, uint32_t content
       }
 }
 
+bool UHttpClient_Base::readBodyJson()
+{
+   U_TRACE_NO_PARAM(0, "UHttpClient_Base::readBodyJson()")
+
+   U_INTERNAL_ASSERT_POINTER(json_func)
+   U_INTERNAL_ASSERT_POINTER(json_reader)
+   U_INTERNAL_ASSERT_DIFFERS(U_http_info.endHeader, 0)
+
+   uint32_t n, remain = U_http_info.clength;
+
+   json_reader->reset();
+
+   while (true)
+      {
+      n = response.size() - U_http_info.endHeader;
+
+      if (n > remain) n = remain;
+
+      U_INTERNAL_DUMP("n = %u remain = %u", n, remain)
+
+      if (n)
+         {
+         json_reader->feed(response.c_pointer(U_http_info.endHeader), n);
+
+         remain -= n;
+
+         if (remain == 0) json_reader->finish();
+
+         // NB: we drop the data of the body already passed to the reader...
+
+         response.size_adjust(U_http_info.endHeader);
+
+         if (json_func(json_reader) == false)
+            {
+            if (remain) UClient_Base::close(); // NB: the rest of the body is still on the connection...
+
+            U_RETURN(true);
+            }
+         }
+
+      if (remain == 0) U_RETURN(true);
+
+      if (USocketExt::read(UClient_Base::socket, response, U_SINGLE_READ, UClient_Base::timeoutMS) == false) U_RETURN(false);
+      }
+}
+
 bool UHttpClient_Base::sendRequestEngine()
 {
    U_TRACE_NO_PARAM(0, "UHttpClient_Base::sendRequestEngine()")
@@ -908,7 +957,24 @@ bool UHttpClient_Base::sendRequestEngine()
             if (data_chunked == false) U_RETURN(true);
             }
 
-         if (UHTTP::readBodyResponse(UClient_Base::socket, &response, body)) U_RETURN(true);
+         if (json_reader &&
+             U_http_info.clength)
+            {
+            if (readBodyJson()) U_RETURN(true);
+            }
+         else if (UHTTP::readBodyResponse(UClient_Base::socket, &response, body))
+            {
+            if (json_reader) // NB: the body with chunked encoding is read all and passed to the reader in one chunk...
+               {
+               json_reader->reset();
+               json_reader->feed(body);
+               json_reader->finish();
+
+               (void) json_func(json_reader);
+               }
+
+            U_RETURN(true);
+            }
 
          if (U_http_info.nResponseCode == HTTP_CLIENT_TIMEOUT ||
              U_http_info.nResponseCode == HTTP_ENTITY_TOO_LARGE)
@@ -29,7 +29,9 @@ uint32_t URPC::readTokenInt(USocket* s, const char* token, UString& buffer, uint
 
    uint32_t value = 0;
 
-   if (((buffer.size() >= (rstart + U_TOKEN_LN)) || USocketExt::read(s, buffer, U_TOKEN_LN)) &&
+   // NB: the buffer can have already part of the data (pipeline), so we read only the bytes missing...
+
+   if (((buffer.size() >= (rstart + U_TOKEN_LN)) || USocketExt::read(s, buffer, rstart + U_TOKEN_LN - buffer.size())) &&
        (token == U_NULLPTR || memcmp(buffer.c_pointer(rstart), token, U_TOKEN_NM) == 0))
       {
       const char* ptr = buffer.c_pointer(rstart + U_TOKEN_NM);
@@ -53,7 +55,7 @@ uint32_t URPC::readTokenString(USocket* s, const char* token, UString& buffer, u
    uint32_t value = readTokenInt(s, token, buffer, rstart);
 
    if (value &&
-       ((buffer.size() >= (rstart + value)) || USocketExt::read(s, buffer, value)))
+       ((buffer.size() >= (rstart + value)) || USocketExt::read(s, buffer, rstart + value - buffer.size())))
       {
       data = buffer.substr(rstart, value);
 
@@ -69,25 +71,48 @@ uint32_t URPC::readTokenString(USocket* s, const char* token, UString& buffer, u
 
 // Read an vector of string from the network (Ex: "FIND00000001ARGV00000003foo")
 
-uint32_t URPC::readTokenVector(USocket* s, const char* token, UString& buffer, UVector<UString>& vec)
+uint32_t URPC::readTokenVector(USocket* s, const char* token, UString& buffer, UVector<UString>& vec, uint32_t rstart)
 {
-   U_TRACE(0, "URPC::readTokenVector(%p,%S,%p,%p)", s, token, &buffer, &vec)
+   U_TRACE(0, "URPC::readTokenVector(%p,%S,%p,%p,%u)", s, token, &buffer, &vec, rstart)
 
-   uint32_t i      = 0,
-            rstart = 0,
-            argc   = readTokenInt(s, token, buffer, rstart);
+   uint32_t i    = 0,
+            argc = readTokenInt(s, token, buffer, rstart);
 
    if (argc)
       {
-      UString data;
+      uint32_t value, prev, start = rstart;
+
+      // NB: the buffer can be reallocated reading the missing part of the request, so we take the substrings
+      //     of the arguments (that reference the buffer) only after that all the arguments are read...
+
+      while (i < argc)
+         {
+         prev  = rstart;
+         value = readTokenInt(s, "ARGV", buffer, rstart);
+
+         if (rstart == prev) break; // NB: the token is not read...
+
+         if (value &&
+             buffer.size() < (rstart + value) &&
+             USocketExt::read(s, buffer, rstart + value - buffer.size()) == false)
+            {
+            break;
+            }
+
+         rstart += value;
+
+         ++i;
+         }
 
-      while (true)
+      for (uint32_t j = 0; j < i; ++j)
          {
-         if (readTokenString(s, "ARGV", buffer, rstart, data) == 0) break;
+         value  = u_hex2int(buffer.c_pointer(start + U_TOKEN_NM), 8);
+         start += U_TOKEN_LN;
 
-         vec.push_back(data);
+         if (value) vec.push_back(buffer.substr(start, value));
+         else       vec.push_back(UString::getStringNull()); // NB: an empty argument (ex: "ARGV00000000")...
 
-         if (++i == argc) break;
+         start += value;
          }
       }
 
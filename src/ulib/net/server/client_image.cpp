@@ -34,6 +34,7 @@ long         UClientImage_Base::time_run;
 long         UClientImage_Base::time_between_request = 10;
 uint32_t     UClientImage_Base::resto;
 uint32_t     UClientImage_Base::rstart;
+uint32_t     UClientImage_Base::nserial;
 uint32_t     UClientImage_Base::nrequest;
 uint32_t     UClientImage_Base::size_request;
 UString*     UClientImage_Base::body;
@@ -137,6 +138,7 @@ UClientImage_Base::UClientImage_Base()
    reset();
 
    flag.u     = 0;
+   serial     = 0;
    last_event = u_now->tv_sec;
 
    conn  = U_NULLPTR;
@@ -426,7 +428,6 @@ void UClientImage_Base::setSendfile(int fd, off_t lstart, off_t lcount)
    U_ASSERT(body->empty())
    U_INTERNAL_ASSERT_DIFFERS(fd, -1)
    U_INTERNAL_ASSERT_MAJOR(lcount, 0)
-   U_INTERNAL_ASSERT_DIFFERS(U_http_version, '2')
 
    setRequestNoCache();
 
@@ -797,6 +798,8 @@ void UClientImage_Base::endRequest()
       {
       UHTTP::setEndRequestProcessing();
 
+      UMemoryArena::reset(); // NB: the objects of the request allocated in the arena are dead, we rewind it...
+
       U_http_method_type = 0; // NB: this mark the end of http request processing...
       }
 
@@ -1075,6 +1078,7 @@ void UClientImage_Base::prepareForRead()
       U_INTERNAL_ASSERT_EQUALS(UServer_Base::pClientImage, this)
 
       UEventFd::fd = socket->iSockDesc;
+      serial       = ++nserial; // NB: a new connection...
 
    // setRequestFromUServer();
       }
@@ -2005,10 +2009,28 @@ void UClientImage_Base::prepareForSendfile()
    U_INTERNAL_DUMP("offset = %I count = %I", offset, count)
 }
 
+void UClientImage_Base::setOpMask(uint32_t mask)
+{
+   U_TRACE(0, "UClientImage_Base::setOpMask(%B)", mask)
+
+   U_INTERNAL_DUMP("UEventFd::op_mask = %B", UEventFd::op_mask)
+
+   if (UEventFd::op_mask != mask)
+      {
+      UEventFd::op_mask = mask;
+
+      if (UNotifier::isHandler(UEventFd::fd)) (void) UNotifier::modify(this);
+      }
+}
+
 int UClientImage_Base::handlerWrite()
 {
    U_TRACE_NO_PARAM(0, "UClientImage_Base::handlerWrite()")
 
+#ifndef U_HTTP2_DISABLE
+   if (U_ClientImage_http(this) == '2') return UHTTP2::handlerWrite(this); // NB: the responses not yet sent of the connection...
+#endif
+
    U_INTERNAL_ASSERT_DIFFERS(U_http_version, '2')
 
 #if !defined(USE_LIBEVENT) && defined(HAVE_EPOLL_WAIT) && defined(DEBUG)
@@ -2136,6 +2158,7 @@ const char* UClientImage_Base::dump(bool _reset) const
                   << "bIPv6                              " << bIPv6               << '\n'
                   << "count                              " << count               << '\n'
                   << "offset                             " << offset              << '\n'
+                  << "serial                             " << serial              << '\n'
                   << "last_event                         " << last_event          << '\n'
                   << "socket          (USocket           " << (void*)socket       << ")\n"
                   << "body            (UString           " << (void*)body         << ")\n"
@@ -13,7 +13,8 @@
 
 #include <ulib/db/rdb.h>
 #include <ulib/net/rpc/rpc.h>
-#include <ulib/net/server/server.h>
+#include <ulib/net/client/client_rdb.h>
+#include <ulib/net/server/server_rdb.h>
 #include <ulib/net/server/client_image_rdb.h>
 
 // 2xx indicates success of some kind
@@ -23,6 +24,7 @@
 #define STR_400 "400 "  // Lookup failed: the entry was not in the database
 #define STR_401 "401 "  // Store failed: flag was insertion of new entries only and the key already existed
 #define STR_402 "402 "  // Remove failed: the entry was already marked deleted
+#define STR_410 "410 "  // Replication: the position is not in the log, the follower must reload a copy of the database
 
 // 5xx go away: parse error, catastrophic error, ...
 #define STR_500 "500 "  // Server error: requested action not taken
@@ -46,207 +48,427 @@ int URDBClientImage::handlerRead()
          }
 #  endif
 
-      // check for RPC request
+      UClientImage_Base::wbuffer->setBuffer(U_CAPACITY);
+
+      // NB: the client can send more request without wait for the response (pipeline), so we process all the request
+      //     of the read buffer and we send the responses together...
+
+      uint32_t rend, start = 0;
+
+      do {
+         // check for RPC request
+
+         URPC::resetInfo();
+
+         rend = URPC::readTokenVector(UClientImage_Base::socket, U_NULLPTR, *UClientImage_Base::rbuffer, *URPC::rpc_info, start);
+
+         if (rend == start) U_RETURN(U_NOTIFIER_DELETE);
+
+         processRequest(UClientImage_Base::rbuffer->c_pointer(start));
+
+         start = rend;
+         }
+      while (start < UClientImage_Base::rbuffer->size());
+
+      // NB: the arguments reference the read buffer, that can be resized reading the next request...
 
       URPC::resetInfo();
 
-      if (URPC::readRequest(UClientImage_Base::socket) == false) U_RETURN(U_NOTIFIER_DELETE);
+      UClientImage_Base::size_request = start;
 
-      UClientImage_Base::wbuffer->setBuffer(U_CAPACITY);
+      return UClientImage_Base::handlerResponse();
+      }
+
+   U_RETURN(U_NOTIFIER_OK);
+}
+
+U_NO_EXPORT void URDBClientImage::processRequest(const char* ptr)
+{
+   U_TRACE(0, "URDBClientImage::processRequest(%.4S)", ptr)
+
+   // Process the RPC message
+
+   int result;
+   const char* res = STR_200;
+
+   enum {
+      RPC_METHOD_FIND               = U_MULTICHAR_CONSTANT32('F','I','N','D'),
+      RPC_METHOD_STORE              = U_MULTICHAR_CONSTANT32('S','T','R','0'),
+      RPC_METHOD_REPLACE            = U_MULTICHAR_CONSTANT32('S','T','R','1'),
+      RPC_METHOD_REMOVE             = U_MULTICHAR_CONSTANT32('R','E','M','V'),
+      RPC_METHOD_SUBSTITUTE0        = U_MULTICHAR_CONSTANT32('S','U','B','0'),
+      RPC_METHOD_SUBSTITUTE1        = U_MULTICHAR_CONSTANT32('S','U','B','1'),
+      RPC_METHOD_PRINT0             = U_MULTICHAR_CONSTANT32('P','R','T','0'),
+      RPC_METHOD_PRINT1             = U_MULTICHAR_CONSTANT32('P','R','T','1'),
+      RPC_METHOD_REORGANIZE         = U_MULTICHAR_CONSTANT32('R','O','R','G'),
+      RPC_METHOD_BEGIN_TRANSACTION  = U_MULTICHAR_CONSTANT32('B','T','R','N'),
+      RPC_METHOD_ABORT_TRANSACTION  = U_MULTICHAR_CONSTANT32('A','T','R','N'),
+      RPC_METHOD_COMMIT_TRANSACTION = U_MULTICHAR_CONSTANT32('C','T','R','N'),
+      RPC_METHOD_REPLICATION_LOG    = U_MULTICHAR_CONSTANT32('R','P','L','Y'),
+      RPC_METHOD_REPLICATION_COPY   = U_MULTICHAR_CONSTANT32('R','S','N','P'),
+      RPC_METHOD_MULTI_FIND         = U_MULTICHAR_CONSTANT32('M','F','N','D'),
+      RPC_METHOD_MULTI_STORE        = U_MULTICHAR_CONSTANT32('M','S','T','0'),
+      RPC_METHOD_MULTI_REPLACE      = U_MULTICHAR_CONSTANT32('M','S','T','1'),
+      RPC_METHOD_MULTI_REMOVE       = U_MULTICHAR_CONSTANT32('M','R','M','V')
+   };
+
+   uint32_t method = u_get_unalignedp32(ptr);
+
+   // NB: a replica is read only (the database is written only with the records of the primary)...
+
+   if (URDBServer::isReplica() &&
+       (method == RPC_METHOD_STORE             ||
+        method == RPC_METHOD_REPLACE           ||
+        method == RPC_METHOD_REMOVE            ||
+        method == RPC_METHOD_MULTI_STORE       ||
+        method == RPC_METHOD_MULTI_REPLACE     ||
+        method == RPC_METHOD_MULTI_REMOVE      ||
+        method == RPC_METHOD_SUBSTITUTE0       ||
+        method == RPC_METHOD_SUBSTITUTE1       ||
+        method == RPC_METHOD_BEGIN_TRANSACTION ||
+        method == RPC_METHOD_ABORT_TRANSACTION ||
+        method == RPC_METHOD_COMMIT_TRANSACTION))
+      {
+      method = 0;
+      }
 
-      // Process the RPC message
-
-      int result;
-      const char* res = STR_200;
-      const char* ptr = UClientImage_Base::rbuffer->data();
-
-      enum {
-         RPC_METHOD_FIND               = U_MULTICHAR_CONSTANT32('F','I','N','D'),
-         RPC_METHOD_STORE              = U_MULTICHAR_CONSTANT32('S','T','R','0'),
-         RPC_METHOD_REPLACE            = U_MULTICHAR_CONSTANT32('S','T','R','1'),
-         RPC_METHOD_REMOVE             = U_MULTICHAR_CONSTANT32('R','E','M','V'),
-         RPC_METHOD_SUBSTITUTE0        = U_MULTICHAR_CONSTANT32('S','U','B','0'),
-         RPC_METHOD_SUBSTITUTE1        = U_MULTICHAR_CONSTANT32('S','U','B','1'),
-         RPC_METHOD_PRINT0             = U_MULTICHAR_CONSTANT32('P','R','T','0'),
-         RPC_METHOD_PRINT1             = U_MULTICHAR_CONSTANT32('P','R','T','1'),
-         RPC_METHOD_REORGANIZE         = U_MULTICHAR_CONSTANT32('R','O','R','G'),
-         RPC_METHOD_BEGIN_TRANSACTION  = U_MULTICHAR_CONSTANT32('B','T','R','N'),
-         RPC_METHOD_ABORT_TRANSACTION  = U_MULTICHAR_CONSTANT32('A','T','R','N'),
-         RPC_METHOD_COMMIT_TRANSACTION = U_MULTICHAR_CONSTANT32('C','T','R','N')
-      };
-
-      switch (u_get_unalignedp32(ptr))
+   switch (method)
+      {
+      case RPC_METHOD_FIND:
          {
-         case RPC_METHOD_FIND:
+         if (rdb->find((*URPC::rpc_info)[0]))
             {
-            if (rdb->find((*URPC::rpc_info)[0]))
-               {
-               // Build the response: 200
+            // Build the response: 200
 
-               uint32_t size = rdb->data.dsize;
+            uint32_t size = rdb->data.dsize;
 
-               (void) UClientImage_Base::wbuffer->reserve(U_TOKEN_LN + size);
+            (void) UClientImage_Base::wbuffer->reserve(U_TOKEN_LN + size);
 
-               UStringExt::buildTokenInt(res = STR_200, size, *UClientImage_Base::wbuffer);
+            UStringExt::buildTokenInt(res = STR_200, size, *UClientImage_Base::wbuffer);
 
-               (void) UClientImage_Base::wbuffer->append((const char*)rdb->data.dptr, size);
-               }
-            else
-               {
-               // Build the response: 400
+            (void) UClientImage_Base::wbuffer->append((const char*)rdb->data.dptr, size);
+            }
+         else
+            {
+            // Build the response: 400
 
-               UStringExt::buildTokenInt(res = STR_400, 0, *UClientImage_Base::wbuffer);
-               }
+            UStringExt::buildTokenInt(res = STR_400, 0, *UClientImage_Base::wbuffer);
             }
-         break;
+         }
+      break;
 
-         case RPC_METHOD_STORE:
-         case RPC_METHOD_REPLACE:
+      case RPC_METHOD_STORE:
+      case RPC_METHOD_REPLACE:
+         {
+         // ------------------------------------------------------
+         // Write a key/value pair to a reliable database
+         // ------------------------------------------------------
+         // RETURN VALUE
+         // ------------------------------------------------------
+         //  0: Everything was OK
+         // -1: flag was RDB_INSERT and this key already existed
+         // -3: disk full writing to the journal file
+         // ------------------------------------------------------
+         // #define RDB_INSERT  0 // Insertion of new entries only
+         // #define RDB_REPLACE 1 // Allow replacing existing entries
+         // ------------------------------------------------------
+
+         result = rdb->store((*URPC::rpc_info)[0], (*URPC::rpc_info)[1], ptr[3] == '0' ? RDB_INSERT : RDB_REPLACE);
+
+         switch (result)
             {
-            // ------------------------------------------------------
-            // Write a key/value pair to a reliable database
-            // ------------------------------------------------------
-            // RETURN VALUE
-            // ------------------------------------------------------
-            //  0: Everything was OK
-            // -1: flag was RDB_INSERT and this key already existed
-            // -3: disk full writing to the journal file
-            // ------------------------------------------------------
-            // #define RDB_INSERT  0 // Insertion of new entries only
-            // #define RDB_REPLACE 1 // Allow replacing existing entries
-            // ------------------------------------------------------
-
-            result = rdb->store((*URPC::rpc_info)[0], (*URPC::rpc_info)[1], ptr[3] == '0' ? RDB_INSERT : RDB_REPLACE);
-
-            switch (result)
-               {
-               case  0: res = STR_200; break; //  0: Everything was OK
-               case -1: res = STR_401; break; // -1: flag was RDB_INSERT and this key already existed
-               case -3: res = STR_500; break; // -3: disk full writing to the journal file
-               }
+            case  0: res = STR_200; break; //  0: Everything was OK
+            case -1: res = STR_401; break; // -1: flag was RDB_INSERT and this key already existed
+            case -3: res = STR_500; break; // -3: disk full writing to the journal file
+            }
+
+         if (result == 0) URDBServer::logStore((*URPC::rpc_info)[0], (*URPC::rpc_info)[1]);
 
-            UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
+
+      case RPC_METHOD_REMOVE:
+         {
+         // ---------------------------------------------------------
+         // Mark a key/value as deleted
+         // ---------------------------------------------------------
+         // RETURN VALUE
+         // ---------------------------------------------------------
+         //  0: Everything was OK
+         // -1: The entry was not in the database
+         // -2: The entry was already marked deleted in the hash-tree
+         // -3: disk full writing to the journal file
+         // ---------------------------------------------------------
+
+         result = rdb->remove((*URPC::rpc_info)[0]);
+
+         switch (result)
+            {
+            case  0: res = STR_200; break; //  0: Everything was OK
+            case -1: res = STR_400; break; // -1: The entry was not in the database
+            case -2: res = STR_402; break; // -2: The entry was already marked deleted in the hash-tree
+            case -3: res = STR_500; break; // -3: disk full writing to the journal file
             }
-         break;
 
-         case RPC_METHOD_REMOVE:
+         if (result == 0) URDBServer::logRemove((*URPC::rpc_info)[0]);
+
+         UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
+
+      case RPC_METHOD_SUBSTITUTE0:
+      case RPC_METHOD_SUBSTITUTE1:
+         {
+         // ----------------------------------------------------------
+         // Substitute a key/value with a new key/value (remove+store)
+         // ----------------------------------------------------------
+         // RETURN VALUE
+         // ----------------------------------------------------------
+         //  0: Everything was OK
+         // -1: The entry was not in the database
+         // -2: The entry was marked deleted in the hash-tree
+         // -3: disk full writing to the journal file
+         // -4: flag was RDB_INSERT and the new key already existed
+         // ----------------------------------------------------------
+
+         // #define RDB_INSERT  0 // Insertion of new entries only
+         // #define RDB_REPLACE 1 // Allow replacing existing entries
+
+         result = rdb->substitute((*URPC::rpc_info)[0], (*URPC::rpc_info)[1], (*URPC::rpc_info)[2], ptr[3] == '0' ? RDB_INSERT : RDB_REPLACE);
+
+         switch (result)
             {
-            // ---------------------------------------------------------
-            // Mark a key/value as deleted
-            // ---------------------------------------------------------
-            // RETURN VALUE
-            // ---------------------------------------------------------
-            //  0: Everything was OK
-            // -1: The entry was not in the database
-            // -2: The entry was already marked deleted in the hash-tree
-            // -3: disk full writing to the journal file
-            // ---------------------------------------------------------
-
-            result = rdb->remove((*URPC::rpc_info)[0]);
-
-            switch (result)
-               {
-               case  0: res = STR_200; break; //  0: Everything was OK
-               case -1: res = STR_400; break; // -1: The entry was not in the database
-               case -2: res = STR_402; break; // -2: The entry was already marked deleted in the hash-tree
-               case -3: res = STR_500; break; // -3: disk full writing to the journal file
-               }
+            case  0: res = STR_200; break; //  0: Everything was OK
+            case -1: res = STR_400; break; // -1: The entry was not in the database
+            case -2: res = STR_402; break; // -2: The entry was marked deleted in the hash-tree
+            case -3: res = STR_500; break; // -3: disk full writing to the journal file
+            case -4: res = STR_401; break; // -4: flag was RDB_INSERT and the new key already existed
+            }
 
-            UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         if (result == 0)
+            {
+            URDBServer::logRemove((*URPC::rpc_info)[0]);
+            URDBServer::logStore( (*URPC::rpc_info)[1], (*URPC::rpc_info)[2]);
             }
-         break;
 
-         case RPC_METHOD_SUBSTITUTE0:
-         case RPC_METHOD_SUBSTITUTE1:
+         UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
+
+      case RPC_METHOD_PRINT0:
+      case RPC_METHOD_PRINT1:
+         {
+         // Build the response: 200
+
+         UString tmp = (ptr[3] == '0' ? rdb->print() : rdb->printSorted());
+
+         UStringExt::buildTokenInt(res = STR_200, tmp.size(), *UClientImage_Base::wbuffer);
+
+         UClientImage_Base::wbuffer->append(tmp);
+         }
+      break;
+
+      case RPC_METHOD_REORGANIZE:
+         {
+         res = (rdb->startReorganize() ? STR_200 : STR_500); // NB: the new cdb is built in background...
+
+         UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
+
+      case RPC_METHOD_BEGIN_TRANSACTION:
+         {
+         if (rdb->beginTransaction() == false) res = STR_500;
+         else
             {
-            // ----------------------------------------------------------
-            // Substitute a key/value with a new key/value (remove+store)
-            // ----------------------------------------------------------
-            // RETURN VALUE
-            // ----------------------------------------------------------
-            //  0: Everything was OK
-            // -1: The entry was not in the database
-            // -2: The entry was marked deleted in the hash-tree
-            // -3: disk full writing to the journal file
-            // -4: flag was RDB_INSERT and the new key already existed
-            // ----------------------------------------------------------
-
-            // #define RDB_INSERT  0 // Insertion of new entries only
-            // #define RDB_REPLACE 1 // Allow replacing existing entries
-
-            result = rdb->substitute((*URPC::rpc_info)[0], (*URPC::rpc_info)[1], (*URPC::rpc_info)[2], ptr[3] == '0' ? RDB_INSERT : RDB_REPLACE);
-
-            switch (result)
-               {
-               case  0: res = STR_200; break; //  0: Everything was OK
-               case -1: res = STR_400; break; // -1: The entry was not in the database
-               case -2: res = STR_402; break; // -2: The entry was marked deleted in the hash-tree
-               case -3: res = STR_500; break; // -3: disk full writing to the journal file
-               case -4: res = STR_401; break; // -4: flag was RDB_INSERT and the new key already existed
-               }
+            res = STR_200;
 
-            UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+            URDBServer::logBeginTransaction();
             }
-         break;
 
-         case RPC_METHOD_PRINT0:
-         case RPC_METHOD_PRINT1:
-            {
-            // Build the response: 200
+         UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
+
+      case RPC_METHOD_ABORT_TRANSACTION:
+         {
+         rdb->abortTransaction();
+
+         URDBServer::logAbortTransaction();
+
+         UStringExt::buildTokenInt(res = STR_200, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
 
-            UString tmp = (ptr[3] == '0' ? rdb->print() : rdb->printSorted());
+      case RPC_METHOD_COMMIT_TRANSACTION:
+         {
+         rdb->commitTransaction();
+
+         URDBServer::logCommitTransaction();
+
+         UStringExt::buildTokenInt(res = STR_200, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
 
+      case RPC_METHOD_REPLICATION_LOG:
+         {
+         // ----------------------------------------------------------------------------------------
+         // Send to the follower the records of the replication log after the position (id,lsn)
+         // ----------------------------------------------------------------------------------------
+         // RESPONSE: 200 => id and lsn after the records (2 * uint64_t) + the records
+         //           410 => the position is not in the log (the follower must reload the database)
+         // ----------------------------------------------------------------------------------------
+
+         UString tmp(U_CAPACITY);
+
+         if (URPC::rpc_info->size() == 2 &&
+             URDBServer::readLog(u_strtoull((*URPC::rpc_info)[0].data(), (*URPC::rpc_info)[0].pend()),
+                                 u_strtoull((*URPC::rpc_info)[1].data(), (*URPC::rpc_info)[1].pend()), tmp))
+            {
             UStringExt::buildTokenInt(res = STR_200, tmp.size(), *UClientImage_Base::wbuffer);
 
-            UClientImage_Base::wbuffer->append(tmp);
+            (void) UClientImage_Base::wbuffer->append(tmp);
+            }
+         else
+            {
+            UStringExt::buildTokenInt(res = STR_410, 0, *UClientImage_Base::wbuffer);
             }
-         break;
+         }
+      break;
+
+      case RPC_METHOD_REPLICATION_COPY:
+         {
+         // ------------------------------------------------------------------------------
+         // Send to the follower a copy of the database and the position of the log
+         // ------------------------------------------------------------------------------
+         // RESPONSE: 200 => id and lsn of the copy (2 * uint64_t) + the entries (print())
+         // ------------------------------------------------------------------------------
+
+         UString tmp(U_CAPACITY);
 
-         case RPC_METHOD_REORGANIZE:
+         if (URDBServer::readSnapshot(tmp))
             {
-            res = (rdb->reorganize() ? STR_200 : STR_500);
+            UStringExt::buildTokenInt(res = STR_200, tmp.size(), *UClientImage_Base::wbuffer);
 
-            UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+            (void) UClientImage_Base::wbuffer->append(tmp);
+            }
+         else
+            {
+            UStringExt::buildTokenInt(res = STR_500, 0, *UClientImage_Base::wbuffer);
             }
-         break;
+         }
+      break;
+
+      case RPC_METHOD_MULTI_FIND:
+         {
+         // ---------------------------------------------------------------------------------------------------
+         // Lookup of all the keys with one lock of the database
+         // ---------------------------------------------------------------------------------------------------
+         // RESPONSE: 200 => for every key an entry like print() ("+klen,dlen:key->data\n", dlen -1 if not found)
+         // ---------------------------------------------------------------------------------------------------
+
+         int vresult[U_RDB_BATCH_MAX];
+         uint32_t n = URPC::rpc_info->size();
 
-         case RPC_METHOD_BEGIN_TRANSACTION:
+         if (n > U_RDB_BATCH_MAX)
             {
-            res = (rdb->beginTransaction() ? STR_200 : STR_500);
+            UStringExt::buildTokenInt(res = STR_500, 0, *UClientImage_Base::wbuffer);
 
-            UStringExt::buildTokenInt(res, 0, *UClientImage_Base::wbuffer);
+            break;
             }
-         break;
 
-         case RPC_METHOD_ABORT_TRANSACTION:
+         UVector<UString> vdata(n);
+
+         (void) rdb->findBatch(*URPC::rpc_info, vdata, vresult);
+
+         UString tmp(U_CAPACITY);
+
+         for (uint32_t i = 0; i < n; ++i)
             {
-            rdb->abortTransaction();
+            UString key = (*URPC::rpc_info)[i];
 
-            UStringExt::buildTokenInt(res = STR_200, 0, *UClientImage_Base::wbuffer);
+            // NB: a key with empty data is found...
+
+            if (vresult[i] == 0) tmp.printKeyValue(U_STRING_TO_PARAM(key), U_STRING_TO_PARAM(vdata[i]));
+            else
+               {
+               tmp.snprintf_add(U_CONSTANT_TO_PARAM("+%u,-1:%v->\n"), key.size(), key.rep);
+               }
             }
-         break;
 
-         case RPC_METHOD_COMMIT_TRANSACTION:
+         UStringExt::buildTokenInt(res = STR_200, tmp.size(), *UClientImage_Base::wbuffer);
+
+         (void) UClientImage_Base::wbuffer->append(tmp);
+         }
+      break;
+
+      case RPC_METHOD_MULTI_STORE:
+      case RPC_METHOD_MULTI_REPLACE:
+      case RPC_METHOD_MULTI_REMOVE:
+         {
+         // ---------------------------------------------------------------------------------------------
+         // Write (key0,data0,key1,data1,...) or remove (key0,key1,...) with one lock of the database
+         // ---------------------------------------------------------------------------------------------
+         // RESPONSE: 200 => for every operation a char with the result ('0' + -result of store/remove)
+         // ---------------------------------------------------------------------------------------------
+
+         int vresult[U_RDB_BATCH_MAX];
+         uint32_t n = URPC::rpc_info->size();
+
+         if (method != RPC_METHOD_MULTI_REMOVE)
             {
-            rdb->commitTransaction();
+            if (n & 1)
+               {
+               UStringExt::buildTokenInt(res = STR_500, 0, *UClientImage_Base::wbuffer);
+
+               break;
+               }
 
-            UStringExt::buildTokenInt(res = STR_200, 0, *UClientImage_Base::wbuffer);
+            n /= 2;
             }
-         break;
 
-         default:
+         // NB: the number of operations is given by the client, we refuse a batch bigger than the buffer of the results...
+
+         if (n > U_RDB_BATCH_MAX)
             {
             UStringExt::buildTokenInt(res = STR_500, 0, *UClientImage_Base::wbuffer);
+
+            break;
             }
-         break;
-         }
 
-      U_SRV_LOG_WITH_ADDR("method %.4S return %s for", ptr, res);
+         if (method == RPC_METHOD_MULTI_REMOVE) (void) rdb->removeBatch(*URPC::rpc_info, vresult);
+         else                                   (void) rdb->storeBatch(*URPC::rpc_info, ptr[3] == '0' ? RDB_INSERT : RDB_REPLACE, vresult);
 
-      return UClientImage_Base::handlerResponse();
+         UStringExt::buildTokenInt(res = STR_200, n, *UClientImage_Base::wbuffer);
+
+         (void) UClientImage_Base::wbuffer->reserve(n);
+
+         char* presult = UClientImage_Base::wbuffer->pend();
+
+         for (uint32_t i = 0; i < n; ++i)
+            {
+            presult[i] = '0' - vresult[i];
+
+            if (vresult[i] == 0)
+               {
+               if (method == RPC_METHOD_MULTI_REMOVE) URDBServer::logRemove((*URPC::rpc_info)[i]);
+               else                                   URDBServer::logStore( (*URPC::rpc_info)[i*2], (*URPC::rpc_info)[i*2+1]);
+               }
+            }
+
+         UClientImage_Base::wbuffer->size_adjust(presult + n);
+         }
+      break;
+
+      default:
+         {
+         UStringExt::buildTokenInt(res = STR_500, 0, *UClientImage_Base::wbuffer);
+         }
+      break;
       }
 
-   U_RETURN(U_NOTIFIER_OK);
+   U_SRV_LOG_WITH_ADDR("method %.4S return %s for", ptr, res);
 }
 
 // DEBUG
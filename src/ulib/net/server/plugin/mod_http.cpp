@@ -73,12 +73,15 @@ int UHttpPlugIn::handlerConfig(UFileConfig& cfg)
    //
    // APACHE_LIKE_LOG        file to write NCSA extended/combined log format: "%h %l %u %t \"%r\" %>s %b \"%{Referer}i\" \"%{User-agent}i\""
    // LOG_FILE_SZ            memory size for file apache like log
+   // APACHE_LIKE_LOG_BINARY flag to write the apache like log as binary structured records (see UAccessLog) instead of text lines
    //
    // ENABLE_INOTIFY         enable automatic update of document root image with inotify
    // CACHE_FILE_MASK        mask (DOS regexp) of pathfile that content      be cached in memory
    // CACHE_AVOID_MASK       mask (DOS regexp) of pathfile that presence NOT be cached in memory
    // NOCACHE_FILE_MASK      mask (DOS regexp) of pathfile that content  NOT be cached in memory
    // CACHE_FILE_STORE       pathfile of memory cache stored on filesystem
+   // CACHE_FILE_MAX_SIZE    max memory size of the content of the files cached in memory, admission TinyLFU and eviction size-aware LRU (default 0 => no limit)
+   // CACHE_FILE_SHARED_SIZE size of the shared memory where the content of the files cached in memory is stored once for all the preforked children (default 0 => disabled)
    //
    // CACHE_FILE_AS_DYNAMIC_MASK mask (DOS regexp) of pathfile that content be cached as dynamic in memory (to avoid 'Last-Modified: ...' in header response)
    //
@@ -107,6 +110,8 @@ int UHttpPlugIn::handlerConfig(UFileConfig& cfg)
    // ----------------------------------------------------------------------------------------------------------------------------------------------------
    // LIMIT_REQUEST_BODY   restricts the total size of the HTTP request body sent from the client
    // REQUEST_READ_TIMEOUT set timeout for receiving requests
+   //
+   // REQUEST_ARENA_SIZE   memory size of the arena for the short-lived objects of the request (form data), rewound in bulk at the end of it (default 0 => disabled)
    // ------------------------------------------------------------------------------------------------------------------------------------------------
    //
    // ------------------------------------------------------------------------------------------------------------------------------------------------
@@ -205,8 +210,25 @@ int UHttpPlugIn::handlerConfig(UFileConfig& cfg)
 
    U_INTERNAL_DUMP("UHTTP::limit_request_body = %u UHTTP::min_size_request_body_for_parallelization = %u", UHTTP::limit_request_body, UHTTP::min_size_request_body_for_parallelization)
 
+   uint32_t arena_size = cfg.readLong(U_CONSTANT_TO_PARAM("REQUEST_ARENA_SIZE"));
+
+   if (arena_size)
+      {
+#  if defined(ENABLE_THREAD) && defined(U_SERVER_THREAD_APPROACH_SUPPORT)
+      if (UServer_Base::preforked_num_kids == -1) // NB: the arena is process-wide, in the thread approach this is not safe...
+         {
+         U_SRV_LOG("WARNING: Sorry, I can't enable the request arena because PREFORK_CHILD == -1 (server thread approach)");
+         }
+      else
+#  endif
+      UMemoryArena::init(arena_size);
+      }
+
    // CACHE FILE
 
+   UHTTP::cache_file_max_size    = cfg.readLong(U_CONSTANT_TO_PARAM("CACHE_FILE_MAX_SIZE"));
+   UHTTP::cache_file_shared_size = cfg.readLong(U_CONSTANT_TO_PARAM("CACHE_FILE_SHARED_SIZE"));
+
    x = cfg.at(U_CONSTANT_TO_PARAM("CACHE_FILE_MASK"));
 
    if (x)
@@ -421,6 +443,8 @@ int UHttpPlugIn::handlerConfig(UFileConfig& cfg)
 
       U_NEW(ULog, UServer_Base::apache_like_log, ULog(x, size));
 
+      U_Log_binary(UServer_Base::apache_like_log) = cfg.readBoolean(U_CONSTANT_TO_PARAM("APACHE_LIKE_LOG_BINARY"));
+
       if (size)
          {
          U_INTERNAL_ASSERT_EQUALS(UServer_Base::shm_data_add, 0)
@@ -564,6 +588,8 @@ int UHttpPlugIn::handlerInit()
 
    UHTTP::init();
 
+   UHTTP::reserveFileCacheShared(); // NB: we need to know the number of entries in the cache...
+
    U_RETURN(U_PLUGIN_HANDLER_OK);
 }
 
@@ -584,6 +610,8 @@ int UHttpPlugIn::handlerRun() // NB: we use this method instead of handlerInit()
 #endif
    if (UServer_Base::handler_inotify) UHTTP::initDbNotFound();
 
+   if (UHTTP::cache_file_shared) UHTTP::initFileCacheShared();
+
 #if defined(U_LINUX) && defined(ENABLE_THREAD)
    U_INTERNAL_ASSERT_POINTER(UServer_Base::ptr_shared_data)
 
@@ -673,6 +701,8 @@ int UHttpPlugIn::handlerFork()
    UHTTP::initInotify();
 #endif
 
+   if (UHTTP::cache_file_shared) UHTTP::afterForkFileCacheShared();
+
    if (UHTTP::bcallInitForAllUSP) UHTTP::callAfterForkForAllUSP();
 
    U_RETURN(U_PLUGIN_HANDLER_OK);
@@ -684,6 +714,12 @@ int UHttpPlugIn::handlerStop()
 
    U_INTERNAL_ASSERT_POINTER(UHTTP::cache_file)
 
+   if (UHTTP::cache_file_max_size) // NB: here the log is still open...
+      {
+      U_SRV_LOG("File cache (content in memory): %u hit, %u miss, %u evicted - used %u of %u bytes",
+                UHTTP::cache_file_hit, UHTTP::cache_file_miss, UHTTP::cache_file_evict, UHTTP::cache_file_used, UHTTP::cache_file_max_size);
+      }
+
    U_SET_MODULE_NAME(usp_end);
 
    UHTTP::callEndForAllUSP();
@@ -15,6 +15,8 @@
 #include <ulib/mime/entity.h>
 #include <ulib/utility/escape.h>
 #include <ulib/utility/websocket.h>
+#include <ulib/utility/socket_ext.h>
+#include <ulib/utility/string_ext.h>
 #include <ulib/net/server/server.h>
 #include <ulib/net/server/client_image.h>
 #include <ulib/net/server/plugin/mod_proxy.h>
@@ -26,11 +28,870 @@
 #endif
 */
 
+#define U_PROXY_MAX_HEADER (64U * 1024U)
+
+// state of the scan of a chunked body (see scanBody())
+
+#define U_CHUNK_SIZE       0 // reading the hex size of the chunk
+#define U_CHUNK_EXT        1 // skipping the chunk extension until LF
+#define U_CHUNK_DATA       2 // reading the data of the chunk
+#define U_CHUNK_DATA_END   3 // skipping the CRLF after the data of the chunk
+#define U_CHUNK_TRAILER    4 // at the start of a trailer line
+#define U_CHUNK_TRAILER_LF 5 // skipping a trailer line until LF
+#define U_CHUNK_LAST_LF    6 // waiting the LF of the final empty line
+
 UHttpClient<UTCPSocket>* UProxyPlugIn::client_http;
+UVector<UProxyUpstream*>* UProxyPlugIn::vupstream;
+
+U_CREAT_FUNC(server_plugin_proxy, UProxyPlugIn)
+
+UProxyUpstream::UProxyUpstream(UModProxyService* _service, UModProxyBackend* _backend, const UString& _server, int _port) : server(_server), header(U_CAPACITY)
+{
+   U_TRACE_CTOR(0, UProxyUpstream, "%p,%p,%V,%d", _service, _backend, _server.rep, _port)
+
+   U_NEW(UTCPSocket, socket, UTCPSocket);
+
+   service      = _service;
+   backend      = _backend;
+   pClientImage = U_NULLPTR;
+   remain       = 0;
+   timestamp    = u_now->tv_sec;
+   sent         = nresponse = client_serial = hkey = 0;
+   port         = _port;
+   client_fd    = -1;
+   status       = 0;
+   state        = IDLE;
+   body_type    = BODY_NONE;
+   chunk_state  = U_CHUNK_SIZE;
+
+   writer.upstream = this;
+
+   bclose_client = bhead = breuse = bretry = bkeep_alive = bprobe = bwait = false;
+}
+
+UProxyUpstream::~UProxyUpstream()
+{
+   U_TRACE_DTOR(0, UProxyUpstream)
+
+   U_DELETE(socket)
+}
+
+bool UProxyUpstream::connect()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::connect()")
+
+   U_INTERNAL_ASSERT_EQUALS(state, IDLE)
+
+   if (socket->beginAsynchronousConnect(server, port))
+      {
+      UEventFd::fd = socket->getFd();
+
+      if (socket->isConnected() == false)
+         {
+         state   = CONNECT;
+         op_mask = EPOLLOUT;
+         }
+      else
+         {
+         socket->setNonBlocking(); // NB: finishAsynchronousConnect() set the socket blocking...
+
+         state   = WRITE;
+         op_mask = EPOLLIN | EPOLLRDHUP;
+         }
+
+      U_RETURN(true);
+      }
+
+   U_SRV_LOG("WARNING: proxy connect to %V:%d failed - errno %d", server.rep, port, errno);
+
+   U_RETURN(false);
+}
+
+bool UProxyUpstream::forward(UClientImage_Base* _pClientImage, const UString& _request)
+{
+   U_TRACE(0, "UProxyUpstream::forward(%p,%V)", _pClientImage, _request.rep)
+
+   U_INTERNAL_ASSERT(_request)
+   U_INTERNAL_ASSERT_EQUALS(pClientImage, U_NULLPTR)
+
+   (void) request.replace(U_STRING_TO_PARAM(_request)); // NB: the read buffer of the client is reused for the next read...
+
+   pClientImage = _pClientImage; // NB: null for a probe of the health check...
+   timestamp    = u_now->tv_sec;
+   sent         = nresponse = 0;
+
+   if (pClientImage == U_NULLPTR) client_fd = -1;
+   else
+      {
+      client_fd     = pClientImage->UEventFd::fd;
+      client_serial = pClientImage->serial;
+
+      if (backend) ++backend->outstanding;
+      }
+
+   header.setEmpty();
+
+   reset();
+
+   if (state == CONNECT) U_RETURN(true); // NB: the request is sent when the connect is complete...
+
+   state = WRITE;
+
+   if (sendRequest()) U_RETURN(true);
+
+   if (pClientImage) release(false);
+
+   U_RETURN(false);
+}
+
+void UProxyUpstream::release(bool bok)
+{
+   U_TRACE(0, "UProxyUpstream::release(%b)", bok)
+
+   U_INTERNAL_ASSERT_POINTER(pClientImage)
+
+   if (bwait)
+      {
+      bwait = false;
+
+      if (isClient(pClientImage)) UNotifier::suspend(&writer); // NB: otherwise the descriptor is already closed...
+      }
+
+   if (pending) pending.clear();
+
+   pClientImage = U_NULLPTR;
+
+   if (backend)
+      {
+      U_INTERNAL_ASSERT_MAJOR(backend->outstanding, 0)
+
+      --backend->outstanding;
+
+      if (bok) service->setBackendSuccess(backend);
+      }
+}
+
+void UProxyUpstream::reset()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::reset()")
+
+   remain      = 0;
+   body_type   = BODY_NONE;
+   chunk_state = U_CHUNK_SIZE;
+   bkeep_alive = false;
+}
+
+bool UProxyUpstream::sendRequest()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::sendRequest()")
+
+   U_INTERNAL_ASSERT_EQUALS(state, WRITE)
+
+   int value;
+   const char* ptr = request.data();
+   uint32_t len    = request.size();
+
+   while (sent < len)
+      {
+      value = socket->send(ptr + sent, len - sent);
+
+      if (value <= 0)
+         {
+         if (value == -1 &&
+             errno == EAGAIN)
+            {
+            if (op_mask != EPOLLOUT)
+               {
+               op_mask = EPOLLOUT;
+
+               (void) UNotifier::modify(this);
+               }
+
+            U_RETURN(true);
+            }
+
+         U_RETURN(false);
+         }
+
+      sent += value;
+      }
+
+   state = HEADER;
+
+   if (op_mask != (EPOLLIN | EPOLLRDHUP))
+      {
+      op_mask = EPOLLIN | EPOLLRDHUP;
+
+      (void) UNotifier::modify(this);
+      }
+
+   U_RETURN(true);
+}
+
+bool UProxyUpstream::isClient(UClientImage_Base* pclient) const
+{
+   U_TRACE(0, "UProxyUpstream::isClient(%p)", pclient)
+
+   U_INTERNAL_ASSERT_POINTER(pclient)
+
+   U_INTERNAL_DUMP("client_fd = %d client_serial = %u pclient->UEventFd::fd = %d pclient->serial = %u", client_fd, client_serial, pclient->UEventFd::fd, pclient->serial)
+
+   // NB: the client can be gone and its descriptor reused by a new connection...
+
+   if (pclient->UEventFd::fd == client_fd     &&
+       pclient->serial       == client_serial &&
+       pclient->socket->isOpen())
+      {
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+
+bool UProxyUpstream::writeToClient(const char* ptr, uint32_t len)
+{
+   U_TRACE(0, "UProxyUpstream::writeToClient(%.*S,%u)", len, ptr, len)
+
+   U_INTERNAL_ASSERT_POINTER(pClientImage)
+
+   if (isClient(pClientImage) == false) U_RETURN(false);
+
+   nresponse += len;
+
+   if (pending)
+      {
+      // NB: we are waiting the client to be writable, the data are queued to keep the order...
+
+      (void) pending.append(ptr, len);
+
+      U_RETURN(true);
+      }
+
+   int value;
+
+   while (len)
+      {
+      value = pClientImage->socket->send(ptr, len);
+
+      if (value <= 0)
+         {
+         if (value == -1 &&
+             errno == EAGAIN)
+            {
+            // NB: the client is slower than the server, we queue the rest and wait for EPOLLOUT on the socket of the client...
+
+            (void) pending.append(ptr, len);
+
+            writer.fd = client_fd;
+
+            UNotifier::resume(&writer, EPOLLOUT);
+
+            bwait = true;
+
+            U_RETURN(true);
+            }
+
+         U_RETURN(false);
+         }
+
+      ptr += value;
+      len -= value;
+      }
+
+   U_RETURN(true);
+}
+
+void UProxyUpstream::flush()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::flush()")
+
+   U_INTERNAL_ASSERT(bwait)
+   U_INTERNAL_ASSERT(pending)
+   U_INTERNAL_ASSERT_POINTER(pClientImage)
+
+   int value;
+
+   if (isClient(pClientImage) == false) goto error;
+
+   timestamp = u_now->tv_sec;
+
+   do {
+      value = pClientImage->socket->send(pending.data(), pending.size());
+
+      if (value <= 0)
+         {
+         if (value == -1 &&
+             errno == EAGAIN)
+            {
+            return;
+            }
+
+         goto error;
+         }
+
+      (void) pending.erase(0, value);
+      }
+   while (pending);
+
+   bwait = false;
+
+   UNotifier::suspend(&writer);
+
+   if (state == FLUSH)
+      {
+      // NB: we are called by the notifier for the writer of the client, so we can't delete this object here...
+
+      if (endResponse() == U_NOTIFIER_DELETE) state = CLOSE;
+      else                                    UNotifier::resume(this, EPOLLIN | EPOLLRDHUP);
+
+      return;
+      }
+
+   // NB: we restart to read from the server...
+
+   UNotifier::resume(this, EPOLLIN | EPOLLRDHUP);
+
+   return;
+
+error:
+   fail(0);
+
+   state = CLOSE;
+}
+
+uint32_t UProxyUpstream::parseHeader()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::parseHeader()")
+
+   const char* ptr = header.data();
+   const char* end = (const char*) u_find(ptr, header.size(), U_CONSTANT_TO_PARAM(U_CRLF2));
+
+   if (end == U_NULLPTR) U_RETURN(0);
+
+   const char* p;
+   int code = 0;
+   uint32_t pos, hlen = end - ptr + U_CONSTANT_SIZE(U_CRLF2);
+
+   reset();
+
+   status = 0;
+
+   body_type = BODY_EOF; // NB: if we don't understand the response we forward everything until the server close the connection...
+
+   if (hlen > U_CONSTANT_SIZE("HTTP/1.x 200\r\n\r\n") &&
+       memcmp(ptr, U_CONSTANT_TO_PARAM("HTTP/1.")) == 0 &&
+       u__isdigit(ptr[9])                              &&
+       u__isdigit(ptr[10])                             &&
+       u__isdigit(ptr[11]))
+      {
+      code = status = (ptr[9] - '0') * 100 + (ptr[10] - '0') * 10 + (ptr[11] - '0');
+
+      if (code < 200 &&
+          code != 101)
+         {
+         // NB: an interim response (100 Continue, 103 Early Hints, ...), the final response follow...
+
+         body_type = BODY_NONE;
+
+         U_RETURN(hlen);
+         }
+
+      bkeep_alive = (ptr[7] == '1' && code != 101);
+
+      pos = (const char*)memchr(ptr, '\n', hlen) - ptr + 1;
+
+      p = UStringExt::getValueFromName(header, pos, hlen - pos, U_CONSTANT_TO_PARAM("Connection"), true);
+
+      if (p)
+         {
+              if (u__strncasecmp(p, U_CONSTANT_TO_PARAM("close"))      == 0) bkeep_alive = false;
+         else if (u__strncasecmp(p, U_CONSTANT_TO_PARAM("keep-alive")) == 0) bkeep_alive = (code != 101);
+         }
+
+      if (bhead        ||
+          code == 204  ||
+          code == 304)
+         {
+         body_type = BODY_NONE;
+         }
+      else if (code != 101)
+         {
+         p = UStringExt::getValueFromName(header, pos, hlen - pos, U_CONSTANT_TO_PARAM("Transfer-Encoding"), true);
+
+         if (p &&
+             u__strncasecmp(p, U_CONSTANT_TO_PARAM("chunked")) == 0)
+            {
+            body_type = BODY_CHUNK;
+            }
+         else
+            {
+            p = UStringExt::getValueFromName(header, pos, hlen - pos, U_CONSTANT_TO_PARAM("Content-Length"), true);
+
+            if (p)
+               {
+               for (end = p; u__isdigit(*end); ++end) {}
+
+               remain    = u_strtoull(p, end);
+               body_type = BODY_LENGTH;
+               }
+            }
+         }
+      }
+
+   if (body_type == BODY_EOF) bkeep_alive = false;
+
+   U_INTERNAL_DUMP("code = %d body_type = %u remain = %llu bkeep_alive = %b", code, body_type, remain, bkeep_alive)
+
+   state = BODY;
+
+   U_RETURN(hlen);
+}
+
+bool UProxyUpstream::scanBody(const char* ptr, uint32_t len, uint32_t& n)
+{
+   U_TRACE(0, "UProxyUpstream::scanBody(%.*S,%u,%p)", len, ptr, len, &n)
+
+   U_INTERNAL_ASSERT_EQUALS(state, BODY)
+
+   if (body_type == BODY_NONE)
+      {
+      n = 0;
+
+      U_RETURN(true);
+      }
+
+   if (body_type == BODY_EOF)
+      {
+      n = len;
+
+      U_RETURN(false);
+      }
+
+   if (body_type == BODY_LENGTH)
+      {
+      n = (remain < len ? (uint32_t)remain : len);
+
+      remain -= n;
+
+      if (remain == 0) U_RETURN(true);
+
+      U_RETURN(false);
+      }
+
+   U_INTERNAL_ASSERT_EQUALS(body_type, BODY_CHUNK)
+
+   unsigned char c;
+   uint32_t k, i = 0;
+
+   while (i < len)
+      {
+      if (chunk_state == U_CHUNK_DATA)
+         {
+         k = (remain < (len - i) ? (uint32_t)remain : (len - i));
+
+         i      += k;
+         remain -= k;
+
+         if (remain == 0) chunk_state = U_CHUNK_DATA_END;
+
+         continue;
+         }
+
+      c = ptr[i++];
+
+      switch (chunk_state)
+         {
+         case U_CHUNK_SIZE:
+            {
+                 if (u__isxdigit(c)) remain = (remain << 4) | u__hexc2int(c);
+            else if (c == '\n')      chunk_state = (remain ? U_CHUNK_DATA : U_CHUNK_TRAILER);
+            else                     chunk_state = U_CHUNK_EXT;
+            }
+         break;
+
+         case U_CHUNK_EXT:
+            {
+            if (c == '\n') chunk_state = (remain ? U_CHUNK_DATA : U_CHUNK_TRAILER);
+            }
+         break;
+
+         case U_CHUNK_DATA_END:
+            {
+            if (c == '\n') chunk_state = U_CHUNK_SIZE;
+            }
+         break;
+
+         case U_CHUNK_TRAILER:
+            {
+                 if (c == '\r') chunk_state = U_CHUNK_LAST_LF;
+            else if (c != '\n') chunk_state = U_CHUNK_TRAILER_LF;
+            else
+               {
+               n = i;
+
+               U_RETURN(true);
+               }
+            }
+         break;
+
+         case U_CHUNK_TRAILER_LF:
+            {
+            if (c == '\n') chunk_state = U_CHUNK_TRAILER;
+            }
+         break;
+
+         case U_CHUNK_LAST_LF:
+            {
+            if (c == '\n')
+               {
+               n = i;
+
+               U_RETURN(true);
+               }
+            }
+         break;
+         }
+      }
+
+   n = len;
+
+   U_RETURN(false);
+}
+
+void UProxyUpstream::finish()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::finish()")
+
+   U_INTERNAL_ASSERT_POINTER(pClientImage)
+   U_INTERNAL_ASSERT_EQUALS(bwait, false)
+
+   UClientImage_Base* pclient = pClientImage;
+   bool bclient = isClient(pclient);
+
+   release(true);
+
+   state     = IDLE;
+   timestamp = u_now->tv_sec;
+
+   request.setEmpty();
+    header.setEmpty();
+
+   if (bclient)
+      {
+      if (bclose_client) UNotifier::handlerDelete((UEventFd*)pclient);
+      else
+         {
+         // NB: the client can send the next request...
+
+         U_ClientImage_idle(pclient) = U_MAYBE;
+
+         pclient->last_event = u_now->tv_sec;
+
+         UNotifier::resume(pclient, pclient->UEventFd::op_mask);
+         }
+      }
+}
+
+void UProxyUpstream::fail(int code)
+{
+   U_TRACE(0, "UProxyUpstream::fail(%d)", code)
+
+   U_INTERNAL_ASSERT_POINTER(pClientImage)
+
+   UClientImage_Base* pclient = pClientImage;
+   bool bclient = isClient(pclient);
+
+   release(false);
+
+   if (backend &&
+       code    &&
+       (breuse == false || nresponse)) // NB: a connection of the pool closed by the server before to answer is not a failure of the backend...
+      {
+      service->setBackendFailure(backend);
+      }
+
+   if (bclient == false) return; // NB: the client is gone...
+
+   if (code == HTTP_BAD_GATEWAY &&
+       bretry               &&
+       nresponse == 0)
+      {
+      // NB: the server has closed the connection before to answer, we try once again with another connection (maybe to another backend).
+      //     We are not in the context of the request of the client (the current connection is another one), so the backend is selected
+      //     with the key saved by forwardRequest(), and a backend that has failed (not a connection of the pool) is avoided if possible...
+
+      UProxyUpstream* upstream;
+      UModProxyBackend* _backend;
+      UModProxyBackend* failed = (breuse ? U_NULLPTR : backend);
+
+      for (int i = 0; i < 2; ++i)
+         {
+         _backend = service->selectBackend(hkey, failed);
+         upstream = UProxyPlugIn::getUpstream(service, _backend, true);
+
+         if (upstream == U_NULLPTR)
+            {
+            if (_backend == U_NULLPTR) break;
+
+            service->setBackendFailure(_backend);
+
+            failed = _backend;
+
+            continue;
+            }
+
+         upstream->hkey          = hkey;
+         upstream->bhead         = bhead;
+         upstream->bretry        = false;
+         upstream->bclose_client = bclose_client;
+
+         if (upstream->forward(pclient, request)) return;
+
+         UNotifier::handlerDelete(upstream);
+
+         break;
+         }
+      }
+
+   if (nresponse == 0)
+      {
+      if (code == HTTP_BAD_GATEWAY)
+         {
+         (void) USocketExt::write(pclient->socket, U_CONSTANT_TO_PARAM("HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"), UServer_Base::timeoutMS);
+         }
+      else if (code == HTTP_GATEWAY_TIMEOUT)
+         {
+         (void) USocketExt::write(pclient->socket, U_CONSTANT_TO_PARAM("HTTP/1.1 504 Gateway Timeout\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"), UServer_Base::timeoutMS);
+         }
+      }
+
+   UNotifier::handlerDelete((UEventFd*)pclient);
+}
+
+int UProxyUpstream::handlerWrite()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::handlerWrite()")
 
-U_CREAT_FUNC(server_plugin_proxy, UProxyPlugIn)
+   if (state == CONNECT)
+      {
+      if (socket->finishAsynchronousConnect() == false) U_RETURN(U_NOTIFIER_DELETE);
+
+      socket->setNonBlocking(); // NB: finishAsynchronousConnect() set the socket blocking...
+
+      state = WRITE;
+      }
+
+   if (state == WRITE &&
+       sendRequest())
+      {
+      U_RETURN(U_NOTIFIER_OK);
+      }
+
+   U_RETURN(U_NOTIFIER_DELETE);
+}
+
+int UProxyUpstream::handlerRead()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::handlerRead()")
+
+   int value;
+   bool complete;
+   const char* ptr;
+   uint32_t n, len, hlen;
+   char buffer[16 * 1024];
+
+   if (state == CLOSE) U_RETURN(U_NOTIFIER_DELETE);
+
+   while (true)
+      {
+      if (pending)
+         {
+         // NB: we stop to read from the server until the client has received the queued data (see flush())...
+
+         UNotifier::suspend(this);
+
+         U_ClientImage_state = U_PLUGIN_HANDLER_AGAIN;
+
+         U_RETURN(U_NOTIFIER_OK);
+         }
+
+      value = socket->recv(buffer, sizeof(buffer));
+
+      if (value <= 0)
+         {
+         if (value == -1 &&
+             errno == EAGAIN)
+            {
+            U_ClientImage_state = U_PLUGIN_HANDLER_AGAIN;
+
+            U_RETURN(U_NOTIFIER_OK);
+            }
+
+         // NB: the server has closed the connection...
+
+         if (value == 0       &&
+             state == BODY    &&
+             body_type == BODY_EOF)
+            {
+            bclose_client = true; // NB: the client can know the end of the response only by the close of the connection...
+
+            U_INTERNAL_ASSERT_EQUALS(bkeep_alive, false)
+
+            if (bwait)
+               {
+               state = FLUSH;
+
+               UNotifier::suspend(this);
+
+               U_RETURN(U_NOTIFIER_OK);
+               }
+
+            finish();
+            }
+
+         U_RETURN(U_NOTIFIER_DELETE);
+         }
+
+      if (state < HEADER) U_RETURN(U_NOTIFIER_DELETE); // NB: data from the server while we don't wait a response...
+
+      timestamp = u_now->tv_sec;
+
+      if (state == BODY)
+         {
+         ptr = buffer;
+         len = value;
+         }
+      else
+         {
+         (void) header.append(buffer, value);
+
+loop:    hlen = parseHeader();
+
+         if (hlen == 0)
+            {
+            if (header.size() > U_PROXY_MAX_HEADER) U_RETURN(U_NOTIFIER_DELETE);
+
+            continue;
+            }
+
+         if (bprobe)
+            {
+            service->setBackendHealth(backend, (status >= 200 && status < 400));
+
+            bprobe = false;
+
+            U_RETURN(U_NOTIFIER_DELETE);
+            }
+
+         if (writeToClient(header.data(), hlen) == false)
+            {
+            fail(0);
+
+            U_RETURN(U_NOTIFIER_DELETE);
+            }
+
+         if (state == HEADER) // NB: interim response...
+            {
+            (void) header.erase(0, hlen);
+
+            if (header) goto loop;
 
-UProxyPlugIn::UProxyPlugIn()
+            continue;
+            }
+
+         ptr = header.c_pointer(hlen);
+         len = header.size() - hlen;
+         }
+
+      complete = scanBody(ptr, len, n);
+
+      if (n &&
+          writeToClient(ptr, n) == false)
+         {
+         fail(0);
+
+         U_RETURN(U_NOTIFIER_DELETE);
+         }
+
+      if (complete)
+         {
+         if (n < len) bkeep_alive = false; // NB: the server sent more data than the response...
+
+         if (bwait)
+            {
+            // NB: the response is complete but the client has not received all the data yet...
+
+            state = FLUSH;
+
+            UNotifier::suspend(this);
+
+            U_RETURN(U_NOTIFIER_OK);
+            }
+
+         U_RETURN(endResponse());
+         }
+      }
+}
+
+int UProxyUpstream::endResponse()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::endResponse()")
+
+   finish();
+
+   if (bkeep_alive == false ||
+       UProxyPlugIn::getIdle(service) > (uint32_t)service->getKeepAlive())
+      {
+      U_RETURN(U_NOTIFIER_DELETE);
+      }
+
+   breuse = true;
+
+   U_RETURN(U_NOTIFIER_OK);
+}
+
+void UProxyUpstream::handlerDelete()
+{
+   U_TRACE_NO_PARAM(0, "UProxyUpstream::handlerDelete()")
+
+   UProxyPlugIn::erase(this);
+
+   if (socket->isOpen()) socket->close();
+
+   if (pClientImage) fail(HTTP_BAD_GATEWAY);
+   else if (bprobe)  service->setBackendHealth(backend, false);
+
+   U_DELETE(this)
+}
+
+int UProxyClientWriter::handlerWrite()
+{
+   U_TRACE_NO_PARAM(0, "UProxyClientWriter::handlerWrite()")
+
+   U_INTERNAL_ASSERT_POINTER(upstream)
+
+   if (upstream->bwait) upstream->flush();
+
+   U_RETURN(U_NOTIFIER_OK); // NB: the descriptor is of the client, we never ask to delete it...
+}
+
+void UProxyClientWriter::handlerDelete()
+{
+   U_TRACE_NO_PARAM(0, "UProxyClientWriter::handlerDelete()")
+
+   U_INTERNAL_ASSERT_POINTER(upstream)
+
+   // NB: error or hangup on the socket of the client while we wait to flush the queued data...
+
+   if (upstream->bwait)
+      {
+      upstream->fail(0);
+
+      upstream->state = UProxyUpstream::CLOSE;
+      }
+}
+
+UProxyPlugIn::UProxyPlugIn() : UEventTime(1L, 0L)
 {
    U_TRACE_CTOR(0, UProxyPlugIn, "")
 }
@@ -40,6 +901,192 @@ UProxyPlugIn::~UProxyPlugIn()
    U_TRACE_DTOR(0, UProxyPlugIn)
 
    if (client_http) U_DELETE(client_http)
+   if (vupstream)   U_DELETE(vupstream) // NB: the connections are owned by UServer_Base::handler_other...
+}
+
+uint32_t UProxyPlugIn::getIdle(UModProxyService* service)
+{
+   U_TRACE(0, "UProxyPlugIn::getIdle(%p)", service)
+
+   uint32_t n = 0;
+
+   for (uint32_t i = 0, sz = vupstream->size(); i < sz; ++i)
+      {
+      UProxyUpstream* upstream = vupstream->at(i);
+
+      if (upstream->service == service &&
+          upstream->isIdle())
+         {
+         ++n;
+         }
+      }
+
+   U_RETURN(n);
+}
+
+UProxyUpstream* UProxyPlugIn::getUpstream(UModProxyService* service, UModProxyBackend* backend, bool bnew)
+{
+   U_TRACE(0, "UProxyPlugIn::getUpstream(%p,%p,%b)", service, backend, bnew)
+
+   U_INTERNAL_ASSERT_POINTER(vupstream)
+
+   int port = (backend ? backend->port : service->getPort());
+   UString server = (backend ? backend->server : service->getServer());
+   UProxyUpstream* upstream;
+
+   // NB: we search backward, the connection used more recently is the most likely to be still alive...
+
+   if (bnew == false)
+      {
+      for (int32_t i = vupstream->size() - 1; i >= 0; --i)
+         {
+         upstream = vupstream->at(i);
+
+         if (upstream->isIdle() &&
+             upstream->isFor(service, server, port))
+            {
+            upstream->breuse = true;
+
+            U_RETURN_POINTER(upstream, UProxyUpstream);
+            }
+         }
+      }
+
+   U_NEW(UProxyUpstream, upstream, UProxyUpstream(service, backend, server, port));
+
+   if (upstream->connect() == false)
+      {
+      U_DELETE(upstream)
+
+      U_RETURN_POINTER(U_NULLPTR, UProxyUpstream);
+      }
+
+   vupstream->push_back(upstream);
+
+   UServer_Base::addHandlerEvent(upstream); // NB: so it is not considered a client by the check for timeout of the connections...
+
+   UNotifier::insert(upstream);
+
+   U_RETURN_POINTER(upstream, UProxyUpstream);
+}
+
+void UProxyPlugIn::erase(UProxyUpstream* upstream)
+{
+   U_TRACE(0, "UProxyPlugIn::erase(%p)", upstream)
+
+   uint32_t pos = vupstream->find(upstream);
+
+   if (pos != U_NOT_FOUND) (void) vupstream->remove(pos);
+
+   pos = UServer_Base::handler_other->find(upstream);
+
+   if (pos != U_NOT_FOUND) (void) UServer_Base::handler_other->remove(pos);
+}
+
+void UProxyPlugIn::probe(UModProxyService* service, UModProxyBackend* backend)
+{
+   U_TRACE(0, "UProxyPlugIn::probe(%p,%p)", service, backend)
+
+   backend->last_probe = u_now->tv_sec;
+
+   UProxyUpstream* upstream = getUpstream(service, backend, true);
+
+   if (upstream == U_NULLPTR)
+      {
+      service->setBackendHealth(backend, false);
+
+      return;
+      }
+
+   UString request(U_CAPACITY);
+
+   request.snprintf(U_CONSTANT_TO_PARAM("GET %v HTTP/1.1\r\nHost: %v:%d\r\nConnection: close\r\n\r\n"), service->health_uri.rep, backend->server.rep, backend->port);
+
+   upstream->bprobe = backend->bprobe = true;
+
+   if (upstream->forward(U_NULLPTR, request) == false) UNotifier::handlerDelete(upstream); // NB: handlerDelete() set the backend down...
+}
+
+bool UProxyPlugIn::isAsynchronous()
+{
+   U_TRACE_NO_PARAM(0, "UProxyPlugIn::isAsynchronous()")
+
+   U_INTERNAL_ASSERT_POINTER(UHTTP::service)
+
+   // NB: the command, the websocket, the redirect and the replace of the response need the complete response (or the connection) in a process...
+
+   if (UHTTP::service->command == U_NULLPTR              &&
+       UHTTP::service->isWebSocket()       == false      &&
+       UHTTP::service->isReplaceResponse() == false      &&
+       UHTTP::service->isFollowRedirects() == false      &&
+       UHTTP::service->isAuthorization()   == false      &&
+       U_http_version != '2'                             &&
+       U_ClientImage_pipeline == false                   &&
+       UServer_Base::preforked_num_kids != -1            &&
+       UServer_Base::isParallelizationChild() == false)
+      {
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+
+bool UProxyPlugIn::forwardRequest()
+{
+   U_TRACE_NO_PARAM(0, "UProxyPlugIn::forwardRequest()")
+
+   bool breuse;
+   UProxyUpstream* upstream;
+   UModProxyBackend* backend;
+   UModProxyBackend* failed = U_NULLPTR;
+   UClientImage_Base* pClientImage = UServer_Base::pClientImage;
+   uint32_t hkey = UHTTP::service->getHashKey();
+   bool bidempotent = ((U_http_method_type & (HTTP_GET | HTTP_HEAD | HTTP_PUT | HTTP_DELETE | HTTP_OPTIONS)) != 0);
+
+   for (int i = 0; i < 2; ++i) // NB: a connection of the pool can be closed by the server at any time, and a backend can be down...
+      {
+      backend  = UHTTP::service->selectBackend(hkey, failed);
+      upstream = getUpstream(UHTTP::service, backend);
+
+      if (upstream == U_NULLPTR)
+         {
+         if (backend == U_NULLPTR) break;
+
+         UHTTP::service->setBackendFailure(backend);
+
+         failed = backend; // NB: we try another backend if there is one available...
+
+         continue;
+         }
+
+      upstream->hkey          = hkey;
+      upstream->bhead         = UHTTP::isHEAD();
+      upstream->bretry        = (bidempotent && (upstream->breuse || UHTTP::service->vbackend.size() > 1));
+      upstream->bclose_client = U_ClientImage_close;
+
+      if (upstream->forward(pClientImage, *UClientImage_Base::request))
+         {
+         // NB: the client is suspended while waiting the response of the server...
+
+         U_ClientImage_close = false;
+
+         U_ClientImage_idle(pClientImage) = U_YES;
+
+         UNotifier::suspend(pClientImage);
+
+         UClientImage_Base::setRequestProcessed();
+
+         U_RETURN(true);
+         }
+
+      breuse = upstream->breuse;
+
+      UNotifier::handlerDelete(upstream);
+
+      if (breuse == false) break;
+      }
+
+   U_RETURN(false);
 }
 
 // Server-wide hooks
@@ -60,9 +1107,88 @@ int UProxyPlugIn::handlerInit()
 
    U_NEW(UHttpClient<UTCPSocket>, client_http, UHttpClient<UTCPSocket>((UFileConfig*)U_NULLPTR));
 
+   U_NEW(UVector<UProxyUpstream*>, vupstream, UVector<UProxyUpstream*>);
+
+   U_RETURN(U_PLUGIN_HANDLER_PROCESSED);
+}
+
+int UProxyPlugIn::handlerRun()
+{
+   U_TRACE_NO_PARAM(0, "UProxyPlugIn::handlerRun()")
+
+   if (UHTTP::vservice) UTimer::insert(this); // NB: check for timeout of the connections to the upstream servers...
+
    U_RETURN(U_PLUGIN_HANDLER_PROCESSED);
 }
 
+// define method VIRTUAL of class UEventTime
+
+int UProxyPlugIn::handlerTime()
+{
+   U_TRACE_NO_PARAM(0, "UProxyPlugIn::handlerTime()")
+
+   UProxyUpstream* upstream;
+
+   for (int32_t i = vupstream->size() - 1; i >= 0; --i)
+      {
+      upstream = vupstream->at(i);
+
+      U_INTERNAL_DUMP("upstream = %p state = %u timestamp = %ld", upstream, upstream->state, upstream->timestamp)
+
+      if (upstream->state == UProxyUpstream::CLOSE)
+         {
+         UNotifier::handlerDelete(upstream);
+
+         continue;
+         }
+
+      if ((u_now->tv_sec - upstream->timestamp) > upstream->service->getTimeout())
+         {
+         if (upstream->pClientImage)
+            {
+            U_SRV_LOG("WARNING: proxy request to %V:%d timed out", upstream->server.rep, upstream->port);
+
+            upstream->bretry = false;
+
+            upstream->fail(HTTP_GATEWAY_TIMEOUT);
+            }
+
+         UNotifier::handlerDelete(upstream);
+         }
+      }
+
+   // active check of the backends of the services (a probe is a connection like the others, so the timeout above apply too)
+
+   UModProxyBackend* backend;
+   UModProxyService* service;
+
+   for (uint32_t i = 0, n = UHTTP::vservice->size(); i < n; ++i)
+      {
+      service = UHTTP::vservice->at(i);
+
+      if (service->isHealthCheck() == false) continue;
+
+      for (uint32_t j = 0, m = service->vbackend.size(); j < m; ++j)
+         {
+         backend = service->vbackend[j];
+
+         if (backend->bprobe == false &&
+             (u_now->tv_sec - backend->last_probe) >= service->health_interval)
+            {
+            probe(service, backend);
+            }
+         }
+      }
+
+   // return value:
+   // ---------------
+   // -1 - normal
+   //  0 - monitoring
+   // ---------------
+
+   U_RETURN(0);
+}
+
 // Connection-wide hooks
 
 int UProxyPlugIn::handlerRequest()
@@ -71,6 +1197,18 @@ int UProxyPlugIn::handlerRequest()
 
    if (UHTTP::isProxyRequest() == false) U_RETURN(U_PLUGIN_HANDLER_OK);
 
+   if (isAsynchronous())
+      {
+      if (forwardRequest() == false)
+         {
+         UClientImage_Base::resetPipelineAndSetCloseConnection();
+
+         UHTTP::setErrorResponse(*UString::str_ctype_html, HTTP_BAD_GATEWAY, U_CONSTANT_TO_PARAM("The proxy server could not connect to the upstream server"), false);
+         }
+
+      U_RETURN(U_PLUGIN_HANDLER_PROCESSED);
+      }
+
    // NB: process the HTTP PROXY request with fork....
 
    if (UServer_Base::startParallelization()) U_RETURN(U_PLUGIN_HANDLER_PROCESSED); // parent
@@ -130,7 +1268,10 @@ int UProxyPlugIn::handlerRequest()
       {
       // before connect to server check if server and/or port to connect has changed...
 
-      if (client_http->setHostPort(UHTTP::service->getServer(), UHTTP::service->getPort()) &&
+      UModProxyBackend* backend = UHTTP::service->selectBackend();
+
+      if (client_http->setHostPort(backend ? backend->server : UHTTP::service->getServer(),
+                                   backend ? backend->port   : UHTTP::service->getPort()) &&
           client_http->UClient_Base::isConnected())
          {
          client_http->UClient_Base::close();
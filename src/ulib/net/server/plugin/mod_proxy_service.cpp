@@ -20,13 +20,32 @@
 #include <ulib/utility/string_ext.h>
 #include <ulib/net/server/plugin/mod_proxy_service.h>
 
+#define U_RING_POINTS 64 // virtual nodes for every backend on the ring of the consistent hash
+
+UModProxyBackend::UModProxyBackend(const UString& _server, int _port) : server(_server)
+{
+   U_TRACE_CTOR(0, UModProxyBackend, "%V,%d", _server.rep, _port)
+
+   eject_until = last_probe = 0;
+   outstanding = fails = 0;
+   port        = _port;
+   healthy     = true;
+   bprobe      = false;
+}
+
 UModProxyService::UModProxyService()
 {
    U_TRACE_CTOR(0, UModProxyService, "")
 
    command = U_NULLPTR;
    vremote_address = U_NULLPTR;
-   port = method_mask = 0;
+   ring = U_NULLPTR;
+   rr = ring_len = 0;
+   port = method_mask = balance = health_interval = 0;
+   timeout      = U_TIMEOUT_MS / 1000;
+   keep_alive   = 16;
+   max_fails    = 3;
+   fail_timeout = 30;
    request_cert = follow_redirects = response_client = websocket = false;
 }
 
@@ -35,6 +54,222 @@ UModProxyService::~UModProxyService()
    U_TRACE_DTOR(0, UModProxyService)
 
    if (vremote_address) U_DELETE(vremote_address)
+
+   if (ring) UMemoryPool::_free(ring, ring_len, sizeof(ring_point));
+}
+
+int UModProxyService::compareRingPoint(const void* p1, const void* p2)
+{
+   U_TRACE(0, "UModProxyService::compareRingPoint(%p,%p)", p1, p2)
+
+   uint32_t h1 = ((const ring_point*)p1)->hash,
+            h2 = ((const ring_point*)p2)->hash;
+
+   U_RETURN(h1 < h2 ? -1 : h1 > h2);
+}
+
+void UModProxyService::loadBackend(UVector<UString>& vec)
+{
+   U_TRACE(0, "UModProxyService::loadBackend(%p)", &vec)
+
+   uint32_t pos, h, i, j, n = vec.size();
+   UModProxyBackend* backend;
+   UString elem;
+
+   for (i = 0; i < n; ++i)
+      {
+      elem = vec[i];
+      pos  = elem.find(':');
+
+      // NB: we need a copy of the name of the server, for the connect it must be null terminated...
+
+      if (pos == U_NOT_FOUND)
+         {
+         U_NEW(UModProxyBackend, backend, UModProxyBackend(UString((void*)U_STRING_TO_PARAM(elem)), 80));
+         }
+      else
+         {
+         U_NEW(UModProxyBackend, backend, UModProxyBackend(UString((void*)elem.data(), pos), elem.substr(pos+1).strtol()));
+         }
+
+      vbackend.push_back(backend);
+      }
+
+   // the ring of the consistent hash: a key goes to the first point (clockwise) of an available backend,
+   // so that removing a backend moves only the keys of that backend...
+
+   ring_len = n * U_RING_POINTS;
+   ring     = (ring_point*) UMemoryPool::cmalloc(ring_len, sizeof(ring_point), true);
+
+   for (i = 0; i < n; ++i)
+      {
+      elem = vec[i];
+      h    = u_cdb_hash((const unsigned char*)U_STRING_TO_PARAM(elem), 0);
+
+      for (j = 0; j < U_RING_POINTS; ++j)
+         {
+         ring[i * U_RING_POINTS + j].hash    = u_integerHash(h ^ (j * 0x9e3779b9));
+         ring[i * U_RING_POINTS + j].backend = vbackend[i];
+         }
+      }
+
+   qsort(ring, ring_len, sizeof(ring_point), compareRingPoint);
+}
+
+uint32_t UModProxyService::getHashKey()
+{
+   U_TRACE_NO_PARAM(0, "UModProxyService::getHashKey()")
+
+   if (balance != HASH) U_RETURN(0);
+
+   uint32_t len;
+   const char* ptr;
+
+   if (hash_key.empty())
+      {
+      ptr = UServer_Base::client_address;
+      len = UServer_Base::client_address_len;
+      }
+   else
+      {
+      ptr = UHTTP::getHeaderValuePtr(U_STRING_TO_PARAM(hash_key), true);
+      len = 0;
+
+      if (ptr) while (ptr[len] != '\r' && ptr[len] != '\n' && ptr[len] != '\0') ++len;
+      }
+
+   uint32_t h = u_integerHash(len ? u_cdb_hash((const unsigned char*)ptr, len, 0) : 0);
+
+   U_RETURN(h);
+}
+
+UModProxyBackend* UModProxyService::selectBackend(uint32_t h, UModProxyBackend* exclude)
+{
+   U_TRACE(0, "UModProxyService::selectBackend(%u,%p)", h, exclude)
+
+   UModProxyBackend* backend;
+   uint32_t i, k, n = vbackend.size();
+
+   if (n == 0) U_RETURN_POINTER(U_NULLPTR, UModProxyBackend);
+
+   if (n == 1)
+      {
+      backend = vbackend[0];
+
+      U_RETURN_POINTER(backend, UModProxyBackend);
+      }
+
+   if (balance == HASH)
+      {
+      uint32_t low = 0, high = ring_len;
+
+      while (low < high) // search the first point of the ring with hash >= h
+         {
+         i = (low + high) / 2;
+
+         if (ring[i].hash < h) low  = i + 1;
+         else                  high = i;
+         }
+
+      for (k = 0; k < ring_len; ++k)
+         {
+         backend = ring[(low + k) % ring_len].backend;
+
+         if (backend != exclude &&
+             backend->isAvailable())
+            {
+            U_RETURN_POINTER(backend, UModProxyBackend);
+            }
+         }
+
+      backend = ring[low % ring_len].backend; // NB: all the backends are down, we try anyway...
+
+      U_RETURN_POINTER(backend, UModProxyBackend);
+      }
+
+   UModProxyBackend* elem;
+
+   backend = U_NULLPTR;
+
+   for (k = 0; k < n; ++k)
+      {
+      i    = (rr + k) % n;
+      elem = vbackend[i];
+
+      if (elem == exclude ||
+          elem->isAvailable() == false)
+         {
+         continue;
+         }
+
+      if (balance == ROUND_ROBIN)
+         {
+         backend = elem;
+
+         break;
+         }
+
+      if (backend == U_NULLPTR ||
+          elem->outstanding < backend->outstanding)
+         {
+         backend = elem;
+         }
+      }
+
+   if (backend == U_NULLPTR) backend = vbackend[rr % n]; // NB: all the backends are down, we try anyway...
+
+   rr = (balance == ROUND_ROBIN ? vbackend.find(backend) + 1 : rr + 1) % n;
+
+   U_RETURN_POINTER(backend, UModProxyBackend);
+}
+
+void UModProxyService::setBackendSuccess(UModProxyBackend* backend)
+{
+   U_TRACE(0, "UModProxyService::setBackendSuccess(%p)", backend)
+
+   U_INTERNAL_ASSERT_POINTER(backend)
+
+   backend->fails = 0;
+}
+
+void UModProxyService::setBackendFailure(UModProxyBackend* backend)
+{
+   U_TRACE(0, "UModProxyService::setBackendFailure(%p)", backend)
+
+   U_INTERNAL_ASSERT_POINTER(backend)
+
+   if (max_fails > 0 &&
+       ++backend->fails >= (uint32_t)max_fails)
+      {
+      // NB: passive check, the backend is ejected from the balancing for a while...
+
+      backend->fails       = 0;
+      backend->eject_until = u_now->tv_sec + fail_timeout;
+
+      U_SRV_LOG("WARNING: proxy backend %V:%d ejected for %d seconds after %d consecutive failures", backend->server.rep, backend->port, fail_timeout, max_fails);
+      }
+}
+
+void UModProxyService::setBackendHealth(UModProxyBackend* backend, bool healthy)
+{
+   U_TRACE(0, "UModProxyService::setBackendHealth(%p,%b)", backend, healthy)
+
+   U_INTERNAL_ASSERT_POINTER(backend)
+
+   backend->bprobe = false;
+
+   if (backend->healthy != healthy)
+      {
+      backend->healthy = healthy;
+
+      U_SRV_LOG("proxy backend %V:%d is %s", backend->server.rep, backend->port, healthy ? "up" : "down");
+      }
+
+   if (healthy)
+      {
+      backend->fails       = 0;
+      backend->eject_until = 0;
+      }
 }
 
 bool UModProxyService::loadConfig(UFileConfig& cfg)
@@ -59,6 +294,16 @@ bool UModProxyService::loadConfig(UFileConfig& cfg)
    //
    // PORT                 port of server for connection
    // SERVER               name of server for connection
+   // TIMEOUT              timeout (in seconds) for the response of server (default 30)
+   // KEEP_ALIVE           max number of idle connections to server kept open by every worker (default 16, 0 => disable)
+   //
+   // BACKEND              list of comma separated servers (host[:port]) for connection, in place of SERVER/PORT
+   // BALANCE              policy for the choice of the server: round-robin (default), least-conn, hash
+   // HASH_KEY             if BALANCE is hash: name of the header of the request to hash (default: the client address)
+   // MAX_FAILS            number of consecutive failures (error or timeout) before the server is ejected (default 3, 0 => disable)
+   // FAIL_TIMEOUT         time (in seconds) for which the server is ejected (default 30)
+   // HEALTH_CHECK_URI     uri of the probe (GET) to check the servers, a response 2xx or 3xx means up
+   // HEALTH_CHECK_INTERVAL time (in seconds) between the probes (default 5)
    //
    // FOLLOW_REDIRECTS     yes if     manage to automatically follow redirects from server
    // USER                     if     manage to follow redirects, in response to a HTTP_UNAUTHORISED response from the HTTP server: user
@@ -108,11 +353,37 @@ bool UModProxyService::loadConfig(UFileConfig& cfg)
          service->host_mask = cfg.at(U_CONSTANT_TO_PARAM("HOST"));
 
          service->port             = cfg.readLong(   U_CONSTANT_TO_PARAM("PORT"), 80);
+         service->timeout          = cfg.readLong(   U_CONSTANT_TO_PARAM("TIMEOUT"), U_TIMEOUT_MS / 1000);
+         service->keep_alive       = cfg.readLong(   U_CONSTANT_TO_PARAM("KEEP_ALIVE"), 16);
          service->websocket        = cfg.readBoolean(U_CONSTANT_TO_PARAM("WEBSOCKET"));
          service->request_cert     = cfg.readBoolean(U_CONSTANT_TO_PARAM("CLIENT_CERTIFICATE"));
          service->response_client  = cfg.readBoolean(U_CONSTANT_TO_PARAM("RESPONSE_TYPE"));
          service->follow_redirects = cfg.readBoolean(U_CONSTANT_TO_PARAM("FOLLOW_REDIRECTS"));
 
+         service->hash_key        = cfg.at(U_CONSTANT_TO_PARAM("HASH_KEY"));
+         service->health_uri      = cfg.at(U_CONSTANT_TO_PARAM("HEALTH_CHECK_URI"));
+         service->max_fails       = cfg.readLong(U_CONSTANT_TO_PARAM("MAX_FAILS"), 3);
+         service->fail_timeout    = cfg.readLong(U_CONSTANT_TO_PARAM("FAIL_TIMEOUT"), 30);
+         service->health_interval = cfg.readLong(U_CONSTANT_TO_PARAM("HEALTH_CHECK_INTERVAL"), 5);
+
+         x = cfg.at(U_CONSTANT_TO_PARAM("BACKEND"));
+
+         if (x &&
+             tmp.split(x, ", \t") > 0)
+            {
+            service->loadBackend(tmp);
+
+            tmp.clear();
+            }
+
+         x = cfg.at(U_CONSTANT_TO_PARAM("BALANCE"));
+
+         if (x)
+            {
+                 if (x.equal(U_CONSTANT_TO_PARAM("least-conn"))) service->balance = LEAST_CONN;
+            else if (x.equal(U_CONSTANT_TO_PARAM("hash")))       service->balance = HASH;
+            }
+
          x = cfg.at(U_CONSTANT_TO_PARAM("URI"));
 
          if (x)
@@ -190,12 +461,14 @@ loop:       switch (u_get_unalignedp32(msk))
 
          UHTTP::vservice->push_back(service);
 
-         cfg.clear();
+         cfg.table.clear(); // NB: we keep the capacity of the table for the next service...
          }
-
-      U_RETURN(true);
       }
 
+   cfg.clear();
+
+   if (UHTTP::vservice->empty() == false) U_RETURN(true); // NB: all the services of the section, not only the first one...
+
    U_RETURN(false);
 }
 
@@ -347,11 +620,42 @@ void UModProxyService::setMsgError(int err)
 }
 
 #if defined(U_STDCPP_ENABLE) && defined(DEBUG)
+const char* UModProxyBackend::dump(bool reset) const
+{
+   U_CHECK_MEMORY
+
+   *UObjectIO::os << "port                                 " << port                      << '\n'
+                  << "fails                                " << fails                     << '\n'
+                  << "bprobe                               " << bprobe                    << '\n'
+                  << "healthy                              " << healthy                   << '\n'
+                  << "last_probe                           " << last_probe                << '\n'
+                  << "eject_until                          " << eject_until               << '\n'
+                  << "outstanding                          " << outstanding               << '\n'
+                  << "server            (UString           " << (void*)&server            << ')';
+
+   if (reset)
+      {
+      UObjectIO::output();
+
+      return UObjectIO::buffer_output;
+      }
+
+   return U_NULLPTR;
+}
+
 const char* UModProxyService::dump(bool reset) const
 {
    U_CHECK_MEMORY
 
    *UObjectIO::os << "port                                 " << port                      << '\n'
+                  << "timeout                              " << timeout                   << '\n'
+                  << "keep_alive                           " << keep_alive                << '\n'
+                  << "rr                                   " << rr                        << '\n'
+                  << "balance                              " << balance                   << '\n'
+                  << "ring_len                             " << ring_len                  << '\n'
+                  << "max_fails                            " << max_fails                 << '\n'
+                  << "fail_timeout                         " << fail_timeout              << '\n'
+                  << "health_interval                      " << health_interval           << '\n'
                   << "websocket                            " << websocket                 << '\n'
                   << "method_mask                          " << method_mask               << '\n'
                   << "request_cert                         " << request_cert              << '\n'
@@ -366,6 +670,9 @@ const char* UModProxyService::dump(bool reset) const
                   << "server            (UString           " << (void*)&server            << ")\n"
                   << "host_mask         (UString           " << (void*)&host_mask         << ")\n"
                   << "password          (UString           " << (void*)&password          << ")\n"
+                  << "hash_key          (UString           " << (void*)&hash_key          << ")\n"
+                  << "health_uri        (UString           " << (void*)&health_uri        << ")\n"
+                  << "vbackend          (UVector<UModProxyBackend*> " << (void*)&vbackend << ")\n"
                   << "environment       (UString           " << (void*)&environment       << ")\n"
                   << "vremote_address   (UVector<UIPAllow> " << (void*)vremote_address    << ")\n"
                   << "vreplace_response (UVector<UString>  " << (void*)&vreplace_response << ')';
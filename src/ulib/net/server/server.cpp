@@ -13,6 +13,7 @@
 
 #include <ulib/url.h>
 #include <ulib/timer.h>
+#include <ulib/ioring.h>
 #include <ulib/db/rdb.h>
 #include <ulib/net/udpsocket.h>
 #include <ulib/utility/escape.h>
@@ -111,6 +112,7 @@ bool          UServer_Base::public_address;
 bool          UServer_Base::monitoring_process;
 bool          UServer_Base::set_tcp_keep_alive;
 bool          UServer_Base::set_realtime_priority;
+bool          UServer_Base::set_cpu_affinity;
 bool          UServer_Base::update_date;
 bool          UServer_Base::update_date1;
 bool          UServer_Base::update_date2;
@@ -1201,11 +1203,6 @@ public:
             continue;
             }
 
-#       if !defined(U_LOG_DISABLE) && defined(USE_LIBZ)
-         if (UServer_Base::log)                         UServer_Base::log->checkForLogRotateDataToWrite();
-         if (UServer_Base::apache_like_log) UServer_Base::apache_like_log->checkForLogRotateDataToWrite();
-#       endif
-
 #       ifdef USE_LOAD_BALANCE
          if (fd_sock > 0)
             {
@@ -1307,6 +1304,44 @@ private:
 };
 #  endif
 
+#  if defined(U_LINUX) && !defined(U_LOG_DISABLE) && defined(USE_LIBZ)
+class ULogRotateThread : public UThread {
+public:
+
+   ULogRotateThread() : UThread(PTHREAD_CREATE_DETACHED) {}
+
+   virtual void run() U_DECL_FINAL
+      {
+      U_TRACE_NO_PARAM(0, "ULogRotateThread::run()")
+
+      U_SRV_LOG("Thread for the compression of the data of the log rotation activated (tid %u)", u_gettid());
+
+      // NB: the gzip compression of the log (some MB) can take more than the tick of UTimeThread, so it is done by this thread.
+      //     If we are late the writer that wrap the log again compress the previous data by itself (see ULog::rotate())...
+
+      struct timespec ts = { 0L, 100L * 1000L * 1000L };
+
+      while (UServer_Base::flag_loop)
+         {
+         if (U_SYSCALL(nanosleep, "%p,%p", &ts, U_NULLPTR) == -1 || UThread::bpause)
+            {
+            U_INTERNAL_DUMP("UServer_Base::flag_loop = %b UThread::bpause = %b", UServer_Base::flag_loop, UThread::bpause)
+
+            continue;
+            }
+
+         if (UServer_Base::log)                         UServer_Base::log->checkForLogRotateDataToWrite();
+         if (UServer_Base::apache_like_log) UServer_Base::apache_like_log->checkForLogRotateDataToWrite();
+         }
+      }
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(ULogRotateThread)
+};
+
+UThread* UServer_Base::pthread_log_rotate;
+#  endif
+
 #  if defined(USE_LIBSSL) && !defined(OPENSSL_NO_OCSP) && defined(SSL_CTRL_SET_TLSEXT_STATUS_REQ_CB) && !defined(_MSWINDOWS_)
 #     include <ulib/net/tcpsocket.h>
 #     include <ulib/net/client/client.h>
@@ -1816,6 +1851,10 @@ UServer_Base::~UServer_Base()
       (void) pthread_rwlock_destroy(ULog::prwlock);
       }
 
+#  if !defined(U_LOG_DISABLE) && defined(USE_LIBZ)
+   if (pthread_log_rotate) U_DELETE(pthread_log_rotate)
+#  endif
+
 #  if defined(USE_LIBSSL)
    if (tls_pin) U_DELETE(tls_pin)
 #  if !defined(OPENSSL_NO_OCSP) && defined(SSL_CTRL_SET_TLSEXT_STATUS_REQ_CB)
@@ -2127,6 +2166,10 @@ void UServer_Base::loadConfigParam()
    //
    // LISTEN_BACKLOG        max number of ready to be delivered connections to accept()
    // SET_REALTIME_PRIORITY flag indicating that the preforked processes will be scheduled under the real-time policies SCHED_FIFO
+   // CPU_AFFINITY          flag indicating that every preforked process is pinned to one cpu and own a SO_REUSEPORT listening socket
+   //                       with SO_INCOMING_CPU (default yes if PREFORK_CHILD is a multiple of the number of cpu)
+   // REUSEPORT_CBPF        flag indicating to attach to the SO_REUSEPORT listening sockets a classic BPF program that select the socket
+   //                       by the cpu that processed the packet (default yes)
    //
    // CLIENT_THRESHOLD           min number of clients to active polling
    // CLIENT_FOR_PARALLELIZATION min number of clients to active parallelization
@@ -2169,6 +2212,10 @@ void UServer_Base::loadConfigParam()
    //                                                                     1 - classic, forking after client accept
    //                                                                    >1 - pool of serialized processes plus monitoring process
    //
+   // EVENT_BACKEND mechanism used to wait for the events on the sockets: epoll    - readiness notification (default)
+   //                                                                     io_uring - multishot accept/recv with provided buffers and batched submission
+   //                                                                                (fallback to epoll if the kernel doesn't support it)
+   //
    // CRASH_COUNT         this is the threshold for the number of crash of child server processes
    // CRASH_EMAIL_NOTIFY  the email address to send a message whenever the number of crash > CRASH_COUNT
    // --------------------------------------------------------------------------------------------------------------------------------------
@@ -2311,6 +2358,34 @@ void UServer_Base::loadConfigParam()
       }
 #endif
 
+#ifdef HAVE_SCHED_GETAFFINITY
+   set_cpu_affinity = pcfg->readBoolean(U_CONSTANT_TO_PARAM("CPU_AFFINITY"), (preforked_num_kids > 1 && (preforked_num_kids % u_get_num_cpu()) == 0));
+#endif
+
+   USocket::breuseport_cbpf = pcfg->readBoolean(U_CONSTANT_TO_PARAM("REUSEPORT_CBPF"), true);
+
+   x = pcfg->at(U_CONSTANT_TO_PARAM("EVENT_BACKEND"));
+
+   if (x)
+      {
+      if (x.equal(U_CONSTANT_TO_PARAM("io_uring")))
+         {
+#     ifndef U_IORING_ENABLE
+         U_WARNING("Sorry, I was compiled without io_uring support so I can't accept EVENT_BACKEND io_uring, we use epoll");
+#     else
+         if (preforked_num_kids != -1) UNotifier::bioring = true;
+         else
+            {
+            U_WARNING("Sorry, the io_uring event backend is not available with the thread approach (PREFORK_CHILD == -1), we use epoll");
+            }
+#     endif
+         }
+      else if (x.equal(U_CONSTANT_TO_PARAM("epoll")) == false)
+         {
+         U_WARNING("Unknown EVENT_BACKEND %V, we use epoll", x.rep);
+         }
+      }
+
 #ifdef USE_LIBSSL
    if (bssl)
       {
@@ -3083,6 +3158,10 @@ void UServer_Base::suspendThread()
 #if defined(U_LINUX) && defined(ENABLE_THREAD)
    if (u_pthread_time) ((UThread*)u_pthread_time)->bpause = true;
 
+# if !defined(U_LOG_DISABLE) && defined(USE_LIBZ)
+   if (pthread_log_rotate) pthread_log_rotate->bpause = true;
+# endif
+
 # if defined(USE_LIBSSL) && !defined(OPENSSL_NO_OCSP) && defined(SSL_CTRL_SET_TLSEXT_STATUS_REQ_CB)
    if (pthread_ocsp) pthread_ocsp->bpause = true;
 # endif
@@ -3431,6 +3510,18 @@ next:
 
       U_SRV_LOG("Mapped %u bytes (%u KB) of shared memory for apache like log", apache_like_log->getSizeLogRotateData(), apache_like_log->getSizeLogRotateData() / 1024);
       }
+
+#  if defined(ENABLE_THREAD) && defined(U_LINUX)
+   U_INTERNAL_ASSERT_EQUALS(pthread_log_rotate, U_NULLPTR)
+
+   if ((isLog()         && log->isMemoryMapped()) ||
+       (apache_like_log && apache_like_log->isMemoryMapped()))
+      {
+      U_NEW_WITHOUT_CHECK_MEMORY(ULogRotateThread, pthread_log_rotate, ULogRotateThread);
+
+      pthread_log_rotate->start(0);
+      }
+#  endif
 #endif
 
 #if defined(USERVER_UDP)
@@ -3665,6 +3756,10 @@ void UServer_Base::sendSignalToAllChildren(int signo, sighandler_t handler)
 #if defined(U_LINUX) && defined(ENABLE_THREAD)
    if (u_pthread_time) ((UThread*)u_pthread_time)->bpause = false;
 
+# if !defined(U_LOG_DISABLE) && defined(USE_LIBZ)
+   if (pthread_log_rotate) pthread_log_rotate->bpause = false;
+# endif
+
 # if defined(USE_LIBSSL) && !defined(OPENSSL_NO_OCSP) && defined(SSL_CTRL_SET_TLSEXT_STATUS_REQ_CB)
    if (pthread_ocsp) pthread_ocsp->bpause = false;
 # endif
@@ -4297,7 +4392,19 @@ retry:   pid = UProcess::waitpid(-1, &status, WNOHANG); // NB: to avoid too much
 #if defined(HAVE_EPOLL_CTL_BATCH) && !defined(USE_LIBEVENT)
    UNotifier::batch((UEventFd*)CLIENT_IMAGE);
 #else
+# ifdef U_IORING_ENABLE
+   if (UNotifier::bioring &&
+       bssl == false)
+      {
+      UIORing::setKind(CSOCKET->iSockDesc, UIORing::RECV); // NB: the data are read by the multishot recv of the ring...
+      }
+# endif
+
    UNotifier::insert((UEventFd*)CLIENT_IMAGE);
+
+   // NB: the first request can be forwarded to another server, the client is suspended while waiting the response (see mod_proxy)...
+
+   if (U_ClientImage_idle(CLIENT_IMAGE) == U_YES) UNotifier::suspend((UEventFd*)CLIENT_IMAGE);
 #endif
 
    if (++CLIENT_IMAGE >= eClientImage) CLIENT_IMAGE = vClientImage;
@@ -4591,6 +4698,15 @@ void UServer_Base::runLoop(const char* user)
 
    if (UNotifier::min_connection)
       {
+#  ifdef U_IORING_ENABLE
+      if (UNotifier::bioring &&
+          binsert            &&
+          budp == false)
+         {
+         UIORing::setAcceptor(socket->iSockDesc, USocket::accept4_flags); // NB: the connections are accepted by the multishot accept of the ring...
+         }
+#  endif
+
       if (binsert)         UNotifier::insert(pthis,           EPOLLEXCLUSIVE | EPOLLROUNDROBIN); // NB: we ask to be notified for request of connection (=> accept)
       if (handler_inotify) UNotifier::insert(handler_inotify, EPOLLEXCLUSIVE | EPOLLROUNDROBIN); // NB: we ask to be notified for change of file system (=> inotify)
 
@@ -4633,6 +4749,14 @@ void UServer_Base::runLoop(const char* user)
 
    if (preforked_num_kids == -1)
       {
+      // NB: the strings of the configuration are read by all the threads...
+
+      document_root->setShared();
+         IP_address->setShared();
+
+      if (host)   host->setShared();
+      if (server) server->setShared();
+
       U_NEW(UClientThread, UNotifier::pthread, UClientThread);
 
 #  ifdef _MSWINDOWS_
@@ -4758,17 +4882,17 @@ void UServer_Base::run()
 
    U_INTERNAL_DUMP("preforked_num_kids = %d monitoring_process = %b", preforked_num_kids, monitoring_process)
 
-   int nkids;
    cpu_set_t cpuset;
-   pid_t pid, pid_to_wait;
+   int nkids, kid_slot;
+   pid_t pid, pid_to_wait, *kid_pid;
 
 #ifdef HAVE_SCHED_GETAFFINITY
-   if (u_get_num_cpu() > 1 &&
-       (preforked_num_kids % u_num_cpu) == 0)
+   if (set_cpu_affinity &&
+       u_get_num_cpu() > 1)
       {
       baffinity = true;
 
-      U_SRV_LOG("cpu affinity is to be set; thread count (%u) multiple of cpu count (%u)", preforked_num_kids, u_num_cpu);
+      U_SRV_LOG("cpu affinity is to be set; thread count (%u) cpu count (%u)", preforked_num_kids, u_num_cpu);
       }
 #endif
 
@@ -4802,17 +4926,29 @@ void UServer_Base::run()
 
    U_INTERNAL_DUMP("nkids = %u", nkids)
 
+   // NB: we keep the pid of the child for every slot, so that a restarted child take the slot (and the cpu) of the child exited...
+
+   kid_pid = (pid_t*) UMemoryPool::cmalloc(nkids, sizeof(pid_t), true);
+
    while (flag_loop)
       {
       u_need_root(false);
 
       while (rkids < nkids)
          {
+         for (kid_slot = 0; kid_slot < nkids && kid_pid[kid_slot] > 0; ++kid_slot) {}
+
+         U_INTERNAL_ASSERT_MINOR(kid_slot, nkids)
+
+         if (kid_slot == nkids) break; // NB: rkids is the number of the pid in kid_pid[], so it can't happen...
+
          if (proc->fork() &&
              proc->parent())
             {
             ++rkids;
 
+            kid_pid[kid_slot] = proc->_pid;
+
             if (preforked_num_kids <= 0) pid_to_wait = proc->_pid;
 
             U_SRV_LOG("Started new child (pid %d), up to %u children", proc->_pid, rkids);
@@ -4826,17 +4962,19 @@ void UServer_Base::run()
             UFile::close(sse_socketpair[0]);
 #        endif
 
-            U_INTERNAL_DUMP("child = %P UNotifier::num_connection = %d", UNotifier::num_connection)
+            rkids = kid_slot; // NB: the index of the child...
+
+            U_INTERNAL_DUMP("child = %P UNotifier::num_connection = %d rkids = %d", UNotifier::num_connection, rkids)
 
 #        ifdef HAVE_SCHED_GETAFFINITY
             if (baffinity)
                {
                CPU_ZERO(&cpuset);
 
-               u_bind2cpu(&cpuset, rkids % u_num_cpu); // Pin the process to a particular cpu...
+               u_bind2cpu(&cpuset, kid_slot % u_num_cpu); // Pin the process to a particular cpu...
 
 #           ifdef SO_INCOMING_CPU
-               USocket::incoming_cpu = rkids % u_num_cpu;
+               USocket::incoming_cpu = kid_slot % u_num_cpu;
 #           endif
 
 #           ifndef U_LOG_DISABLE
@@ -4866,7 +5004,7 @@ void UServer_Base::run()
                {
                struct bitmask* bmask = (struct bitmask*) U_SYSCALL(numa_bitmask_alloc, "%u", 16);
 
-               (void) U_SYSCALL(numa_bitmask_setbit, "%p,%u", bmask, rkids % 2);
+               (void) U_SYSCALL(numa_bitmask_setbit, "%p,%u", bmask, kid_slot % 2);
 
                U_SYSCALL_VOID(numa_set_membind,  "%p", bmask);
                U_SYSCALL_VOID(numa_bitmask_free, "%p", bmask);
@@ -4937,6 +5075,8 @@ void UServer_Base::run()
 
       if (rkids == 0)  // NB: check for SIGHUP event...
          {
+         (void) U_SYSCALL(memset, "%p,%d,%u", kid_pid, 0, nkids * sizeof(pid_t));
+
          manageSigHUP();
 
          continue;
@@ -4945,11 +5085,21 @@ void UServer_Base::run()
       if (pid > 0 &&
           flag_loop) // NB: check for SIGTERM event...
          {
+         int i = 0;
+
+         while (i < nkids && kid_pid[i] != pid) ++i;
+
+         if (i == nkids) continue; // NB: not one of the children that we keep (ex: the process that send the email for the crashes)...
+
          U_INTERNAL_ASSERT_MAJOR(rkids, 0)
 
          --rkids;
 
-         baffinity = false;
+         kid_pid[i] = 0;
+
+         // NB: the socket of the restarted child goes to the end of the SO_REUSEPORT group, so the cpu is not anymore its position...
+
+         USocket::breuseport_cbpf = false;
 
          U_INTERNAL_DUMP("down to %u children", rkids)
 
@@ -5003,6 +5153,8 @@ void UServer_Base::run()
 
    U_INTERNAL_ASSERT(proc->parent())
 
+   UMemoryPool::_free(kid_pid, nkids, sizeof(pid_t));
+
 stop:
 #if defined(USERVER_UDP) && defined(U_HTTP3_DISABLE)
    if (budp == false)
@@ -5101,6 +5253,10 @@ bool UServer_Base::startParallelization(uint32_t nclient)
          }
 #  endif
 
+#  ifdef U_IORING_ENABLE
+      if (UNotifier::bioring) UIORing::detach(csocket->iSockDesc); // NB: the ring of the parent must not consume the data of the child...
+#  endif
+
       pid_t pid = startNewChild();
 
       if (pid > 0)
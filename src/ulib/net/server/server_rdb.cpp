@@ -13,10 +13,323 @@
 
 #include <ulib/db/rdb.h>
 #include <ulib/net/rpc/rpc.h>
+#include <ulib/net/tcpsocket.h>
+#include <ulib/utility/string_ext.h>
+#include <ulib/net/client/client_rdb.h>
 #include <ulib/net/server/server_rdb.h>
 #include <ulib/net/server/client_image_rdb.h>
 
-URDB* URDBServer::rdb;
+#define U_RPL_HEADER (sizeof(uint64_t) * 2) // id of the log and lsn of the first record in the file
+#define U_RPL_CHUNK  (256U * 1024U)         // max size of the records sent for a request of the follower
+#define U_RPL_TIMEOUT 30L                    // seconds to wait a response of the primary before to retry with a new connection
+
+URDB*        URDBServer::rdb;
+UFile*       URDBServer::rpl;
+UString*     URDBServer::rpl_pending;
+URDBReplica* URDBServer::preplica;
+uint64_t     URDBServer::rpl_id;
+uint64_t     URDBServer::rpl_base;
+uint32_t     URDBServer::rpl_end;
+uint32_t     URDBServer::rpl_max;
+
+// NB: the follower never wait the primary in the event loop: the connection is registered with UNotifier, the request is sent by
+//     the timer (or after the response to the previous request when the follower is behind) and the response is applied when
+//     it is complete...
+
+class U_NO_EXPORT URDBReplica : public UEventFd, public UEventTime {
+public:
+
+   URDBReplica(uint32_t poll_ms) : UEventTime(poll_ms / 1000, (poll_ms % 1000) * 1000)
+      {
+      U_TRACE_CTOR(0, URDBReplica, "%u", poll_ms)
+
+      id        =
+      lsn       = 0;
+      port      = 0;
+      timestamp = 0;
+      state     = IDLE;
+      }
+
+   virtual ~URDBReplica() U_DECL_FINAL
+      {
+      U_TRACE_DTOR(0, URDBReplica)
+
+      if (state != IDLE) UNotifier::handlerDelete((UEventFd*)this);
+
+      if (pos.isOpen()) pos.close();
+      }
+
+   bool open(const UString& _host, unsigned int _port)
+      {
+      U_TRACE(0, "URDBReplica::open(%V,%u)", _host.rep, _port)
+
+      // NB: the position of the follower in the log of the primary is saved in <db>.pos...
+
+      char buffer_path[MAX_FILENAME_LEN];
+
+      uint32_t len = UFile::setPathFromFile(*(const UFile*)URDBServer::rdb, buffer_path, U_CONSTANT_TO_PARAM(".pos"));
+
+      if (pos.creat(UString(buffer_path, len), O_RDWR))
+         {
+         uint64_t buffer[2];
+
+         if (pos.pread(buffer, sizeof(buffer), 0))
+            {
+            id  = buffer[0];
+            lsn = buffer[1];
+            }
+
+         U_INTERNAL_DUMP("id = %llu lsn = %llu", id, lsn)
+
+         host = _host.copy(); // NB: must be null terminated (see USocket::beginAsynchronousConnect())...
+         port = _port;
+
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   // define method VIRTUAL of class UEventTime
+
+   virtual int handlerTime() U_DECL_FINAL
+      {
+      U_TRACE_NO_PARAM(0, "URDBReplica::handlerTime()")
+
+      if (state == READY)
+         {
+         if (sendRequest("RPLY") == false) UNotifier::handlerDelete((UEventFd*)this);
+         }
+      else if (state == IDLE)
+         {
+         if (socket.beginAsynchronousConnect(host, port))
+            {
+            UEventFd::fd = socket.getFd();
+
+            if (socket.isConnected())
+               {
+               socket.setNonBlocking(); // NB: finishAsynchronousConnect() set the socket blocking...
+
+               state   = READY;
+               op_mask = EPOLLIN | EPOLLRDHUP;
+
+               UNotifier::insert(this);
+
+               if (sendRequest("RPLY") == false) UNotifier::handlerDelete((UEventFd*)this);
+               }
+            else
+               {
+               state   = CONNECT;
+               op_mask = EPOLLOUT;
+
+               UNotifier::insert(this);
+               }
+
+            timestamp = u_now->tv_sec;
+            }
+         }
+      else if ((u_now->tv_sec - timestamp) > U_RPL_TIMEOUT)
+         {
+         U_SRV_LOG("WARNING: replication from %V:%u timed out", host.rep, port);
+
+         UNotifier::handlerDelete((UEventFd*)this);
+         }
+
+      U_RETURN(0); // monitoring
+      }
+
+   // define method VIRTUAL of class UEventFd
+
+   virtual int handlerWrite() U_DECL_FINAL
+      {
+      U_TRACE_NO_PARAM(0, "URDBReplica::handlerWrite()")
+
+      if (state != CONNECT ||
+          socket.finishAsynchronousConnect() == false)
+         {
+         U_RETURN(U_NOTIFIER_DELETE);
+         }
+
+      socket.setNonBlocking();
+
+      state   = READY;
+      op_mask = EPOLLIN | EPOLLRDHUP;
+
+      (void) UNotifier::modify(this);
+
+      if (sendRequest("RPLY")) U_RETURN(U_NOTIFIER_OK);
+
+      U_RETURN(U_NOTIFIER_DELETE);
+      }
+
+   virtual int handlerRead() U_DECL_FINAL
+      {
+      U_TRACE_NO_PARAM(0, "URDBReplica::handlerRead()")
+
+      int value;
+      char buffer[16 * 1024];
+
+      if (state != RPLY &&
+          state != RSNP)
+         {
+         U_RETURN(U_NOTIFIER_DELETE); // NB: data from the primary while we don't wait a response...
+         }
+
+      while (true)
+         {
+         value = socket.recv(buffer, sizeof(buffer));
+
+         if (value <= 0)
+            {
+            if (value == -1 &&
+                errno == EAGAIN)
+               {
+               U_RETURN(U_NOTIFIER_OK);
+               }
+
+            U_RETURN(U_NOTIFIER_DELETE);
+            }
+
+         (void) response.append(buffer, value);
+
+         if (response.size() < U_TOKEN_LN) continue;
+
+         uint32_t len = u_hex2int(response.c_pointer(U_TOKEN_NM), 8);
+
+         if (response.size() < (U_TOKEN_LN + len)) continue;
+
+         if (response.size() > (U_TOKEN_LN + len)) U_RETURN(U_NOTIFIER_DELETE);
+
+         if (endResponse()) U_RETURN(U_NOTIFIER_OK);
+
+         U_RETURN(U_NOTIFIER_DELETE);
+         }
+      }
+
+   virtual void handlerDelete() U_DECL_FINAL
+      {
+      U_TRACE_NO_PARAM(0, "URDBReplica::handlerDelete()")
+
+      // NB: we retry to connect at the next tick of the timer...
+
+      if (socket.isOpen()) socket.close();
+
+      UEventFd::fd = -1;
+
+      state = IDLE;
+
+      response.clear();
+      }
+
+#if defined(DEBUG) && defined(U_STDCPP_ENABLE)
+   const char* dump(bool _reset) const { return UEventTime::dump(_reset); }
+#endif
+
+protected:
+   enum State {
+      IDLE    = 0, // not connected
+      CONNECT = 1, // asynchronous connect in progress
+      READY   = 2, // connected, waiting the next tick of the timer
+      RPLY    = 3, // waiting the records of the log after the position
+      RSNP    = 4  // waiting a copy of the database
+   };
+
+   UTCPSocket socket;
+   UFile pos;
+   UString host, response;
+   uint64_t id, lsn;
+   long timestamp;
+   unsigned int port;
+   int state;
+
+   bool sendRequest(const char* token)
+      {
+      U_TRACE(0, "URDBReplica::sendRequest(%S)", token)
+
+      U_INTERNAL_ASSERT_EQUALS(state, READY)
+
+      UVector<UString> vec(2);
+
+      if (token[1] == 'P') // RPLY
+         {
+         UString _id(22U), _lsn(22U);
+
+          _id.appendNumber64(id);
+         _lsn.appendNumber64(lsn);
+
+         vec.push_back(_id);
+         vec.push_back(_lsn);
+         }
+
+      UString req(U_TOKEN_LN * 3 + 44U);
+
+      UStringExt::buildTokenVector(token, vec, req);
+
+      // NB: the request is small, a partial write on a new connection is an error...
+
+      if (socket.send(U_STRING_TO_PARAM(req)) == (int)req.size())
+         {
+         state     = (token[1] == 'P' ? RPLY : RSNP);
+         timestamp = u_now->tv_sec;
+
+         response.setBuffer(U_CAPACITY);
+
+         U_RETURN(true);
+         }
+
+      U_RETURN(false);
+      }
+
+   bool endResponse()
+      {
+      U_TRACE_NO_PARAM(0, "URDBReplica::endResponse()")
+
+      int n = -1;
+      uint64_t id_prev  = id,
+               lsn_prev = lsn;
+      uint32_t code     = u_strtoul(response.data(), response.c_pointer(3));
+
+      U_INTERNAL_DUMP("code = %u", code)
+
+      if (code == 200)
+         {
+         UString data = response.substr(U_TOKEN_LN);
+
+         n = (state == RPLY ? URDBClient_Base::applyJournal(URDBServer::rdb, data, id, lsn)
+                            : URDBClient_Base::applyCopy(   URDBServer::rdb, data, id, lsn));
+         }
+      else if (code  == 410 &&
+               state == RPLY)
+         {
+         // NB: the position is not in the log of the primary, we must reload a copy of the database...
+
+         state = READY;
+
+         return sendRequest("RSNP");
+         }
+
+      if (n < 0) U_RETURN(false);
+
+      state = READY;
+
+      if (id  == id_prev &&
+          lsn == lsn_prev)
+         {
+         U_RETURN(true);
+         }
+
+      uint64_t buffer[2] = { id, lsn };
+
+      (void) pos.pwrite(buffer, sizeof(buffer), 0);
+
+      // NB: we are behind the end of the log of the primary, we don't wait the next tick of the timer...
+
+      return sendRequest("RPLY");
+      }
+
+private:
+   U_DISALLOW_COPY_AND_ASSIGN(URDBReplica)
+};
 
 URDBServer::URDBServer(UFileConfig* cfg, bool ignore_case) : UServer<UTCPSocket>(cfg)
 {
@@ -31,6 +344,17 @@ URDBServer::~URDBServer()
 {
    U_TRACE_DTOR(0, URDBServer)
 
+   if (preplica) U_DELETE(preplica)
+
+   if (rpl)
+      {
+      rpl->close();
+
+      U_DELETE(rpl)
+      }
+
+   if (rpl_pending) U_DELETE(rpl_pending)
+
    rdb->close();
 
    U_DELETE(rdb)
@@ -39,17 +363,307 @@ URDBServer::~URDBServer()
 
 // Open a reliable database
 
-bool URDBServer::open(const UString& pathdb, uint32_t log_size)
+bool URDBServer::open(const UString& pathdb, uint32_t log_size, uint32_t rpl_size)
 {
-   U_TRACE(0, "URDBServer::open(%V,%u)", pathdb.rep, log_size)
+   U_TRACE(0, "URDBServer::open(%V,%u,%u)", pathdb.rep, log_size, rpl_size)
 
    URDBClientImage::rdb = rdb;
 
-   if (rdb->open(pathdb, log_size)) U_RETURN(true);
+   if (rdb->open(pathdb, log_size) == false) U_RETURN(false);
+
+   if (rpl_size)
+      {
+      U_INTERNAL_ASSERT_EQUALS(rpl, U_NULLPTR)
+
+      if (isSingleProcess() == false) U_RETURN(false);
+
+      U_NEW(UFile, rpl, UFile);
+
+      char buffer_path[MAX_FILENAME_LEN];
+
+      uint32_t len = UFile::setPathFromFile(*(const UFile*)rdb, buffer_path, U_CONSTANT_TO_PARAM(".rpl"));
+
+      if (rpl->creat(UString(buffer_path, len), O_RDWR) == false) U_RETURN(false);
+
+      rpl_max = rpl_size;
+      rpl_end = rpl->size();
+
+      uint64_t buffer[2];
+
+      if (rpl_end >= U_RPL_HEADER &&
+          rpl->pread(buffer, sizeof(buffer), 0))
+         {
+         rpl_id   = buffer[0];
+         rpl_base = buffer[1];
+         }
+      else
+         {
+         logRestart();
+         }
+
+      U_INTERNAL_DUMP("rpl_id = %llu rpl_base = %llu rpl_end = %u", rpl_id, rpl_base, rpl_end)
+      }
+
+   U_RETURN(true);
+}
+
+bool URDBServer::follow(const UString& host, unsigned int port, uint32_t poll_ms)
+{
+   U_TRACE(0, "URDBServer::follow(%V,%u,%u)", host.rep, port, poll_ms)
+
+   U_INTERNAL_ASSERT_EQUALS(preplica, U_NULLPTR)
+
+   if (isSingleProcess() == false) U_RETURN(false);
+
+   U_NEW(URDBReplica, preplica, URDBReplica(poll_ms));
+
+   if (preplica->open(host, port))
+      {
+      UTimer::insert(preplica);
+
+      U_RETURN(true);
+      }
+
+   U_DELETE(preplica)
+
+   preplica = U_NULLPTR;
 
    U_RETURN(false);
 }
 
+// REPLICATION
+
+U_NO_EXPORT bool URDBServer::isSingleProcess()
+{
+   U_TRACE_NO_PARAM(0, "URDBServer::isSingleProcess()")
+
+   // NB: the end of the log, the transaction in progress and the position of the follower are in the memory of the process...
+
+   if (preforked_num_kids != 0)
+      {
+      U_WARNING("Sorry, I can't replicate the database with PREFORK_CHILD != 0 (%d)", preforked_num_kids);
+
+      U_RETURN(false);
+      }
+
+   U_RETURN(true);
+}
+
+U_NO_EXPORT void URDBServer::logWriteHeader()
+{
+   U_TRACE_NO_PARAM(0, "URDBServer::logWriteHeader()")
+
+   uint64_t buffer[2] = { rpl_id, rpl_base };
+
+   (void) rpl->pwrite(buffer, sizeof(buffer), 0);
+}
+
+U_NO_EXPORT void URDBServer::logRestart()
+{
+   U_TRACE_NO_PARAM(0, "URDBServer::logRestart()")
+
+   // NB: a new log has a new id, so the follower of a previous log reload a copy of the database...
+
+   rpl_id   = ((uint64_t)u_now->tv_sec << 32) | u_get_num_random();
+   rpl_base = 0;
+   rpl_end  = U_RPL_HEADER;
+
+   (void) rpl->ftruncate(rpl_end);
+
+   logWriteHeader();
+}
+
+U_NO_EXPORT void URDBServer::logAppend(const char* ptr, uint32_t len)
+{
+   U_TRACE(0, "URDBServer::logAppend(%p,%u)", ptr, len)
+
+   U_INTERNAL_ASSERT_POINTER(rpl)
+
+   if ((rpl_end - U_RPL_HEADER + len) > rpl_max)
+      {
+      // NB: the log restart empty, the follower behind the current end must reload a copy of the database...
+
+      rpl_base += rpl_end - U_RPL_HEADER;
+      rpl_end   = U_RPL_HEADER;
+
+      (void) rpl->ftruncate(rpl_end);
+
+      logWriteHeader();
+      }
+
+   if (rpl->pwrite(ptr, len, rpl_end)) rpl_end += len;
+
+   U_INTERNAL_DUMP("rpl_base = %llu rpl_end = %u", rpl_base, rpl_end)
+}
+
+U_NO_EXPORT void URDBServer::logRecord(const UString& key, const UString* data)
+{
+   U_TRACE(0, "URDBServer::logRecord(%V,%p)", key.rep, data)
+
+   if (rpl == U_NULLPTR) return;
+
+   // NB: a record states a key length, a data length (U_NOT_FOUND for remove), the key and the data (like the journal)...
+
+   uint32_t klen = key.size(),
+            dlen = (data ? data->size() : 0),
+            len  = sizeof(UCDB::cdb_record_header) + klen + dlen;
+
+   UString record(len);
+
+   char* ptr = record.data();
+
+   u_put_unalignedp32(ptr,   klen);
+   u_put_unalignedp32(ptr+4, data ? dlen : U_NOT_FOUND);
+
+   U_MEMCPY(ptr + sizeof(UCDB::cdb_record_header), key.data(), klen);
+
+   if (dlen) U_MEMCPY(ptr + sizeof(UCDB::cdb_record_header) + klen, data->data(), dlen);
+
+   record.size_adjust(len);
+
+   if (rpl_pending) (void) rpl_pending->append(record);
+   else             logAppend(U_STRING_TO_PARAM(record));
+}
+
+void URDBServer::logBeginTransaction()
+{
+   U_TRACE_NO_PARAM(0, "URDBServer::logBeginTransaction()")
+
+   if (rpl &&
+       rpl_pending == U_NULLPTR)
+      {
+      U_NEW_STRING(rpl_pending, UString);
+      }
+}
+
+void URDBServer::logAbortTransaction()
+{
+   U_TRACE_NO_PARAM(0, "URDBServer::logAbortTransaction()")
+
+   if (rpl_pending)
+      {
+      U_DELETE(rpl_pending)
+
+      rpl_pending = U_NULLPTR;
+      }
+   else if (rpl)
+      {
+      // NB: the abort after the commit (or without a transaction) revert the database to the last reorganize,
+      //     the log can have records of entries that are no more in the database so the follower must reload it...
+
+      logRestart();
+      }
+}
+
+void URDBServer::logCommitTransaction()
+{
+   U_TRACE_NO_PARAM(0, "URDBServer::logCommitTransaction()")
+
+   if (rpl_pending)
+      {
+      if (*rpl_pending) logAppend(U_STRING_TO_PARAM(*rpl_pending));
+
+      U_DELETE(rpl_pending)
+
+      rpl_pending = U_NULLPTR;
+      }
+}
+
+bool URDBServer::readLog(uint64_t id, uint64_t lsn, UString& buffer)
+{
+   U_TRACE(0, "URDBServer::readLog(%llu,%llu,%V)", id, lsn, buffer.rep)
+
+   uint64_t lsn_end = rpl_base + rpl_end - U_RPL_HEADER;
+
+   U_INTERNAL_DUMP("rpl_id = %llu rpl_base = %llu lsn_end = %llu", rpl_id, rpl_base, lsn_end)
+
+   // NB: the follower must reload a copy of the database if the position is not in the log...
+
+   if (rpl == U_NULLPTR ||
+       id  != rpl_id    ||
+       lsn <  rpl_base  ||
+       lsn >  lsn_end)
+      {
+      U_RETURN(false);
+      }
+
+   uint32_t offset = U_RPL_HEADER + (uint32_t)(lsn - rpl_base),
+            len    = U_min(rpl_end - offset, U_RPL_CHUNK);
+
+   // NB: we send only complete records, if the first record is bigger than the chunk we send it alone...
+
+   UString records(len + sizeof(UCDB::cdb_record_header));
+
+   if (len &&
+       rpl->pread(records.data(), len, offset) == false)
+      {
+      U_RETURN(false);
+      }
+
+   char* ptr = records.data();
+   char* end = ptr + len;
+
+   while ((end - ptr) >= (ptrdiff_t)sizeof(UCDB::cdb_record_header))
+      {
+      uint32_t klen = u_get_unalignedp32(ptr),
+               dlen = u_get_unalignedp32(ptr+4),
+               sz   = sizeof(UCDB::cdb_record_header) + klen + (dlen == U_NOT_FOUND ? 0 : dlen);
+
+      if ((uint32_t)(end - ptr) < sz)
+         {
+         if (ptr == records.data())
+            {
+            U_INTERNAL_ASSERT(offset + sz <= rpl_end)
+
+            (void) records.reserve(sz);
+
+            if (rpl->pread(records.data(), sz, offset) == false) U_RETURN(false);
+
+            ptr = records.data() + sz;
+            }
+
+         break;
+         }
+
+      ptr += sz;
+      }
+
+   len = ptr - records.data();
+
+   uint64_t header[2] = { rpl_id, lsn + len };
+
+   (void) buffer.reserve(sizeof(header) + len);
+
+   (void) buffer.append((const char*)header, sizeof(header));
+   (void) buffer.append(records.data(), len);
+
+   U_RETURN(true);
+}
+
+bool URDBServer::readSnapshot(UString& buffer)
+{
+   U_TRACE(0, "URDBServer::readSnapshot(%V)", buffer.rep)
+
+   // NB: the records of a transaction in progress are not in the log...
+
+   if (rpl == U_NULLPTR ||
+       rpl_pending)
+      {
+      U_RETURN(false);
+      }
+
+   UString tmp = rdb->print();
+
+   uint64_t header[2] = { rpl_id, rpl_base + rpl_end - U_RPL_HEADER };
+
+   (void) buffer.reserve(sizeof(header) + tmp.size());
+
+   (void) buffer.append((const char*)header, sizeof(header));
+   (void) buffer.append(tmp);
+
+   U_RETURN(true);
+}
+
 // method VIRTUAL to redefine
 
 void URDBServer::preallocate()
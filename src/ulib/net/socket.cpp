@@ -12,8 +12,8 @@
 // ============================================================================
 
 #include <ulib/file.h>
+#include <ulib/ioring.h>
 #include <ulib/timeval.h>
-#include <ulib/notifier.h>
 #include <ulib/internal/chttp.h>
 #include <ulib/utility/interrupt.h>
 #include <ulib/utility/string_ext.h>
@@ -53,6 +53,7 @@ int  USocket::incoming_cpu = -1;
 int  USocket::iBackLog = SOMAXCONN;
 int  USocket::accept4_flags;  // If flags is 0, then accept4() is the same as accept()
 bool USocket::breuseport;
+bool USocket::breuseport_cbpf = true;
 bool USocket::bincoming_cpu;
 
 socklen_t               USocket::peer_addr_len; 
@@ -502,14 +503,7 @@ void USocket::reusePort(int _flags)
    U_CHECK_MEMORY
 
 #ifdef U_LINUX
-# if (!defined(U_SERVER_CAPTIVE_PORTAL) || defined(ENABLE_THREAD)) && !defined(HAVE_OLD_IOSTREAM)
-   if (enable_bpf() == false) // Enable BPF filtering to distribute the ingress packets among the SO_REUSEPORT sockets
-      {
-      U_WARNING("SO_ATTACH_REUSEPORT_CBPF failed, port %u", iLocalPort);
-      }
-# endif
-
-   U_INTERNAL_DUMP("breuseport = %b", breuseport)
+   U_INTERNAL_DUMP("breuseport = %b breuseport_cbpf = %b incoming_cpu = %d", breuseport, breuseport_cbpf, incoming_cpu)
 
    if (breuseport)
       {
@@ -542,6 +536,28 @@ void USocket::reusePort(int _flags)
       if (incoming_cpu != -1) bincoming_cpu = setSockOpt(SOL_SOCKET, SO_INCOMING_CPU, (void*)&incoming_cpu);
 #    endif
 
+#    if (!defined(U_SERVER_CAPTIVE_PORTAL) || defined(ENABLE_THREAD)) && !defined(HAVE_OLD_IOSTREAM)
+      /**
+       * NB: the filter belong to the SO_REUSEPORT sockets group, so we must set it on the socket that is joined to the group
+       * (after listen()), and it can be set by any socket of the group. The filter select the socket by its position in the
+       * group, that is the order of listen(), so it map the cpu to the process pinned on it only if the processes start in
+       * order. When a process is restarted its socket goes to the end of the group, in this case we remove the filter and
+       * the kernel distribute by hash, preferring the socket with SO_INCOMING_CPU equal to the cpu processing the packet...
+       */
+
+      if (breuseport_cbpf)
+         {
+         if (enable_bpf() == false) // Enable BPF filtering to distribute the ingress packets among the SO_REUSEPORT sockets
+            {
+            U_WARNING("SO_ATTACH_REUSEPORT_CBPF failed, port %u", iLocalPort);
+            }
+         }
+      else
+         {
+         (void) disable_bpf();
+         }
+#    endif
+
       (void) U_FF_SYSCALL(close, "%d", old);
       }
 #endif
@@ -876,6 +892,10 @@ void USocket::close_socket()
       uint32_t count = 0;
       char _buf[8 * 1024];
 
+#  ifdef U_IORING_ENABLE
+      if (UNotifier::bioring) UIORing::detach(iSockDesc); // NB: we want to read directly from the socket...
+#  endif
+
       /**
        * At this point, the socket layer has to wait until the receiver has
        * acknowledged the FIN packet by receiving a ACK packet. This is done by
@@ -908,6 +928,9 @@ void USocket::close_socket()
    if (U_ClientImage_parallelization != U_PARALLELIZATION_CHILD &&
        UNotifier::isHandler(iSockDesc))
       {
+#  ifdef U_IORING_ENABLE
+      if (UNotifier::bioring == false) // NB: with io_uring the requests are cancelled by UNotifier::handlerDelete()...
+#  endif
       (void) U_FF_SYSCALL(epoll_ctl, "%d,%d,%d,%p", UNotifier::epollfd, EPOLL_CTL_DEL, iSockDesc, (struct epoll_event*)1);
 
       UNotifier::handlerDelete(iSockDesc, EPOLLIN | EPOLLRDHUP);
@@ -931,6 +954,22 @@ bool USocket::acceptClient(USocket* pcNewConnection)
    SocketAddress cRemote;
    socklen_t slDummy = cRemote.sizeOf();
 
+#ifdef U_IORING_ENABLE
+   if (UNotifier::bioring &&
+       UIORing::isAcceptor(iSockDesc))
+      {
+      // NB: the connections are accepted by the multishot accept of the ring, we ask only the address of the peer...
+
+      while ((pcNewConnection->iSockDesc = UIORing::accept()) != -1 &&
+             U_SYSCALL(getpeername, "%d,%p,%p", pcNewConnection->iSockDesc, (sockaddr*)cRemote, &slDummy) == -1) // NB: the peer can be already gone...
+         {
+         (void) U_SYSCALL(close, "%d", pcNewConnection->iSockDesc);
+
+         slDummy = cRemote.sizeOf();
+         }
+      }
+   else
+#endif
 #if defined(HAVE_ACCEPT4) && !defined(USE_FSTACK)
        pcNewConnection->iSockDesc  = U_SYSCALL(accept4, "%d,%p,%p,%d", iSockDesc, (sockaddr*)cRemote, &slDummy, accept4_flags);
 // if (pcNewConnection->iSockDesc != -1 || errno != ENOSYS) goto next;
@@ -1278,6 +1317,15 @@ int USocket::recv(void* pBuffer, uint32_t iBufLength)
 
    int iBytesRead;
 
+#ifdef U_IORING_ENABLE
+   if (UNotifier::bioring &&
+       UIORing::isRecv(iSockDesc) &&
+       UIORing::recv(iSockDesc, pBuffer, iBufLength, iBytesRead)) // NB: the data staged by the multishot recv of the ring...
+      {
+      U_RETURN(iBytesRead);
+      }
+#endif
+
 loop:
    iBytesRead = U_FF_SYSCALL(recv, "%d,%p,%u,%d", getFd(), CAST(pBuffer), iBufLength, 0);
 
@@ -12,7 +12,7 @@
 // ============================================================================
 
 #include <ulib/timer.h>
-#include <ulib/notifier.h>
+#include <ulib/ioring.h>
 #include <ulib/net/socket.h>
 #include <ulib/internal/chttp.h>
 #include <ulib/utility/interrupt.h>
@@ -57,6 +57,7 @@ struct pollfd UNotifier::fds[1];
  */
 
 int        UNotifier::nfd_ready; // the number of file descriptors ready for the requested I/O
+bool       UNotifier::bioring;
 bool       UNotifier::flag_sigterm;
 long       UNotifier::last_event;
 uint32_t   UNotifier::min_connection;
@@ -178,6 +179,16 @@ next:
       {
       U_INTERNAL_DUMP("num_connection = %u", num_connection)
 
+#  ifdef U_IORING_ENABLE
+      if (bioring &&
+          initIORing())
+         {
+         (void) U_FF_SYSCALL(close, "%d", old);
+
+         return;
+         }
+#  endif
+
       if (num_connection)
          {
          U_INTERNAL_ASSERT_POINTER(lo_map_fd)
@@ -314,7 +325,49 @@ next:
 #  endif
 #endif
       }
+
+#ifdef U_IORING_ENABLE
+   if (bioring) (void) initIORing();
+#endif
+}
+
+#ifdef U_IORING_ENABLE
+U_NO_EXPORT bool UNotifier::initIORing()
+{
+   U_TRACE_NO_PARAM(0, "UNotifier::initIORing()")
+
+   U_INTERNAL_ASSERT(bioring)
+
+   if (UIORing::init() == false)
+      {
+      bioring = false;
+
+      U_WARNING("The io_uring event backend is not available with this kernel, we fall back to epoll");
+
+      U_RETURN(false);
+      }
+
+   // NB: reinitialized all after fork()...
+
+   if (num_connection)
+      {
+      for (int fd = 1; fd < (int32_t)lo_map_fd_len; ++fd)
+         {
+         if ((handler_event = lo_map_fd[fd])) UIORing::insert(handler_event);
+         }
+
+      if (hi_map_fd->first())
+         {
+         do {
+            UIORing::insert(hi_map_fd->elem());
+            }
+         while (hi_map_fd->next());
+         }
+      }
+
+   U_RETURN(true);
 }
+#endif
 
 void UNotifier::resume(UEventFd* item, uint32_t flags)
 {
@@ -323,6 +376,15 @@ void UNotifier::resume(UEventFd* item, uint32_t flags)
    U_INTERNAL_ASSERT_POINTER(item)
 
 #ifdef HAVE_EPOLL_WAIT
+# ifdef U_IORING_ENABLE
+   if (bioring)
+      {
+      UIORing::resume(item, flags);
+
+      return;
+      }
+# endif
+
    struct epoll_event _events = { flags, { item } };
 
    (void) U_FF_SYSCALL(epoll_ctl, "%d,%d,%d,%p", epollfd, EPOLL_CTL_ADD, item->fd, &_events);
@@ -353,6 +415,15 @@ void UNotifier::suspend(UEventFd* item)
    U_INTERNAL_ASSERT_POINTER(item)
 
 #ifdef HAVE_EPOLL_WAIT
+# ifdef U_IORING_ENABLE
+   if (bioring)
+      {
+      UIORing::suspend(item);
+
+      return;
+      }
+# endif
+
    (void) U_FF_SYSCALL(epoll_ctl, "%d,%d,%d,%p", epollfd, EPOLL_CTL_DEL, item->fd, (struct epoll_event*)1);
 #elif defined(HAVE_KQUEUE)
    U_INTERNAL_ASSERT_MAJOR(kq, 0)
@@ -444,6 +515,15 @@ loop:
    nkqevents = 0;
 #else
    U_INTERNAL_ASSERT_DIFFERS(U_ClientImage_parallelization, U_PARALLELIZATION_CHILD)
+
+# ifdef U_IORING_ENABLE
+   if (bioring)
+      {
+      waitForEventIORing(ptimeout);
+
+      return;
+      }
+# endif
 loop:
    nfd_ready = U_FF_SYSCALL(epoll_wait, "%d,%p,%u,%d", epollfd, events, max_connection, UEventTime::getMilliSecond(ptimeout));
 #endif
@@ -674,6 +754,67 @@ loop2:         if (pevents->events)
       }
 }
 
+#ifdef U_IORING_ENABLE
+U_NO_EXPORT void UNotifier::waitForEventIORing(UEventTime* ptimeout)
+{
+   U_TRACE(0, "UNotifier::waitForEventIORing(%p)", ptimeout)
+
+   bool bdelete;
+   uint32_t revents;
+
+loop:
+   nfd_ready = UIORing::waitForEvent(UEventTime::getMilliSecond(ptimeout));
+
+   if (nfd_ready > 0)
+      {
+#  ifdef DEBUG
+      if (max_nfd_ready < (uint32_t)nfd_ready) max_nfd_ready = nfd_ready;
+
+      U_INTERNAL_DUMP("max_nfd_ready = %u", max_nfd_ready)
+#  endif
+
+      U_gettimeofday // NB: optimization if it is enough a time resolution of one second...
+
+      last_event = u_now->tv_sec;
+
+      // NB: the completions are already reaped, here we have only the dispatch to the handlers (in the same way of epoll)...
+
+      while ((handler_event = UIORing::nextEvent(revents)))
+         {
+         U_INTERNAL_DUMP("handler_event->fd = %d revents = %B", handler_event->fd, revents)
+
+         bdelete = UNLIKELY((revents & (EPOLLERR | EPOLLHUP))             != 0) ||
+                     LIKELY((revents & (EPOLLIN  | EPOLLRDHUP | EPOLLPRI)) != 0 ? handler_event->handlerRead()
+                                                                               : handler_event->handlerWrite() == U_NOTIFIER_DELETE);
+
+         U_INTERNAL_DUMP("bdelete = %b", bdelete)
+
+         if (bdelete)
+            {
+            U_ClientImage_state = U_NOTIFY_DELETE;
+
+            handlerDelete(handler_event);
+            }
+         else
+            {
+            UIORing::update(handler_event);
+            }
+         }
+      }
+   else if (nfd_ready == -1)
+      {
+      U_INTERNAL_DUMP("errno = %d num_connection = %u", errno, num_connection)
+
+      if (errno == EINTR                   &&
+          UInterrupt::event_signal_pending &&
+          (UInterrupt::callHandlerSignal(), UInterrupt::exit_loop_wait_event_for_signal) == false)
+         {
+         goto loop;
+         }
+      }
+}
+#endif
+
 void UNotifier::waitForEvent()
 {
    U_TRACE_NO_PARAM(0, "UNotifier::waitForEvent()")
@@ -843,6 +984,15 @@ void UNotifier::insert(UEventFd* item, int op)
       }
 # endif
 
+# ifdef U_IORING_ENABLE
+   if (bioring)
+      {
+      UIORing::insert(item); // NB: the request is only queued, it is submitted with the next wait for events...
+
+      return;
+      }
+# endif
+
    struct epoll_event _events = { item->op_mask | op, { item } };
 
    (void) U_FF_SYSCALL(epoll_ctl, "%d,%d,%d,%p", epollfd, EPOLL_CTL_ADD, fd, &_events);
@@ -918,6 +1068,15 @@ bool UNotifier::modify(UEventFd* item)
    U_INTERNAL_ASSERT_MAJOR(epollfd, 0)
    U_INTERNAL_ASSERT_DIFFERS(U_ClientImage_parallelization, U_PARALLELIZATION_CHILD)
 
+# ifdef U_IORING_ENABLE
+   if (bioring)
+      {
+      if (UIORing::modify(item) == false) U_RETURN(false);
+
+      U_RETURN(true);
+      }
+# endif
+
    struct epoll_event _events = { item->op_mask, { item } };
 
    if (U_FF_SYSCALL(epoll_ctl, "%d,%d,%d,%p", epollfd, EPOLL_CTL_MOD, fd, &_events)) U_RETURN(false);
@@ -1005,6 +1164,10 @@ void UNotifier::handlerDelete(unsigned int fd, int mask)
       unlock();
       }
 
+#ifdef U_IORING_ENABLE
+   if (bioring) UIORing::erase(fd);
+#endif
+
 #if !defined(USE_LIBEVENT) && !defined(HAVE_EPOLL_WAIT) && !defined(HAVE_KQUEUE)
    if ((mask & (EPOLLIN | EPOLLRDHUP)) != 0)
       {
@@ -1163,6 +1326,10 @@ void UNotifier::clear()
    UMemoryPool::_free(events, max_connection + 1, sizeof(struct epoll_event));
 
    (void) U_FF_SYSCALL(close, "%d", epollfd);
+
+#  ifdef U_IORING_ENABLE
+   if (bioring) UIORing::clear();
+#  endif
 # elif defined(HAVE_KQUEUE)
    U_INTERNAL_ASSERT_MAJOR(kq, 0)
    U_INTERNAL_ASSERT_POINTER(kqevents)
@@ -1312,6 +1479,18 @@ int UNotifier::waitForRead(int fd, int timeoutMS)
    if (timeoutMS > 0) U_INTERNAL_ASSERT(timeoutMS >= 100)
 #endif
 
+#ifdef U_IORING_ENABLE
+   if (bioring &&
+       UIORing::isRecv(fd))
+      {
+      // NB: the data of fd are consumed by the multishot recv, so we must wait on the ring...
+
+      int ret = UIORing::waitForRead(fd, timeoutMS);
+
+      if (ret != -2) U_RETURN(ret);
+      }
+#endif
+
 #ifdef HAVE_POLL_H
    // NB: POLLRDHUP stream socket peer closed connection, or ***** shut down writing half of connection ****
 
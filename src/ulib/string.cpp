@@ -604,6 +604,30 @@ void UString::str_allocate(int which)
 #else
    U_INTERNAL_ASSERT_EQUALS(U_NUM_ELEMENTS(stringrep_storage), 75)
 #endif
+
+   // the constant allocated are the canonical rep of their content (see getIntern())
+
+   static const int intern_index[] = { 0, STR_ALLOCATE_INDEX_SOAP, STR_ALLOCATE_INDEX_IMAP, STR_ALLOCATE_INDEX_SSI, STR_ALLOCATE_INDEX_NOCAT,
+                                       STR_ALLOCATE_INDEX_HTTP, STR_ALLOCATE_INDEX_QUERY_PARSER, STR_ALLOCATE_INDEX_ORM, STR_ALLOCATE_INDEX_HTTP2,
+                                       (int)U_NUM_ELEMENTS(stringrep_storage) };
+
+   int k = (which ? __builtin_ctz(which)+1 : 0);
+
+   if (k < (int)U_NUM_ELEMENTS(intern_index)-1)
+      {
+      uustringrep key;
+
+      for (int i = intern_index[k], n = U_min(intern_index[k+1], (int)U_NUM_ELEMENTS(stringrep_storage)); i < n; ++i)
+         {
+         key.p1 = stringrep_storage+i;
+
+         if (key.p2 != pkey &&
+             key.p2->_length) // NB: the storage can have some entry not used...
+            {
+            addIntern(key.p2);
+            }
+         }
+      }
 }
 
 UStringRep::~UStringRep()
@@ -630,7 +654,7 @@ UStringRep* UStringRep::create(uint32_t length, uint32_t need, const char* ptr)
    // NB: we don't use new (ctor) because we want an allocation with more space for string data...
 
 #ifndef ENABLE_MEMPOOL
-      r = (UStringRep*) U_SYSCALL_MALLOC(need+(1+sizeof(UStringRep)));
+      r = (UStringRep*) (UMemoryArena::isScope() && need <= U_CAPACITY ? UMemoryArena::allocate(need+(1+sizeof(UStringRep))) : U_SYSCALL_MALLOC(need+(1+sizeof(UStringRep))));
    _ptr = (char*)(r + 1);
 
    U_INTERNAL_ASSERT_POINTER_MSG(r, "cannot allocate memory, exiting...")
@@ -641,7 +665,7 @@ UStringRep* UStringRep::create(uint32_t length, uint32_t need, const char* ptr)
 
       if (_ptr == MAP_FAILED)
          {
-         string_rep_null->references++;
+         string_rep_null->hold();
 
          U_RETURN_POINTER(string_rep_null, UStringRep);
          }
@@ -665,7 +689,7 @@ UStringRep* UStringRep::create(uint32_t length, uint32_t need, const char* ptr)
          {
          need = U_STACK_TYPE_9-(1+sizeof(UStringRep));
 
-         r = (UStringRep*) UMemoryPool::pop(9);
+         r = (UStringRep*) (UMemoryArena::isScope() ? UMemoryArena::allocate(U_STACK_TYPE_9) : UMemoryPool::pop(9));
          }
       else
          {
@@ -702,7 +726,7 @@ UStringRep* UStringRep::create(uint32_t length, uint32_t need, const char* ptr)
 
          U_INTERNAL_DUMP("sz = %u need = %u stack_index = %u", sz, need, stack_index)
 
-         r = (UStringRep*) UMemoryPool::pop(stack_index);
+         r = (UStringRep*) (UMemoryArena::isScope() ? UMemoryArena::allocate(need+(1+sizeof(UStringRep))) : UMemoryPool::pop(stack_index));
          }
 
       _ptr = (char*)(r + 1);
@@ -846,6 +870,141 @@ bool UString::shrink(bool bmalloc)
    U_RETURN(false);
 }
 
+// NB: the memory of the arena is given back at the end of the request and the source of a substring is not shared, so in this case we work on a private copy...
+
+void UString::setFlagReferences(uint32_t flag)
+{
+   U_TRACE(0, "UString::setFlagReferences(%u)", flag)
+
+   if ((rep->references & U_STRINGREP_FLAGS) == 0)
+      {
+      if (UMemoryArena::contains(rep) ||
+          UMemoryArena::contains(rep->str)
+#  if defined(U_SUBSTR_INC_REF) || defined(DEBUG)
+          || rep->parent
+#  endif
+         )
+         {
+         bool bscope = UMemoryArena::isScope();
+
+         if (bscope) UMemoryArena::leave();
+
+         _set(UStringRep::create(rep->_length, rep->_length, rep->str));
+
+         if (bscope) UMemoryArena::enter();
+
+         if (rep->isImmortal()) return; // NB: string_rep_null...
+         }
+
+      if (flag == U_STRINGREP_IMMORTAL) rep->references  = U_STRINGREP_IMMORTAL;
+      else                              rep->references |= U_STRINGREP_SHARED;
+      }
+
+   U_INTERNAL_ASSERT(invariant())
+}
+
+// INTERN
+
+static uint32_t    intern_num;
+static UStringRep* intern_table[U_INTERN_TABLE_SIZE];
+
+// NB: item == U_NULLPTR => we create (if necessary) a copy of the content as canonical rep...
+
+UStringRep* UString::findIntern(const char* s, uint32_t n, UStringRep* item, bool binsert)
+{
+   U_TRACE(0, "UString::findIntern(%.*S,%u,%p,%b)", n, s, n, item, binsert)
+
+   U_INTERNAL_ASSERT_RANGE(1, n, U_INTERN_MAX_LENGTH)
+
+   UStringRep* r;
+   UStringRep** slot;
+   UStringRep* copy = U_NULLPTR;
+   uint32_t index = u_hash((unsigned char*)s, n);
+
+   for (uint32_t i = 0; i < U_INTERN_TABLE_SIZE; ++i, ++index) // linear probing (the entries are never removed)
+      {
+      slot = intern_table + (index & (U_INTERN_TABLE_SIZE-1));
+
+      r = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+      if (r == U_NULLPTR)
+         {
+         if (binsert == false ||
+             intern_num >= (U_INTERN_TABLE_SIZE / 4) * 3)
+            {
+            break;
+            }
+
+         if (item == U_NULLPTR)
+            {
+            bool bscope = UMemoryArena::isScope();
+
+            if (bscope) UMemoryArena::leave();
+
+            item = copy = UStringRep::create(n, n, s);
+
+            if (bscope) UMemoryArena::enter();
+
+            copy->references = U_STRINGREP_IMMORTAL;
+            }
+
+         // NB: the slot can be taken at the same time by another thread with the same content...
+
+         if (__sync_bool_compare_and_swap(slot, U_NULLPTR, item))
+            {
+            (void) __sync_add_and_fetch(&intern_num, 1);
+
+            U_RETURN_POINTER(item, UStringRep);
+            }
+
+         r = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+         }
+
+      if (r->_length == n &&
+          memcmp(r->str, s, n) == 0)
+         {
+         break;
+         }
+
+      r = U_NULLPTR;
+      }
+
+   if (copy)
+      {
+      copy->references = 0;
+
+      copy->_release();
+      }
+
+   U_RETURN_POINTER(r, UStringRep);
+}
+
+UStringRep* UString::getIntern(const char* s, uint32_t n, bool binsert)
+{
+   U_TRACE(0, "UString::getIntern(%.*S,%u,%b)", n, s, n, binsert)
+
+   if (n == 0) U_RETURN_POINTER(UStringRep::string_rep_null, UStringRep);
+
+   if (n > U_INTERN_MAX_LENGTH) U_RETURN_POINTER(U_NULLPTR, UStringRep);
+
+   UStringRep* r = findIntern(s, n, U_NULLPTR, binsert);
+
+   U_RETURN_POINTER(r, UStringRep);
+}
+
+void UString::addIntern(UStringRep* r)
+{
+   U_TRACE(0, "UString::addIntern(%V)", r)
+
+   U_INTERNAL_ASSERT(r->isImmortal())
+
+   if (r->_length &&
+       r->_length <= U_INTERN_MAX_LENGTH)
+      {
+      (void) findIntern(r->str, r->_length, r, true);
+      }
+}
+
 static const int MultiplyDeBruijnBitPosition2[32] = { 0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8, 31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9 };
 
 void UStringRep::_release()
@@ -916,6 +1075,13 @@ void UStringRep::_release()
 # endif
 #endif
 
+   if (UMemoryArena::contains(this)) // NB: the memory of the arena is given back in bulk at the end of the request...
+      {
+      UMemoryArena::release(this);
+
+      return;
+      }
+
 #ifndef ENABLE_MEMPOOL
    U_SYSCALL_FREE((void*)this);
 #else
@@ -1038,13 +1204,28 @@ UStringRep* UStringRep::substr(const char* t, uint32_t tlen) const
       {
       r = string_rep_null;
 
-      r->references++;
+      r->hold();
       }
    else
       {
       U_INTERNAL_ASSERT_RANGE(str, t, pend())
 
-      U_NEW(UStringRep, r, UStringRep(t, tlen));
+      if (UMemoryArena::isScope() == false)
+         {
+         U_NEW(UStringRep, r, UStringRep(t, tlen));
+         }
+      else
+         {
+         r = (UStringRep*) UMemoryArena::allocate(sizeof(UStringRep));
+
+#     ifdef DEBUG
+         U_SET_LOCATION_INFO;
+         U_REGISTER_OBJECT_PTR(0,UStringRep,r,&(r->memory._this))
+         r->memory._this = (void*)U_CHECK_MEMORY_SENTINEL;
+#     endif
+
+         r->set(tlen, 0U, t);
+         }
 
 #  if defined(U_SUBSTR_INC_REF) || defined(DEBUG)
       UStringRep* p = (UStringRep*)this;
@@ -1059,7 +1240,7 @@ UStringRep* UStringRep::substr(const char* t, uint32_t tlen) const
       r->parent = p;
 
 #    ifdef U_SUBSTR_INC_REF
-      p->references++; // substring increment reference of source string
+      p->hold(); // substring increment reference of source string
 #    else
       p->child++;      // substring capture event 'DEAD OF SOURCE STRING WITH CHILD ALIVE'...
 
@@ -2092,7 +2273,7 @@ void UString::printKeyValue(const char* key, uint32_t keylen, const char* _data,
                ptr +=         u_buffer_len;
                               u_buffer_len = 0;
       }
-   else
+   else if (datalen) // NB: the data can be empty...
       {
       U_MEMCPY(ptr, _data, datalen);
                ptr +=      datalen;
@@ -424,6 +424,10 @@ bool UThread::start(uint32_t timeoutMS)
    (void) U_SYSCALL(pthread_attr_init,           "%p",    &attr);
    (void) U_SYSCALL(pthread_attr_setdetachstate, "%p,%d", &attr, detachstate);
 
+#if defined(ENABLE_MEMPOOL) && defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+   UMemoryPool::bthread = true;
+#endif
+
    result = (U_SYSCALL(pthread_create, "%p,%p,%p,%p", &tid, &attr, (pvPFpv)execHandler, this) == 0);
 
    (void) pthread_attr_destroy(&attr);
@@ -632,6 +636,10 @@ UThreadPool::UThreadPool(uint32_t size) : UThread(PTHREAD_CREATE_DETACHED), pool
    (void) pthread_attr_init(&attr);
    (void) pthread_attr_setdetachstate(&attr, UThread::detachstate);
 
+#if defined(ENABLE_MEMPOOL) && defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+   UMemoryPool::bthread = true;
+#endif
+
    for (uint32_t i = 0; i < size; ++i)
       {
       U_NEW(UThread, th, UThread(UThread::detachstate));
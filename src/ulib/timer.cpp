@@ -13,9 +13,45 @@
 
 #include <ulib/timer.h>
 
-int     UTimer::mode;
-UTimer* UTimer::pool;
-UTimer* UTimer::first;
+int      UTimer::mode;
+uint32_t UTimer::num;
+uint64_t UTimer::current;
+UTimer*  UTimer::pool;
+UTimer*  UTimer::first;
+UTimer*  UTimer::expired;
+uint64_t UTimer::pending[U_TIMER_LEVEL];
+UTimer*  UTimer::wheel[U_TIMER_LEVEL][U_TIMER_SLOT];
+
+static inline uint32_t getLevel(uint64_t x) // NB: x != 0...
+{
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(HAVE_OLD_IOSTREAM)
+   return (63 - __builtin_clzll(x)) / U_TIMER_SLOT_BIT;
+#else
+   uint32_t n = 0;
+
+   while ((x >>= U_TIMER_SLOT_BIT)) ++n;
+
+   return n;
+#endif
+}
+
+static inline uint32_t getSlot(uint64_t x) // NB: x != 0...
+{
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(HAVE_OLD_IOSTREAM)
+   return __builtin_ctzll(x);
+#else
+   uint32_t n = 0;
+
+   while ((x & 1) == 0) { x >>= 1; ++n; }
+
+   return n;
+#endif
+}
+
+static inline uint64_t getTick(const struct timeval& tv)
+{
+   return ((uint64_t)tv.tv_sec * 1000ULL) + (uint64_t)(tv.tv_usec / 1000L);
+}
 
 U_NO_EXPORT void UTimer::insertEntry()
 {
@@ -23,33 +59,65 @@ U_NO_EXPORT void UTimer::insertEntry()
 
    U_CHECK_MEMORY
 
-   U_INTERNAL_DUMP("first = %p", first)
+   U_INTERNAL_ASSERT_EQUALS(prev, U_NULLPTR)
 
-   if (first)
-      {
-      UTimer** ptr = &first;
+   // NB: the resolution of the wheel is one millisecond, with signal we anticipate the expiration of the tolerance...
 
-      do {
-         U_INTERNAL_DUMP("this = %p *ptr = %p", this, *ptr)
+   tick = getTick(alarm->xtime);
 
-         if (*this < **ptr) break;
+   if (mode != NOSIGNAL) tick -= alarm->tolerance;
 
-         ptr = &(*ptr)->next;
-         }
-      while (*ptr);
+   if (tick <= current) tick = current + 1; // NB: already expired, it is called at the next tick...
+
+   uint32_t level = getLevel(tick ^ current),
+            slot  = (tick >> (level * U_TIMER_SLOT_BIT)) & (U_TIMER_SLOT-1);
+
+   U_INTERNAL_DUMP("tick = %llu current = %llu level = %u slot = %u", tick, current, level, slot)
+
+   link(&wheel[level][slot]);
+
+   pending[level] |= (1ULL << slot);
 
-      next = *ptr;
-      *ptr = this;
+   alarm->ptimer = this;
+
+   ++num;
+
+   if (first &&
+       *this < *first)
+      {
+      first = this;
       }
-   else
+}
+
+U_NO_EXPORT void UTimer::removeEntry()
+{
+   U_TRACE_NO_PARAM(0, "UTimer::removeEntry()")
+
+   U_CHECK_MEMORY
+
+   U_INTERNAL_ASSERT_MAJOR(num, 0)
+   U_INTERNAL_ASSERT_POINTER(prev)
+
+   UTimer** head = prev;
+
+   unlink();
+
+   // NB: if the entry was the last of a slot of the wheel we clear the bit of the slot...
+
+   if (*head == U_NULLPTR &&
+       head >= &wheel[0][0] &&
+       head <  &wheel[0][0] + U_TIMER_LEVEL * U_TIMER_SLOT)
       {
-      // The list is empty
+      uint32_t n = head - &wheel[0][0];
 
-      next  = U_NULLPTR;
-      first = this;
+      pending[n / U_TIMER_SLOT] &= ~(1ULL << (n % U_TIMER_SLOT));
       }
 
-   U_ASSERT(invariant())
+   alarm->ptimer = U_NULLPTR;
+
+   if (first == this) first = U_NULLPTR;
+
+   --num;
 }
 
 void UTimer::insert(UEventTime* a)
@@ -73,116 +141,199 @@ void UTimer::insert(UEventTime* a)
       pool = pool->next;
       }
 
-   // add it in to its new list, sorted correctly
+   // add it in to the wheel
 
    (item->alarm = a)->setTimeToExpire();
 
-   item->insertEntry();
+   if (num == 0) // NB: the wheel is empty, we can move it to now...
+      {
+      u_gettimeofday(&UEventTime::timeout1);
 
-#ifdef DEBUG
-   item = first;
+      current = getTick(UEventTime::timeout1);
+      }
 
-   for (uint32_t i = 0; item; ++i, item = item->next) U_INTERNAL_DUMP("item[%u] = %p", i, item)
-#endif
+   item->insertEntry();
+
+   U_ASSERT(invariant())
 }
 
-void UTimer::callHandlerTimeout()
+void UTimer::setFirst()
 {
-   U_TRACE_NO_PARAM(0, "UTimer::callHandlerTimeout()")
-
-   U_INTERNAL_ASSERT_POINTER(first)
+   U_TRACE_NO_PARAM(0, "UTimer::setFirst()")
 
-   UTimer* item = first;
-                  first = first->next; // remove it from its active list
+   U_INTERNAL_ASSERT_MAJOR(num, 0)
+   U_INTERNAL_ASSERT_EQUALS(first, U_NULLPTR)
 
-   int result = item->alarm->handlerTime();
-
-        if (result == -1) erase(item); // -1 => normal
-   else if (result ==  0)              //  0 => monitoring
+   if (expired) first = expired;
+   else
       {
-      U_INTERNAL_DUMP("UEventTime::timeout1 = %#19D (next alarm expire) = %#19D", UEventTime::timeout1.tv_sec, item->next ? item->next->alarm->expire() : 0L)
+      // NB: the levels are ordered (every timer of a level expire before the timers of the next level) and so the slots of a level...
 
-      u_gettimeofday(&UEventTime::timeout1);
+      uint32_t level = 0;
 
-      U_INTERNAL_DUMP("UEventTime::timeout1 = { %ld %6ld } first = %p", UEventTime::timeout1.tv_sec, UEventTime::timeout1.tv_usec, first)
+      while (pending[level] == 0)
+         {
+         ++level;
 
-      // add it back in to its new list, sorted correctly
+         U_INTERNAL_ASSERT_MINOR(level, U_TIMER_LEVEL)
+         }
 
-      item->alarm->updateTimeToExpire();
+      first = wheel[level][getSlot(pending[level])];
+      }
 
-      item->insertEntry();
+   for (UTimer* item = first->next; item; item = item->next)
+      {
+      if (*item < *first) first = item;
       }
+
+   U_INTERNAL_DUMP("first = %p", first)
 }
 
-void UTimer::updateTimeToExpire(UEventTime* ptime)
+void UTimer::expire(uint64_t tick)
 {
-   U_TRACE(0, "UTimer::updateTimeToExpire(%p)", ptime)
-
-   U_INTERNAL_ASSERT_POINTER(first)
+   U_TRACE(0, "UTimer::expire(%llu)", tick)
 
-   UTimer* item;
+   U_INTERNAL_DUMP("current = %llu num = %u", current, num)
 
-   for (UTimer** ptr = &first; (item = *ptr); ptr = &(*ptr)->next)
+   if (tick > current)
       {
-      if (item->alarm == ptime)
+      UTimer* item;
+      UTimer* todo = U_NULLPTR;
+      uint64_t mask, steps;
+      uint32_t shift, slot;
+
+      for (uint32_t level = 0; level < U_TIMER_LEVEL; ++level)
+         {
+         shift = level * U_TIMER_SLOT_BIT;
+         steps = (tick >> shift) - (current >> shift);
+
+         if (steps == 0) break;
+
+         if (pending[level])
+            {
+            // NB: the slots between the old and the new position of the current tick in this level...
+
+            if (steps >= U_TIMER_SLOT) mask = ~0ULL;
+            else
+               {
+               mask = (1ULL << steps) - 1;
+               slot = ((current >> shift) + 1) & (U_TIMER_SLOT-1);
+
+               if (slot) mask = (mask << slot) | (mask >> (U_TIMER_SLOT - slot));
+               }
+
+            mask &= pending[level];
+
+            pending[level] &= ~mask;
+
+            while (mask)
+               {
+               slot  = getSlot(mask);
+               mask &= mask - 1;
+
+               while ((item = wheel[level][slot]))
+                  {
+                  item->unlink();
+                  item->link(&todo);
+                  }
+               }
+            }
+         }
+
+      current = tick;
+
+      U_INTERNAL_DUMP("current = %llu", current)
+
+      // NB: the timers of the slots passed are expired or go to a lower level...
+
+      while ((item = todo))
          {
-         U_INTERNAL_DUMP("*ptr = %p item->next = %p", *ptr, item->next)
+         item->unlink();
 
-         *ptr = item->next; // remove it from its active list
+         if (item->tick <= tick) item->link(&expired);
+         else
+            {
+            --num;
 
-         break;
+            item->insertEntry();
+            }
          }
+
+      U_ASSERT(invariant())
       }
 
-   U_ASSERT(invariant())
-   U_INTERNAL_ASSERT_POINTER(item)
+   // call the handler of the expired timers
 
-   U_INTERNAL_DUMP("UEventTime::timeout1 = %#19D (next alarm expire) = %#19D", UEventTime::timeout1.tv_sec, item->next ? item->next->alarm->expire() : 0L)
+   UTimer* item;
 
-   u_gettimeofday(&UEventTime::timeout1);
+   while ((item = expired))
+      {
+      item->removeEntry();
 
-   U_INTERNAL_DUMP("UEventTime::timeout1 = { %ld %6ld } first = %p", UEventTime::timeout1.tv_sec, UEventTime::timeout1.tv_usec, first)
+      int result = item->alarm->handlerTime();
 
-   // add it back in to its new list, sorted correctly
+           if (result == -1) erase(item); // -1 => normal
+      else if (result ==  0)              //  0 => monitoring
+         {
+         u_gettimeofday(&UEventTime::timeout1);
 
-   ptime->updateTimeToExpire();
+         U_INTERNAL_DUMP("UEventTime::timeout1 = { %ld %6ld }", UEventTime::timeout1.tv_sec, UEventTime::timeout1.tv_usec)
 
-#ifndef U_COVERITY_FALSE_POSITIVE // Dereference after null check (FORWARD_NULL)
-   item->insertEntry();
-#endif
+         // add it back in to the wheel
+
+         item->alarm->updateTimeToExpire();
+
+         item->insertEntry();
+         }
+      }
 }
 
-void UTimer::run()
+void UTimer::callHandlerTimeout()
 {
-   U_TRACE_NO_PARAM(1, "UTimer::run()")
+   U_TRACE_NO_PARAM(0, "UTimer::callHandlerTimeout()")
+
+   U_INTERNAL_ASSERT_POINTER(first)
+
+   // NB: the wait for the first timer is over, so it is expired even if the clock is a little behind...
 
    u_gettimeofday(&UEventTime::timeout1);
 
-   U_INTERNAL_DUMP("UEventTime::timeout1 = { %ld %6ld } first = %p", UEventTime::timeout1.tv_sec, UEventTime::timeout1.tv_usec, first)
+   uint64_t now = getTick(UEventTime::timeout1);
 
-   UTimer* item = first;
-   bool bnosignal = (mode == NOSIGNAL);
+   expire(first->tick > now ? first->tick : now);
+}
 
-loop:
-#ifdef DEBUG
-   U_INTERNAL_DUMP("item = %p item->next = %p", item, item->next)
+void UTimer::updateTimeToExpire(UEventTime* ptime)
+{
+   U_TRACE(0, "UTimer::updateTimeToExpire(%p)", ptime)
+
+   UTimer* item = ptime->ptimer;
 
    U_INTERNAL_ASSERT_POINTER(item)
+   U_INTERNAL_ASSERT_EQUALS(item->alarm, ptime)
 
-   if (item->next) U_INTERNAL_ASSERT(*item <= *(item->next))
-#endif
+   item->removeEntry();
 
-   if (bnosignal ? item->alarm->isExpired()
-                 : item->alarm->isExpiredWithTolerance())
-      {
-      item = item->next;
+   u_gettimeofday(&UEventTime::timeout1);
 
-      callHandlerTimeout();
+   U_INTERNAL_DUMP("UEventTime::timeout1 = { %ld %6ld }", UEventTime::timeout1.tv_sec, UEventTime::timeout1.tv_usec)
 
-      if (item) goto loop;
-      }
+   // add it back in to the wheel
 
-   U_INTERNAL_DUMP("first = %p", first)
+   ptime->updateTimeToExpire();
+
+   item->insertEntry();
+}
+
+void UTimer::run()
+{
+   U_TRACE_NO_PARAM(1, "UTimer::run()")
+
+   u_gettimeofday(&UEventTime::timeout1);
+
+   U_INTERNAL_DUMP("UEventTime::timeout1 = { %ld %6ld } num = %u", UEventTime::timeout1.tv_sec, UEventTime::timeout1.tv_usec, num)
+
+   if (num) expire(getTick(UEventTime::timeout1));
 
    if (UInterrupt::event_signal_pending) UInterrupt::callHandlerSignal();
 }
@@ -195,7 +346,12 @@ void UTimer::setTimer()
 
    run();
 
-   if (first) first->alarm->setTimeVal(&(UInterrupt::timerval.it_value));
+   if (num)
+      {
+      if (first == U_NULLPTR) setFirst();
+
+      first->alarm->setTimeVal(&(UInterrupt::timerval.it_value));
+      }
    else
       {
       UInterrupt::timerval.it_value.tv_sec  =
@@ -216,32 +372,25 @@ void UTimer::erase(UEventTime* palarm)
 {
    U_TRACE(0, "UTimer::erase(%p)", palarm)
 
-   U_INTERNAL_ASSERT_POINTER(first)
+   UTimer* item = palarm->ptimer;
 
-   UTimer* item;
+   U_INTERNAL_DUMP("item = %p", item)
 
-   for (UTimer** ptr = &first; (item = *ptr); ptr = &(*ptr)->next)
+   if (item) // NB: it can be called from the handler of the alarm itself...
       {
-      if (item->alarm == palarm)
-         {
-         U_INTERNAL_DUMP("*ptr = %p item->next = %p", *ptr, item->next)
+      U_INTERNAL_ASSERT_EQUALS(item->alarm, palarm)
 
-         *ptr = item->next; // remove it from its active list
+      item->removeEntry();
 
-         erase(item);
-
-         break;
-         }
+      erase(item);
       }
-
-   U_ASSERT(invariant())
 }
 
 void UTimer::clear()
 {
    U_TRACE_NO_PARAM(1, "UTimer::clear()")
 
-   U_INTERNAL_DUMP("mode = %d first = %p pool = %p", mode, first, pool)
+   U_INTERNAL_DUMP("mode = %d num = %u pool = %p", mode, num, pool)
 
    UTimer* next;
    UTimer* item;
@@ -254,21 +403,29 @@ void UTimer::clear()
       (void) U_SYSCALL(setitimer, "%d,%p,%p", ITIMER_REAL, &UInterrupt::timerval, U_NULLPTR);
       }
 
-   if (first)
+   if (num)
       {
-      next = first;
-             first = U_NULLPTR;
+      for (uint32_t i = 0; i <= U_TIMER_LEVEL * U_TIMER_SLOT; ++i)
+         {
+         next = (i < U_TIMER_LEVEL * U_TIMER_SLOT ? wheel[0][i] : expired);
 
-      do {
-         item = next;
-                next = item->next;
+         while ((item = next))
+            {
+            next = item->next;
 
-         U_INTERNAL_DUMP("item->alarm = %p next = %p", item->alarm, next)
+            U_INTERNAL_DUMP("item->alarm = %p next = %p", item->alarm, next)
 
-      // U_DELETE(item->alarm)
-         U_DELETE(item)
+         // U_DELETE(item->alarm)
+            U_DELETE(item)
+            }
          }
-      while (next);
+
+      num     = 0;
+      first   =
+      expired = U_NULLPTR;
+
+      (void) U_SYSCALL(memset, "%p,%d,%u",  wheel, 0, sizeof(wheel));
+      (void) U_SYSCALL(memset, "%p,%d,%u", pending, 0, sizeof(pending));
       }
 
    if (pool)
@@ -294,20 +451,35 @@ bool UTimer::invariant()
 {
    U_TRACE_NO_PARAM(0, "UTimer::invariant()")
 
-   if (first)
+   uint32_t n = 0;
+
+   for (uint32_t level = 0; level < U_TIMER_LEVEL; ++level)
       {
-      for (UTimer* item = first; item->next; item = item->next)
+      for (uint32_t slot = 0; slot < U_TIMER_SLOT; ++slot)
          {
-         if (          item->next &&
-             *item > *(item->next))
+         if (((pending[level] >> slot) & 1) != (wheel[level][slot] != U_NULLPTR))
             {
-            U_ERROR("UTimer::invariant() failed: item = %p { %ld %6ld } item->next = %p { %ld %6ld }",
-                        item,             item->alarm->xtime.tv_sec,       item->alarm->xtime.tv_usec,
-                        item->next, item->next->alarm->xtime.tv_sec, item->next->alarm->xtime.tv_usec);
+            U_ERROR("UTimer::invariant() failed: level = %u slot = %u pending = %llu", level, slot, pending[level]);
+            }
+
+         for (UTimer* item = wheel[level][slot]; item; item = item->next, ++n)
+            {
+            if (item->tick <= current                                                   ||
+                getLevel(item->tick ^ current) != level                                 ||
+                ((item->tick >> (level * U_TIMER_SLOT_BIT)) & (U_TIMER_SLOT-1)) != slot ||
+                item->alarm->ptimer != item)
+               {
+               U_ERROR("UTimer::invariant() failed: item = %p { %ld %6ld } tick = %llu current = %llu level = %u slot = %u",
+                           item, item->alarm->xtime.tv_sec, item->alarm->xtime.tv_usec, item->tick, current, level, slot);
+               }
             }
          }
       }
 
+   for (UTimer* item = expired; item; item = item->next) ++n;
+
+   if (n != num) U_ERROR("UTimer::invariant() failed: num = %u n = %u", num, n);
+
    U_RETURN(true);
 }
 #endif
@@ -344,10 +516,26 @@ void UTimer::printInfo(ostream& os)
 {
    U_TRACE(0+256, "UTimer::printInfo(%p)", &os)
 
-   os << "first = ";
+   os << "num   = " << num << "\nfirst = ";
 
-   if (first) os << *first;
-   else       os << (void*)first;
+   if (num)
+      {
+      if (first == U_NULLPTR) setFirst();
+
+      os << *(first->alarm);
+      }
+   else
+      {
+      os << (void*)first;
+      }
+
+   for (uint32_t level = 0; level < U_TIMER_LEVEL; ++level)
+      {
+      for (uint32_t slot = 0; slot < U_TIMER_SLOT; ++slot)
+         {
+         if (wheel[level][slot]) os << "\nwheel[" << level << "][" << slot << "] = " << *wheel[level][slot];
+         }
+      }
 
    os << "\npool  = ";
 
@@ -364,10 +552,15 @@ const char* UTimer::dump(bool reset) const
                                                  << " } { " << UInterrupt::timerval.it_value.tv_sec
                                                  << " "     << UInterrupt::timerval.it_value.tv_usec
                                                                  << " } }\n"
-                  << "pool         (UTimer     " << (void*)pool  << ")\n"
-                  << "first        (UTimer     " << (void*)first << ")\n"
-                  << "next         (UTimer     " << (void*)next  << ")\n"
-                  << "alarm        (UEventTime " << (void*)alarm << ")";
+                  << "num                      " << num             << '\n'
+                  << "tick                     " << tick            << '\n'
+                  << "current                  " << current         << '\n'
+                  << "pool         (UTimer     " << (void*)pool     << ")\n"
+                  << "first        (UTimer     " << (void*)first    << ")\n"
+                  << "expired      (UTimer     " << (void*)expired  << ")\n"
+                  << "next         (UTimer     " << (void*)next     << ")\n"
+                  << "prev         (UTimer     " << (void*)prev     << ")\n"
+                  << "alarm        (UEventTime " << (void*)alarm    << ")";
 
    if (reset)
       {
@@ -0,0 +1,137 @@
+// ============================================================================
+//
+// = LIBRARY
+//    ULib - c++ library
+//
+// = FILENAME
+//    access_log.cpp - binary structured access log (alternative to the apache like log)
+//
+// = AUTHOR
+//    Stefano Casazza
+//
+// ============================================================================
+
+#include <ulib/log.h>
+#include <ulib/utility/access_log.h>
+
+const char* UAccessLog::entry;
+uint32_t    UAccessLog::rotate_cnt;
+uint64_t    UAccessLog::cache[U_ACCESS_LOG_CACHE_SIZE];
+
+// NB: return the slot of the cache to set with the identifier after the write of the definition of the string...
+
+U_NO_EXPORT uint64_t* UAccessLog::addString(struct iovec* iov, int& n, char* hdr, uint64_t& id, const char* s, uint32_t len)
+{
+   U_TRACE(0, "UAccessLog::addString(%p,%d,%p,%p,%.*S,%u)", iov, n, hdr, &id, len, s, len)
+
+   if (len == 0)
+      {
+      s   = "-";
+      len = 1;
+      }
+   else if (len > U_ACCESS_LOG_STRING_MAX)
+      {
+      len = U_ACCESS_LOG_STRING_MAX;
+      }
+
+   id = getId(s, len);
+
+   uint64_t* slot = cache + (id & (U_ACCESS_LOG_CACHE_SIZE-1));
+
+   if (*slot != id)
+      {
+      hdr[0] = (char)U_ACCESS_LOG_MAGIC;
+      hdr[1] = 'S';
+
+      u_put_unalignedp16(hdr+2, (uint16_t)(U_ACCESS_LOG_STRING_HDR + len));
+      u_put_unalignedp64(hdr+4, id);
+
+      iov[n].iov_base   = (caddr_t)hdr;
+      iov[n].iov_len    = U_ACCESS_LOG_STRING_HDR;
+      iov[n+1].iov_base = (caddr_t)s;
+      iov[n+1].iov_len  = len;
+
+      n += 2;
+
+      U_RETURN_POINTER(slot, uint64_t);
+      }
+
+   U_RETURN_POINTER(U_NULLPTR, uint64_t);
+}
+
+void UAccessLog::write(ULog* log, record& r, const char* request, uint32_t request_len, const char* referer, uint32_t referer_len, const char* agent, uint32_t agent_len)
+{
+   U_TRACE(0, "UAccessLog::write(%p,%p,%.*S,%u,%.*S,%u,%.*S,%u)", log, &r, request_len, request, request_len, referer_len, referer, referer_len, agent_len, agent, agent_len)
+
+   U_INTERNAL_ASSERT_POINTER(log)
+   U_INTERNAL_ASSERT(U_Log_binary(log))
+
+   int n = 0;
+   struct iovec iov[7];
+   char hdr[3 * U_ACCESS_LOG_STRING_HDR];
+
+   // NB: after the rotation of the log the definition of the strings must be written again in the new file...
+
+   uint32_t cnt =
+#ifdef HAVE_GCC_ATOMICS
+   __atomic_load_n(&(log->ptr_log_data->rotate_cnt), __ATOMIC_ACQUIRE);
+#else
+   *(volatile uint32_t*)&(log->ptr_log_data->rotate_cnt);
+#endif
+
+   if (cnt != rotate_cnt)
+      {
+      rotate_cnt = cnt;
+
+      (void) U_SYSCALL(memset, "%p,%d,%u", cache, 0, sizeof(cache));
+      }
+
+   // the uri is the request line without the method and the protocol (GET /index.html HTTP/1.1)
+
+   const char* uri = request;
+   const char* end = request + request_len;
+   const char* ptr = (const char*) memchr(request, ' ', request_len);
+
+   if (ptr)
+      {
+      uri = ptr+1;
+
+      for (ptr = end-1; ptr > uri; --ptr)
+         {
+         if (*ptr == ' ')
+            {
+            if ((end-ptr) > 4 &&
+                u_get_unalignedp32(ptr+1) == U_MULTICHAR_CONSTANT32('H','T','T','P'))
+               {
+               end = ptr;
+               }
+
+            break;
+            }
+         }
+      }
+
+   uint64_t* slot[3] = { addString(iov, n, hdr,                             r.uri,     uri,     end-uri),
+                         addString(iov, n, hdr +     U_ACCESS_LOG_STRING_HDR, r.referer, referer, referer_len),
+                         addString(iov, n, hdr + 2 * U_ACCESS_LOG_STRING_HDR, r.agent,   agent,   agent_len) };
+
+   r.magic = U_ACCESS_LOG_MAGIC;
+   r.type  = 'R';
+   r.len   = sizeof(record);
+   r.time  = (uint64_t)u_now->tv_sec * 1000000ULL + u_now->tv_usec;
+
+   if (r.version == 0) r.version = '-';
+
+   iov[n].iov_base = (caddr_t)&r;
+   iov[n].iov_len  = sizeof(record);
+
+   // NB: the cache is updated only if the definitions are written, a record can be dropped (Ex: bigger than the log)
+   //     and the next records must not use the identifier of a string that is not in the log...
+
+   if (log->write(iov, n+1))
+      {
+      if (slot[0]) *slot[0] = r.uri;
+      if (slot[1]) *slot[1] = r.referer;
+      if (slot[2]) *slot[2] = r.agent;
+      }
+}
@@ -21,7 +21,7 @@ bool                          UHTTP2::bcontinue100;
 bool                          UHTTP2::bsetting_ack;
 bool                          UHTTP2::bsetting_send;
 bool                          UHTTP2::priority_exclusive;
-uint8_t                       UHTTP2::priority_weight;     // 0 if not set
+uint16_t                      UHTTP2::priority_weight;     // 0 if not set
 uint32_t                      UHTTP2::priority_dependency; // 0 if not set
 uint32_t                      UHTTP2::hash_static_table[61];
 uint32_t                      UHTTP2::wait_for_continuation;
@@ -31,6 +31,8 @@ UHTTP2::Stream*               UHTTP2::pStreamEnd;
 UHTTP2::FrameHeader           UHTTP2::frame;
 UHTTP2::Connection*           UHTTP2::vConnection;
 UHTTP2::Connection*           UHTTP2::pConnection;
+uint32_t                      UHTTP2::nStreamFree[HTTP2_STREAM_TABLE_CLASS];
+UHTTP2::Stream*               UHTTP2::vStreamFree[HTTP2_STREAM_TABLE_CLASS][HTTP2_STREAM_TABLE_FREE];
 UHTTP2::HpackHeaderTableEntry UHTTP2::hpack_static_table[61];
 
 #define U_HTTP2_TIMEOUT_MS (10L * 1000L) // 10 second timeout
@@ -143,7 +145,11 @@ UHTTP2::Connection::Connection() : itable(64, setIndexStaticTable)
    odyntbl.hpack_capacity     =
    odyntbl.hpack_max_capacity = 4096;
 
-   for (uint32_t i = 0; i < HTTP2_MAX_CONCURRENT_STREAMS; ++i) (void) U_SYSCALL(memset, "%p,%d,%u", &(streams[i].id), 0, sizeof(uint32_t) * 3);
+   streams          = U_NULLPTR; // NB: the stream table is allocated on the first request (see initRequest())...
+   wfile            = U_NULLPTR;
+   streams_capacity =
+   npending         =
+   wflen            = 0;
 
 #ifdef DEBUG
    (void) memset(&ddyntbl, 0, sizeof(HpackDynamicTable));
@@ -371,8 +377,16 @@ void UHTTP2::updateSetting(unsigned char* ptr, uint32_t len)
                return;
                }
 
-            pConnection->out_window                        =
+            // NB: the change of the initial window size apply to the send windows of all the streams (not to the window of the connection)...
+
+            int32_t delta = (int32_t)value - (int32_t)pConnection->peer_settings.initial_window_size;
+
             pConnection->peer_settings.initial_window_size = value;
+
+            for (Stream* pstr = pConnection->streams, *end = pstr+pConnection->streams_capacity; pstr < end; ++pstr)
+               {
+               if (pstr->id) pstr->out_window += delta;
+               }
             }
          break;
 
@@ -1069,6 +1083,8 @@ check1:
                }
             }
 
+         name.intern(false); // NB: only lookup, the names come from the client (it must not fill the table)...
+
          UHashMap<void*>::lhash = name.hashIgnoreCase();
 
          goto insert;
@@ -1871,6 +1887,14 @@ void UHTTP2::decodeHeaders()
             }
          }
 
+      // RFC 9218: the priority header field (ex: priority: u=1, i) take precedence over the weight of RFC 7540...
+
+      UHashMap<void*>::lhash = u_hash_ignore_case((unsigned char*)U_CONSTANT_TO_PARAM("priority"));
+
+      UString value = table->at(U_CONSTANT_TO_PARAM("priority"));
+
+      if (value) setPriority(pStream, U_STRING_TO_PARAM(value));
+
       U_INTERNAL_DUMP("Host            = %.*S", U_HTTP_HOST_TO_TRACE)
       U_INTERNAL_DUMP("Range           = %.*S", U_HTTP_RANGE_TO_TRACE)
       U_INTERNAL_DUMP("Accept          = %.*S", U_HTTP_ACCEPT_TO_TRACE)
@@ -1938,8 +1962,6 @@ void UHTTP2::manageHeaders()
          return;
          }
 
-      // TODO: implement priority for http2
-
       sz  -= 5;
       ptr += 5;
       }
@@ -2002,6 +2024,128 @@ next:
    wait_for_continuation = frame.stream_id;
 }
 
+/**
+ * The stream table of a connection is allocated on the first request with HTTP2_STREAM_TABLE_MIN entries and grows by doubling up to
+ * HTTP2_MAX_CONCURRENT_STREAMS, when the connection is closed the table is given back to the free tables of the process, so the memory
+ * used for the streams depends on the connections really active and not on UNotifier::max_connection
+ */
+
+U_NO_EXPORT UHTTP2::Stream* UHTTP2::newStreamTable(uint32_t capacity)
+{
+   U_TRACE(0, "UHTTP2::newStreamTable(%u)", capacity)
+
+   U_INTERNAL_ASSERT_RANGE(HTTP2_STREAM_TABLE_MIN, capacity, HTTP2_MAX_CONCURRENT_STREAMS)
+
+   uint32_t i = 0;
+
+   for (uint32_t n = HTTP2_STREAM_TABLE_MIN; n < capacity; n <<= 1) ++i;
+
+   U_INTERNAL_DUMP("nStreamFree[%u] = %u", i, nStreamFree[i])
+
+   Stream* table;
+
+   if (nStreamFree[i]) table = vStreamFree[i][--nStreamFree[i]];
+   else
+      {
+      table = new Stream[capacity];
+
+      for (Stream* end = table+capacity, *ptr = table; ptr < end; ++ptr)
+         {
+         ptr->sclose = false; // NB: resetStream() check it...
+
+         resetStream(ptr);
+         }
+      }
+
+   U_RETURN_POINTER(table, Stream);
+}
+
+U_NO_EXPORT void UHTTP2::deleteStreamTable(Stream* table, uint32_t capacity)
+{
+   U_TRACE(0, "UHTTP2::deleteStreamTable(%p,%u)", table, capacity)
+
+   U_INTERNAL_ASSERT_POINTER(table)
+
+   uint32_t i = 0;
+
+   for (uint32_t n = HTTP2_STREAM_TABLE_MIN; n < capacity; n <<= 1) ++i;
+
+   U_INTERNAL_DUMP("nStreamFree[%u] = %u", i, nStreamFree[i])
+
+   for (Stream* end = table+capacity, *ptr = table; ptr < end; ++ptr) resetStream(ptr);
+
+   if (nStreamFree[i] == HTTP2_STREAM_TABLE_FREE)
+      {
+      delete[] table;
+
+      return;
+      }
+
+   vStreamFree[i][nStreamFree[i]++] = table;
+}
+
+void UHTTP2::growStreamTable()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP2::growStreamTable()")
+
+   U_INTERNAL_DUMP("pConnection->streams_capacity = %u", pConnection->streams_capacity)
+
+   U_INTERNAL_ASSERT_MINOR(pConnection->streams_capacity, HTTP2_MAX_CONCURRENT_STREAMS)
+
+   uint32_t capacity = pConnection->streams_capacity,
+            idx_cur  = pStream    - pConnection->streams,
+            idx_end  = pStreamEnd - pConnection->streams;
+
+   Stream* table = newStreamTable(capacity * 2);
+
+   for (uint32_t i = 0; i < capacity; ++i)
+      {
+      Stream* src = pConnection->streams+i;
+      Stream* dst = table+i;
+
+      dst->body.swap(src->body);
+      dst->wbody.swap(src->wbody);
+      dst->headers.swap(src->headers);
+
+      dst->id          = src->id;
+      dst->state       = src->state;
+      dst->clength     = src->clength;
+      dst->woffset     = src->woffset;
+      dst->soffset     = src->soffset;
+      dst->scount      = src->scount;
+      dst->sfd         = src->sfd;
+      dst->sclose      = src->sclose;
+      dst->out_window  = src->out_window;
+      dst->urgency     = src->urgency;
+      dst->incremental = src->incremental;
+
+      src->sclose = false; // NB: the file now belongs to the new table, deleteStreamTable() must not close it...
+      }
+
+   if (pConnection->wfile) pConnection->wfile = table + (pConnection->wfile - pConnection->streams);
+
+   deleteStreamTable(pConnection->streams, capacity);
+
+   pConnection->streams          = table;
+   pConnection->streams_capacity = capacity * 2;
+
+   pStream    = table + idx_cur;
+   pStreamEnd = table + idx_end;
+}
+
+void UHTTP2::releaseStreamTable()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP2::releaseStreamTable()")
+
+   if (pConnection->streams)
+      {
+      deleteStreamTable(pConnection->streams, pConnection->streams_capacity);
+
+      pConnection->streams          = U_NULLPTR;
+      pConnection->streams_capacity = 0;
+      }
+}
+
 void UHTTP2::setStream()
 {
    U_TRACE_NO_PARAM(0, "UHTTP2::setStream()")
@@ -2039,7 +2183,10 @@ manage_headers:
 
       if (nerror == NO_ERROR)
          {
-         pStream->id = frame.stream_id;
+         pStream->id          = frame.stream_id;
+         pStream->out_window  = pConnection->peer_settings.initial_window_size;
+         pStream->urgency     = getUrgency();
+         pStream->incremental = false;
 
          if (pConnection->max_processed_stream_id < frame.stream_id) pConnection->max_processed_stream_id = frame.stream_id;
          }
@@ -2051,13 +2198,18 @@ manage_headers:
       {
       // Ex: frame.stream_id = 5 pConnection->max_processed_stream_id = 3 pStream->id = 1 pStream->state = (2, STREAM_STATE_HALF_CLOSED)
 
-      if ((pStream = ++pStreamEnd) >= (pConnection->streams+HTTP2_MAX_CONCURRENT_STREAMS))
+      if ((pStream = ++pStreamEnd) >= (pConnection->streams+pConnection->streams_capacity))
          {
-         pStream = --pStreamEnd;
+         if (pConnection->streams_capacity == HTTP2_MAX_CONCURRENT_STREAMS)
+            {
+            pStream = --pStreamEnd;
 
-         nerror = REFUSED_STREAM;
+            nerror = REFUSED_STREAM;
 
-         return;
+            return;
+            }
+
+         growStreamTable();
          }
 
       goto manage_headers;
@@ -2161,7 +2313,25 @@ loop:
 
    if (frame.type > CONTINUATION)
       {
-      if (wait_for_continuation == 0) goto ret; // The endpoint MUST discard frames that have unknown or unsupported types
+      if (wait_for_continuation == 0)
+         {
+         if (frame.type == PRIORITY_UPDATE) // RFC 9218: the prioritized stream ID (4 bytes) followed by the priority field value
+            {
+            if (frame.stream_id ||
+                frame.length < 4)
+               {
+               nerror = PROTOCOL_ERROR;
+
+               goto end;
+               }
+
+            Stream* pstr = findStream(u_http2_parse_sid(frame.payload));
+
+            if (pstr) setPriority(pstr, (const char*)frame.payload+4, frame.length-4);
+            }
+
+         goto ret; // The endpoint MUST discard frames that have unknown or unsupported types
+         }
 
       nerror = PROTOCOL_ERROR;
 
@@ -2270,7 +2440,9 @@ window_update:
 
          uint32_t window_size_increment = u_http2_parse_window(frame.payload);
 
-         U_INTERNAL_DUMP("pConnection->out_window = %d window_size_increment = %u", pConnection->out_window, window_size_increment)
+         int32_t* pwindow = (frame.stream_id ? &(pStream->out_window) : &(pConnection->out_window));
+
+         U_INTERNAL_DUMP("frame.stream_id = %u out_window = %d window_size_increment = %u", frame.stream_id, *pwindow, window_size_increment)
 
          if (window_size_increment == 0)
             {
@@ -2279,14 +2451,14 @@ window_update:
             goto end;
             }
 
-         if ((pConnection->out_window + window_size_increment) > HTTP2_MAX_WINDOW_SIZE)
+         if (((int64_t)*pwindow + window_size_increment) > HTTP2_MAX_WINDOW_SIZE)
             {
             nerror = FLOW_CONTROL_ERROR;
 
             goto end;
             }
 
-         if (frame.stream_id) pConnection->out_window += window_size_increment;
+         *pwindow += window_size_increment;
 
          goto ret;
          }
@@ -2353,7 +2525,9 @@ window_update:
 
          if (nerror == NO_ERROR)
             {
-            // TODO: implement priority for http2
+            Stream* pstr = findStream(frame.stream_id); // NB: the PRIORITY frame can be for a stream in any state (also idle)...
+
+            if (pstr) pstr->urgency = getUrgency();
 
             goto ret;
             }
@@ -2469,11 +2643,7 @@ ret:
    U_INTERNAL_DUMP("pConnection->out_window = %d UClientImage_Base::rbuffer->size() = %u UClientImage_Base::rstart = %u",
                     pConnection->out_window,     UClientImage_Base::rbuffer->size(),     UClientImage_Base::rstart)
 
-   if (pConnection->out_window == 0 ||
-       UClientImage_Base::rbuffer->size() > UClientImage_Base::rstart)
-      {
-      goto loop;
-      }
+   if (UClientImage_Base::rbuffer->size() > UClientImage_Base::rstart) goto loop;
 }
 
 unsigned char* UHTTP2::hpackEncodeHeader(unsigned char* dst, const UString& name, const UString& value)
@@ -2694,7 +2864,7 @@ void UHTTP2::handlerResponse()
       ULog::updateDate3(U_NULLPTR);
 #  endif
 
-      UString date((void*)(((char*)UClientImage_Base::iov_vec[1].iov_base)+6), 29);
+      UString date((void*)(((char*)UClientImage_Base::iov_vec[1].iov_base)+17+6), 29); // HTTP/1.1 200 OK\r\nDate: Wed, 20 Jun 2012 11:43:17 GMT
 
       /**
        * dst = hpackEncodeInt(dst, 54, (1<<6)-1, 0x40);
@@ -2795,254 +2965,495 @@ void UHTTP2::handlerResponse()
    U_INTERNAL_ASSERT_MINOR(UClientImage_Base::wbuffer->size(), pConnection->peer_settings.max_frame_size)
 }
 
-void UHTTP2::writeData(struct iovec* iov, bool bdata, bool flag)
+void UHTTP2::writeResponse()
 {
-   U_TRACE(0, "UHTTP2::writeData(%p,%b,%b)", iov, bdata, flag)
+   U_TRACE_NO_PARAM(0, "UHTTP2::writeResponse()")
 
-   char* ptr               = (char*)iov[3].iov_base;
-   char* ptr2              = (char*)iov[2].iov_base;
-   uint32_t sz1            =        iov[1].iov_len,
-            sz2            =        iov[3].iov_len,
-            max_frame_size = pConnection->peer_settings.max_frame_size;
+   U_INTERNAL_ASSERT_DIFFERS(U_ClientImage_parallelization, U_PARALLELIZATION_PARENT)
 
-   if (sz2 <= max_frame_size)
-      {
-      u_http2_write_len_and_type(ptr2,sz2,DATA);
+   UClientImage_Base* pclient = UServer_Base::pClientImage;
 
-      ptr2[4] = flag;
+   off_t file_sz = pclient->count; // NB: the body of the response can be a range of a file to send with sendfile() (see UHTTP::setSendfile())...
 
-      if (bdata) (void) writev(iov,   4, HTTP2_FRAME_HEADER_SIZE+sz1+HTTP2_FRAME_HEADER_SIZE+sz2);
-      else       (void) writev(iov+2, 2,                             HTTP2_FRAME_HEADER_SIZE+sz2);
+   if (UHTTP::isHEAD())
+      {
+      file_sz = 0;
 
-      return;
+      UClientImage_Base::body->clear();
       }
 
-   u_http2_write_len_and_type(ptr2,max_frame_size,DATA);
+   char* ptr0 = UClientImage_Base::wbuffer->data();
+
+   uint32_t sz0     = UClientImage_Base::wbuffer->size(),
+            body_sz = UClientImage_Base::body->size();
+
+   U_INTERNAL_DUMP("UClientImage_Base::wbuffer(%u) = %V", sz0, UClientImage_Base::wbuffer->rep)
+
+   U_INTERNAL_ASSERT(*UClientImage_Base::wbuffer)
+
+   U_SRV_LOG_WITH_ADDR("send response (%s,id:%u,bytes:%I) %#.*S to", pConnection->bug_client ? pConnection->bug_client : "HTTP2",
+                           pStream->id, sz0+HTTP2_FRAME_HEADER_SIZE+(body_sz+file_sz ? body_sz+file_sz+HTTP2_FRAME_HEADER_SIZE : 0), sz0, ptr0);
+
+   /**
+    * NB: the response is not written here, the HEADERS frame is appended to the frames of the connection not yet sent (they must be
+    * sent in the order of the encoding because of the hpack dynamic table) and the body is kept by the stream, then sendResponses()
+    * interleaves the DATA frames of all the streams with a response...
+    */
+
+   (void) pConnection->wheaders.reserve(HTTP2_FRAME_HEADER_SIZE + sz0);
+
+   char* ptr = pConnection->wheaders.pend();
 
-   ptr2[4] = 0;
+   u_http2_write_len_and_type(ptr,sz0,HEADERS);
 
-   iov[3].iov_len = max_frame_size;
+   ptr[4] = FLAG_END_HEADERS | (body_sz == 0 && file_sz == 0); // FLAG_END_STREAM (1)
 
-   if (pConnection->bug_client)
+   u_write_unalignedp32(ptr+5,pStream->id);
+
+   U_MEMCPY(ptr+HTTP2_FRAME_HEADER_SIZE, ptr0, sz0);
+
+   pConnection->wheaders.size_adjust(ptr+HTTP2_FRAME_HEADER_SIZE+sz0);
+
+   if (body_sz)
       {
-      if (bdata) (void) writev(iov,   4, HTTP2_FRAME_HEADER_SIZE+sz1+HTTP2_FRAME_HEADER_SIZE+max_frame_size);
-      else       (void) writev(iov+2, 2,                             HTTP2_FRAME_HEADER_SIZE+max_frame_size);
+      U_ASSERT(pStream->wbody.empty())
 
-      U_INTERNAL_DUMP("nerror = %u", nerror)
+      pStream->wbody   = *UClientImage_Base::body;
+      pStream->woffset = 0;
 
-      if (nerror != NO_ERROR) return;
+      pConnection->npending++;
+      }
+   else if (file_sz)
+      {
+      U_INTERNAL_ASSERT_EQUALS(pStream->sfd, -1)
+      U_INTERNAL_ASSERT_DIFFERS(pclient->sfd, -1)
 
-loop1:
-      iov[2].iov_len  = HTTP2_FRAME_HEADER_SIZE;
-      iov[3].iov_base = (ptr += max_frame_size);
-                         sz2 -= max_frame_size;
+      pStream->sfd     = pclient->sfd;
+      pStream->soffset = pclient->offset;
+      pStream->scount  = file_sz;
+      pStream->sclose  = ((U_ClientImage_pclose(pclient) & U_CLOSE) != 0);
 
-      U_INTERNAL_DUMP("pConnection->peer_settings.max_frame_size = %u sz2 = %u", max_frame_size, sz2)
+      pConnection->npending++;
+      }
 
-      if (sz2 > max_frame_size)
+   if (pclient->count) // NB: the file now belongs to the stream (or it is not sent for HEAD)...
+      {
+      if (file_sz == 0 &&
+          (U_ClientImage_pclose(pclient) & U_CLOSE) != 0)
          {
-         u_http2_write_len_and_type(ptr2,max_frame_size,DATA);
+         UFile::close(pclient->sfd);
+         }
+
+      U_ClientImage_pclose(pclient) &= ~U_CLOSE;
 
-         ptr2[4] = 0;
+      pclient->offset =
+      pclient->count  = 0;
+      pclient->sfd    = -1;
+      }
+}
 
-         iov[3].iov_len = max_frame_size;
+void UHTTP2::setPriority(Stream* ptr, const char* s, uint32_t len)
+{
+   U_TRACE(0, "UHTTP2::setPriority(%p,%.*S,%u)", ptr, len, s, len)
+
+   // RFC 9218: the priority field value is a dictionary (ex: u=5, i) where u is the urgency (0-7) and i is the incremental flag
+
+   for (const char* end = s + len; s < end; ++s)
+      {
+      while (s < end && (*s == ',' || u__isspace(*s))) ++s;
 
-         if (writev(iov+2, 2, HTTP2_FRAME_HEADER_SIZE+max_frame_size) == false) return;
+      uint32_t n = (end - s);
 
-         goto loop1;
+      if (n >= 3    &&
+          s[0] == 'u' &&
+          s[1] == '=' &&
+          s[2] >= '0' &&
+          s[2] <= '7' &&
+          (n == 3 || u__isdigit(s[3]) == false))
+         {
+         ptr->urgency = s[2] - '0';
+         }
+      else if (n >= 1 &&
+               s[0] == 'i')
+         {
+              if (n == 1 || s[1] == ',' || s[1] == ';' || u__isspace(s[1])) ptr->incremental = true;
+         else if (n >= 4 && s[1] == '=' && s[2] == '?')                      ptr->incremental = (s[3] == '1');
          }
 
-      u_http2_write_len_and_type(ptr2,sz2,DATA);
+      while (s < end && *s != ',') ++s;
+      }
 
-      ptr2[4] = flag;
+   U_INTERNAL_DUMP("ptr->id = %u ptr->urgency = %u ptr->incremental = %b", ptr->id, ptr->urgency, ptr->incremental)
+}
 
-      iov[3].iov_len = sz2;
+U_NO_EXPORT bool UHTTP2::addDataFrame(Stream* ptr, struct iovec* iov, uint32_t& iovcnt, uint32_t& count, char* hdr, uint32_t iovmax, DataFrame* vframe, uint32_t& nframe, uint32_t& nfile)
+{
+   U_TRACE(0, "UHTTP2::addDataFrame(%p,%p,%u,%u,%p,%u,%p,%u,%u)", ptr, iov, iovcnt, count, hdr, iovmax, vframe, nframe, nfile)
 
-      (void) writev(iov+2, 2, HTTP2_FRAME_HEADER_SIZE+sz2);
+   off_t rest     = (ptr->sfd == -1 ? (off_t)(ptr->wbody.size() - ptr->woffset) : ptr->scount);
+   int32_t window = (ptr->out_window < pConnection->out_window ? ptr->out_window : pConnection->out_window);
 
-      return;
+   U_INTERNAL_DUMP("ptr->id = %u rest = %I ptr->out_window = %d pConnection->out_window = %d", ptr->id, rest, ptr->out_window, pConnection->out_window)
+
+   if (rest == 0           ||
+       window <= 0         ||
+       (iovcnt + 2) > iovmax ||
+       nframe == HTTP2_FRAME_MAX ||
+       (nfile &&
+        (nfile == HTTP2_SENDFILE_MAX ||
+         pConnection->bug_client)))
+      {
+      U_RETURN(false);
       }
 
-   U_DEBUG("UHTTP2::writeData(%p,%b,%b) - User-Agent: = %.*S", iov, bdata, flag, U_HTTP_USER_AGENT_TO_TRACE)
+   uint32_t len = (rest > window ? window : rest);
 
-   uint32_t iovcnt, count;
-   struct iovec iov_vec[1024];
+   if (len > pConnection->peer_settings.max_frame_size) len = pConnection->peer_settings.max_frame_size;
 
-   if (bdata)
+   hdr += nframe * HTTP2_FRAME_HEADER_SIZE;
+
+   u_http2_write_len_and_type(hdr,len,DATA);
+
+   hdr[4] = (rest == len); // FLAG_END_STREAM (1)
+
+   u_write_unalignedp32(hdr+5,ptr->id);
+
+   iov[iovcnt].iov_base = (caddr_t)hdr;
+   iov[iovcnt].iov_len  = HTTP2_FRAME_HEADER_SIZE;
+
+   if (ptr->sfd != -1)
       {
-      U_MEMCPY(iov_vec, iov, sizeof(struct iovec) * (iovcnt = 4));
+      // the payload is sent by sendResponses() with sendfile() after the writev() of the frames before it
+
+      iovcnt += 1;
+      count  += HTTP2_FRAME_HEADER_SIZE;
 
-      count = HTTP2_FRAME_HEADER_SIZE+sz1+HTTP2_FRAME_HEADER_SIZE+max_frame_size;
+      ptr->scount -= len;
+
+      ++nfile;
       }
    else
       {
-      U_MEMCPY(iov_vec, iov+2, sizeof(struct iovec) * (iovcnt = 2));
+      iov[iovcnt+1].iov_base = (caddr_t)ptr->wbody.c_pointer(ptr->woffset);
+      iov[iovcnt+1].iov_len  = len;
+
+      iovcnt += 2;
+      count  += HTTP2_FRAME_HEADER_SIZE + len;
 
-      count = HTTP2_FRAME_HEADER_SIZE+max_frame_size;
+      ptr->woffset += len;
       }
 
-loop2:
-   ptr += max_frame_size;
+   ptr->out_window         -= len;
+   pConnection->out_window -= len;
 
-   if ((sz2 -= max_frame_size) > max_frame_size)
-      {
-      U_MEMCPY(iov_vec+iovcnt, iov+2, sizeof(struct iovec) * 2);
+   // NB: if the socket is not writable (EAGAIN) the frames of the round not yet started are given back to their streams (see savePending())...
 
-      ++iovcnt;
+   vframe[nframe].ptr    = ptr;
+   vframe[nframe].iovcnt = iovcnt;
+   vframe[nframe].count  = count;
+   vframe[nframe].len    = len;
+   vframe[nframe].bfile  = (ptr->sfd != -1);
 
-                               iov_vec[iovcnt].iov_base = ptr;
-      U_INTERNAL_ASSERT_EQUALS(iov_vec[iovcnt].iov_len, max_frame_size)
+   ++nframe;
 
-      ++iovcnt;
+   U_RETURN(true);
+}
 
-      U_INTERNAL_ASSERT_MINOR(iovcnt, 1024)
+/**
+ * The scheduler of the responses (RFC 9218 extensible priorities): first the HEADERS frames not yet sent, then the DATA frames of the
+ * streams in order of urgency. With the same urgency the non incremental responses are sent one by one in order of stream id and the
+ * incremental responses share the bandwidth (a frame for stream in round robin). A DATA frame is limited by the send window of the
+ * stream and of the connection, a stream without window is skipped so it doesn't block the others. The frames are coalesced in a writev()
+ * of max HTTP2_WRITEV_MAX iovec (one frame for write for the client in the list of bug client). The payload of a DATA frame of a file
+ * (response too big for the cache of the memory) is not copied: it is sent with sendfile() after the writev() of the frames before it
+ * (that end with the header of the frame), for max HTTP2_SENDFILE_MAX frames for round (so the consecutive frames of a file don't need
+ * a round each) with the socket corked to avoid small TCP segments.
+ *
+ * We never wait here: when no stream can send for lack of window we return to the event loop (the WINDOW_UPDATE frames are read as the
+ * other frames, see handlerRequest()) and when the socket is not writable (EAGAIN) the part of the round already started is saved in the
+ * connection, we wait for EPOLLOUT and the responses are resumed by handlerWrite()...
+ */
+
+U_NO_EXPORT bool UHTTP2::writePending()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP2::writePending()")
 
-      count += HTTP2_FRAME_HEADER_SIZE+max_frame_size;
+   uint32_t n, sz = pConnection->wpending.size();
 
-      goto loop2;
-      }
+   if (sz)
+      {
+      struct iovec iov[1] = { { (caddr_t)pConnection->wpending.data(), sz } };
 
-   iov_vec[iovcnt] = iov[2];
+      if ((n = writev(iov, 1, sz)) < sz)
+         {
+         if (n) pConnection->wpending.moveToBeginDataInBuffer(n);
 
-   ++iovcnt;
+         U_RETURN(false);
+         }
 
-   iov_vec[iovcnt].iov_len  = sz2;
-   iov_vec[iovcnt].iov_base = ptr;
+      pConnection->wpending.setEmpty();
+      }
 
-   ++iovcnt;
+   if (pConnection->wflen)
+      {
+      U_INTERNAL_ASSERT_POINTER(pConnection->wfile)
 
-   U_INTERNAL_ASSERT_MINOR(iovcnt, 1024)
+      if ((pConnection->wflen -= sendfile(pConnection->wfile, pConnection->wflen))) U_RETURN(false);
 
-   count += HTTP2_FRAME_HEADER_SIZE+sz2;
+      pConnection->wfile = U_NULLPTR;
+      }
 
-   (void) writev(iov_vec, iovcnt, count);
+   U_RETURN(true);
 }
 
-void UHTTP2::writeResponse()
+U_NO_EXPORT void UHTTP2::savePending(struct iovec* iov, DataFrame* vframe, uint32_t nframe, uint32_t k, uint32_t sent, uint32_t fsent)
 {
-   U_TRACE_NO_PARAM(0, "UHTTP2::writeResponse()")
+   U_TRACE(0, "UHTTP2::savePending(%p,%p,%u,%u,%u,%u)", iov, vframe, nframe, k, sent, fsent)
 
-   U_INTERNAL_ASSERT_DIFFERS(U_ClientImage_parallelization, U_PARALLELIZATION_PARENT)
+   Stream* ptr;
+   uint32_t i, n, len, to = (k < nframe ? vframe[k].count : pConnection->wheaders.size()); // NB: k == nframe => only HEADERS frames...
 
-   char buffer1[HTTP2_FRAME_HEADER_SIZE];
-   char buffer2[HTTP2_FRAME_HEADER_SIZE];
+   U_INTERNAL_ASSERT(sent <= to)
 
-   if (UHTTP::isHEAD()) UClientImage_Base::body->clear();
+   // the bytes of the frame k (where we stop) and of the HEADERS frames not yet written are saved, so we have always something to wait for
 
-   char* ptr  = UClientImage_Base::body->data();
-   char* ptr0 = UClientImage_Base::wbuffer->data();
-   char* ptr1 = buffer1;
+   for (i = n = 0; n < to; n += iov[i++].iov_len)
+      {
+      if ((n + iov[i].iov_len) > sent)
+         {
+         len = (to < (n + iov[i].iov_len) ? to - n : iov[i].iov_len);
 
-   uint32_t sz0     = UClientImage_Base::wbuffer->size(),
-            body_sz = UClientImage_Base::body->size();
+         if (sent > n) (void) pConnection->wpending.append((const char*)iov[i].iov_base + (sent - n), len - (sent - n));
+         else          (void) pConnection->wpending.append((const char*)iov[i].iov_base,              len);
+         }
+      }
 
-   struct iovec iov_vec[4] = { { (caddr_t)buffer1, HTTP2_FRAME_HEADER_SIZE },
-                               { (caddr_t)ptr0, sz0 },
-                               { (caddr_t)buffer2, HTTP2_FRAME_HEADER_SIZE },
-                               { (caddr_t)ptr, body_sz } };
+   pConnection->wheaders.setEmpty();
 
-   U_INTERNAL_DUMP("UClientImage_Base::wbuffer(%u) = %V", sz0, UClientImage_Base::wbuffer->rep)
+   if (k < nframe)
+      {
+      if (vframe[k].bfile)
+         {
+         pConnection->wfile = vframe[k].ptr;
+         pConnection->wflen = vframe[k].len - fsent;
+         }
 
-   U_INTERNAL_ASSERT(*UClientImage_Base::wbuffer)
+      ++k;
+      }
 
-   u_http2_write_len_and_type(ptr1,sz0,HEADERS);
+   // the frames not yet started are given back to their streams (they are sent again by the next round)
 
-   ptr1[4] = FLAG_END_HEADERS | (body_sz == 0); // FLAG_END_STREAM (1)
+   for (; k < nframe; ++k)
+      {
+      ptr = vframe[k].ptr;
+      len = vframe[k].len;
 
-   u_write_unalignedp32(ptr1+5,pStream->id);
+      if (vframe[k].bfile) ptr->scount  += len;
+      else                 ptr->woffset -= len;
 
-   U_SRV_LOG_WITH_ADDR("send response (%s,id:%u,bytes:%u) %#.*S to", pConnection->bug_client ? pConnection->bug_client : "HTTP2",
-                           pStream->id, sz0+HTTP2_FRAME_HEADER_SIZE+(body_sz ? body_sz+HTTP2_FRAME_HEADER_SIZE : 0), sz0, ptr0);
+      ptr->out_window         += len;
+      pConnection->out_window += len;
+      }
 
-   if (body_sz == 0)
-      {
-#  ifdef DEBUG
-   // decodeHeadersResponse(ptr0, sz0);
-#  endif
+   U_SRV_LOG("partial write: (remain %u bytes, %u of the payload of a file) - waiting for the socket to be writable - sock_fd %u",
+               pConnection->wpending.size(), pConnection->wflen, UServer_Base::csocket->iSockDesc);
+}
 
-      (void) writev(iov_vec, 2, HTTP2_FRAME_HEADER_SIZE+sz0);
+void UHTTP2::sendResponses()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP2::sendResponses()")
 
-      return;
-      }
+   U_INTERNAL_ASSERT_EQUALS(nerror, NO_ERROR)
 
-   U_INTERNAL_ASSERT_MAJOR(body_sz, 0)
+   Stream* ptr;
+   Stream* end;
+   uint8_t urgency;
+   bool bcork = false, bprogress;
+   struct iovec iov[HTTP2_WRITEV_MAX];
+   DataFrame vframe[HTTP2_FRAME_MAX];
+   char hdr[HTTP2_FRAME_MAX * HTTP2_FRAME_HEADER_SIZE];
+   uint32_t i, k, n, iovcnt, count, nframe, nfile, start, sent, fsent, iovmax = (pConnection->bug_client ? 3 : HTTP2_WRITEV_MAX);
 
-   char* ptr2 = buffer2;
+   if (writePending() == false) goto done; // NB: the write of the round before is not yet completed...
 
-   u_write_unalignedp32(ptr2+5,pStream->id);
+loop:
+   end = pConnection->streams + pConnection->streams_capacity;
 
-   if ((uint32_t)pConnection->out_window >= body_sz)
+   U_INTERNAL_DUMP("pConnection->wheaders(%u) = %V pConnection->npending = %u pConnection->out_window = %d",
+                    pConnection->wheaders.size(), pConnection->wheaders.rep, pConnection->npending, pConnection->out_window)
+
+   if (pConnection->npending)
       {
-      pConnection->out_window -= body_sz;
+      for (ptr = pConnection->streams; ptr < end; ++ptr)
+         {
+         if (ptr->wbody &&
+             (ptr->state == STREAM_STATE_CLOSED || // NB: RST_STREAM...
+              ptr->woffset == ptr->wbody.size()))
+            {
+            ptr->wbody.clear();
 
-      writeData(iov_vec, true, FLAG_END_STREAM);
+            ptr->woffset = 0;
 
-      return;
+            pConnection->npending--;
+            }
+         else if (ptr->sfd != -1 &&
+                  (ptr->state == STREAM_STATE_CLOSED ||
+                   ptr->scount == 0))
+            {
+            if (ptr->sclose) UFile::close(ptr->sfd);
+
+            ptr->soffset =
+            ptr->scount  = 0;
+            ptr->sfd     = -1;
+            ptr->sclose  = false;
+
+            pConnection->npending--;
+            }
+         }
       }
 
-   U_DEBUG("Current window size (%d) is not sufficient for data size: %u", pConnection->out_window, body_sz)
+   iovcnt =
+   count  =
+   nframe =
+   nfile  = 0;
+
+   if (pConnection->wheaders)
+      {
+      iov[0].iov_base = (caddr_t)pConnection->wheaders.data();
+      iov[0].iov_len  = count = pConnection->wheaders.size();
 
-   U_SRV_LOG("WARNING: Current window size (%d) is not sufficient for data size: %u", pConnection->out_window, body_sz);
+      iovcnt = 1;
+      }
 
-   if (pConnection->out_window == 0)
+   if (pConnection->npending)
       {
-      if (writev(iov_vec, 2, HTTP2_FRAME_HEADER_SIZE+sz0) == false) return;
+      for (urgency = 0; urgency <= 7; ++urgency)
+         {
+         for (ptr = pConnection->streams; ptr < end; ++ptr)
+            {
+            if (ptr->urgency == urgency &&
+                ptr->incremental == false)
+               {
+               while (addDataFrame(ptr, iov, iovcnt, count, hdr, iovmax, vframe, nframe, nfile)) {}
+               }
+            }
+
+         do {
+            bprogress = false;
+
+            for (ptr = pConnection->streams; ptr < end; ++ptr)
+               {
+               if (ptr->urgency == urgency &&
+                   ptr->incremental        &&
+                   addDataFrame(ptr, iov, iovcnt, count, hdr, iovmax, vframe, nframe, nfile))
+                  {
+                  bprogress = true;
+                  }
+               }
+            }
+         while (bprogress);
+         }
       }
-   else
+
+   if (count)
       {
-      ptr               += pConnection->out_window;
-      body_sz           -= pConnection->out_window;
-      iov_vec[3].iov_len = pConnection->out_window;
-                           pConnection->out_window = 0;
+      if (nfile &&
+          bcork == false)
+         {
+         bcork = true;
 
-      writeData(iov_vec, true, false);
+         USocket::setTcpCork(UServer_Base::csocket, 1U);
+         }
 
-      U_INTERNAL_DUMP("nerror = %u", nerror)
+      for (i = start = sent = 0; i < nframe; ++i)
+         {
+         if (vframe[i].bfile)
+            {
+            if ((n = writev(iov+start, vframe[i].iovcnt-start, vframe[i].count-sent)) < (vframe[i].count-sent))
+               {
+               sent += n;
 
-      if (nerror != NO_ERROR) return;
+               goto write_blocked;
+               }
+
+            start = vframe[i].iovcnt;
+            sent  = vframe[i].count;
+
+            if ((fsent = sendfile(vframe[i].ptr, vframe[i].len)) < vframe[i].len)
+               {
+               k = i;
+
+               goto blocked;
+               }
+            }
+         }
+
+      if (start < iovcnt)
+         {
+         if ((n = writev(iov+start, iovcnt-start, count-sent)) < (count-sent))
+            {
+            sent += n;
+
+            goto write_blocked;
+            }
+         }
+
+      if (pConnection->wheaders) pConnection->wheaders.setEmpty();
+
+      goto loop;
       }
 
-   // we must wait for a Window Update frame if the current window size is not sufficient...
+   if (pConnection->npending) U_SRV_LOG("WARNING: Current window size (%d) is not sufficient for the responses not yet sent: %u", pConnection->out_window, pConnection->npending);
 
-   Stream* pStreamOld = pStream;
+   goto done;
 
-loop:
-   readFrame();
+write_blocked: // NB: the frames before the byte where we stop are written (and the payload of the files between them is sent)...
+   for (k = 0; k < nframe && vframe[k].count <= sent; ++k) {}
 
-   U_INTERNAL_DUMP("nerror = %u", nerror)
+   fsent = 0;
 
-   if (nerror == NO_ERROR)
+blocked:
+   if (nerror == NO_ERROR) savePending(iov, vframe, nframe, k, sent, fsent);
+
+done:
+   if (bcork &&
+       UServer_Base::csocket->isOpen())
       {
-      if (pConnection->out_window == 0) goto loop;
+      USocket::setTcpCork(UServer_Base::csocket, 0U); // NB: flush the frames...
+      }
 
-      U_INTERNAL_DUMP("pStreamOld = %u pStream = %u", pStreamOld, pStream)
+   // NB: while we wait for the socket to be writable we don't read other frames (as with a pending sendfile of HTTP/1.1)...
 
-      pStream = pStreamOld;
+   if (nerror == NO_ERROR) UServer_Base::pClientImage->setOpMask(isWritePending() ? EPOLLOUT : EPOLLIN | EPOLLRDHUP | EPOLLET);
+}
 
-      iov_vec[2].iov_len  = HTTP2_FRAME_HEADER_SIZE;
-      iov_vec[3].iov_base = ptr;
+int UHTTP2::handlerWrite(UClientImage_Base* pclient)
+{
+   U_TRACE(0, "UHTTP2::handlerWrite(%p)", pclient)
 
-      if (body_sz > (uint32_t)pConnection->out_window)
-         {
-         ptr               += pConnection->out_window;
-         body_sz           -= pConnection->out_window;
-         iov_vec[3].iov_len = pConnection->out_window;
-                              pConnection->out_window = 0;
+   // NB: called directly from UNotifier when the socket is writable again, we resume the responses not yet sent (see sendResponses())...
 
-         writeData(iov_vec, false, false);
+   uint32_t idx = (pclient - UServer_Base::vClientImage);
 
-         U_INTERNAL_DUMP("nerror = %u", nerror)
+   U_INTERNAL_DUMP("idx = %u", idx)
 
-         if (nerror != NO_ERROR) return;
+   U_INTERNAL_ASSERT_MINOR(idx, UNotifier::max_connection)
 
-         goto loop;
-         }
+   UServer_Base::csocket      = pclient->socket;
+   UServer_Base::pClientImage = pclient;
 
-      iov_vec[3].iov_len       = body_sz;
-      pConnection->out_window -= body_sz;
+   pConnection = vConnection + idx;
+   nerror      = NO_ERROR;
 
-      writeData(iov_vec, false, true);
-      }
+   sendResponses();
+
+   U_INTERNAL_DUMP("nerror = %u", nerror)
+
+   if (nerror != NO_ERROR) U_RETURN(U_NOTIFIER_DELETE);
+
+   pclient->last_event = u_now->tv_sec; // NB: the client is reading, so it is not idle...
+
+   U_RETURN(U_NOTIFIER_OK);
 }
 
 // HTTP2 => HTTP1
@@ -3178,7 +3589,7 @@ void UHTTP2::handlerDelete(UClientImage_Base* pclient, bool& bsocket_open)
 #ifdef DEBUG
    U_DUMP("pConnection->state = (%u, %s) pConnection->max_processed_stream_id = %u", pConnection->state, getConnectionStatusDescription(), pConnection->max_processed_stream_id)
 
-   for (pStream = pConnection->streams, pStreamEnd = (pStream+HTTP2_MAX_CONCURRENT_STREAMS); pStream < pStreamEnd; ++pStream)
+   for (pStream = pConnection->streams, pStreamEnd = (pStream+pConnection->streams_capacity); pStream < pStreamEnd; ++pStream)
       {
       U_ASSERT(pStream->body.empty())
       U_ASSERT(pStream->headers.empty())
@@ -3190,11 +3601,25 @@ void UHTTP2::handlerDelete(UClientImage_Base* pclient, bool& bsocket_open)
    clearHpackDynTbl(&(pConnection->idyntbl));
    clearHpackDynTbl(&(pConnection->odyntbl));
 
+   releaseStreamTable();
+
    pConnection->state = CONN_STATE_IS_CLOSING;
 
    U_INTERNAL_DUMP("pclient->socket->iState = %u", pclient->socket->iState)
 
+   bool bframe = isWritePending(); // NB: a frame partially written, the GOAWAY frame would be read as part of it...
+
+   pConnection->wheaders.clear();
+   pConnection->wpending.clear();
+
+   pConnection->npending = 0;
+   pConnection->wfile    = U_NULLPTR;
+   pConnection->wflen    = 0;
+
+   pclient->UEventFd::op_mask = EPOLLIN | EPOLLRDHUP | EPOLLET; // NB: maybe we are waiting for the socket to be writable (see sendResponses())...
+
    if (bsocket_open &&
+       bframe == false &&
        pclient->socket->isTimeout())
       {
       bsocket_open = false;
@@ -3219,6 +3644,12 @@ bool UHTTP2::initRequest()
 
    U_DUMP("pConnection->state = (%u, %s) pConnection->max_processed_stream_id = %u", pConnection->state, getConnectionStatusDescription(), pConnection->max_processed_stream_id)
 
+   if (pConnection->streams == U_NULLPTR)
+      {
+      pConnection->streams_capacity = HTTP2_STREAM_TABLE_MIN;
+      pConnection->streams          = newStreamTable(HTTP2_STREAM_TABLE_MIN);
+      }
+
    pStream    =
    pStreamEnd = pConnection->streams;
 
@@ -3238,7 +3669,7 @@ bool UHTTP2::initRequest()
 
             if (pStreamEnd->id == pConnection->max_processed_stream_id) U_RETURN(true);
             }
-         while (++pStreamEnd < (pStream+HTTP2_MAX_CONCURRENT_STREAMS));
+         while (++pStreamEnd < (pStream+pConnection->streams_capacity));
 
          pStreamEnd = pConnection->streams;
 
@@ -3335,7 +3766,8 @@ void UHTTP2::handlerRequest()
          pStream->id                          =
          pConnection->max_processed_stream_id = 1;
 
-         pStream->state = STREAM_STATE_HALF_CLOSED;
+         pStream->state      = STREAM_STATE_HALF_CLOSED;
+         pStream->out_window = pConnection->peer_settings.initial_window_size;
 
          if ((pStream->clength = U_http_info.clength))
             {
@@ -3396,6 +3828,15 @@ next2:
    UClientImage_Base::request->clear();
 
 read_request:
+   if (isResponsePending()) // NB: before to wait for other frames we send the responses not yet sent...
+      {
+      sendResponses();
+
+      U_INTERNAL_DUMP("nerror = %u", nerror)
+
+      if (nerror != NO_ERROR) goto err;
+      }
+
    readFrame();
 
    U_INTERNAL_DUMP("nerror = %u", nerror)
@@ -3432,6 +3873,15 @@ read_request:
             goto read_request; // NB: OPTION upgrade, we need a HEADERS frame...
             }
 
+         if (isResponsePending()) // NB: we can have read WINDOW_UPDATE frames for the responses not yet sent...
+            {
+            sendResponses();
+
+            U_INTERNAL_DUMP("nerror = %u", nerror)
+
+            if (nerror != NO_ERROR) goto err;
+            }
+
          UClientImage_Base::setRequestProcessed();
 
          return;
@@ -3583,7 +4033,11 @@ process_request:
 
             U_SRV_LOG_WITH_ADDR("send response (HTTP2,id:%u,bytes:%u) %#.*S to", pStream->id, sz0, sz0, ptr0);
 
-            if (USocketExt::write(UServer_Base::csocket, ptr0, sz0, 0) != (int)sz0) nerror = CONNECT_ERROR;
+            // NB: the responses not yet sent must go first, so the frames are appended to the HEADERS frames not yet sent...
+
+            (void) pConnection->wheaders.append(ptr0, sz0);
+
+            sendResponses();
 
 #        ifdef DEBUG
          // (void) UFile::writeToTmp(ptr0, sz0, O_RDWR | O_TRUNC, U_CONSTANT_TO_PARAM("load_balance_response.%P"), 0);
@@ -3617,6 +4071,12 @@ process_request:
             }
          }
 
+      if (isResponsePending()) sendResponses();
+
+      U_INTERNAL_DUMP("nerror = %u", nerror)
+
+      if (nerror != NO_ERROR) goto err;
+
       UClientImage_Base::wbuffer->clear();
 
 #  ifdef DEBUG
@@ -4009,6 +4469,7 @@ const char* UHTTP2::getFrameTypeDescription(char type)
       case U_HTTP2_ENTRY(GOAWAY);
       case U_HTTP2_ENTRY(WINDOW_UPDATE);
       case U_HTTP2_ENTRY(CONTINUATION);
+      case U_HTTP2_ENTRY(PRIORITY_UPDATE);
 
       default: descr = "Frame type unknown";
       }
@@ -530,21 +530,22 @@ uint32_t USocketExt::iov_resize(struct iovec* liov, const struct iovec* iov, int
                   //  iov[idx].iov_len = 0;
       }
 
-   liov    = (struct iovec*)iov + idx;
-   liovcnt =             iovcnt - idx;
+   liovcnt = iovcnt - idx;
+
+   // NB: the iovec not yet written are copied in liov (that can be iov itself, as with the partial writes of writev())...
+
+   (void) U_SYSCALL(memmove, "%p,%p,%u", liov, iov + idx, liovcnt * sizeof(struct iovec));
 
    if (byte_written)
       {
-             liov[0].iov_base =
-       (char*)iov[0].iov_base + byte_written;
-             liov[0].iov_len  =
-              iov[0].iov_len  - byte_written;
+      liov[0].iov_base = (char*)liov[0].iov_base + byte_written;
+      liov[0].iov_len -=                          byte_written;
       }
 
    U_INTERNAL_DUMP("idx = %u liovcnt = %u liov[0].iov_len = %u byte_written = %u", idx, liovcnt, liov[0].iov_len, byte_written)
 
    U_INTERNAL_ASSERT_RANGE(0,liovcnt,256)
-   U_INTERNAL_ASSERT_MAJOR(liov[0].iov_len, byte_written)
+   U_INTERNAL_ASSERT_MAJOR(liov[0].iov_len, 0)
 
    U_DUMP_IOVEC(liov,liovcnt)
 
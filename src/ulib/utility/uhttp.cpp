@@ -22,6 +22,7 @@
 #include <ulib/mime/multipart.h>
 #include <ulib/utility/escape.h>
 #include <ulib/utility/base64.h>
+#include <ulib/utility/access_log.h>
 #include <ulib/base/coder/url.h>
 #include <ulib/utility/dir_walk.h>
 #include <ulib/net/client/client.h>
@@ -147,6 +148,22 @@ URDBObjectHandler<UDataStorage*>* UHTTP::db_session;
          UHTTP::UFileCacheData*   UHTTP::file_gzip_bomb;
          UHTTP::UFileCacheData*   UHTTP::file_not_in_cache_data;
 UHashMap<UHTTP::UFileCacheData*>* UHTTP::cache_file;
+         UHTTP::UFileCacheData*   UHTTP::cache_file_lru;
+         uint8_t*                 UHTTP::cache_file_sketch;
+         uint32_t                 UHTTP::cache_file_max_size;
+         uint32_t                 UHTTP::cache_file_used;
+         uint32_t                 UHTTP::cache_file_sample;
+         uint32_t                 UHTTP::cache_file_hit;
+         uint32_t                 UHTTP::cache_file_miss;
+         uint32_t                 UHTTP::cache_file_evict;
+         ULock*                   UHTTP::cache_file_lock;
+         int                      UHTTP::cache_file_shared_slot = -1;
+         bool                     UHTTP::cache_file_shared_attach;
+         uint32_t                 UHTTP::cache_file_shared_size;
+         uint32_t                 UHTTP::cache_file_shared_nslot;
+UHTTP::file_cache_shared*         UHTTP::cache_file_shared;
+
+#define U_FILE_CACHE_SKETCH_WIDTH 4096 // NB: the index of the sketch take the high 12 bits of the hash...
 
 #ifdef USE_PHP
 UHTTP::UPHP* UHTTP::php_embed;
@@ -334,10 +351,17 @@ UHTTP::UFileCacheData::UFileCacheData()
 #ifndef U_HTTP2_DISABLE
    http2 = U_NULLPTR;
 #endif
-   size        = 0;
+   prev        =
+   next        = U_NULLPTR;
+   size        =
+   hkey        =
+   gen         =
+   weight      = 0;
+   slot        = -1;
    mode        = 0;
    mtime       = 0;
-   link        = false;
+   link        =
+   evict       = false;
    expire      = U_TIME_FOR_EXPIRE;
    mime_index  = U_unknow;
    wd = fd     = -1;
@@ -359,6 +383,14 @@ UHTTP::UFileCacheData::UFileCacheData(const UHTTP::UFileCacheData& elem)
    mtime      = elem.mtime;      // time of last modification
    mime_index = elem.mime_index; // index file mime type
 
+   prev       =
+   next       = U_NULLPTR;
+   hkey       =
+   gen        =
+   weight     = 0;
+   slot       = -1;
+   evict      = false;
+
    expire = (u_now->tv_sec < elem.expire ? elem.expire : U_TIME_FOR_EXPIRE); // check expire time of the entry
 }
 
@@ -386,6 +418,8 @@ UHTTP::UFileCacheData::~UFileCacheData()
          }
       }
 
+   if (next) UHTTP::unlinkFileCache(this);
+
    if (array) U_DELETE(array)
 
 #ifndef U_HTTP2_DISABLE
@@ -635,7 +669,13 @@ void UHTTP::in_READ()
                         {
                         // NB: check if we have the content of file in cache...
 
-                        if (inotify_file_data->array) inotify_file_data->expire = 0; // NB: we delay the renew...
+                        // NB: with the content in shared memory we renew it now, only the first child that get the event rebuild it...
+
+                        if (inotify_file_data->array &&
+                            inotify_file_data->slot == -1)
+                           {
+                           inotify_file_data->expire = 0; // NB: we delay the renew...
+                           }
                         else
                            {
                            if (file_data == U_NULLPTR) file_data = getFileCachePointer(*inotify_pathname);
@@ -645,6 +685,8 @@ void UHTTP::in_READ()
                               U_INTERNAL_ASSERT_EQUALS(file_data, inotify_file_data)
 
                               renewFileDataInCache();
+
+                              inotify_file_data = file_data; // NB: the entry is renewed, it is a new object (the next event can be for the same file)...
                               }
                            }
                         }
@@ -1516,6 +1558,10 @@ void UHTTP::dtor()
       U_DELETE(vusp)
       U_DELETE(cache_file)
 
+      if (cache_file_lock) U_DELETE(cache_file_lock)
+
+      if (cache_file_sketch) UMemoryPool::_free(cache_file_sketch, 4 * U_FILE_CACHE_SKETCH_WIDTH, sizeof(uint8_t));
+
       if (db_session) clearSession();
 
       if (db_not_found)
@@ -3821,6 +3867,14 @@ U_NO_EXPORT inline bool UHTTP::setSendfile(int fd, off_t start, off_t count)
 
    UClientImage_Base::setSendfile(fd, start, count);
 
+#ifndef U_HTTP2_DISABLE
+   // NB: with HTTP/2 we don't need the fork of a child for a big file: the file is sent by UHTTP2::sendResponses() without to wait
+   //     for the socket (the write is resumed with EPOLLOUT by UHTTP2::handlerWrite()), so the worker is not blocked by a slow client
+   //     and a child could not use the connection anyway (it is shared by the streams and by the state of the hpack encoder)...
+
+   if (U_http_version == '2') U_RETURN(false);
+#endif
+
    if ((count - start) > (6 * U_1M)) return UServer_Base::startParallelization();
 
    U_RETURN(false);
@@ -4836,10 +4890,12 @@ file_in_cache:
 #  endif
 
 from_cache:
-      if (isGETorHEAD() &&
-          isDataFromCache())
+      if (isGETorHEAD())
          {
-         processFileCache();
+         if (file_data->slot != -1) checkFileCacheShared();
+         if (cache_file_max_size)   checkFileCachePolicy();
+
+         if (isDataFromCache()) processFileCache();
          }
 
       U_INTERNAL_DUMP("U_ClientImage_parallelization = %u", U_ClientImage_parallelization)
@@ -5527,7 +5583,8 @@ void UHTTP::setEndRequestProcessing()
 
       // response_code, body_len
 
-      if (iov_vec[5].iov_len == 0)
+      if (iov_vec[5].iov_len == 0 &&
+          U_Log_binary(UServer_Base::apache_like_log) == false)
          {
          U_INTERNAL_ASSERT_EQUALS(iov_buffer, iov_vec[5].iov_base)
 
@@ -5561,11 +5618,28 @@ void UHTTP::setEndRequestProcessing()
          }
 #    endif
 
-      U_INTERNAL_ASSERT_EQUALS(iov_vec[2].iov_base, ULog::date.date2)
+      if (U_Log_binary(UServer_Base::apache_like_log))
+         {
+         UAccessLog::record r;
+
+         r.ip       = (UServer_Base::csocket->remoteIPAddress().getAddressFamily() == AF_INET ? UServer_Base::getClientAddress() : 0);
+         r.status   = U_http_info.nResponseCode;
+         r.method   = U_http_method_num;
+         r.version  = U_http_version;
+         r.body_len = UClientImage_Base::body->size();
+
+         UAccessLog::write(UServer_Base::apache_like_log, r, (const char*)iov_vec[4].iov_base, iov_vec[4].iov_len,
+                                                             (const char*)iov_vec[6].iov_base, iov_vec[6].iov_len,
+                                                             (const char*)iov_vec[8].iov_base, iov_vec[8].iov_len);
+         }
+      else
+         {
+         U_INTERNAL_ASSERT_EQUALS(iov_vec[2].iov_base, ULog::date.date2)
 
-      ULog::updateDate2();
+         ULog::updateDate2();
 
-      UServer_Base::apache_like_log->write(iov_vec, 10);
+         UServer_Base::apache_like_log->write(iov_vec, 10);
+         }
 
       iov_vec[0].iov_len = 0;
       }
@@ -6698,7 +6772,14 @@ uint32_t UHTTP::processForm()
 
    if (isGETorHEAD())
       {
-      if (U_http_info.query_len) (void) tmp.assign(U_HTTP_QUERY_TO_PARAM);
+      if (U_http_info.query_len)
+         {
+         UMemoryArena::enter(); // NB: the form data are released by setEndRequestProcessing()...
+
+         (void) tmp.assign(U_HTTP_QUERY_TO_PARAM);
+
+         UMemoryArena::leave();
+         }
       }
    else
       {
@@ -6776,8 +6857,12 @@ uint32_t UHTTP::processForm()
 
    if (tmp)
       {
+      UMemoryArena::enter();
+
       uint32_t len = UStringExt::getNameValueFromData(tmp, *form_name_value, U_CONSTANT_TO_PARAM("&"));
 
+      UMemoryArena::leave();
+
       U_ASSERT_EQUALS(len, form_name_value->size())
 
       if (len) *qcontent = tmp;
@@ -9671,13 +9756,47 @@ manage:
 
          mime_index = file_data->mime_index;
 
-         putDataInCache(lpathname, header, content);
+         U_INTERNAL_DUMP("cache_file_shared_slot = %d", cache_file_shared_slot)
+
+         if (cache_file_shared_slot == -1) putDataInCache(lpathname, header, content);
+         else
+            {
+            // NB: if the content published is for the same stat of the file (another child has rebuilt it) we attach to it,
+            //     otherwise we are the first child that see the change and we rebuild and publish it...
+
+            file_cache_slot* pslot = cache_file_shared->slot + cache_file_shared_slot;
+
+            cache_file_shared_attach = (pslot->mtime == file_data->mtime &&
+                                        pslot->size  == file_data->size);
+
+            U_INTERNAL_DUMP("cache_file_shared_attach = %b pslot->mtime = %#3D pslot->size = %u", cache_file_shared_attach, pslot->mtime, pslot->size)
+
+            if (cache_file_shared_attach &&
+                attachFileCacheShared(file_data))
+               {
+               U_SRV_LOG("File cached (shared memory): %V - %u bytes", lpathname.rep, file_data->size);
+               }
+            else
+               {
+               putDataInCache(lpathname, header, content);
+
+               if (cache_file_shared_attach == false) (void) publishFileCacheShared(file_data, cache_file_shared_slot);
+               }
+            }
+
+         if (cache_file_max_size &&
+             content)
+            {
+            checkFileCacheAdmission(lpathname);
+            }
          }
       }
 
 end:
    U_INTERNAL_DUMP("file_data->mime_index(%d) = %C", file_data->mime_index, file_data->mime_index)
 
+   setFileCacheDataShared(file_data);
+
    U_ASSERT_EQUALS(cache_file->find(lpathname), false)
 
    cache_file->insert(lpathname, file_data); // NB: we don't need to call u_construct<UHTTP::UFileCacheData>()...
@@ -9701,7 +9820,8 @@ void UHTTP::renewFileDataInCache()
 
    // NB: we need to do this before call eraseAfterFind()...
 
-   int fd      = file_data->fd;
+   int fd      = file_data->fd,
+       slot    = file_data->slot;
    UString key = cache_file->getKey();
 
    if (fd != -1) UFile::close(fd);
@@ -9712,7 +9832,30 @@ void UHTTP::renewFileDataInCache()
 
    cache_file->eraseAfterFind();
 
-   checkFileForCache(key);
+   if (slot == -1) checkFileForCache(key);
+   else
+      {
+      // NB: the choice between attach to the content published by another child or rebuild it is done by checkFileForCache()...
+
+      cache_file_lock->lock();
+
+      cache_file_shared_slot = slot;
+
+      checkFileForCache(key);
+
+      if (file_data &&
+          file_data->slot == -1) // NB: the content is not in memory (ex: empty file), we keep the slot for the next renew...
+         {
+         file_data->gen  = cache_file_shared->slot[slot].gen;
+         file_data->slot = slot;
+
+         setFileCacheSharedAck(slot, file_data->gen);
+         }
+
+      cache_file_shared_slot = -1;
+
+      cache_file_lock->unlock();
+      }
 
    if (fd != -1     &&
        file->st_ino && // stat() ok...
@@ -9724,6 +9867,623 @@ void UHTTP::renewFileDataInCache()
    U_INTERNAL_DUMP("file_data->array = %p", file_data->array)
 }
 
+/**
+ * Policy of the cache for the content in memory (CACHE_FILE_MAX_SIZE)
+ *
+ * The frequency of access of the entries is estimated with a count-min sketch (TinyLFU): 4 rows of saturating counters,
+ * halved every time the number of samples reaches 10 times the number of entries in the cache, so that the history fades.
+ * The entries with the content in memory are kept in a LRU list weighted by the bytes they use. A new content is admitted
+ * only if it is more frequently used than all the victims (from the tail of the list) that must be evicted to make room
+ * for it. An evicted entry drops only the content, the metadata stay in the cache and the file is served from disk...
+ */
+
+static const uint32_t sketch_seed[4] = { 0x9e3779b1, 0x85ebca77, 0xc2b2ae3d, 0x27d4eb2f };
+
+U_NO_EXPORT uint32_t UHTTP::getFileCacheFrequency(uint32_t hkey)
+{
+   U_TRACE(0, "UHTTP::getFileCacheFrequency(%u)", hkey)
+
+   U_INTERNAL_ASSERT_POINTER(cache_file_sketch)
+
+   uint32_t freq = 255;
+
+   for (uint32_t i = 0; i < 4; ++i)
+      {
+      uint8_t count = cache_file_sketch[i * U_FILE_CACHE_SKETCH_WIDTH + ((hkey * sketch_seed[i]) >> 20)];
+
+      if (count < freq) freq = count;
+      }
+
+   U_RETURN(freq);
+}
+
+U_NO_EXPORT void UHTTP::incFileCacheFrequency(uint32_t hkey)
+{
+   U_TRACE(0, "UHTTP::incFileCacheFrequency(%u)", hkey)
+
+   U_INTERNAL_ASSERT_POINTER(cache_file_sketch)
+
+   uint32_t i;
+
+   for (i = 0; i < 4; ++i)
+      {
+      uint8_t* ptr = cache_file_sketch + i * U_FILE_CACHE_SKETCH_WIDTH + ((hkey * sketch_seed[i]) >> 20);
+
+      if (*ptr < 15) ++(*ptr);
+      }
+
+   uint32_t n = cache_file->size();
+
+   if (++cache_file_sample >= U_max(n, U_FILE_CACHE_SKETCH_WIDTH / 16) * 10) // aging...
+      {
+      for (i = 0; i < 4 * U_FILE_CACHE_SKETCH_WIDTH; ++i) cache_file_sketch[i] >>= 1;
+
+      cache_file_sample /= 2;
+      }
+}
+
+U_NO_EXPORT void UHTTP::touchFileCache(UFileCacheData* ptr)
+{
+   U_TRACE(0, "UHTTP::touchFileCache(%p)", ptr)
+
+   U_INTERNAL_DUMP("cache_file_lru = %p", cache_file_lru)
+
+   if (ptr == cache_file_lru) return;
+
+   if (ptr->next) // NB: unlink...
+      {
+      ptr->prev->next = ptr->next;
+      ptr->next->prev = ptr->prev;
+      }
+
+   if (cache_file_lru == U_NULLPTR) ptr->prev = ptr->next = ptr;
+   else
+      {
+      ptr->next = cache_file_lru;
+      ptr->prev = cache_file_lru->prev;
+
+      cache_file_lru->prev->next = ptr;
+      cache_file_lru->prev       = ptr;
+      }
+
+   cache_file_lru = ptr;
+}
+
+void UHTTP::unlinkFileCache(UFileCacheData* ptr)
+{
+   U_TRACE(0, "UHTTP::unlinkFileCache(%p)", ptr)
+
+   U_INTERNAL_ASSERT_POINTER(ptr->next)
+   U_INTERNAL_ASSERT(cache_file_used >= ptr->weight)
+
+   if (ptr->next == ptr) cache_file_lru = U_NULLPTR;
+   else
+      {
+      ptr->prev->next = ptr->next;
+      ptr->next->prev = ptr->prev;
+
+      if (ptr == cache_file_lru) cache_file_lru = ptr->next;
+      }
+
+   ptr->prev =
+   ptr->next = U_NULLPTR;
+
+   cache_file_used -= ptr->weight;
+}
+
+U_NO_EXPORT void UHTTP::evictFileCache(UFileCacheData* ptr)
+{
+   U_TRACE(0, "UHTTP::evictFileCache(%p)", ptr)
+
+   if (ptr->next) unlinkFileCache(ptr);
+
+   U_DELETE(ptr->array)
+
+   ptr->array = U_NULLPTR;
+
+#ifndef U_HTTP2_DISABLE
+   U_DELETE(ptr->http2)
+
+   ptr->http2 = U_NULLPTR;
+#endif
+
+   ptr->evict = true;
+}
+
+U_NO_EXPORT bool UHTTP::admitFileCache(uint32_t weight, uint32_t freq, bool bevict)
+{
+   U_TRACE(0, "UHTTP::admitFileCache(%u,%u,%b)", weight, freq, bevict)
+
+   U_INTERNAL_DUMP("cache_file_used = %u cache_file_max_size = %u", cache_file_used, cache_file_max_size)
+
+   if (weight > cache_file_max_size) U_RETURN(false);
+
+   uint32_t need = cache_file_used + weight;
+
+   if (need <= cache_file_max_size) U_RETURN(true);
+
+   // NB: the candidate must beat every victim that we need to evict to make room...
+
+   UFileCacheData* victim = cache_file_lru->prev;
+
+   for (uint32_t freed = 0; (need - freed) > cache_file_max_size; victim = victim->prev)
+      {
+      if (getFileCacheFrequency(victim->hkey) >= freq) U_RETURN(false);
+
+      freed += victim->weight;
+      }
+
+   if (bevict)
+      {
+      while (cache_file_used + weight > cache_file_max_size)
+         {
+         evictFileCache(cache_file_lru->prev);
+
+         ++cache_file_evict;
+         }
+      }
+
+   U_RETURN(true);
+}
+
+U_NO_EXPORT void UHTTP::checkFileCacheAdmission(const UString& path)
+{
+   U_TRACE(0, "UHTTP::checkFileCacheAdmission(%V)", path.rep)
+
+   U_INTERNAL_ASSERT_POINTER(file_data)
+   U_INTERNAL_ASSERT_POINTER(file_data->array)
+   U_INTERNAL_ASSERT_MAJOR(cache_file_max_size, 0)
+
+   if (cache_file_sketch == U_NULLPTR)
+      {
+      uint32_t n = 4 * U_FILE_CACHE_SKETCH_WIDTH;
+
+      cache_file_sketch = (uint8_t*) UMemoryPool::pmalloc(&n, sizeof(uint8_t), true);
+      }
+
+   uint32_t i, n, weight = 0;
+
+   for (i = 0, n = file_data->array->size(); i < n; ++i) weight += file_data->array->at(i).size();
+
+#ifndef U_HTTP2_DISABLE
+   if (file_data->http2) // NB: the vector of the headers for http2 is released by evictFileCache()...
+      {
+      for (i = 0, n = file_data->http2->size(); i < n; ++i) weight += file_data->http2->at(i).size();
+      }
+#endif
+
+   file_data->hkey   = path.hash();
+   file_data->weight = weight;
+
+   if (admitFileCache(weight, getFileCacheFrequency(file_data->hkey), true))
+      {
+      touchFileCache(file_data);
+
+      cache_file_used += weight;
+      }
+   else
+      {
+      evictFileCache(file_data);
+
+      U_SRV_LOG("File content not admitted in cache (used %u of %u bytes): %V - %u bytes", cache_file_used, cache_file_max_size, path.rep, weight);
+      }
+}
+
+void UHTTP::checkFileCachePolicy()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP::checkFileCachePolicy()")
+
+   U_INTERNAL_ASSERT_POINTER(file_data)
+   U_INTERNAL_ASSERT_MAJOR(cache_file_max_size, 0)
+
+   U_INTERNAL_DUMP("file_data->next = %p file_data->evict = %b", file_data->next, file_data->evict)
+
+   if (file_data->next)
+      {
+      ++cache_file_hit;
+
+      incFileCacheFrequency(file_data->hkey);
+
+      touchFileCache(file_data);
+
+      return;
+      }
+
+   if (file_data->evict == false) return; // NB: the content is not managed by the policy (sendfile, dynamic page, ...)
+
+   ++cache_file_miss;
+
+   incFileCacheFrequency(file_data->hkey);
+
+   // NB: we load again the content only if it is now hotter than the victims that it would replace...
+
+   if (file_data == cache_file->elem() &&
+       admitFileCache(file_data->weight, getFileCacheFrequency(file_data->hkey), false))
+      {
+      renewFileDataInCache();
+
+      if (file_data == U_NULLPTR) file_data = file_not_in_cache_data;
+      }
+}
+
+// SHARED MEMORY FOR THE CONTENT OF THE CACHE (CACHE_FILE_SHARED_SIZE)
+
+U_NO_EXPORT bool UHTTP::countFileCacheShared(UStringRep* key, void* value)
+{
+   U_TRACE(0+256, "UHTTP::countFileCacheShared(%V,%p)", key, value)
+
+   UFileCacheData* ptr = (UFileCacheData*)value;
+
+   if (ptr->array &&
+       ptr->link == false)
+      {
+      ++cache_file_shared_nslot;
+      }
+
+   U_RETURN(true);
+}
+
+U_NO_EXPORT bool UHTTP::copyFileCacheShared(UStringRep* key, void* value)
+{
+   U_TRACE(0+256, "UHTTP::copyFileCacheShared(%V,%p)", key, value)
+
+   UFileCacheData* ptr = (UFileCacheData*)value;
+
+   if (ptr->array &&
+       ptr->link == false &&
+       cache_file_shared_nslot < cache_file_shared->nslot)
+      {
+      (void) publishFileCacheShared(ptr, cache_file_shared_nslot++);
+      }
+
+   U_RETURN(true);
+}
+
+void UHTTP::reserveFileCacheShared()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP::reserveFileCacheShared()")
+
+   U_INTERNAL_ASSERT_POINTER(cache_file)
+   U_INTERNAL_ASSERT_EQUALS(cache_file_shared, U_NULLPTR)
+
+   U_INTERNAL_DUMP("cache_file_shared_size = %u", cache_file_shared_size)
+
+   if (cache_file_shared_size &&
+       UServer_Base::isPreForked())
+      {
+      cache_file_shared_nslot = 0;
+
+      cache_file->callForAllEntry(countFileCacheShared);
+
+      if (cache_file_shared_nslot)
+         {
+         // NB: two step shared memory acquisition - first we get the offset (+8 for the alignment), after the pointer...
+
+         cache_file_shared = (file_cache_shared*) UServer_Base::getOffsetToDataShare(sizeof(file_cache_shared) + (cache_file_shared_nslot - 1) * sizeof(file_cache_slot) +
+                                                                                     cache_file_shared_nslot * UServer_Base::preforked_num_kids * sizeof(uint32_t) +
+                                                                                     cache_file_shared_size + 8);
+         }
+      }
+}
+
+void UHTTP::initFileCacheShared()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP::initFileCacheShared()")
+
+   U_INTERNAL_ASSERT_POINTER(cache_file_shared)
+   U_INTERNAL_ASSERT_POINTER(UServer_Base::ptr_shared_data)
+
+   cache_file_shared = (file_cache_shared*) (((ptrdiff_t)UServer_Base::getPointerToDataShare(cache_file_shared) + 7) & ~(ptrdiff_t)7);
+
+   cache_file_shared->nslot = cache_file_shared_nslot;
+   cache_file_shared->nkid  = UServer_Base::preforked_num_kids;
+   cache_file_shared->size  = cache_file_shared_size;
+   cache_file_shared->used  = 0;
+
+   (void) U_SYSCALL(memset, "%p,%d,%u", cache_file_shared->slot, 0, cache_file_shared_nslot * (sizeof(file_cache_slot) + cache_file_shared->nkid * sizeof(uint32_t)));
+
+   U_NEW(ULock, cache_file_lock, ULock);
+
+   cache_file_lock->init(&(cache_file_shared->lock));
+
+   cache_file_shared_nslot = 0; // NB: now it is the index of the next slot...
+
+   cache_file->callForAllEntry(copyFileCacheShared);
+
+   // NB: the children (not yet forked) reference the content published...
+
+   uint32_t* ack = (uint32_t*)(cache_file_shared->slot + cache_file_shared->nslot);
+
+   for (uint32_t i = 0; i < cache_file_shared->nslot; ++i)
+      {
+      for (uint32_t k = 0; k < cache_file_shared->nkid; ++k) *ack++ = cache_file_shared->slot[i].gen;
+      }
+
+   U_SRV_LOG("Mapped %u bytes (%u KB) of shared memory for the content of %u files in cache (used %u bytes)",
+               cache_file_shared_size, cache_file_shared_size / 1024, cache_file_shared->nslot, cache_file_shared->used);
+}
+
+// NB: the acknowledge of the generation referenced by every child follow the slots, the data area follow them...
+
+#define U_FILE_CACHE_SHARED_ACK(n) ((uint32_t*)(cache_file_shared->slot + cache_file_shared->nslot) + (n) * cache_file_shared->nkid)
+#define U_FILE_CACHE_SHARED_DATA   ((char*)U_FILE_CACHE_SHARED_ACK(cache_file_shared->nslot))
+
+U_NO_EXPORT void UHTTP::setFileCacheSharedAck(int slot, uint32_t gen)
+{
+   U_TRACE(0, "UHTTP::setFileCacheSharedAck(%d,%u)", slot, gen)
+
+   U_INTERNAL_ASSERT_POINTER(cache_file_shared)
+   U_INTERNAL_ASSERT_MINOR((uint32_t)UServer_Base::rkids, cache_file_shared->nkid)
+
+   U_FILE_CACHE_SHARED_ACK(slot)[UServer_Base::rkids] = gen;
+}
+
+U_NO_EXPORT bool UHTTP::isFileCacheSharedInUse(int slot, file_cache_region* pregion)
+{
+   U_TRACE(0, "UHTTP::isFileCacheSharedInUse(%d,%p)", slot, pregion)
+
+   U_INTERNAL_DUMP("pregion->gen = %u pregion->cap = %u", pregion->gen, pregion->cap)
+
+   if (pregion->cap)
+      {
+      uint32_t* ack = U_FILE_CACHE_SHARED_ACK(slot);
+
+      for (uint32_t k = 0; k < cache_file_shared->nkid; ++k)
+         {
+         if (ack[k] == pregion->gen) U_RETURN(true); // NB: the child k has not yet moved to the new generation...
+         }
+      }
+
+   U_RETURN(false);
+}
+
+U_NO_EXPORT bool UHTTP::publishFileCacheShared(UFileCacheData* ptr, int slot)
+{
+   U_TRACE(0, "UHTTP::publishFileCacheShared(%p,%d)", ptr, slot)
+
+   U_INTERNAL_ASSERT_POINTER(ptr->array)
+   U_INTERNAL_ASSERT_POINTER(cache_file_shared)
+   U_INTERNAL_ASSERT_MINOR((uint32_t)slot, cache_file_shared->nslot)
+
+   UString item;
+   file_cache_slot* pslot     = cache_file_shared->slot + slot;
+   file_cache_region* pregion = pslot->region + ((pslot->gen + 1) & 1); // NB: the region not in use...
+   uint32_t i, k, len, total = 0, narray = ptr->array->size(), nhttp2 = 0, gen = pslot->gen + 1;
+
+#ifndef U_HTTP2_DISABLE
+   nhttp2 = ptr->http2->size();
+#endif
+
+   for (i = 0; i < narray; ++i) total += ptr->array->at(i).size();
+#ifndef U_HTTP2_DISABLE
+   for (i = 0; i < nhttp2; ++i) total += ptr->http2->at(i).size();
+#endif
+
+   ptr->slot = slot;
+
+   pslot->size  = ptr->size;
+   pslot->mtime = ptr->mtime;
+
+   bool binuse = isFileCacheSharedInUse(slot, pregion);
+
+   U_INTERNAL_DUMP("total = %u binuse = %b pregion->base = %u pregion->cap = %u cache_file_shared->used = %u", total, binuse, pregion->base, pregion->cap, cache_file_shared->used)
+
+   // NB: the region is reused by the rebuild if the new content fit and no child reference anymore the content that it hold, otherwise
+   //     the region is extended if it is the last one or it is moved at the end of the data area (with room for some growth, the old
+   //     region is lost)...
+
+   if ((narray + nhttp2) <= 9 &&
+       (binuse || total > pregion->cap))
+      {
+      uint32_t base = (binuse == false && (pregion->base + pregion->cap) == cache_file_shared->used ? pregion->base : cache_file_shared->used),
+               cap  = (total + (pregion->cap ? total / 8 : 0) + 7) & ~7;
+
+      if ((base + cap) > cache_file_shared->size) cap = (total + 7) & ~7;
+
+      if ((base + cap) <= cache_file_shared->size)
+         {
+         binuse = false;
+
+         pregion->base = base;
+         pregion->cap  = cap;
+
+         cache_file_shared->used = base + cap;
+         }
+      }
+
+   pregion->gen = gen;
+
+   if ((narray + nhttp2) > 9 ||
+       binuse                ||
+       total > pregion->cap)
+      {
+      // NB: the content remain private, the other children must rebuild it (a region still referenced is lost)...
+
+      if (binuse) pregion->base = pregion->cap = 0;
+
+      pregion->narray =
+      pregion->nhttp2 = 0;
+
+      __sync_synchronize();
+
+      pslot->gen = ptr->gen = gen;
+
+      setFileCacheSharedAck(slot, gen);
+
+      U_SRV_LOG("WARNING: shared memory for the content of the cache is full (used %u of %u bytes)", cache_file_shared->used, cache_file_shared->size);
+
+      U_RETURN(false);
+      }
+
+   uint32_t off = pregion->base;
+   char* data   = U_FILE_CACHE_SHARED_DATA + off;
+
+   for (k = 0; k < (narray + nhttp2); ++k)
+      {
+#  ifndef U_HTTP2_DISABLE
+      item = (k < narray ? ptr->array->at(k) : ptr->http2->at(k - narray));
+#  else
+      item = ptr->array->at(k);
+#  endif
+
+      pregion->off[k] = off;
+      pregion->len[k] = (len = item.size());
+
+      if (len)
+         {
+         U_MEMCPY(data, item.data(), len);
+
+         // NB: the entry now reference the content in shared memory (the private copy is released)...
+
+#     ifndef U_HTTP2_DISABLE
+         if (k >= narray) ptr->http2->replace(k - narray, UString(data, len));
+         else
+#     endif
+         ptr->array->replace(k, UString(data, len));
+
+         off  += len;
+         data += len;
+         }
+      }
+
+   pregion->narray = narray;
+   pregion->nhttp2 = nhttp2;
+
+   // NB: the switch of the generation publish the region (the content must be visible before it)...
+
+   __sync_synchronize();
+
+   pslot->gen = ptr->gen = gen;
+
+   setFileCacheSharedAck(slot, gen);
+
+   U_RETURN(true);
+}
+
+// NB: in the thread approach (PREFORK_CHILD == -1) the content of the cache is served by all the threads without copy...
+
+U_NO_EXPORT void UHTTP::setFileCacheDataShared(UFileCacheData* ptr)
+{
+   U_TRACE(0, "UHTTP::setFileCacheDataShared(%p)", ptr)
+
+#if defined(ENABLE_THREAD) && !defined(USE_LIBEVENT) && defined(U_SERVER_THREAD_APPROACH_SUPPORT)
+   if (UServer_Base::preforked_num_kids == -1)
+      {
+      UVector<UString>* vec[2] = { ptr->array,
+#  ifndef U_HTTP2_DISABLE
+                                   ptr->http2
+#  else
+                                   U_NULLPTR
+#  endif
+                                 };
+
+      for (uint32_t i = 0; i < 2; ++i)
+         {
+         if (vec[i] == U_NULLPTR) continue;
+
+         for (uint32_t k = 0, n = vec[i]->size(); k < n; ++k)
+            {
+            UString item = vec[i]->at(k);
+
+            if (item.isNull()) continue;
+
+            UStringRep* r = item.rep;
+
+            item.setShared();
+
+            if (item.rep != r) vec[i]->replace(k, item); // NB: setShared() made a private copy...
+            }
+         }
+      }
+#endif
+}
+
+U_NO_EXPORT bool UHTTP::attachFileCacheShared(UFileCacheData* ptr)
+{
+   U_TRACE(0, "UHTTP::attachFileCacheShared(%p)", ptr)
+
+   U_INTERNAL_ASSERT_POINTER(cache_file_shared)
+   U_INTERNAL_ASSERT_DIFFERS(cache_file_shared_slot, -1)
+
+   file_cache_slot* pslot     = cache_file_shared->slot + cache_file_shared_slot;
+   file_cache_region* pregion = pslot->region + (pslot->gen & 1);
+
+   ptr->gen  = pslot->gen;
+   ptr->slot = cache_file_shared_slot;
+
+   setFileCacheSharedAck(cache_file_shared_slot, ptr->gen); // NB: now the old region can be reused...
+
+   U_INTERNAL_DUMP("pslot->gen = %u pregion->narray = %u pregion->nhttp2 = %u", pslot->gen, pregion->narray, pregion->nhttp2)
+
+   if (pregion->narray == 0) U_RETURN(false); // NB: the content is private to the child that rebuilt it...
+
+   const char* data = U_FILE_CACHE_SHARED_DATA;
+
+   U_NEW(UVector<UString>, ptr->array, UVector<UString>(6U));
+#ifndef U_HTTP2_DISABLE
+   U_NEW(UVector<UString>, ptr->http2, UVector<UString>(3U));
+#endif
+
+   for (uint32_t len, k = 0; k < (pregion->narray + pregion->nhttp2); ++k)
+      {
+      UString item;
+
+      if ((len = pregion->len[k])) item = UString(data + pregion->off[k], len);
+
+#  ifndef U_HTTP2_DISABLE
+      if (k >= pregion->narray) ptr->http2->push_back(item);
+      else
+#  endif
+      ptr->array->push_back(item);
+      }
+
+   U_RETURN(true);
+}
+
+U_NO_EXPORT bool UHTTP::ackFileCacheShared(UStringRep* key, void* value)
+{
+   U_TRACE(0+256, "UHTTP::ackFileCacheShared(%V,%p)", key, value)
+
+   UFileCacheData* ptr = (UFileCacheData*)value;
+
+   if (ptr->slot != -1) setFileCacheSharedAck(ptr->slot, ptr->gen);
+
+   U_RETURN(true);
+}
+
+void UHTTP::afterForkFileCacheShared()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP::afterForkFileCacheShared()")
+
+   U_INTERNAL_ASSERT_POINTER(cache_file_shared)
+
+   // NB: a child restarted take the place of the child exited, it reference the content published before the fork...
+
+   cache_file->callForAllEntry(ackFileCacheShared);
+}
+
+void UHTTP::checkFileCacheShared()
+{
+   U_TRACE_NO_PARAM(0, "UHTTP::checkFileCacheShared()")
+
+   U_INTERNAL_ASSERT_POINTER(file_data)
+   U_INTERNAL_ASSERT_POINTER(cache_file_shared)
+   U_INTERNAL_ASSERT_DIFFERS(file_data->slot, -1)
+
+   file_cache_slot* pslot = cache_file_shared->slot + file_data->slot;
+
+   U_INTERNAL_DUMP("pslot->gen = %u file_data->gen = %u", pslot->gen, file_data->gen)
+
+   if (pslot->gen == file_data->gen) return;
+
+   if (file_data == cache_file->elem())
+      {
+      renewFileDataInCache();
+
+      if (file_data == U_NULLPTR) file_data = file_not_in_cache_data;
+      }
+}
+
 U_NO_EXPORT void UHTTP::processDataFromCache()
 {
    U_TRACE_NO_PARAM(0, "UHTTP::processDataFromCache()")
@@ -12903,6 +13663,11 @@ U_EXPORT const char* UHTTP::UFileCacheData::dump(bool reset) const
                   << "mode                    " << mode          << '\n'
                   << "expire                  " << expire        << '\n'
                   << "mtime                   " << mtime         << '\n'
+                  << "gen                     " << gen           << '\n'
+                  << "slot                    " << slot          << '\n'
+                  << "hkey                    " << hkey          << '\n'
+                  << "evict                   " << evict         << '\n'
+                  << "weight                  " << weight        << '\n'
                   << "array (UVector<UString> " << (void*)&array << ')';
 
    if (reset)
@@ -0,0 +1,128 @@
+// test_access_log.cpp
+
+#include <ulib/log.h>
+#include <ulib/file.h>
+#include <ulib/utility/access_log.h>
+
+class UBinaryLog : public ULog {
+public:
+
+   UBinaryLog(const UString& path) : ULog(path, 0) { U_Log_binary(this) = true; }
+};
+
+static uint32_t nstr;
+static uint64_t vid[16];
+static UString* vstr;
+
+static void write(ULog& log, uint16_t status, uint32_t body_len, const char* request, const char* referer, const char* agent)
+{
+   U_TRACE(5, "::write(%p,%u,%u,%S,%S,%S)", &log, status, body_len, request, referer, agent)
+
+   UAccessLog::record r;
+
+   (void) memset(&r, 0, sizeof(r));
+
+   r.ip       = U_MULTICHAR_CONSTANT32(127,0,0,1);
+   r.status   = status;
+   r.method   = 0;
+   r.version  = '1';
+   r.body_len = body_len;
+
+   UAccessLog::write(&log, r, request, strlen(request), referer, strlen(referer), agent, strlen(agent));
+}
+
+static const char* lookup(uint64_t id)
+{
+   U_TRACE(5, "::lookup(%llu)", id)
+
+   for (uint32_t i = 0; i < nstr; ++i)
+      {
+      if (vid[i] == id) return vstr[i].c_str();
+      }
+
+   return "?";
+}
+
+static void read(const UString& data)
+{
+   U_TRACE(5, "::read(%V)", data.rep)
+
+   char type;
+   uint32_t len;
+   const char* s;
+   UAccessLog::record r;
+   const char* ptr = data.data();
+   const char* end = data.pend();
+
+   nstr = 0;
+
+   while ((type = UAccessLog::next(ptr, end)))
+      {
+      if (type == 'S')
+         {
+         U_INTERNAL_ASSERT_MINOR(nstr, 16)
+
+         vid[nstr] = UAccessLog::getString(s, len);
+
+         U_ASSERT_EQUALS(vid[nstr], UAccessLog::getId(s, len))
+
+         vstr[nstr++] = UString(s, len);
+
+         cout << "S " << vstr[nstr-1] << '\n';
+         }
+      else
+         {
+         U_ASSERT_EQUALS(type, 'R')
+
+         UAccessLog::getRecord(r);
+
+         U_ASSERT_DIFFERS(r.time, 0)
+
+         cout << "R " << r.status << ' ' << r.body_len << ' ' << (char)r.version << ' '
+              << lookup(r.uri) << ' ' << lookup(r.referer) << ' ' << lookup(r.agent) << '\n';
+         }
+      }
+
+   U_ASSERT(ptr == end)
+}
+
+int
+U_EXPORT main (int argc, char* argv[], char* env[])
+{
+   U_ULIB_INIT(argv);
+
+   U_TRACE(5,"main(%d)",argc)
+
+   UString str[16];
+
+   vstr = str;
+
+   UString path = U_STRING_FROM_CONSTANT("tmp/test_access_log.log");
+
+   UBinaryLog y(path);
+
+   write(y, 200, 1024, "GET /index.html HTTP/1.1", "", "curl/7.64");
+
+   uint32_t first = UFile::contentOf(path).size();
+
+   write(y, 404, 0,    "GET /missing HTTP/1.1",    "http://localhost/index.html", "curl/7.64");
+   write(y, 200, 1024, "GET /index.html HTTP/1.1", "", "curl/7.64"); // NB: the strings are already defined...
+
+   UString data = UFile::contentOf(path);
+
+   read(data);
+
+   cout << "--------" << '\n';
+
+   // NB: bytes that are not an entry (garbage, a header with a wrong length, a record truncated by a crash) must be skipped...
+
+   UString torn(U_CAPACITY);
+
+   (void) torn.append(U_CONSTANT_TO_PARAM("garbage"));
+   (void) torn.append(data.data(), first);
+   (void) torn.append(U_CONSTANT_TO_PARAM("\xAC" "R" "\x10\x00" "garbage"));
+   (void) torn.append(data.c_pointer(first), data.size() - first);
+   (void) torn.append(data.c_pointer(data.size() - sizeof(UAccessLog::record)), 20);
+
+   read(torn);
+}
@@ -3,6 +3,8 @@
 #include <ulib/file.h>
 #include <ulib/cache.h>
 
+#include <sys/wait.h>
+
 /*
 // #define ORIGINAL
 #define USIZE 10
@@ -325,4 +327,40 @@ U_EXPORT main (int argc, char* argv[])
    U_INTERNAL_ASSERT( ok )
 
    cout << c;
+
+   // shared cache: every process insert its keys, the keys of all processes must be visible
+   // NB: every shard has room for all the 800 entries (at most 28 bytes each), so nothing can be evicted whatever the spread of the keys...
+
+   USharedCache sc;
+
+   ok = sc.open(U_STRING_FROM_CONSTANT("./cache_shared.file"), 1024 * 1024, 8, U_NULLPTR, true);
+
+   U_INTERNAL_ASSERT( ok )
+   U_INTERNAL_ASSERT_EQUALS( sc.getNumShard(), 8 )
+
+   char key[32];
+   pid_t pid[4];
+   int i, j, status;
+
+   for (i = 0; i < 4; ++i)
+      {
+      if ((pid[i] = fork()) == 0)
+         {
+         for (j = 0; j < 200; ++j) sc.add(UString(key, u__snprintf(key, sizeof(key), U_CONSTANT_TO_PARAM("%d-%d"), i, j)), UString(tbl[j % 9]));
+
+         ::_exit(0);
+         }
+      }
+
+   for (i = 0; i < 4; ++i) (void) waitpid(pid[i], &status, 0);
+
+   for (i = 0; i < 4; ++i)
+      {
+      for (j = 0; j < 200; ++j)
+         {
+         ok = sc.get(key, u__snprintf(key, sizeof(key), U_CONSTANT_TO_PARAM("%d-%d"), i, j)) == UString(tbl[j % 9]);
+
+         U_INTERNAL_ASSERT( ok )
+         }
+      }
 }
@@ -59,5 +59,15 @@ U_EXPORT main (int argc, char* argv[], char* env[])
 
    U_ASSERT( y == U_STRING_FROM_CONSTANT("Basic realm=\"WallyWorld\"") )
 
+   // NB: the name of the headers come from the network, they are only looked up in the table of the interned string...
+
+   UMimeHeader h3;
+
+   n = h3.parse(U_STRING_FROM_CONSTANT("X-Flood-Name: 1\r\nHost: dummy\r\n\r\n"));
+
+   U_ASSERT( n == 2 )
+   U_ASSERT( h3.getHeader(U_STRING_FROM_CONSTANT("X-Flood-Name")) == U_STRING_FROM_CONSTANT("1") )
+   U_ASSERT( UString::getIntern(U_CONSTANT_TO_PARAM("X-Flood-Name"), false) == U_NULLPTR )
+
    cout << h << endl;
 }
@@ -1,11 +1,60 @@
 // test_http.cpp
 
 #include <ulib/file.h>
+#include <ulib/json/reader.h>
 #include <ulib/net/tcpsocket.h>
 #include <ulib/net/client/http.h>
 
 // #define JOHN
 
+// NB: called by the client after every chunk of the body read from the socket, the value of the key _source is skipped...
+
+static bool readJson(void* ptr)
+{
+   U_TRACE(5, "::readJson(%p)", ptr)
+
+   int event;
+   UJsonReader* reader = (UJsonReader*)ptr;
+
+   while ((event = reader->next()) > UJsonReader::INVALID)
+      {
+      if (event == UJsonReader::KEY)
+         {
+         UString key = reader->getString();
+
+         cout << key << " = ";
+
+         if (key.equal(U_CONSTANT_TO_PARAM("_source")))
+            {
+            cout << "...\n";
+
+            reader->skip();
+            }
+         }
+      else if (event == UJsonReader::STRING)      cout << reader->getString() << '\n';
+      else if (event == UJsonReader::NUMBER)      cout << reader->getInteger() << '\n';
+      else if (event == UJsonReader::TRUE_VALUE)  cout << "true\n";
+      else if (event == UJsonReader::FALSE_VALUE) cout << "false\n";
+      else if (event == UJsonReader::NULL_VALUE)  cout << "null\n";
+      else if (event == UJsonReader::START_OBJECT ||
+               event == UJsonReader::START_ARRAY)
+         {
+         cout << (event == UJsonReader::START_OBJECT ? "{\n" : "[\n");
+         }
+      }
+
+   if (event == UJsonReader::INVALID)
+      {
+      cout << "INVALID\n";
+
+      U_RETURN(false);
+      }
+
+   if (event == UJsonReader::END_DOCUMENT) cout << "END\n";
+
+   U_RETURN(true);
+}
+
 int U_EXPORT main(int argc, char* argv[], char* env[])
 {
    U_ULIB_INIT(argv);
@@ -42,11 +91,17 @@ int U_EXPORT main(int argc, char* argv[], char* env[])
    http.setRequestPasswordAuthentication(U_STRING_FROM_CONSTANT("Aladdin"),
                                          U_STRING_FROM_CONSTANT("open sesame"));
 
+   UJsonReader reader;
+
+   if (argc > 2) http.setJsonReader(&reader, readJson); // NB: the body (with Content-Length) is passed to the reader...
+
    if (http.connectServer(url) &&
        http.sendRequest())
       {
       UString content = http.getContent();
 
+      U_INTERNAL_ASSERT(argc == 2 || content.empty())
+
       cout.write(content.data(), content.size());
       }
 #else
@@ -0,0 +1,196 @@
+// test_ioring.cpp
+
+#include <ulib/ioring.h>
+
+#include <sys/wait.h>
+
+#ifdef U_IORING_ENABLE
+#  include <stddef.h>
+#  include <sys/prctl.h>
+#  include <sys/syscall.h>
+#  include <linux/filter.h>
+#  include <linux/seccomp.h>
+#endif
+
+static int nread;
+static const char* backend;
+
+class handlerPipe : public UEventFd {
+public:
+
+   handlerPipe(int _fd)
+      {
+      fd = _fd;
+      }
+
+   ~handlerPipe()
+      {
+      }
+
+   int handlerRead()
+      {
+      U_TRACE_NO_PARAM(5, "handlerPipe::handlerRead()")
+
+      char buffer[64];
+
+      int bytes_read = U_SYSCALL(read, "%d,%p,%u", fd, buffer, sizeof(buffer));
+
+      if (bytes_read <= 0) U_RETURN(U_NOTIFIER_DELETE);
+
+      ++nread;
+
+      printf("%s: read %.*s\n", backend, bytes_read, buffer);
+
+      // NB: with the last message we ask to delete the handler, the request of the ring must be cancelled...
+
+      if (buffer[0] == 'Q') U_RETURN(U_NOTIFIER_DELETE);
+
+      U_RETURN(U_NOTIFIER_OK);
+      }
+
+   void handlerDelete()
+      {
+      U_TRACE_NO_PARAM(5, "handlerPipe::handlerDelete()")
+
+      printf("%s: delete handler\n", backend);
+
+      delete this;
+      }
+};
+
+static void send(int fd, const char* msg)
+{
+   U_TRACE(5, "send(%d,%S)", fd, msg)
+
+   (void) U_SYSCALL(write, "%d,%p,%u", fd, msg, u__strlen(msg, __PRETTY_FUNCTION__));
+}
+
+static void dispatch(int expected)
+{
+   U_TRACE(5, "dispatch(%d)", expected)
+
+   UEventTime timeout(0L, 100000L);
+
+   for (int i = 0; i < 10 && nread < expected; ++i) UNotifier::waitForEvent(&timeout);
+
+   U_INTERNAL_ASSERT_EQUALS(nread, expected)
+}
+
+// the requests of the ring (or the registrations of epoll) queued by insert() are submitted with the wait for events,
+// and every completion is dispatched to the handler; after the dispatch the request is rearmed (see UIORing::update())
+
+static void check()
+{
+   U_TRACE_NO_PARAM(5, "check()")
+
+   int fds[2];
+
+   (void) U_SYSCALL(pipe, "%p", fds);
+
+   UNotifier::init();
+
+   handlerPipe* handler;
+
+   U_NEW_WITHOUT_CHECK_MEMORY(handlerPipe, handler, handlerPipe(fds[0]));
+
+   UNotifier::insert(handler);
+
+   nread = 0;
+
+   send(fds[1], "hello");
+   dispatch(1);
+
+   send(fds[1], "world");
+   dispatch(2);
+
+   send(fds[1], "Quit");
+   dispatch(3);
+
+   U_ASSERT(UNotifier::empty())
+
+   // NB: the handler is deleted, the completion of the request cancelled must not be dispatched...
+
+   send(fds[1], "lost");
+   dispatch(3);
+
+   (void) U_SYSCALL(close, "%d", fds[0]);
+   (void) U_SYSCALL(close, "%d", fds[1]);
+
+   fflush(stdout);
+}
+
+#ifdef U_IORING_ENABLE
+// the kernel without io_uring: io_uring_setup() fails with ENOSYS (seccomp filter), so we must fall back to epoll
+
+static bool disableIORing()
+{
+   U_TRACE_NO_PARAM(5, "disableIORing()")
+
+   struct sock_filter filter[] = {
+      BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, offsetof(struct seccomp_data, nr)),
+      BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   __NR_io_uring_setup, 0, 1),
+      BPF_STMT(BPF_RET | BPF_K,             SECCOMP_RET_ERRNO | ENOSYS),
+      BPF_STMT(BPF_RET | BPF_K,             SECCOMP_RET_ALLOW)
+   };
+
+   struct sock_fprog prog = { (unsigned short)U_NUM_ELEMENTS(filter), filter };
+
+   if (U_SYSCALL(prctl, "%d,%lu,%lu,%lu,%lu", PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0)                     == 0 &&
+       U_SYSCALL(prctl, "%d,%lu,%p,%lu,%lu",  PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0) == 0)
+      {
+      U_RETURN(true);
+      }
+
+   U_RETURN(false);
+}
+#endif
+
+int U_EXPORT main(int argc, char* argv[])
+{
+   U_ULIB_INIT(argv);
+
+   U_TRACE(5, "main(%d)", argc)
+
+   UNotifier::max_connection = 64;
+
+   // NB: the fallback is checked first in a child, before that the notifier of the parent is initialized...
+
+   fflush(stdout);
+
+   pid_t pid = U_SYSCALL_NO_PARAM(fork);
+
+   if (pid == 0)
+      {
+      backend = "fallback";
+
+#  ifdef U_IORING_ENABLE
+      UNotifier::bioring = true;
+
+      if (disableIORing() == false) U_ERROR("Sorry, I can't install the seccomp filter");
+#  endif
+
+      check();
+
+      U_INTERNAL_ASSERT_EQUALS(UNotifier::bioring, false)
+
+      exit(0);
+      }
+
+   int status;
+
+   (void) U_SYSCALL(waitpid, "%d,%p,%d", pid, &status, 0);
+
+   if (WIFEXITED(status) == false ||
+       WEXITSTATUS(status) != 0)
+      {
+      U_ERROR("The check of the fallback to epoll has failed");
+      }
+
+#ifdef U_IORING_ENABLE
+   UNotifier::bioring = true; // NB: if the kernel is without the features that we need we fall back to epoll...
+#endif
+
+   backend = "io_uring";
+
+   check();
+}
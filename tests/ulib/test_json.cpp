@@ -1,6 +1,8 @@
 // test_json.cpp
 
 #include <ulib/file.h>
+#include <ulib/json/codec.h>
+#include <ulib/json/reader.h>
 #include <ulib/debug/crono.h>
 
 #include "json_obj.h"
@@ -109,6 +111,404 @@ static void testVector()
    U_ASSERT_EQUALS( result, vecJson )
 }
 
+class Child {
+public:
+   UString name;
+   double weight;
+   bool active;
+
+   Child() : weight(0), active(false) {}
+
+   template <class V> void visitJSON(V& v)
+      {
+      U_JSON_FIELD(v, name);
+      U_JSON_FIELD(v, weight);
+      U_JSON_FIELD(v, active);
+      }
+
+#ifdef DEBUG
+   const char* dump(bool reset) const { return ""; }
+#endif
+};
+
+class Person {
+public:
+   int age;
+   UString lastName;
+   UVector<UString> tags;
+   UVector<Child*> children;
+
+   Person() : age(0) {}
+
+   template <class V> void visitJSON(V& v)
+      {
+      U_JSON_FIELD(v, age);
+      U_JSON_FIELD(v, lastName);
+      U_JSON_FIELD(v, tags);
+      U_JSON_FIELD(v, children);
+      }
+};
+
+class Limits {
+public:
+   int i;
+   short sh;
+   unsigned int u;
+   long long ll;
+   unsigned long long ull;
+
+   Limits() : i(0), sh(0), u(0), ll(0), ull(0) {}
+
+   template <class V> void visitJSON(V& v)
+      {
+      U_JSON_FIELD(v, i);
+      U_JSON_FIELD(v, sh);
+      U_JSON_FIELD(v, u);
+      U_JSON_FIELD(v, ll);
+      U_JSON_FIELD(v, ull);
+      }
+};
+
+static void testCodec()
+{
+   U_TRACE_NO_PARAM(5, "testCodec()")
+
+   // NB: the strings without escape are substrings of the document, so the documents must outlive the objects...
+
+   UString result, result1,
+           personJson = U_STRING_FROM_CONSTANT("{ \"unknown\": {\"a\":[1,{\"b\":\"}\"}]}, \"age\": -42, \"lastName\": \"Ro\\\"ss\\u0041\","
+                                               " \"tags\": [\"a\",\"b\\n\"], \"children\": [ {\"name\":\"c1\",\"weight\":1.5,\"active\":true}, {\"weight\":2e3} ] }");
+   Person p, q;
+
+   bool ok = JSON_decode(personJson, p);
+
+   U_INTERNAL_ASSERT(ok)
+   U_INTERNAL_ASSERT_EQUALS(p.age, -42)
+   U_INTERNAL_ASSERT_EQUALS(p.lastName, "Ro\"ssA")
+   U_INTERNAL_ASSERT_EQUALS(p.tags[1], "b\n")
+   U_INTERNAL_ASSERT_EQUALS(p.children.size(), 2)
+   U_INTERNAL_ASSERT_EQUALS(p.children[1]->weight, 2000.0)
+
+   JSON_encode(result, p);
+
+   U_ASSERT_EQUALS(result, "{\"age\":-42,\"lastName\":\"Ro\\\"ssA\",\"tags\":[\"a\",\"b\\n\"],\"children\":[{\"name\":\"c1\",\"weight\":1.5,\"active\":true},"
+                           "{\"name\":\"\",\"weight\":2000.0,\"active\":false}]}")
+
+   ok = JSON_decode(result, q);
+
+   U_INTERNAL_ASSERT(ok)
+
+   JSON_encode(result1, q);
+
+   U_ASSERT_EQUALS(result, result1)
+
+   ok = JSON_decode(U_STRING_FROM_CONSTANT("{\"age\":\"x\"}"), q);
+   U_INTERNAL_ASSERT_EQUALS(ok, false)
+   ok = JSON_decode(U_STRING_FROM_CONSTANT("{\"age\":1"), q);
+   U_INTERNAL_ASSERT_EQUALS(ok, false)
+   ok = JSON_decode(U_STRING_FROM_CONSTANT("{\"age\":1} x"), q);
+   U_INTERNAL_ASSERT_EQUALS(ok, false)
+
+   // NB: a number out of the range of the type of the field is an error...
+
+   static const struct { const char* json; bool ok; } limits[] = {
+      { "{\"i\":2147483647}",             true },
+      { "{\"i\":2147483648}",             false },
+      { "{\"i\":-2147483648}",            true },
+      { "{\"i\":-2147483649}",            false },
+      { "{\"i\":-2.5}",                   true },
+      { "{\"i\":1e10}",                   false },
+      { "{\"i\":-3e9}",                   false },
+      { "{\"sh\":32767}",                 true },
+      { "{\"sh\":40000}",                 false },
+      { "{\"u\":4294967295}",             true },
+      { "{\"u\":4294967296}",             false },
+      { "{\"u\":-1}",                     false },
+      { "{\"u\":-0.5}",                   false },
+      { "{\"ll\":9223372036854775807}",   true },
+      { "{\"ll\":9223372036854775808}",   false },
+      { "{\"ll\":-9223372036854775808}",  true },
+      { "{\"ll\":-9223372036854775809}",  false },
+      { "{\"ll\":9.3e18}",                false },
+      { "{\"ull\":18446744073709551615}", true },
+      { "{\"ull\":18446744073709551616}", false },
+      { "{\"ull\":99999999999999999999}", false },
+      { "{\"ull\":1e20}",                 false } };
+
+   for (uint32_t i = 0; i < U_NUM_ELEMENTS(limits); ++i)
+      {
+      Limits l;
+
+      ok = JSON_decode(UString(limits[i].json, u__strlen(limits[i].json, __PRETTY_FUNCTION__)), l);
+
+      U_INTERNAL_ASSERT_EQUALS(ok, limits[i].ok)
+      }
+
+   Limits l;
+
+   ok = JSON_decode(U_STRING_FROM_CONSTANT("{\"i\":-2.5,\"ll\":-9223372036854775808,\"ull\":18446744073709551615}"), l);
+
+   U_INTERNAL_ASSERT(ok)
+   U_INTERNAL_ASSERT_EQUALS(l.i, -2)
+   U_INTERNAL_ASSERT_EQUALS(l.ll, LLONG_MIN)
+   U_INTERNAL_ASSERT_EQUALS(l.ull, ULLONG_MAX)
+}
+
+// NB: a pretty-printed document (parsed with the structural index) must give the same result of the same document minified (parsed
+//     without index): the run of seven backslash (three escaped backslash and an escaped quote) cross the boundary of the first block
+//     of 64 bytes and the run of four backslash (two escaped backslash before the closing quote) cross the boundary of the second...
+
+static void testParseIndex()
+{
+   U_TRACE_NO_PARAM(5, "testParseIndex()")
+
+   UValue json1, json2;
+   UString pretty(U_CAPACITY),
+           minified = U_STRING_FROM_CONSTANT("{\"a\":\"x\\\\\\\\\\\\\\\"y\",\"b\":\"z\\\\\\\\\",\"c\":[1,2.5,true,null,{\"d\":\"e\\u0041\"}]}");
+
+   (void) pretty.append(U_CONSTANT_TO_PARAM("{\n"));
+   (void) pretty.append(51U, ' ');
+   (void) pretty.append(U_CONSTANT_TO_PARAM("\"a\": \"x\\\\\\\\\\\\\\\"y\",\n"));
+   (void) pretty.append(47U, ' ');
+   (void) pretty.append(U_CONSTANT_TO_PARAM("\"b\": \"z\\\\\\\\\",\n"
+                                            "    \"c\": [\n"
+                                            "        1,\n"
+                                            "        2.5,\n"
+                                            "        true,\n"
+                                            "        null,\n"
+                                            "        {\n"
+                                            "            \"d\": \"e\\u0041\"\n"
+                                            "        }\n"
+                                            "    ]\n"
+                                            "}\n"));
+
+   U_INTERNAL_ASSERT_MAJOR(pretty.size(), U_JSON_PARSE_INDEX_SIZE)
+   U_INTERNAL_ASSERT_EQUALS(memcmp(pretty.c_pointer(60),  U_CONSTANT_TO_PARAM("\\\\\\\\\\\\\\\"")), 0)
+   U_INTERNAL_ASSERT_EQUALS(memcmp(pretty.c_pointer(126), U_CONSTANT_TO_PARAM("\\\\\\\\\"")),         0)
+
+   bool ok = json1.parse(pretty);
+
+   U_INTERNAL_ASSERT(ok)
+
+   ok = json2.parse(minified);
+
+   U_INTERNAL_ASSERT(ok)
+
+   U_ASSERT_EQUALS(json1.output(), json2.output())
+   U_ASSERT_EQUALS(json1.at(U_CONSTANT_TO_PARAM("a"))->getString(), "x\\\\\\\"y")
+   U_ASSERT_EQUALS(json1.at(U_CONSTANT_TO_PARAM("b"))->getString(), "z\\\\")
+}
+
+// NB: a nesting deeper than U_JSON_PARSE_STACK_SIZE grows the stack of the parser (thread local) that must be released by clearParser()...
+
+class UValueParser : public UValue {
+public:
+
+   static uint32_t getStackSize()               { return sd_max; }
+   static parser_stack_data* getStackPointer()  { return sd; }
+};
+
+static void testParseDepth()
+{
+   U_TRACE_NO_PARAM(5, "testParseDepth()")
+
+   UString document(U_CAPACITY);
+
+   (void) document.append(1000U, '[');
+   (void) document.append(1000U, ']');
+
+   UValue json;
+   bool ok = json.parse(document);
+
+   U_INTERNAL_ASSERT(ok)
+   U_INTERNAL_ASSERT_MAJOR(UValueParser::getStackSize(), 1000)
+
+   U_ASSERT_EQUALS(json.output(), document)
+
+   UValue::clearParser();
+
+   U_INTERNAL_ASSERT_EQUALS(UValueParser::getStackSize(), 0)
+   U_INTERNAL_ASSERT(UValueParser::getStackPointer() == U_NULLPTR)
+
+   json.clear();
+
+   ok = json.parse(document);
+
+   U_INTERNAL_ASSERT(ok)
+   U_ASSERT_EQUALS(json.output(), document)
+}
+
+// NB: the document is fed to the reader in chunk of the given size, so that the tokens are split across the chunks. The events are
+//     returned as text, if depth is not 0 the containers nested deeper than depth are skipped as the value of the key skip_key...
+
+static uint32_t max_buffer_size;
+
+static UString readJson(const char* doc, uint32_t len, uint32_t chunk, uint32_t depth = 0, const char* skip_key = U_NULLPTR)
+{
+   U_TRACE(5, "readJson(%.*S,%u,%u,%u,%S)", len, doc, len, chunk, depth, skip_key)
+
+   int event = UJsonReader::NEED_MORE;
+   UJsonReader reader;
+   UString result(U_CAPACITY);
+
+   max_buffer_size = 0;
+
+   for (uint32_t i = 0; i < len; i += chunk)
+      {
+      reader.feed(doc+i, U_min(chunk, len-i));
+
+      if ((i+chunk) >= len) reader.finish();
+
+      if (max_buffer_size < reader.getBufferSize()) max_buffer_size = reader.getBufferSize();
+
+      while ((event = reader.next()) > UJsonReader::INVALID)
+         {
+         switch (event)
+            {
+            case UJsonReader::START_OBJECT: (void) result.append(1U, '{'); break;
+            case UJsonReader::END_OBJECT:   (void) result.append(1U, '}'); break;
+            case UJsonReader::START_ARRAY:  (void) result.append(1U, '['); break;
+            case UJsonReader::END_ARRAY:    (void) result.append(1U, ']'); break;
+            case UJsonReader::TRUE_VALUE:   (void) result.append(1U, 't'); break;
+            case UJsonReader::FALSE_VALUE:  (void) result.append(1U, 'f'); break;
+            case UJsonReader::NULL_VALUE:   (void) result.append(1U, 'z'); break;
+
+            case UJsonReader::KEY:
+            case UJsonReader::STRING:
+               {
+               (void) result.append(1U, (event == UJsonReader::KEY ? 'k' : 's'));
+               (void) result.append(reader.getString());
+               (void) result.append(1U, ' ');
+               }
+            break;
+
+            case UJsonReader::NUMBER:
+               {
+               (void) result.append(1U, 'n');
+               (void) result.append(reader.getData(), reader.getLength());
+               (void) result.append(1U, ' ');
+               }
+            break;
+            }
+
+         if (depth &&
+             (event == UJsonReader::START_OBJECT ||
+              event == UJsonReader::START_ARRAY) &&
+             reader.getDepth() > depth)
+            {
+            (void) result.append(U_CONSTANT_TO_PARAM("... "));
+
+            reader.skip();
+            }
+
+         if (skip_key &&
+             event == UJsonReader::KEY &&
+             reader.getString().equal(skip_key, u__strlen(skip_key, __PRETTY_FUNCTION__)))
+            {
+            (void) result.append(U_CONSTANT_TO_PARAM("... "));
+
+            reader.skip();
+            }
+         }
+
+      if (event != UJsonReader::NEED_MORE) break;
+      }
+
+   if (event == UJsonReader::END_DOCUMENT) (void) result.append(U_CONSTANT_TO_PARAM("END"));
+   else                                    (void) result.append(U_CONSTANT_TO_PARAM("INVALID"));
+
+   U_INTERNAL_ASSERT_EQUALS(event == UJsonReader::INVALID, reader.isError())
+
+   U_RETURN_STRING(result);
+}
+
+static void testReader()
+{
+   U_TRACE_NO_PARAM(5, "testReader()")
+
+   // tokens split across the chunks
+
+   const char* doc = "{\"a\\u0041\":[1,-2.5e3,\"x\\\"y\",true,false,null],\"b\":{\"c\":{}} , \"d\" : 12345678901}";
+   uint32_t len    = u__strlen(doc, __PRETTY_FUNCTION__);
+   UString result  = readJson(doc, len, len);
+
+   U_ASSERT_EQUALS(result, "{kaA [n1 n-2.5e3 sx\"y tfz]kb {kc {}}kd n12345678901 }END")
+
+   for (uint32_t chunk = 1; chunk < len; ++chunk) U_ASSERT_EQUALS(readJson(doc, len, chunk), result)
+
+   // NB: with a chunk of one byte the buffer of the reader contains only the token not completed...
+
+   (void) readJson(doc, len, 1);
+
+   U_INTERNAL_ASSERT_MINOR(max_buffer_size, 16)
+
+   U_ASSERT_EQUALS(readJson(U_CONSTANT_TO_PARAM("42"), 1),         "n42 END")
+   U_ASSERT_EQUALS(readJson(U_CONSTANT_TO_PARAM(" \"s\"  "), 1),   "ss END")
+   U_ASSERT_EQUALS(readJson(U_CONSTANT_TO_PARAM("[] trailing"), 1), "[]END")
+
+   // skipping the nested values (NB: the brackets and the escaped quote inside the strings of the subtree must not be counted...)
+
+   doc = "{\"skip\":{\"x\":[1,{\"y\":\"}]\\\"[\"}],\"z\":\"\\\\\"},\"keep\":1,\"arr\":[[1,[2]],{\"w\":[3]},4],\"skip\":\"v\",\"last\":[]}";
+   len = u__strlen(doc, __PRETTY_FUNCTION__);
+
+   for (uint32_t chunk = 1; chunk <= len; ++chunk)
+      {
+      U_ASSERT_EQUALS(readJson(doc, len, chunk, 0, "skip"), "{kskip ... kkeep n1 karr [[n1 [n2 ]]{kw [n3 ]}n4 ]kskip ... klast []}END")
+      U_ASSERT_EQUALS(readJson(doc, len, chunk, 2, "skip"), "{kskip ... kkeep n1 karr [[... {... n4 ]kskip ... klast []}END")
+      }
+
+   // malformed input
+
+   static const char* malformed[] = {
+      "",
+      "{",
+      "[1,2",
+      "\"abc",
+      "{\"a\" 1}",
+      "{\"a\":1,}",
+      "{\"a\":1]",
+      "{1:2}",
+      "[1,]",
+      "[1 2]",
+      "[01]",
+      "[1.]",
+      "[-]",
+      "[1e]",
+      "[tru]",
+      "[nul",
+      "[\"\\x\"]",
+      "[\"\\u12g4\"]",
+      "[\"a\nb\"]",
+      "}",
+      "{\"skip\":[1,\"]\"" };
+
+   for (uint32_t i = 0; i < U_NUM_ELEMENTS(malformed); ++i)
+      {
+      doc = malformed[i];
+      len = u__strlen(doc, __PRETTY_FUNCTION__);
+
+      if (len == 0)
+         {
+         UJsonReader reader;
+
+         reader.finish();
+
+         U_INTERNAL_ASSERT_EQUALS(reader.next(), UJsonReader::INVALID)
+         U_INTERNAL_ASSERT_EQUALS(reader.next(), UJsonReader::INVALID)
+         U_INTERNAL_ASSERT(reader.isError())
+
+         continue;
+         }
+
+      for (uint32_t chunk = 1; chunk <= len; ++chunk)
+         {
+         result = readJson(doc, len, chunk, 0, "skip");
+
+         U_INTERNAL_ASSERT_DIFFERS(result.find("INVALID", 0, U_CONSTANT_SIZE("INVALID")), U_NOT_FOUND)
+         }
+      }
+}
+
 // Do a query and print the results
 
 static void testQuery(const UString& json, const char* cquery, const UString& expected)
@@ -180,6 +580,10 @@ U_EXPORT main (int argc, char* argv[], char* env[])
 
    testMap();
    testVector();
+   testCodec();
+   testParseIndex();
+   testParseDepth();
+   testReader();
 
    Request().testJSON();
    Response().testJSON();
@@ -2,6 +2,98 @@
 
 #include <ulib/net/server/server.h>
 
+// the writers are processes that share the log (as the preforked children of the server), the log is rotated by the writer
+// whose record go over the end and the gzip compression of the data is done by the parent process, as the thread of the
+// server (see ULogRotateThread). Without the parent (bdrain == false) the writer that wrap the log compress by itself...
+
+static uint32_t getCpuTime() // usec
+{
+   struct timespec ts;
+
+   (void) clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+   return (ts.tv_sec * 1000000U) + (ts.tv_nsec / 1000U);
+}
+
+static void writers(uint32_t nwriter, uint32_t n, uint32_t size, bool bdrain, bool bprint)
+{
+   U_TRACE(5, "::writers(%u,%u,%u,%b,%b)", nwriter, n, size, bdrain, bprint)
+
+   ULog y(U_STRING_FROM_CONSTANT("$PWD/tmp/test_log_writers.log"), size);
+
+#ifdef USE_LIBZ
+   y.setLogRotate("tmp");
+   y.setShared(U_NULLPTR);
+#endif
+
+   int fds[2];
+   uint32_t i, w, start, latency, worst = 0;
+   struct timespec ts = { 0L, 1000L * 1000L };
+
+   y.setPrefix(U_CONSTANT_TO_PARAM(U_SERVER_LOG_PREFIX));
+
+   (void) U_SYSCALL(pipe, "%p", fds);
+
+   for (w = 0; w < nwriter; ++w)
+      {
+      if (U_SYSCALL_NO_PARAM(fork) == 0)
+         {
+         uint32_t max = 0;
+
+         // NB: we measure the cpu time of the write, so the time that the writer is not running (1 CPU, 8 writers) don't count...
+
+         for (i = 0; i < n; ++i)
+            {
+            start = getCpuTime();
+
+            y.log(U_CONSTANT_TO_PARAM("writer %2u message %6u"), w, i);
+
+            if ((latency = getCpuTime() - start) > max) max = latency;
+
+            if (bprint && (i % 10) == 0) (void) U_SYSCALL(nanosleep, "%p,%p", &ts, U_NULLPTR); // NB: as the writers of the server, that do something else between two records...
+            }
+
+         latency = max;
+
+         (void) U_SYSCALL(write, "%d,%p,%u", fds[1], &latency, sizeof(uint32_t));
+
+         ::_exit(0); // NB: the log must not be closed by the writer...
+         }
+      }
+
+   (void) U_SYSCALL(close, "%d", fds[1]);
+
+   for (w = 0; w < nwriter; )
+      {
+      if (UNotifier::waitForRead(fds[0], 100) == 1) // NB: 100ms as ULogRotateThread...
+         {
+         if (U_SYSCALL(read, "%d,%p,%u", fds[0], &latency, sizeof(uint32_t)) != sizeof(uint32_t)) break; // NB: a writer is died...
+
+         if (latency > worst) worst = latency;
+
+         ++w;
+         }
+#  ifdef USE_LIBZ
+      else if (bdrain)
+         {
+         y.checkForLogRotateDataToWrite();
+         }
+#  endif
+      }
+
+   U_INTERNAL_ASSERT_EQUALS(w, nwriter)
+
+   (void) U_SYSCALL(close, "%d", fds[0]);
+
+   if (bprint) printf("writers %u records %6u compression %s: worst cpu time of a write %6u usec\n", nwriter, n, (bdrain ? "by the parent " : "by the writers"), worst);
+
+   y.closeLog();
+
+#ifdef USE_LIBZ
+   UFile::shm_unlink("/test_log_writers.log");
+#endif
+}
+
 int
 U_EXPORT main (int argc, char* argv[], char* env[])
 {
@@ -12,6 +104,24 @@ U_EXPORT main (int argc, char* argv[], char* env[])
    u_init_ulib_hostname();
    u_init_ulib_username();
 
+   uint32_t i, n = (argc > 1 ? u_atoi(argv[1]) : 10);
+
+   if (argc > 2)
+      {
+      if (argc == 3) writers(u_atoi(argv[2]), n, 64 * 1024, true, false);
+      else
+         {
+         // benchmark (ex: test_log 20000 8 bench): the log of 1M is rotated some time by second...
+
+         writers(u_atoi(argv[2]), n, 1024 * 1024, true,  true);
+         writers(u_atoi(argv[2]), n, 1024 * 1024, false, true);
+         }
+
+      cout << "ok" << '\n';
+
+      return 0;
+      }
+
    ULog y(U_STRING_FROM_CONSTANT("$PWD/test_log.log"), 1024);
 
 #ifdef USE_LIBZ
@@ -20,8 +130,6 @@ U_EXPORT main (int argc, char* argv[], char* env[])
 
    y.setPrefix(U_CONSTANT_TO_PARAM(U_SERVER_LOG_PREFIX));
 
-   uint32_t i, n = (argc > 1 ? u_atoi(argv[1]) : 10);
-
    for (i = 0; i < n; ++i)
       {
       y.log(U_CONSTANT_TO_PARAM("message %6d - %H %U %w"), i+1);
@@ -169,6 +169,176 @@ static void check_size()
    U_ASSERT( U_SIZE_TO_STACK_INDEX(U_STACK_TYPE_9 - 0) ==  9 )
 }
 
+static void check_arena()
+{
+   U_TRACE_NO_PARAM(5, "check_arena()")
+
+   UMemoryArena::init(PAGESIZE);
+
+   UMemoryArena::enter();
+
+   U_ASSERT(UMemoryArena::isScope())
+
+   UString* leak = U_NULLPTR;
+
+   U_NEW_STRING(leak, UString(100U));
+
+   U_ASSERT(UMemoryArena::contains(leak->rep))
+
+   UMemoryArena::leave();
+
+   // NB: one object of the arena is still alive, the rewind is postponed and the arena must stop to grow at the cap...
+
+   for (int i = 0; i < (U_ARENA_MAX_CHUNK * 2); ++i)
+      {
+      UMemoryArena::enter();
+
+      if (UMemoryArena::isScope() == false) break;
+
+      for (int j = 0; j < 32 && UMemoryArena::isScope(); ++j)
+         {
+         UString tmp(200U);
+
+         (void) tmp.append(U_CONSTANT_TO_PARAM("arena"));
+         }
+
+      UMemoryArena::reset();
+      }
+
+   UMemoryArena::enter();
+
+   U_ASSERT_EQUALS(UMemoryArena::isScope(), false)
+
+   UString out(100U); // NB: over the cap the objects come from the pool...
+
+   U_ASSERT_EQUALS(UMemoryArena::contains(out.rep), false)
+
+   U_DELETE(leak)
+
+   UMemoryArena::reset();
+   UMemoryArena::enter();
+
+   U_ASSERT(UMemoryArena::isScope())
+
+   UMemoryArena::leave();
+   UMemoryArena::clear();
+}
+
+#if defined(ENABLE_MEMPOOL) && defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+#  define U_NUM_WORKER   4
+#  define U_NUM_BLOCK  100 // more than the blocks kept by a magazine, so the magazines are refilled and spilled to the stacks...
+
+static void* late;
+static pthread_key_t late_key;
+static void* vblock[U_NUM_WORKER][U_NUM_STACK_TYPE][U_NUM_BLOCK];
+
+static void freeLate(void* ptr) // NB: destructor of a key called after the one that flush the magazines of the thread...
+{
+   U_TRACE(5, "::freeLate(%p)", ptr)
+
+   UMemoryPool::push(ptr, 1);
+}
+
+static void* magazine_worker(void* arg)
+{
+   U_TRACE(5, "::magazine_worker(%p)", arg)
+
+   int n = (int)(long)arg;
+   char* ptr;
+   uint32_t sz;
+
+   for (int round = 0; round < 100; ++round)
+      {
+      for (int stack_index = 1; stack_index < U_NUM_STACK_TYPE; ++stack_index)
+         {
+         sz = UMemoryPool::U_STACK_INDEX_TO_SIZE[stack_index];
+
+         for (int k = 0; k < U_NUM_BLOCK; ++k)
+            {
+            ptr = (char*) (vblock[n][stack_index][k] = UMemoryPool::pop(stack_index));
+
+            ptr[0] = ptr[sz-1] = 'A'+n;
+            }
+
+         // NB: a block given to two threads at the same time is overwritten by the other one...
+
+         for (int k = 0; k < U_NUM_BLOCK; ++k)
+            {
+            ptr = (char*)vblock[n][stack_index][k];
+
+            U_INTERNAL_ASSERT_EQUALS(ptr[0],    'A'+n)
+            U_INTERNAL_ASSERT_EQUALS(ptr[sz-1], 'A'+n)
+            }
+
+         if (round < 99) // NB: the blocks of the last round are freed by the main thread...
+            {
+            for (int k = 0; k < U_NUM_BLOCK; ++k) UMemoryPool::push(vblock[n][stack_index][k], stack_index);
+            }
+         }
+      }
+
+   return U_NULLPTR;
+}
+
+static void* late_worker(void* arg)
+{
+   U_TRACE(5, "::late_worker(%p)", arg)
+
+   late = UMemoryPool::pop(1);
+
+   (void) pthread_setspecific(late_key, late);
+
+   return U_NULLPTR;
+}
+
+static void check_magazine()
+{
+   U_TRACE_NO_PARAM(5, "check_magazine()")
+
+   pthread_t tid[U_NUM_WORKER];
+
+   UMemoryPool::bthread = true; // NB: like UThread::start()...
+
+   UMemoryPool::push(UMemoryPool::pop(1), 1); // NB: create the key of the magazines before our key...
+
+   (void) pthread_key_create(&late_key, freeLate);
+
+   for (long n = 0; n < U_NUM_WORKER; ++n) (void) pthread_create(tid+n, U_NULLPTR, magazine_worker, (void*)n);
+   for (long n = 0; n < U_NUM_WORKER; ++n) (void) pthread_join(tid[n], U_NULLPTR);
+
+   // NB: the block freed after the flush of the magazines of the thread must be back on its stack (and not lost in the magazine of a dead thread)...
+
+   (void) pthread_create(tid, U_NULLPTR, late_worker, U_NULLPTR);
+   (void) pthread_join(  tid[0],                    U_NULLPTR);
+
+   bool found = false;
+   void* vptr[U_NUM_WORKER * U_NUM_BLOCK];
+
+   for (int k = 0; k < (U_NUM_WORKER * U_NUM_BLOCK); ++k)
+      {
+      vptr[k] = UMemoryPool::pop(1);
+
+      if (vptr[k] == late) found = true;
+      }
+
+   for (int k = 0; k < (U_NUM_WORKER * U_NUM_BLOCK); ++k) UMemoryPool::push(vptr[k], 1);
+
+   U_ASSERT(found)
+
+   // NB: the blocks allocated by the workers are freed by another thread...
+
+   for (int n = 0; n < U_NUM_WORKER; ++n)
+      {
+      for (int stack_index = 1; stack_index < U_NUM_STACK_TYPE; ++stack_index)
+         {
+         for (int k = 0; k < U_NUM_BLOCK; ++k) UMemoryPool::push(vblock[n][stack_index][k], stack_index);
+         }
+      }
+
+   (void) pthread_key_delete(late_key);
+}
+#endif
+
 static struct itimerval timeval = { { 0, 2000 }, { 0, 2000 } };
 
 static RETSIGTYPE
@@ -201,6 +371,7 @@ U_EXPORT main(int argc, char** argv)
       }
 
    check_size();
+   check_arena();
 
 #  define U_NUM_ENTRY_MEM_BLOCK 32
 
@@ -238,6 +409,10 @@ U_EXPORT main(int argc, char** argv)
 
    if (argc > 2) printf("Time Consumed with U_NUM_ENTRY_MEM_BLOCK(%d) = %ld ms\n", n, crono.getTimeElapsed());
 
+#if defined(ENABLE_MEMPOOL) && defined(ENABLE_THREAD) && !defined(_MSWINDOWS_)
+   check_magazine();
+#endif
+
 #ifdef DEBUG
    UMemoryPool::printInfo(cout);
 #endif
@@ -1,5 +1,6 @@
 // test_rdb.cpp
 
+#include <ulib/timeval.h>
 #include <ulib/db/rdb.h>
 
 static int print(UStringRep* key, UStringRep* data)
@@ -54,6 +55,230 @@ static void transaction(URDB& rdb)
       }
 }
 
+// a journal (or a frozen journal) of another format with records is refused, without records it is initialized again
+
+static void setHeader(const UString& path, uint32_t offset, uint32_t value)
+{
+   U_TRACE(5, "::setHeader(%V,%u,%u)", path.rep, offset, value)
+
+   int fd = UFile::open(path.data(), O_RDWR, PERM_FILE);
+
+   U_ASSERT( fd != -1 )
+
+   bool result = UFile::pwrite(fd, &value, sizeof(uint32_t), offset);
+
+   U_ASSERT( result )
+
+   UFile::close(fd);
+}
+
+static void version(const UString& name)
+{
+   U_TRACE(5, "::version(%V)", name.rep)
+
+   URDB y(false);
+   UString jnl = name + U_STRING_FROM_CONSTANT(".jnl"),
+           old = name + U_STRING_FROM_CONSTANT(".jnl.old");
+
+   // NB: the header of the journal start with off, sync, nrecord, reference and version (in the format 1 here start the hash table)...
+
+   if (y.open(name, 1024 * 1024, true))
+      {
+      (void) y.store(U_STRING_FROM_CONSTANT("key"), U_STRING_FROM_CONSTANT("data"), RDB_INSERT);
+
+      y.close();
+
+      setHeader(jnl, 16, 3092);
+
+      U_ASSERT( y.open(name, 1024 * 1024) == false )
+
+      setHeader(jnl, 8, 0);
+
+      U_ASSERT( y.open(name, 1024 * 1024) )
+      U_ASSERT( y.size() == 0 )
+      U_ASSERT( y[U_STRING_FROM_CONSTANT("key")].empty() )
+
+      (void) y.store(U_STRING_FROM_CONSTANT("key"), U_STRING_FROM_CONSTANT("data"), RDB_INSERT);
+
+      U_ASSERT( y[U_STRING_FROM_CONSTANT("key")] == U_STRING_FROM_CONSTANT("data") )
+
+      y.close();
+
+      bool result = UFile::writeTo(old, UString(4096U, '\0'), O_RDWR | O_CREAT | O_TRUNC);
+
+      U_ASSERT( result )
+      U_ASSERT( y.open(name, 1024 * 1024) == false )
+
+      (void) UFile::_unlink(old.data());
+
+      U_ASSERT( y.open(name, 1024 * 1024) )
+      U_ASSERT( y[U_STRING_FROM_CONSTANT("key")] == U_STRING_FROM_CONSTANT("data") )
+
+      y.close();
+      }
+}
+
+// the writes go on while the new cdb is built in background from the old cdb and the frozen journal
+
+static void background(const UString& name, uint32_t num)
+{
+   U_TRACE(5, "::background(%V,%u)", name.rep, num)
+
+   int ret;
+   URDB y(false);
+   char key[32], _data[32];
+   uint32_t i, klen, dlen;
+
+   if (y.open(name, 1024 * 1024, true))
+      {
+      for (i = 0; i < num; ++i)
+         {
+         klen = u__snprintf(key,   sizeof(key),   U_CONSTANT_TO_PARAM("key_%u"),  i);
+         dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("data_%u"), i);
+
+         (void) y.store(key, klen, UString(_data, dlen), RDB_INSERT);
+         }
+
+      bool result = y.startReorganize();
+
+      U_ASSERT( result )
+      U_ASSERT( y.isReorganizing() )
+
+      U_ASSERT_EQUALS( y.size(), num )
+
+      // NB: the key odd are replaced, the key multiple of 3 are removed and we add new keys...
+
+      for (i = 0; i < num; ++i)
+         {
+         klen = u__snprintf(key, sizeof(key), U_CONSTANT_TO_PARAM("key_%u"), i);
+
+         if ((i % 3) == 0)
+            {
+            ret = y.remove(key, klen);
+
+            U_ASSERT_EQUALS( ret, 0 )
+            }
+         else if (i & 1)
+            {
+            dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("new_%u"), i);
+
+            ret = y.store(key, klen, UString(_data, dlen), RDB_INSERT);
+
+            U_ASSERT_EQUALS( ret, -1 )
+
+            ret = y.store(key, klen, UString(_data, dlen), RDB_REPLACE);
+
+            U_ASSERT_EQUALS( ret, 0 )
+            }
+
+         klen = u__snprintf(key,   sizeof(key),   U_CONSTANT_TO_PARAM("add_%u"), i);
+         dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("data_%u"), i);
+
+         ret = y.store(key, klen, UString(_data, dlen), RDB_INSERT);
+
+         U_ASSERT_EQUALS( ret, 0 )
+         }
+
+      y.close();
+
+      U_ASSERT( y.isReorganizing() == false )
+      }
+
+   if (y.open(name, 1024 * 1024))
+      {
+      for (i = 0; i < num; ++i)
+         {
+         klen = u__snprintf(key, sizeof(key), U_CONSTANT_TO_PARAM("key_%u"), i);
+
+         UString value = y.at(key, klen);
+
+         if ((i % 3) == 0)
+            {
+            U_ASSERT( value.empty() )
+            }
+         else if (i & 1)
+            {
+            dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("new_%u"), i);
+
+            U_ASSERT( value == UString(_data, dlen) )
+            }
+         else
+            {
+            dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("data_%u"), i);
+
+            U_ASSERT( value == UString(_data, dlen) )
+            }
+
+         klen = u__snprintf(key,   sizeof(key),   U_CONSTANT_TO_PARAM("add_%u"), i);
+         dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("data_%u"), i);
+
+         value = y.at(key, klen);
+
+         U_ASSERT( value == UString(_data, dlen) )
+         }
+
+      bool result = y.closeReorganize();
+
+      U_ASSERT( result )
+      }
+}
+
+// the hash table of the journal grows with the number of record so the time of lookup don't depend on it
+
+static void benchmark(const UString& name, uint32_t num, bool bprint)
+{
+   U_TRACE(5, "::benchmark(%V,%u,%b)", name.rep, num, bprint)
+
+   URDB y(false);
+
+   if (y.open(name, 1024 * 1024, true)) // NB: we have only the journal (HTTP session, SSL session, ...)
+      {
+      UTimeVal crono;
+      char key[32], _data[32];
+      uint32_t i, j, k, klen, dlen = 0, n = 0;
+
+      for (uint32_t step = 1000; step <= num; step *= 10)
+         {
+         for (; n < step; ++n)
+            {
+            klen = u__snprintf(key,   sizeof(key),   U_CONSTANT_TO_PARAM("session_%u"), n);
+            dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("data_%u"),    n);
+
+            (void) y.store(key, klen, UString(_data, dlen), RDB_INSERT);
+            }
+
+         crono.start();
+
+         for (i = j = 0; i < 100000; ++i)
+            {
+            k    = (i * 7919) % n;
+            klen = u__snprintf(key, sizeof(key), U_CONSTANT_TO_PARAM("session_%u"), k);
+
+            if (y.find(key, klen)) ++j;
+            }
+
+         crono.stop();
+
+         U_ASSERT_EQUALS( j, 100000 )
+         U_ASSERT_EQUALS( y.size(), n )
+
+         if (bprint) printf("records %7u lookup %4.0f ns\n", n, crono.getTimeElapsed() * 10.);
+         }
+
+      // NB: with num < 1000 no record is stored...
+
+      if (n)
+         {
+         klen = u__snprintf(key,   sizeof(key),   U_CONSTANT_TO_PARAM("session_%u"), n-1);
+         dlen = u__snprintf(_data, sizeof(_data), U_CONSTANT_TO_PARAM("data_%u"),    n-1);
+
+         U_ASSERT( y.at(key, klen) == UString(_data, dlen) )
+         }
+
+      y.close();
+      }
+}
+
 int
 U_EXPORT main(int argc, char* argv[], char* env[])
 {
@@ -240,4 +465,10 @@ U_EXPORT main(int argc, char* argv[], char* env[])
          x.close();
          }
       }
+
+   version(name + U_STRING_FROM_CONSTANT(".ver"));
+
+   background(name + U_STRING_FROM_CONSTANT(".bg"), 10000);
+
+   benchmark(name + U_STRING_FROM_CONSTANT(".bench"), (argc > 3 ? u_atoi(argv[3]) : 10000), (argc > 3));
 }
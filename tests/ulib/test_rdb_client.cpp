@@ -52,6 +52,164 @@ static void transaction(URDBClient<UTCPSocket>& rdb)
       }
 }
 
+static void batch(URDBClient<UTCPSocket>& rdb)
+{
+   U_TRACE(5, "::batch(%p)", &rdb)
+
+   uint32_t i;
+   int vresult[3];
+   static int vresult_max[U_RDB_BATCH_MAX + 1];
+   UVector<UString> vkey, vkey_data, vdata, vkey_max(U_RDB_BATCH_MAX + 1);
+
+   vkey.push_back(U_STRING_FROM_CONSTANT("batch0"));
+   vkey.push_back(U_STRING_FROM_CONSTANT("batch1"));
+   vkey.push_back(U_STRING_FROM_CONSTANT("batch2"));
+
+   vkey_data.push_back(vkey[0]);
+   vkey_data.push_back(U_STRING_FROM_CONSTANT("data0"));
+   vkey_data.push_back(vkey[1]);
+   vkey_data.push_back(UString::getStringNull()); // NB: a key with empty data...
+
+   U_ASSERT( rdb.store(vkey_data, RDB_INSERT, vresult) == 2 )
+   U_ASSERT( vresult[0] == 0 && vresult[1] == 0 )
+
+   U_ASSERT( rdb.store(vkey_data, RDB_INSERT, vresult) == 0 )
+   U_ASSERT( vresult[0] == -1 && vresult[1] == -1 )
+
+   U_ASSERT( rdb.find(vkey, vdata) == 2 )
+   U_ASSERT( vdata.size() == 3 )
+   U_ASSERT( vdata[0] == U_STRING_FROM_CONSTANT("data0") )
+   U_ASSERT( vdata[1].empty() )
+   U_ASSERT( vdata[2].empty() )
+
+   U_ASSERT( rdb.remove(vkey, vresult) == 2 )
+   U_ASSERT( vresult[0] == 0 && vresult[1] == 0 && vresult[2] == -1 )
+
+   vdata.clear();
+
+   U_ASSERT( rdb.find(vkey, vdata) == 0 )
+   U_ASSERT( vdata.size() == 3 )
+
+   // NB: a batch bigger than U_RDB_BATCH_MAX is split in chunks by the client...
+
+   vkey_data.clear();
+
+   for (i = 0; i <= U_RDB_BATCH_MAX; ++i)
+      {
+      UString key(20U);
+
+      key.snprintf(U_CONSTANT_TO_PARAM("batch_max%u"), i);
+
+      vkey_max.push_back(key);
+      vkey_data.push_back(key);
+      vkey_data.push_back(key);
+      }
+
+   U_ASSERT( rdb.store(vkey_data, RDB_INSERT, vresult_max) == U_RDB_BATCH_MAX + 1 )
+
+   for (i = 0; i <= U_RDB_BATCH_MAX; ++i) U_ASSERT( vresult_max[i] == 0 )
+
+   vdata.clear();
+
+   U_ASSERT( rdb.find(vkey_max, vdata) == U_RDB_BATCH_MAX + 1 )
+   U_ASSERT( vdata.size() == U_RDB_BATCH_MAX + 1 )
+   U_ASSERT( vdata[0] == vkey_max[0] )
+   U_ASSERT( vdata[U_RDB_BATCH_MAX] == vkey_max[U_RDB_BATCH_MAX] )
+
+   vdata.clear(); // NB: the data reference the response of the client...
+
+   U_ASSERT( rdb.remove(vkey_max, vresult_max) == U_RDB_BATCH_MAX + 1 )
+
+   for (i = 0; i <= U_RDB_BATCH_MAX; ++i) U_ASSERT( vresult_max[i] == 0 )
+
+   U_ASSERT( rdb.remove(vkey_max, vresult_max) == 0 )
+
+   for (i = 0; i <= U_RDB_BATCH_MAX; ++i) U_ASSERT( vresult_max[i] == -2 ) // -2: already marked deleted
+}
+
+static void pipeline(URDBClient<UTCPSocket>& rdb)
+{
+   U_TRACE(5, "::pipeline(%p)", &rdb)
+
+   int vcode[4];
+   UVector<UString> vresponse;
+   UString key  = U_STRING_FROM_CONSTANT("pipeline"),
+           data = U_STRING_FROM_CONSTANT("queued");
+
+   // NB: the requests are sent with only one write, the responses are read in the same order...
+
+   URPC::rpc_info->push_back(key);
+   URPC::rpc_info->push_back(data);
+
+   rdb.queueRequest("STR0");
+
+   URPC::rpc_info->push_back(key);
+
+   rdb.queueRequest("FIND");
+
+   URPC::rpc_info->push_back(key);
+
+   rdb.queueRequest("REMV");
+
+   URPC::rpc_info->push_back(key);
+
+   rdb.queueRequest("FIND");
+
+   U_ASSERT( rdb.getPipelineSize() == 4 )
+
+   U_ASSERT( rdb.flushPipeline(vcode, &vresponse) )
+
+   U_ASSERT( rdb.getPipelineSize() == 0 )
+
+   U_ASSERT( vcode[0] == 200 )
+   U_ASSERT( vcode[1] == 200 )
+   U_ASSERT( vcode[2] == 200 )
+   U_ASSERT( vcode[3] == 400 ) // 400: the entry was not in the database
+
+   U_ASSERT( vresponse.size() == 4 )
+   U_ASSERT( vresponse[1] == data )
+   U_ASSERT( vresponse[3].empty() )
+}
+
+static void replica(URDBClient<UTCPSocket>& rdb, const UString& host, unsigned int port)
+{
+   U_TRACE(5, "::replica(%p,%V,%u)", &rdb, host.rep, port)
+
+   URDBClient<UTCPSocket> y(U_NULLPTR);
+
+   if (y.setHostPort(host, port) && y.connect())
+      {
+      int i;
+      UString key  = U_STRING_FROM_CONSTANT("replica"),
+              data = U_STRING_FROM_CONSTANT("ok");
+
+      // NB: the replica pull the records of the primary every 100ms...
+
+      U_ASSERT( rdb.store(key, data, RDB_REPLACE) == 0 )
+
+      for (i = 0; i < 100 && y[key] != data; ++i) UTimeVal::nanosleep(100L);
+
+      U_ASSERT( y[key] == data )
+
+      // NB: the replica is read only...
+
+      U_ASSERT( y.store(key, data, RDB_REPLACE) == -3 )
+      U_ASSERT( y.remove(key) == -3 )
+
+      U_ASSERT( rdb.remove(key) == 0 )
+
+      for (i = 0; i < 100 && y[key].empty() == false; ++i) UTimeVal::nanosleep(100L);
+
+      U_ASSERT( y[key].empty() )
+
+      cout << "-------- replica ---------" << endl;
+      y.callForAllEntrySorted(print);
+      cout << "--------------------------" << endl;
+
+      y.close();
+      }
+}
+
 int
 U_EXPORT main(int argc, char* argv[], char* env[])
 {
@@ -213,13 +371,18 @@ U_EXPORT main(int argc, char* argv[], char* env[])
 
          transaction(x);
 
+         value.clear(); // NB: the value reference the buffer of the client, that is reallocated by the response of a big batch...
+
+         batch(x);
+         pipeline(x);
+
          cout << "--------------------------" << endl;
          x.callForAllEntry(print);
          cout << "-------- sorted ----------" << endl;
          x.callForAllEntrySorted(print);
          cout << "--------------------------" << endl;
 
-         value.clear();
+         if (argc > 2) replica(x, host, atoi(argv[2]));
 
          x.close();
          }
@@ -29,6 +29,19 @@ int U_EXPORT main(int argc, char* argv[], char* env[])
       y.UFile::close();
       y.UFile::reset();
 
-      if (s.open(dbname)) s.run();
+      // NB: with the port of the primary we are a replica of the database...
+
+      if (argc > 3)
+         {
+         if (s.open(dbname) &&
+             s.follow(U_STRING_FROM_CONSTANT("localhost"), atoi(argv[3])))
+            {
+            s.run();
+            }
+         }
+      else
+         {
+         if (s.open(dbname, 1024 * 1024, 1024 * 1024)) s.run();
+         }
       }
 }
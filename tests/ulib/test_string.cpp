@@ -33,6 +33,8 @@ using std::min;
 #define TEST_NOT_MEMBER
 #define TEST_OPERATIONS
 #define TEST_SUBSTR
+#define TEST_SHARED
+#define TEST_INTERN
 #define TEST_CLASS
 #define TEST_STREAM
 
@@ -1066,6 +1068,98 @@ static void test_substr_01()
 }
 #endif
 
+#ifdef TEST_SHARED
+static void test_shared_01()
+{
+   U_TRACE(5, "test_shared_01()")
+
+   UString str01(U_CONSTANT_TO_PARAM("rockaway, pacifica")), str02, str03(100U);
+
+   U_ASSERT( UString::getStringNull().isImmortal() )
+   U_ASSERT( str01.isShared() == false )
+
+   // the references are counted with atomic operations and the string is immutable...
+
+   str01.setShared();
+   str02 = str01;
+
+   U_ASSERT( str02.isShared() )
+   U_ASSERT( str02.uniq() == false )
+
+   str02.append(U_CONSTANT_TO_PARAM(" beach"));
+
+   U_ASSERT( str02.isShared() == false )
+   U_ASSERT( str01 == "rockaway, pacifica" )
+   U_ASSERT( str02 == "rockaway, pacifica beach" )
+
+   str02 = str01;
+   str02.clear();
+
+   U_ASSERT( str01.isShared() )
+   U_ASSERT( str01 == "rockaway, pacifica" )
+
+   // the rep is never freed...
+
+   (void) str03.append(U_CONSTANT_TO_PARAM("pacifica"));
+
+   str03.setImmortal();
+   str02 = str03;
+
+   U_ASSERT( str02.isImmortal() )
+   U_ASSERT( str02.reference() == U_STRINGREP_IMMORTAL )
+   U_ASSERT( str02 == "pacifica" )
+}
+#endif
+
+#ifdef TEST_INTERN
+static void test_intern_01()
+{
+   U_TRACE(5, "test_intern_01()")
+
+   UString str01(U_CONSTANT_TO_PARAM("x-requested-with")), str02, str03;
+
+   U_ASSERT( str01.isInterned() == false )
+
+   // the strings with the same content have the same rep...
+
+   str01.intern();
+   str02.setIntern(U_CONSTANT_TO_PARAM("x-requested-with"));
+
+   U_ASSERT( str01.isImmortal() )
+   U_ASSERT( str01.isInterned() )
+   U_ASSERT( str01.rep == str02.rep )
+
+   // the constant str_* are pre-populated...
+
+   str03.setIntern(U_CONSTANT_TO_PARAM("host"));
+
+   U_ASSERT( str03.rep == UString::str_host->rep )
+   U_ASSERT( UString::getIntern(U_CONSTANT_TO_PARAM("x-forwarded-for"), false) == U_NULLPTR )
+
+   // the lookup only (for the input from the network) don't add the content to the table...
+
+   UString str04;
+
+   str04.setIntern(U_CONSTANT_TO_PARAM("x-custom-header"), false);
+
+   U_ASSERT( str04 == "x-custom-header" )
+   U_ASSERT( str04.isInterned() == false )
+   U_ASSERT( UString::getIntern(U_CONSTANT_TO_PARAM("x-custom-header"), false) == U_NULLPTR )
+
+   str04.setIntern(U_CONSTANT_TO_PARAM("host"), false);
+
+   U_ASSERT( str04.rep == UString::str_host->rep )
+
+   // the method that modify the interned string work on a private copy...
+
+   (void) str02.append(U_CONSTANT_TO_PARAM("-test"));
+
+   U_ASSERT( str02.isInterned() == false )
+   U_ASSERT( str01 == "x-requested-with" )
+   U_ASSERT( str02 == "x-requested-with-test" )
+}
+#endif
+
 #if defined(TEST_CLASS) && defined(U_STD_STRING)
 // class UString
 // Do a quick sanity check on known problems with element access and
@@ -1917,6 +2011,12 @@ U_EXPORT main(int argc, char* argv[])
 #  ifdef TEST_SUBSTR
       test_substr_01();
 #  endif
+#  ifdef TEST_SHARED
+      test_shared_01();
+#  endif
+#  ifdef TEST_INTERN
+      test_intern_01();
+#  endif
 #  if defined(TEST_CLASS) && defined(U_STD_STRING)
       test_class_01();
       test_class_02();
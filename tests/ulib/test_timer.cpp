@@ -78,12 +78,127 @@ public:
 #endif
 };
 
+// the sorted list used by UTimer before the timing wheel (to compare insert and erase)
+
+class MyTimerList {
+public:
+   MyTimerList* next;
+   UEventTime* alarm;
+
+   static MyTimerList* first;
+
+   static void insert(MyTimerList* item)
+      {
+      MyTimerList** ptr = &first;
+
+      while (*ptr && (*item->alarm < *(*ptr)->alarm) == false) ptr = &(*ptr)->next;
+
+      item->next = *ptr;
+      *ptr       = item;
+      }
+
+   static void erase(UEventTime* palarm)
+      {
+      for (MyTimerList** ptr = &first; *ptr; ptr = &(*ptr)->next)
+         {
+         if ((*ptr)->alarm == palarm)
+            {
+            *ptr = (*ptr)->next;
+
+            break;
+            }
+         }
+      }
+};
+
+MyTimerList* MyTimerList::first;
+
+static long getMilliSecond(const struct timeval& start)
+{
+   struct timeval now;
+
+   u_gettimeofday(&now);
+
+   return ((now.tv_sec - start.tv_sec) * 1000L) + ((now.tv_usec - start.tv_usec) / 1000L);
+}
+
+static void benchmark(uint32_t n)
+{
+   U_TRACE(5, "benchmark(%u)", n)
+
+   UTimer::init(UTimer::NOSIGNAL);
+
+   uint32_t i;
+   struct timeval start;
+   MyAlarm1** va = (MyAlarm1**) UMemoryPool::cmalloc(n, sizeof(MyAlarm1*));
+   MyTimerList* vl = (MyTimerList*) UMemoryPool::cmalloc(n, sizeof(MyTimerList));
+
+   // NB: the timeout are random between 1 second and 1 hour like the REQ_TIMEOUT and keep-alive of many connections...
+
+   for (i = 0; i < n; ++i)
+      {
+      U_NEW(MyAlarm1, va[i], MyAlarm1(1L + (u_get_num_random() % 3600), (long)(u_get_num_random() % 1000000)));
+
+      u_gettimeofday(&(va[i]->xtime));
+
+      va[i]->xtime.tv_sec  += va[i]->tv_sec;
+      va[i]->xtime.tv_usec += va[i]->tv_usec;
+
+      vl[i].alarm = va[i];
+      }
+
+   u_gettimeofday(&start);
+
+   for (i = 0; i < n; ++i) MyTimerList::insert(vl+i);
+
+   long list_insert = getMilliSecond(start);
+
+   u_gettimeofday(&start);
+
+   for (i = 0; i < n; ++i) MyTimerList::erase(va[((uint64_t)i * 7919) % n]);
+
+   long list_erase = getMilliSecond(start);
+
+   u_gettimeofday(&start);
+
+   for (i = 0; i < n; ++i) UTimer::insert(va[i]);
+
+   long wheel_insert = getMilliSecond(start);
+
+   u_gettimeofday(&start);
+
+   for (i = 0; i < n; ++i) UTimer::erase(va[((uint64_t)i * 7919) % n]);
+
+   long wheel_erase = getMilliSecond(start);
+
+#ifdef U_STDCPP_ENABLE
+   cout << "timers " << n << '\n'
+        << "sorted list:  insert " << list_insert  << " ms erase " << list_erase  << " ms\n"
+        << "timing wheel: insert " << wheel_insert << " ms erase " << wheel_erase << " ms\n";
+#endif
+
+   UTimer::clear();
+
+   for (i = 0; i < n; ++i) U_DELETE(va[i])
+
+   UMemoryPool::_free(va, n, sizeof(MyAlarm1*));
+   UMemoryPool::_free(vl, n, sizeof(MyTimerList));
+}
+
 int U_EXPORT main (int argc, char* argv[])
 {
    U_ULIB_INIT(argv);
 
    U_TRACE(5,"main(%d)",argc)
 
+   if (argc > 1 &&
+       strcmp(argv[1], "bench") == 0)
+      {
+      benchmark(argc > 2 ? u_atoi(argv[2]) : 10000);
+
+      return 0;
+      }
+
    UTimer::init(UTimer::SYNC);
 
    UTimeVal s(0L, 50L * 1000L);